@@ -13,19 +13,155 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include "alphabet.h"
 
-int getValue(char c) {
-    if (c != '*' && c != '#' && (c < '0' || '9' < c)) return -1;
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
-    switch (c) {
-        case '*':
-            return 10;
-        case '#':
-            return 11;
-        default:
-            return c - '0';
+#if defined(__SANITIZE_ADDRESS__)
+#define NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#endif
+#endif
+#ifndef NO_SANITIZE_ADDRESS
+#define NO_SANITIZE_ADDRESS /**< Wyłącza sprawdzanie dostępów do pamięci
+                                 w funkcji, która świadomie czyta za znak
+                                 terminujący. */
+#endif
+
+/**
+ * @brief Tłumaczy znak alfabetu @p c na kodowanie wewnętrzne.
+ * @param[in] c - znak alfabetu.
+ * @return Znak w kodowaniu wewnętrznym.
+ */
+static inline char encodeChar(char c) {
+    return (char) (c + (c == '*') * (':' - '*') + (c == '#') * (';' - '#'));
+}
+
+/**
+ * @brief Sprawdza poprawność ciągu @p str i wyznacza jego długość w jednym
+ * przejściu, znak po znaku.
+ * @param[in] str - sprawdzany ciąg znaków.
+ * @param[out] plain - wskaźnik na zmienną, w której zostanie zapisane, czy
+ *                     ciąg składa się z samych cyfr.
+ * @return Długość ciągu, jeśli jest poprawny, lub zero w przeciwnym wypadku.
+ */
+static size_t scanNumberScalar(char const *str, bool *plain) {
+    size_t i = 0;
+    bool special = false;
+    int value;
+
+    for (; str[i] != '\0'; i++) {
+        if ((value = getValue(str[i])) == -1) return 0;
+        special |= value >= 10;
+    }
+
+    *plain = !special;
+    return i;
+}
+
+/**
+ * @brief Sprawdza poprawność ciągu @p str i wyznacza jego długość w jednym
+ * przejściu.
+ * Na procesorach z SSE2 ciąg przeglądany jest blokami po 16 znaków. Bloki
+ * wczytywane są spod adresów wyrównanych do 16 bajtów, więc nie przekraczają
+ * granicy strony pamięci, nawet jeśli sięgają za znak terminujący.
+ * @param[in] str - sprawdzany ciąg znaków.
+ * @param[out] plain - wskaźnik na zmienną, w której zostanie zapisane, czy
+ *                     ciąg składa się z samych cyfr.
+ * @return Długość ciągu, jeśli jest poprawny, lub zero w przeciwnym wypadku.
+ */
+NO_SANITIZE_ADDRESS
+static size_t scanNumber(char const *str, bool *plain) {
+#if defined(__SSE2__)
+    size_t i = 0;
+    bool special = false;
+    int value;
+
+    for (; ((uintptr_t) (str + i) & 15) != 0; i++) {
+        if (str[i] == '\0') {
+            *plain = !special;
+            return i;
+        }
+        if ((value = getValue(str[i])) == -1) return 0;
+        special |= value >= 10;
     }
+
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i digitZero = _mm_set1_epi8('0');
+    const __m128i star = _mm_set1_epi8('*');
+    const __m128i hash = _mm_set1_epi8('#');
+    for (;; i += 16) {
+        __m128i block = _mm_load_si128((__m128i const *) (str + i));
+        __m128i shifted = _mm_sub_epi8(block, digitZero);
+        __m128i digit = _mm_cmpeq_epi8(_mm_min_epu8(shifted, nine), shifted);
+        __m128i other = _mm_or_si128(_mm_cmpeq_epi8(block, star),
+                                     _mm_cmpeq_epi8(block, hash));
+
+        unsigned end = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(block,
+                                                                   zero));
+        unsigned valid = (unsigned) _mm_movemask_epi8(_mm_or_si128(digit,
+                                                                   other));
+        /* Znaczenie mają jedynie znaki przed znakiem terminującym. */
+        unsigned before = end ? (end & -end) - 1 : 0xFFFF;
+        if ((valid & before) != before) return 0;
+        special |= ((unsigned) _mm_movemask_epi8(other) & before) != 0;
+        if (end) {
+            i += (size_t) __builtin_ctz(end);
+            break;
+        }
+    }
+
+    *plain = !special;
+    return i;
+#else
+    return scanNumberScalar(str, plain);
+#endif
+}
+
+/**
+ * @brief Tłumaczy znaki poprawnego ciągu @p str od pozycji @p i do
+ * @p length na kodowanie wewnętrzne, znak po znaku.
+ * @param[out] out - bufor na co najmniej @p length + 1 znaków.
+ * @param[in] str - poprawny ciąg znaków.
+ * @param[in] i - pozycja pierwszego tłumaczonego znaku.
+ * @param[in] length - długość @p str.
+ */
+static void translateScalar(char *out, char const *str, size_t i,
+                            size_t length) {
+    for (; i < length; i++)
+        out[i] = encodeChar(str[i]);
+    out[length] = '\0';
+}
+
+/**
+ * @brief Tłumaczy @p length znaków poprawnego ciągu @p str na kodowanie
+ * wewnętrzne.
+ * @param[out] out - bufor na co najmniej @p length + 1 znaków.
+ * @param[in] str - poprawny ciąg znaków.
+ * @param[in] length - długość @p str.
+ */
+static void translate(char *out, char const *str, size_t length) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i star = _mm_set1_epi8('*');
+    const __m128i hash = _mm_set1_epi8('#');
+    const __m128i starShift = _mm_set1_epi8(':' - '*');
+    const __m128i hashShift = _mm_set1_epi8(';' - '#');
+    for (; i + 16 <= length; i += 16) {
+        __m128i block = _mm_loadu_si128((__m128i const *) (str + i));
+        __m128i shift = _mm_or_si128(
+            _mm_and_si128(_mm_cmpeq_epi8(block, star), starShift),
+            _mm_and_si128(_mm_cmpeq_epi8(block, hash), hashShift));
+        _mm_storeu_si128((__m128i *) (out + i), _mm_add_epi8(block, shift));
+    }
+#endif
+    translateScalar(out, str, i, length);
 }
 
 size_t isCorrect(char const *str) {
@@ -39,22 +175,58 @@ size_t isCorrect(char const *str) {
     return i;
 }
 
-int strCompare(const void *a, const void *b) {
-    char *num1 = *(char **) a;
-    char *num2 = *(char **) b;
-    size_t pos = 0;
+size_t numEncode(char const *str, char const **encoded) {
+    return numEncodeInto(str, NULL, 0, encoded);
+}
 
-    while (true) {
-        if (num1[pos] == '\0' && num2[pos] == '\0')
-            return 0;
-        else if (num1[pos] == '\0')
-            return -1;
-        else if (num2[pos] == '\0')
-            return 1;
-        else if (num1[pos] == num2[pos])
-            pos++;
-        else
-            return getValue(num1[pos]) - getValue(num2[pos]);
+/**
+ * @brief Sprawdza poprawność ciągu @p str i tłumaczy go na kodowanie
+ * wewnętrzne.
+ * Działa jak numEncodeInto(), a dla @p scalar równego @p true przegląda ciąg
+ * znak po znaku niezależnie od procesora.
+ * @param[in] str - tłumaczony ciąg znaków.
+ * @param[out] buf - bufor na przetłumaczoną kopię lub NULL.
+ * @param[in] cap - rozmiar bufora @p buf.
+ * @param[out] encoded - wskaźnik na zmienną na przetłumaczony ciąg.
+ * @param[in] scalar - czy pominąć instrukcje wektorowe.
+ * @return Długość ciągu, jeśli @p str jest poprawny, lub zero w przeciwnym
+ * wypadku.
+ */
+static size_t encode(char const *str, char *buf, size_t cap,
+                     char const **encoded, bool scalar) {
+    *encoded = NULL;
+    if (!str) return 0;
+
+    bool plain;
+    size_t length = scalar ? scanNumberScalar(str, &plain)
+                           : scanNumber(str, &plain);
+    if (length == 0) return 0;
+
+    if (plain) {
+        *encoded = str;
+        return length;
     }
+
+    char *copy = length < cap ? buf : malloc(length + 1);
+    if (!copy) return length;
+    if (scalar)
+        translateScalar(copy, str, 0, length);
+    else
+        translate(copy, str, length);
+    *encoded = copy;
+    return length;
 }
 
+size_t numEncodeInto(char const *str, char *buf, size_t cap,
+                     char const **encoded) {
+    return encode(str, buf, cap, encoded, false);
+}
+
+size_t numEncodeScalar(char const *str, char *buf, size_t cap,
+                       char const **encoded) {
+    return encode(str, buf, cap, encoded, true);
+}
+
+void numFreeEncoded(char const *encoded, char const *str) {
+    if (encoded != str) free((char *) encoded);
+}
@@ -6,6 +6,13 @@
  * Niepuste ciągi znaków z alfabetu nazywamy odtąd <em> poprawnymi ciągami
  * znaków </em>.
  *
+ * Wewnątrz modułów numery przechowywane są w <em>kodowaniu wewnętrznym</em>:
+ * cyfry pozostają bez zmian, zaś znaki '*' i '#' zastępowane są kolejnymi
+ * po '9' znakami ASCII, czyli ':' oraz ';'. Porządek bajtów tak zakodowanych
+ * ciągów jest zgodny z porządkiem leksykograficznym alfabetu, więc można je
+ * porównywać funkcjami @p strcmp i @p memcmp. Numery tłumaczone są między
+ * kodowaniami wyłącznie na granicy interfejsu @ref phone_forward.h.
+ *
  * @author Adam Greloch <ag438473@students.mimuw.edu.pl>
  * @copyright Uniwersytet Warszawski
  * @date 2022
@@ -14,6 +21,9 @@
 #ifndef __ALPHABET_H__
 #define __ALPHABET_H__
 
+#include <stddef.h>
+#include <string.h>
+
 #define ALLNUM 12 /**< Rozmiar alfabetu w drzewie,
                        czyli moc zbioru \f$\Omega\f$. */
 
@@ -23,7 +33,27 @@
  * @return Wartość liczbowa z przedziału od @p 0 do @p 11, jeśli znak należy do
  * alfabetu, lub @p -1, jeśli podano znak spoza alfabetu.
  */
-int getValue(char c);
+static inline int getValue(char c) {
+    switch (c) {
+        case '*':
+            return 10;
+        case '#':
+            return 11;
+        default:
+            return ('0' <= c && c <= '9') ? c - '0' : -1;
+    }
+}
+
+/**
+ * @brief Zwraca wartość liczbową znaku @p c w kodowaniu wewnętrznym.
+ * Zakłada, że @p c jest znakiem zakodowanego poprawnego ciągu.
+ * @param[in] c - znak w kodowaniu wewnętrznym.
+ * @return Wartość liczbowa z przedziału od @p 0 do @p 11, równa wartości
+ * zwracanej przez getValue() dla odpowiadającego znaku alfabetu.
+ */
+static inline int symbolValue(char c) {
+    return c - '0';
+}
 
 /**
  * @brief Sprawdza, czy @p str jest poprawnym ciągiem znaków.
@@ -36,15 +66,78 @@ int getValue(char c);
 size_t isCorrect(char const *str);
 
 /**
- * @brief Przeprowadza porównanie dwóch poprawnych ciągów znaku w porządku
- * leksykograficznym.
+ * @brief Sprawdza poprawność ciągu @p str i tłumaczy go na kodowanie
+ * wewnętrzne.
+ * Poprawność, długość i obecność znaków innych niż cyfry wyznaczane są
+ * w jednym przejściu, na procesorach z SSE2 po 16 znaków naraz.
+ * Ciąg złożony z samych cyfr nie zmienia się przy tłumaczeniu, więc wówczas
+ * w @p encoded umieszczany jest sam @p str. W przeciwnym razie alokowana jest
+ * przetłumaczona kopia, którą należy zwolnić za pomocą numFreeEncoded().
+ * @param[in] str - tłumaczony ciąg znaków.
+ * @param[out] encoded - wskaźnik na zmienną, w której zostanie zapisany
+ *                       przetłumaczony ciąg, lub NULL, jeśli @p str nie jest
+ *                       poprawny lub nie udało się alokować pamięci.
+ * @return Długość ciągu, jeśli @p str jest poprawny, lub zero w przeciwnym
+ * wypadku.
+ */
+size_t numEncode(char const *str, char const **encoded);
+
+/**
+ * @brief Sprawdza poprawność ciągu @p str i tłumaczy go na kodowanie
+ * wewnętrzne, w miarę możliwości bez alokacji pamięci.
+ * Działa jak numEncode(), lecz przetłumaczoną kopię umieszcza w buforze
+ * @p buf, jeśli ten ją mieści. Kopii w buforze nie należy zwalniać.
+ * @param[in] str - tłumaczony ciąg znaków.
+ * @param[out] buf - bufor na przetłumaczoną kopię lub NULL.
+ * @param[in] cap - rozmiar bufora @p buf.
+ * @param[out] encoded - wskaźnik na zmienną, w której zostanie zapisany
+ *                       przetłumaczony ciąg, lub NULL, jeśli @p str nie jest
+ *                       poprawny lub nie udało się alokować pamięci.
+ * @return Długość ciągu, jeśli @p str jest poprawny, lub zero w przeciwnym
+ * wypadku.
+ */
+size_t numEncodeInto(char const *str, char *buf, size_t cap,
+                     char const **encoded);
+
+/**
+ * @brief Sprawdza poprawność ciągu @p str i tłumaczy go na kodowanie
+ * wewnętrzne bez instrukcji wektorowych.
+ * Działa jak numEncodeInto(), lecz zawsze przegląda ciąg znak po znaku.
+ * Służy do porównywania obu ścieżek w testach.
+ * @param[in] str - tłumaczony ciąg znaków.
+ * @param[out] buf - bufor na przetłumaczoną kopię lub NULL.
+ * @param[in] cap - rozmiar bufora @p buf.
+ * @param[out] encoded - wskaźnik na zmienną, w której zostanie zapisany
+ *                       przetłumaczony ciąg, lub NULL, jeśli @p str nie jest
+ *                       poprawny lub nie udało się alokować pamięci.
+ * @return Długość ciągu, jeśli @p str jest poprawny, lub zero w przeciwnym
+ * wypadku.
+ */
+size_t numEncodeScalar(char const *str, char *buf, size_t cap,
+                       char const **encoded);
+
+/**
+ * @brief Zwalnia ciąg @p encoded utworzony przez numEncode() dla @p str.
+ * Nic nie robi, jeśli numEncode() nie alokowało pamięci.
+ * @param[in] encoded - przetłumaczony ciąg lub NULL.
+ * @param[in] str - ciąg przekazany do numEncode().
+ */
+void numFreeEncoded(char const *encoded, char const *str);
+
+/**
+ * @brief Porównuje dwa poprawne ciągi znaków w kodowaniu wewnętrznym
+ * w porządku leksykograficznym.
  * Rosnący ciąg \f$\langle 0,1,2,\ldots,9,*,\# \rangle\f$ definiuje
- * leksykograficzny porządek na tym alfabecie.
- * @param[in] a - podwójny wskaźnik na ciąg znaków reprezentujący pierwszy numer
- * @param[in] b - podwójny wskaźnik na ciąg znaków reprezentujący drugi numer
+ * leksykograficzny porządek na tym alfabecie; kodowanie wewnętrzne zachowuje
+ * go, zatem wystarcza porównanie bajtów.
+ * @param[in] a - wskaźnik na ciąg znaków reprezentujący pierwszy numer
+ * @param[in] b - wskaźnik na ciąg znaków reprezentujący drugi numer
  * @return Wartość ujemna, jeśli @p a jest mniejszy od @p b. Wartość zero,
  * jeśli @p a jest równe @p b. Wartość dodatnia, jeśli @p a jest większy od
+ * @p b.
  */
-int strCompare(const void *a, const void *b);
+static inline int numCompare(char const *a, char const *b) {
+    return strcmp(a, b);
+}
 
 #endif /* __ALPHABET_H__ */
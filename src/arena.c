@@ -0,0 +1,111 @@
+/** @file
+ * Implementacja klasy obsługującej arenę obiektów o stałym rozmiarze.
+ *
+ * @author Adam Greloch <ag438473@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include "arena.h"
+
+#define SLAB_OBJECTS (1u << ARENA_SLAB_SHIFT) /**< Liczba obiektów w slabie. */
+#define INIT_SLABS 4 /**< Początkowy rozmiar tablicy slabów. */
+#define SLAB_ALIGN 64 /**< Wyrównanie początku slabu. Obiekty o rozmiarze
+                           będącym wielokrotnością linii pamięci podręcznej
+                           nie przekraczają wówczas jej granic. */
+
+Arena *arenaNew(size_t objectSize) {
+    Arena *arena = malloc(sizeof(Arena));
+    if (!arena) return NULL;
+
+    if (objectSize < sizeof(uint32_t)) objectSize = sizeof(uint32_t);
+    arena->objectSize = (objectSize + 3) / 4 * 4;
+    arena->slabs = NULL;
+    arena->slabCount = 0;
+    arena->slabCapacity = 0;
+    /* Indeks zerowy jest zarezerwowany dla ARENA_NULL. */
+    arena->next = 1;
+    arena->freeList = ARENA_NULL;
+
+    return arena;
+}
+
+/**
+ * @brief Alokuje nowy slab, w razie potrzeby powiększając tablicę slabów.
+ * @param[in,out] arena - wskaźnik na arenę.
+ * @return Wartość @p true, jeśli udało się alokować pamięć. Wartość @p false
+ * w przeciwnym wypadku.
+ */
+static bool arenaGrow(Arena *arena) {
+    if (arena->slabCount == arena->slabCapacity) {
+        size_t capacity = arena->slabCapacity ? 2 * arena->slabCapacity
+                                              : INIT_SLABS;
+        unsigned char **slabs = realloc(arena->slabs,
+                                        capacity * sizeof(unsigned char *));
+        if (!slabs) return false;
+        arena->slabs = slabs;
+        arena->slabCapacity = capacity;
+    }
+
+    unsigned char *raw = malloc(SLAB_OBJECTS * arena->objectSize + SLAB_ALIGN);
+    if (!raw) return false;
+
+    /* Przesunięcie względem początku alokacji (od 1 do SLAB_ALIGN) zapisujemy
+     * w bajcie poprzedzającym wyrównany slab, by móc go później zwolnić. */
+    size_t offset = SLAB_ALIGN - (uintptr_t) raw % SLAB_ALIGN;
+    unsigned char *slab = raw + offset;
+    slab[-1] = (unsigned char) (offset - 1);
+
+    arena->slabs[arena->slabCount++] = slab;
+    return true;
+}
+
+uint32_t arenaAlloc(Arena *arena) {
+    if (!arena) return ARENA_NULL;
+
+    if (arena->freeList != ARENA_NULL) {
+        uint32_t idx = arena->freeList;
+        arena->freeList = *(uint32_t *) arenaGet(arena, idx);
+        return idx;
+    }
+
+    if (arena->next == UINT32_MAX) return ARENA_NULL;
+    if ((arena->next >> ARENA_SLAB_SHIFT) == arena->slabCount)
+        if (!arenaGrow(arena)) return ARENA_NULL;
+
+    return arena->next++;
+}
+
+bool arenaReserve(Arena *arena, size_t count) {
+    if (!arena) return false;
+    if (count == 0) return true;
+    /* Obiekty z listy wolnych miejsc pomijamy; rezerwacja jest wówczas
+     * jedynie nadmiarowa. */
+    if (count > UINT32_MAX - arena->next) return false;
+
+    uint32_t last = arena->next + (uint32_t) (count - 1);
+    while ((last >> ARENA_SLAB_SHIFT) >= arena->slabCount)
+        if (!arenaGrow(arena)) return false;
+    return true;
+}
+
+void arenaFree(Arena *arena, uint32_t idx) {
+    if (!arena || idx == ARENA_NULL) return;
+    *(uint32_t *) arenaGet(arena, idx) = arena->freeList;
+    arena->freeList = idx;
+}
+
+void arenaDelete(Arena *arena, void (*destructor)(void *)) {
+    if (!arena) return;
+
+    if (destructor)
+        for (uint32_t idx = 1; idx < arena->next; idx++)
+            destructor(arenaGet(arena, idx));
+
+    for (size_t i = 0; i < arena->slabCount; i++)
+        free(arena->slabs[i] - arena->slabs[i][-1] - 1);
+    free(arena->slabs);
+    free(arena);
+}
@@ -0,0 +1,113 @@
+/** @file
+ * Interfejs klasy obsługującej arenę obiektów o stałym rozmiarze.
+ *
+ * Arena przydziela pamięć dużymi blokami (slabami), z których kolejne obiekty
+ * wydzielane są przez przesunięcie licznika. Zwolnione obiekty trafiają na
+ * listę wolnych miejsc i są używane ponownie przy kolejnych alokacjach.
+ * Usunięcie areny zwalnia wszystkie slaby naraz, bez przechodzenia po
+ * strukturach zbudowanych z jej obiektów.
+ *
+ * Początek każdego slabu jest wyrównany do 64 bajtów, zatem obiekty o rozmiarze
+ * równym linii pamięci podręcznej nie przekraczają jej granic.
+ *
+ * Obiekty identyfikowane są 32-bitowymi indeksami zamiast wskaźników.
+ * Indeks @ref ARENA_NULL nie odpowiada żadnemu obiektowi.
+ *
+ * @author Adam Greloch <ag438473@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ARENA_NULL 0 /**< Indeks niewskazujący na żaden obiekt. */
+#define ARENA_SLAB_SHIFT 12 /**< Logarytm liczby obiektów w slabie. */
+
+/**
+ * Struktura przechowująca arenę. Jej definicja jest jawna wyłącznie po to,
+ * by funkcja arenaGet() mogła być rozwijana w miejscu wywołania; poza
+ * modułem areny należy ją traktować jako nieprzezroczystą.
+ */
+struct Arena {
+    unsigned char **slabs; /**< Tablica wskaźników na slaby. */
+    size_t slabCount; /**< Liczba zaalokowanych slabów. */
+    size_t slabCapacity; /**< Rozmiar tablicy @p slabs. */
+    size_t objectSize; /**< Rozmiar obiektu wyrównany do 4 bajtów. */
+    uint32_t next; /**< Indeks kolejnego obiektu do wydzielenia ze slabów. */
+    uint32_t freeList; /**< Indeks pierwszego obiektu zwróconego do areny.
+                            Początkowe 4 bajty każdego zwróconego obiektu
+                            przechowują indeks następnego takiego obiektu. */
+};
+
+typedef struct Arena Arena; /**< @struct Arena */
+
+/** @brief Tworzy nową arenę.
+ * Tworzy pustą arenę obiektów o rozmiarze @p objectSize. Powstała arena musi
+ * być zwolniona za pomocą funkcji arenaDelete().
+ * @param[in] objectSize - rozmiar pojedynczego obiektu w bajtach.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ * alokować pamięci.
+ */
+Arena *arenaNew(size_t objectSize);
+
+/** @brief Przydziela obiekt z areny.
+ * Jeśli lista wolnych miejsc jest niepusta, zwraca jej pierwszy element.
+ * W przeciwnym razie wydziela kolejny obiekt z bieżącego slabu, w razie
+ * potrzeby alokując nowy slab.
+ * @param[in,out] arena - wskaźnik na arenę.
+ * @return Indeks niezainicjowanego obiektu lub @ref ARENA_NULL, gdy nie
+ * udało się alokować pamięci.
+ */
+uint32_t arenaAlloc(Arena *arena);
+
+/** @brief Zapewnia miejsce na @p count kolejnych obiektów.
+ * Alokuje z góry slaby, z których wydzielone zostaną obiekty przy kolejnych
+ * wywołaniach arenaAlloc(), tak by @p count następnych wywołań na pewno się
+ * powiodło. Slaby alokowane są w całości, lecz system przydziela ich strony
+ * dopiero przy pierwszym zapisie.
+ * @param[in,out] arena - wskaźnik na arenę.
+ * @param[in] count - liczba obiektów.
+ * @return Wartość @p true, jeśli udało się alokować pamięć. Wartość @p false
+ * w przeciwnym wypadku; część slabów mogła wówczas zostać alokowana.
+ */
+bool arenaReserve(Arena *arena, size_t count);
+
+/** @brief Zwraca obiekt do areny.
+ * Umieszcza obiekt o indeksie @p idx na liście wolnych miejsc areny. Arena
+ * nadpisuje jedynie początkowe 4 bajty obiektu, pozostała jego zawartość nie
+ * ulega zmianie. Nic nie robi, jeśli @p idx ma wartość @ref ARENA_NULL.
+ * @param[in,out] arena - wskaźnik na arenę.
+ * @param[in] idx - indeks obiektu przydzielonego z @p arena.
+ */
+void arenaFree(Arena *arena, uint32_t idx);
+
+/** @brief Zwraca wskaźnik na obiekt o indeksie @p idx.
+ * Wskaźnik pozostaje ważny aż do usunięcia areny.
+ * @param[in] arena - wskaźnik na arenę.
+ * @param[in] idx - indeks obiektu przydzielonego z @p arena.
+ * @return Wskaźnik na obiekt lub NULL, jeśli @p idx ma wartość
+ * @ref ARENA_NULL.
+ */
+static inline void *arenaGet(Arena const *arena, uint32_t idx) {
+    if (idx == ARENA_NULL) return NULL;
+    return arena->slabs[idx >> ARENA_SLAB_SHIFT] +
+           (idx & ((1u << ARENA_SLAB_SHIFT) - 1)) * arena->objectSize;
+}
+
+/** @brief Usuwa arenę.
+ * Wywołuje @p destructor dla każdego obiektu kiedykolwiek wydzielonego ze
+ * slabów areny, po czym zwalnia wszystkie slaby. Obiekty zwrócone do areny
+ * również są przekazywane do @p destructor, więc przed wywołaniem
+ * arenaFree() należy pozostawić je w stanie, który destruktor rozpozna jako
+ * pusty. Nic nie robi, jeśli @p arena ma wartość NULL.
+ * @param[in,out] arena - wskaźnik na usuwaną arenę.
+ * @param[in] destructor - funkcja zwalniająca zasoby obiektu lub NULL.
+ */
+void arenaDelete(Arena *arena, void (*destructor)(void *));
+
+#endif /* __ARENA_H__ */
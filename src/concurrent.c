@@ -0,0 +1,307 @@
+/** @file
+ * Implementacja klasy przechowującej przekierowania numerów telefonów, którą
+ * wiele wątków może odpytywać bez blokad w czasie jej modyfikowania.
+ *
+ * @author Adam Greloch <ag438473@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include "concurrent.h"
+
+#define READER_SLOTS 64 /**< Liczba par liczników czytelników. */
+#define LINE 64 /**< Rozmiar linii pamięci podręcznej w bajtach. */
+
+/**
+ * Liczniki czytelników obu epok, przydzielone części wątków. Zajmują całą
+ * linię pamięci podręcznej, aby wątki korzystające z różnych liczników nie
+ * unieważniały sobie nawzajem linii.
+ */
+typedef struct ReaderSlot {
+    atomic_size_t readers[2]; /**< Liczby czytelników w każdej z epok. */
+    char padding[LINE - 2 * sizeof(atomic_size_t)]; /**< Dopełnienie. */
+} ReaderSlot;
+
+/**
+ * Struktura przechowująca obie kopie przekierowań.
+ */
+struct PhfwdConcurrent {
+    PhoneForward *copies[2]; /**< Kopie przekierowań. */
+    atomic_uint active; /**< Indeks kopii odpytywanej przez czytelników. */
+    atomic_uint epoch; /**< Indeks liczników, w których zgłaszają się nowi
+                            czytelnicy. */
+    pthread_mutex_t writer; /**< Szereguje modyfikacje i chroni pole
+                                 @p missed. */
+    struct Missed *missed; /**< Ostatnia modyfikacja, której nie udało się
+                                powtórzyć na nieaktywnej kopii, lub NULL. */
+    ReaderSlot slots[READER_SLOTS]; /**< Liczniki czytelników. */
+};
+
+/** Licznik wątków, które odpytywały którąkolwiek strukturę. */
+static atomic_size_t threadCount;
+
+/** Indeks liczników czytelników bieżącego wątku lub SIZE_MAX, jeśli nie
+ * został jeszcze przydzielony. */
+static _Thread_local size_t threadSlot = SIZE_MAX;
+
+/**
+ * Modyfikacja wykonywana na jednej kopii przekierowań.
+ */
+typedef bool (*Write)(PhoneForward *pf, PhfwdRule const *rules, size_t n);
+
+/**
+ * Modyfikacja zapamiętana do powtórzenia na nieaktywnej kopii wraz z kopiami
+ * napisów jej argumentów, umieszczonymi w tym samym bloku pamięci za
+ * tablicą @p rules.
+ */
+typedef struct Missed {
+    Write write; /**< Modyfikacja. */
+    size_t n; /**< Liczba argumentów. */
+    PhfwdRule rules[]; /**< Argumenty modyfikacji. */
+} Missed;
+
+/**
+ * @brief Dodaje do kopii @p pf przekierowanie @p rules[0].
+ * @param[in,out] pf - wskaźnik na kopię.
+ * @param[in] rules - wskaźnik na przekierowanie.
+ * @param[in] n - nieużywane.
+ * @return Wynik phfwdAdd().
+ */
+static bool writeAdd(PhoneForward *pf, PhfwdRule const *rules, size_t n) {
+    (void) n;
+    return phfwdAdd(pf, rules->num1, rules->num2);
+}
+
+/**
+ * @brief Dodaje do kopii @p pf wsad przekierowań @p rules.
+ * @param[in,out] pf - wskaźnik na kopię.
+ * @param[in] rules - tablica przekierowań.
+ * @param[in] n - liczba przekierowań.
+ * @return Wynik phfwdAddBatch().
+ */
+static bool writeAddBatch(PhoneForward *pf, PhfwdRule const *rules,
+                          size_t n) {
+    return phfwdAddBatch(pf, rules, n);
+}
+
+/**
+ * @brief Usuwa z kopii @p pf przekierowania o prefiksie @p rules[0].num1.
+ * @param[in,out] pf - wskaźnik na kopię.
+ * @param[in] rules - wskaźnik na przekierowanie, którego pierwszy napis
+ *                    reprezentuje prefiks numerów.
+ * @param[in] n - nieużywane.
+ * @return Wynik phfwdTryRemove().
+ */
+static bool writeRemove(PhoneForward *pf, PhfwdRule const *rules, size_t n) {
+    (void) n;
+    return phfwdTryRemove(pf, rules->num1);
+}
+
+/**
+ * @brief Kopiuje napis do bufora.
+ * @param[in] num - wskaźnik na napis lub NULL.
+ * @param[in,out] buffer - wskaźnik na wskaźnik na wolne miejsce w buforze,
+ *                         przesuwany za skopiowany napis.
+ * @return Wskaźnik na kopię napisu lub NULL, jeśli @p num ma wartość NULL.
+ */
+static char const *missedString(char const *num, char **buffer) {
+    if (!num) return NULL;
+
+    size_t size = strlen(num) + 1;
+    char *copy = memcpy(*buffer, num, size);
+    *buffer += size;
+    return copy;
+}
+
+/**
+ * @brief Zapamiętuje modyfikację wraz z kopiami jej argumentów.
+ * @param[in] write - modyfikacja.
+ * @param[in] rules - tablica argumentów modyfikacji.
+ * @param[in] n - liczba argumentów.
+ * @return Wskaźnik na zapamiętaną modyfikację lub NULL, gdy nie udało się
+ *         alokować pamięci.
+ */
+static Missed *missedNew(Write write, PhfwdRule const *rules, size_t n) {
+    size_t size = sizeof(Missed);
+    for (size_t i = 0; i < n; i++) {
+        size += sizeof(PhfwdRule);
+        if (rules[i].num1) size += strlen(rules[i].num1) + 1;
+        if (rules[i].num2) size += strlen(rules[i].num2) + 1;
+    }
+
+    Missed *missed = malloc(size);
+    if (!missed) return NULL;
+
+    char *buffer = (char *) &missed->rules[n];
+    missed->write = write;
+    missed->n = n;
+    for (size_t i = 0; i < n; i++) {
+        missed->rules[i].num1 = missedString(rules[i].num1, &buffer);
+        missed->rules[i].num2 = missedString(rules[i].num2, &buffer);
+    }
+    return missed;
+}
+
+/**
+ * @brief Wyznacza liczniki czytelników bieżącego wątku.
+ * Kolejne wątki otrzymują kolejne liczniki, więc przy co najwyżej
+ * @ref READER_SLOTS wątkach żaden licznik nie jest współdzielony.
+ * @return Indeks liczników.
+ */
+static size_t readerSlot(void) {
+    if (threadSlot == SIZE_MAX)
+        threadSlot = atomic_fetch_add(&threadCount, 1) % READER_SLOTS;
+    return threadSlot;
+}
+
+/**
+ * @brief Czeka, aż wyjdą wszyscy czytelnicy epoki @p epoch.
+ * @param[in] pc - wskaźnik na strukturę.
+ * @param[in] epoch - indeks epoki.
+ */
+static void readersDrain(PhfwdConcurrent *pc, unsigned epoch) {
+    for (size_t i = 0; i < READER_SLOTS; i++)
+        while (atomic_load(&pc->slots[i].readers[epoch]) != 0)
+            sched_yield();
+}
+
+/**
+ * @brief Wykonuje modyfikację @p write na obu kopiach.
+ * Modyfikuje nieaktywną kopię i czyni ją aktywną. Następnie czeka, aż wyjdą
+ * czytelnicy, którzy mogli wybrać poprzednią kopię: najpierw ci ze
+ * starszej epoki, a po zmianie epoki ci z bieżącej, tak by nowi czytelnicy
+ * nie mogli opóźniać modyfikującego w nieskończoność. Na koniec powtarza
+ * modyfikację na poprzedniej kopii. Kopia argumentów, potrzebna do
+ * powtórzenia, powstaje przed zmianą którejkolwiek kopii. Jeśli powtórzenie
+ * się nie powiedzie, to modyfikacja zostaje zapamiętana i powtórzona na tej
+ * kopii przed kolejną modyfikacją, która nie zostanie wykonana, dopóki to
+ * się nie uda. Zapamiętana jest więc co najwyżej jedna modyfikacja.
+ * @param[in,out] pc - wskaźnik na strukturę.
+ * @param[in] write - modyfikacja.
+ * @param[in] rules - tablica argumentów modyfikacji.
+ * @param[in] n - liczba argumentów.
+ * @return Wartość @p true, jeśli modyfikacja się powiodła. Wartość @p false,
+ * jeśli nie powiodła się na nieaktywnej kopii lub nie udało się alokować
+ * pamięci; wówczas struktura pozostaje bez zmian.
+ */
+static bool concurrentWrite(PhfwdConcurrent *pc, Write write,
+                            PhfwdRule const *rules, size_t n) {
+    pthread_mutex_lock(&pc->writer);
+    unsigned next = atomic_load(&pc->active) ^ 1;
+    PhoneForward *copy = pc->copies[next];
+
+    if (pc->missed && pc->missed->write(copy, pc->missed->rules,
+                                        pc->missed->n)) {
+        free(pc->missed);
+        pc->missed = NULL;
+    }
+
+    Missed *missed = pc->missed ? NULL : missedNew(write, rules, n);
+    bool ok = missed && write(copy, rules, n);
+    if (ok) {
+        atomic_store(&pc->active, next);
+        unsigned epoch = atomic_load(&pc->epoch);
+        readersDrain(pc, epoch ^ 1);
+        atomic_store(&pc->epoch, epoch ^ 1);
+        readersDrain(pc, epoch);
+        if (!write(pc->copies[next ^ 1], missed->rules, missed->n)) {
+            pc->missed = missed;
+            missed = NULL;
+        }
+    }
+    free(missed);
+    pthread_mutex_unlock(&pc->writer);
+    return ok;
+}
+
+/**
+ * @brief Wybiera kopię dla czytelnika i zgłasza jego wejście.
+ * Czytelnik zgłasza się przed odczytaniem indeksu aktywnej kopii, więc
+ * modyfikujący, który zmienił ten indeks, zobaczy go w licznikach.
+ * @param[in,out] pc - wskaźnik na strukturę.
+ * @param[out] counter - wskaźnik na zmienną, w której zostanie zapisany
+ *                       wskaźnik na licznik do zmniejszenia przy wyjściu.
+ * @return Wskaźnik na kopię, którą czytelnik może odpytywać do wyjścia.
+ */
+static PhoneForward const *readEnter(PhfwdConcurrent *pc,
+                                     atomic_size_t **counter) {
+    ReaderSlot *slot = &pc->slots[readerSlot()];
+    *counter = &slot->readers[atomic_load(&pc->epoch)];
+    atomic_fetch_add(*counter, 1);
+    return pc->copies[atomic_load(&pc->active)];
+}
+
+PhfwdConcurrent *phfwdConcurrentNew(void) {
+    PhfwdConcurrent *pc = malloc(sizeof(PhfwdConcurrent));
+    if (!pc) return NULL;
+
+    pc->copies[0] = phfwdNew();
+    pc->copies[1] = phfwdNew();
+    if (!pc->copies[0] || !pc->copies[1]) {
+        phfwdDelete(pc->copies[0]);
+        phfwdDelete(pc->copies[1]);
+        free(pc);
+        return NULL;
+    }
+
+    atomic_init(&pc->active, 0);
+    atomic_init(&pc->epoch, 0);
+    for (size_t i = 0; i < READER_SLOTS; i++) {
+        atomic_init(&pc->slots[i].readers[0], 0);
+        atomic_init(&pc->slots[i].readers[1], 0);
+    }
+    pc->missed = NULL;
+    pthread_mutex_init(&pc->writer, NULL);
+    return pc;
+}
+
+void phfwdConcurrentDelete(PhfwdConcurrent *pc) {
+    if (!pc) return;
+
+    pthread_mutex_destroy(&pc->writer);
+    free(pc->missed);
+    phfwdDelete(pc->copies[0]);
+    phfwdDelete(pc->copies[1]);
+    free(pc);
+}
+
+bool phfwdConcurrentAdd(PhfwdConcurrent *pc, char const *num1,
+                        char const *num2) {
+    PhfwdRule rule = {num1, num2};
+    return pc && concurrentWrite(pc, writeAdd, &rule, 1);
+}
+
+bool phfwdConcurrentAddBatch(PhfwdConcurrent *pc, PhfwdRule const *rules,
+                             size_t n) {
+    return pc && (n == 0 || rules) &&
+           concurrentWrite(pc, writeAddBatch, rules, n);
+}
+
+bool phfwdConcurrentRemove(PhfwdConcurrent *pc, char const *num) {
+    PhfwdRule rule = {num, NULL};
+    return pc && concurrentWrite(pc, writeRemove, &rule, 1);
+}
+
+PhoneNumbers *phfwdConcurrentGet(PhfwdConcurrent *pc, char const *num) {
+    if (!pc) return NULL;
+
+    atomic_size_t *counter;
+    PhoneNumbers *result = phfwdGet(readEnter(pc, &counter), num);
+    atomic_fetch_sub(counter, 1);
+    return result;
+}
+
+PhoneNumbers *phfwdConcurrentReverse(PhfwdConcurrent *pc, char const *num) {
+    if (!pc) return NULL;
+
+    atomic_size_t *counter;
+    PhoneNumbers *result = phfwdReverse(readEnter(pc, &counter), num);
+    atomic_fetch_sub(counter, 1);
+    return result;
+}
@@ -0,0 +1,121 @@
+/** @file
+ * Interfejs klasy przechowującej przekierowania numerów telefonów, którą
+ * wiele wątków może odpytywać bez blokad w czasie jej modyfikowania.
+ *
+ * Struktura utrzymuje dwie kopie przekierowań @ref PhoneForward. Czytelnicy
+ * odpytują kopię wskazaną jako aktywną, zaś modyfikacje wykonywane są
+ * najpierw na drugiej kopii, która następnie zostaje aktywną. Czytelnicy
+ * zgłaszają wejście i wyjście w jednym z dwóch liczników swojej epoki,
+ * rozłożonych na wiele linii pamięci podręcznej. Po przełączeniu kopii
+ * modyfikujący czeka, aż wyjdą wszyscy czytelnicy obu epok, którzy mogli
+ * jeszcze widzieć poprzednią kopię, i dopiero wtedy powtarza na niej tę samą
+ * modyfikację. Żaden węzeł nie jest więc zwalniany ani zmieniany, dopóki
+ * może go czytać inny wątek.
+ *
+ * Czytelnicy nie czekają nigdy, zaś modyfikacje są szeregowane blokadą
+ * i kosztują dwukrotne wykonanie operacji oraz oczekiwanie na czytelników.
+ * Modyfikacja, której nie udało się powtórzyć na drugiej kopii z braku
+ * pamięci, zostaje zapamiętana i powtórzona przed następną, w czasie
+ * proporcjonalnym do jej własnego, a nie do rozmiaru struktury.
+ *
+ * Struktura zajmuje około dwa razy więcej pamięci niż jedna struktura
+ * @ref PhoneForward z tymi samymi przekierowaniami, ponieważ obie kopie są
+ * pełne i niezależne. Każda modyfikacja alokuje ponadto na czas swojego
+ * wykonania kopię argumentów, która przetrwa ją tylko wtedy, gdy powtórzenie
+ * się nie powiodło; przechowywana jest co najwyżej jedna taka kopia.
+ * Wyniki zapytań nie wskazują na pamięć struktury, więc pozostają ważne po
+ * ich zakończeniu.
+ *
+ * @author Adam Greloch <ag438473@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef __CONCURRENT_H__
+#define __CONCURRENT_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "phone_forward.h"
+
+/**
+ * To jest struktura przechowująca przekierowania numerów telefonów,
+ * odpytywana współbieżnie z ich modyfikacjami.
+ */
+struct PhfwdConcurrent;
+typedef struct PhfwdConcurrent PhfwdConcurrent; /**< @struct PhfwdConcurrent */
+
+/** @brief Tworzy nową strukturę.
+ * Tworzy nową strukturę niezawierającą żadnych przekierowań.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         alokować pamięci.
+ */
+PhfwdConcurrent *phfwdConcurrentNew(void);
+
+/** @brief Usuwa strukturę.
+ * Usuwa strukturę wskazywaną przez @p pc. Nic nie robi, jeśli wskaźnik ten
+ * ma wartość NULL. W czasie usuwania żaden inny wątek nie może korzystać ze
+ * struktury.
+ * @param[in] pc – wskaźnik na usuwaną strukturę.
+ */
+void phfwdConcurrentDelete(PhfwdConcurrent *pc);
+
+/** @brief Dodaje przekierowanie.
+ * Działa jak phfwdAdd(). Dodane przekierowanie widzą wszystkie zapytania
+ * rozpoczęte po powrocie z funkcji.
+ * @param[in,out] pc – wskaźnik na strukturę;
+ * @param[in] num1   – wskaźnik na napis reprezentujący prefiks numerów
+ *                     przekierowywanych;
+ * @param[in] num2   – wskaźnik na napis reprezentujący prefiks numerów,
+ *                     na które jest wykonywane przekierowanie.
+ * @return Wartość @p true, jeśli przekierowanie zostało dodane.
+ *         Wartość @p false, jeśli wystąpił błąd w sensie phfwdAdd() lub
+ *         @p pc ma wartość NULL; wówczas struktura pozostaje bez zmian.
+ */
+bool phfwdConcurrentAdd(PhfwdConcurrent *pc, char const *num1,
+                        char const *num2);
+
+/** @brief Dodaje wsad przekierowań.
+ * Działa jak phfwdAddBatch().
+ * @param[in,out] pc – wskaźnik na strukturę;
+ * @param[in] rules  – tablica przekierowań;
+ * @param[in] n      – liczba przekierowań.
+ * @return Wartość @p true, jeśli wszystkie przekierowania zostały dodane.
+ *         Wartość @p false, jeśli wystąpił błąd w sensie phfwdAddBatch() lub
+ *         @p pc ma wartość NULL; wówczas struktura pozostaje bez zmian.
+ */
+bool phfwdConcurrentAddBatch(PhfwdConcurrent *pc, PhfwdRule const *rules,
+                             size_t n);
+
+/** @brief Usuwa przekierowania.
+ * Działa jak phfwdTryRemove().
+ * @param[in,out] pc – wskaźnik na strukturę;
+ * @param[in] num    – wskaźnik na napis reprezentujący prefiks numerów.
+ * @return Wartość @p true, jeśli przekierowania zostały usunięte lub napis
+ *         nie reprezentuje numeru. Wartość @p false, jeśli nie udało się
+ *         alokować pamięci lub @p pc ma wartość NULL; wówczas struktura
+ *         pozostaje bez zmian.
+ */
+bool phfwdConcurrentRemove(PhfwdConcurrent *pc, char const *num);
+
+/** @brief Wyznacza przekierowanie numeru.
+ * Działa jak phfwdGet() dla stanu struktury po ostatniej zakończonej
+ * modyfikacji lub po modyfikacji trwającej. Nie zakłada blokad.
+ * @param[in] pc  – wskaźnik na strukturę;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy
+ *         nie udało się alokować pamięci lub @p pc ma wartość NULL.
+ */
+PhoneNumbers *phfwdConcurrentGet(PhfwdConcurrent *pc, char const *num);
+
+/** @brief Wyznacza przekierowania na dany numer.
+ * Działa jak phfwdReverse() dla stanu struktury po ostatniej zakończonej
+ * modyfikacji lub po modyfikacji trwającej. Nie zakłada blokad.
+ * @param[in] pc  – wskaźnik na strukturę;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy
+ *         nie udało się alokować pamięci lub @p pc ma wartość NULL.
+ */
+PhoneNumbers *phfwdConcurrentReverse(PhfwdConcurrent *pc, char const *num);
+
+#endif /* __CONCURRENT_H__ */
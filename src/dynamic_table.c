@@ -1,6 +1,6 @@
 /** @file
- * Implementacja klasy obsługującej dynamiczną tablicę poprawnych ciągów
- * znaków (zdefiniowanych w @ref alphabet.h)
+ * Implementacja klasy obsługującej dynamiczną tablicę upakowanych numerów
+ * (zdefiniowanych w @ref packed.h)
  *
  * @author Adam Greloch <ag438473@students.mimuw.edu.pl>
  * @copyright Uniwersytet Warszawski
@@ -11,7 +11,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include "dynamic_table.h"
-#include "alphabet.h"
+#include "packed.h"
 
 #define INIT_SIZE 16 /**< Początkowy rozmiar dynamicznej tablicy @p
                           Table#data */
@@ -21,8 +21,9 @@
  */
 struct Table {
     size_t amount; /**< Liczba numerów telefonów przechowywanych w @p str. */
-    char **data; /**< Dynamiczna tablica o początkowym rozmiarze @p INIT_SIZE,
-                     w której przechowywane są poprawne ciągi znaków. */
+    uint8_t **data; /**< Dynamiczna tablica o początkowym rozmiarze
+                         @p INIT_SIZE, w której przechowywane są upakowane
+                         numery. */
     size_t size; /**< Rozmiar tablicy. */
 };
 
@@ -30,7 +31,7 @@ Table *tableNew() {
     Table *t = malloc(sizeof(Table));
     if (!t) return NULL;
 
-    t->data = calloc(INIT_SIZE, sizeof(char *));
+    t->data = calloc(INIT_SIZE, sizeof(uint8_t *));
     if (!t->data) {
         free(t);
         return NULL;
@@ -42,9 +43,77 @@ Table *tableNew() {
     return t;
 }
 
-void tableSort(Table *t, int (*cmp)(const void *, const void *)) {
+#define INSERTION_SORT_SIZE 16 /**< Rozmiar, poniżej którego fragment
+                                    sortowany jest przez wstawianie. */
+
+/**
+ * @brief Zamienia miejscami dwa wskaźniki.
+ * @param a - wskaźnik na pierwszy wskaźnik.
+ * @param b - wskaźnik na drugi wskaźnik.
+ */
+static inline void swapNums(uint8_t **a, uint8_t **b) {
+    uint8_t *tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+/**
+ * @brief Sortuje @p n upakowanych numerów leżących od @p data.
+ * Sortowanie szybkie z medianą z trzech elementów; rekurencja schodzi do
+ * mniejszej części, więc jej głębokość jest logarytmiczna. Numery porównywane
+ * są bezpośrednio funkcją packedCompare(), bez komparatora przekazywanego
+ * przez wskaźnik.
+ * @param data - wskaźnik na pierwszy numer.
+ * @param n - liczba numerów.
+ */
+static void sortNums(uint8_t **data, size_t n) {
+    while (n > INSERTION_SORT_SIZE) {
+        size_t mid = n / 2, last = n - 1;
+        if (packedCompare(data[mid], data[0]) < 0) swapNums(&data[mid], &data[0]);
+        if (packedCompare(data[last], data[0]) < 0) swapNums(&data[last], &data[0]);
+        if (packedCompare(data[last], data[mid]) < 0)
+            swapNums(&data[last], &data[mid]);
+
+        uint8_t *pivot = data[mid];
+        size_t i = 0, j = last;
+        while (true) {
+            while (packedCompare(data[i], pivot) < 0) i++;
+            while (packedCompare(data[j], pivot) > 0) j--;
+            if (i >= j) break;
+            swapNums(&data[i++], &data[j--]);
+        }
+
+        /* Elementy do indeksu j włącznie nie są większe od elementów za nim. */
+        if (j + 1 < n - j - 1) {
+            sortNums(data, j + 1);
+            data += j + 1;
+            n -= j + 1;
+        }
+        else {
+            sortNums(data + j + 1, n - j - 1);
+            n = j + 1;
+        }
+    }
+
+    for (size_t i = 1; i < n; i++) {
+        uint8_t *curr = data[i];
+        size_t j = i;
+        while (j > 0 && packedCompare(data[j - 1], curr) > 0) {
+            data[j] = data[j - 1];
+            j--;
+        }
+        data[j] = curr;
+    }
+}
+
+void tableSort(Table *t) {
     if (!t || !t->data) return;
-    qsort(t->data, t->amount, sizeof(char *), cmp);
+    sortNums(t->data, t->amount);
+}
+
+void tableSortRange(Table *t, size_t from, size_t to) {
+    if (!t || !t->data || from >= to || to > t->amount) return;
+    sortNums(t->data + from, to - from);
 }
 
 /**
@@ -56,8 +125,8 @@ void tableSort(Table *t, int (*cmp)(const void *, const void *)) {
 static bool tableResize(Table *t) {
     if (t->amount == t->size) {
         t->size *= 2;
-        char **backup = t->data;
-        t->data = realloc(t->data, t->size * sizeof(char *));
+        uint8_t **backup = t->data;
+        t->data = realloc(t->data, t->size * sizeof(uint8_t *));
         if (!t->data) {
             t->data = backup;
             return false;
@@ -66,22 +135,23 @@ static bool tableResize(Table *t) {
     return true;
 }
 
-bool tableAdd(Table *t, const char *str) {
-    if (!t || !str) return false;
+bool tableAdd(Table *t, uint8_t const *num) {
+    if (!t || !num) return false;
     if (!tableResize(t)) return false;
 
-    t->data[t->amount] = malloc((isCorrect(str) + 1) * sizeof(char));
+    size_t size = packedSize(packedLength(num));
+    t->data[t->amount] = malloc(size);
     if (!t->data[t->amount])
         return false;
-    strcpy(t->data[t->amount], str);
+    memcpy(t->data[t->amount], num, size);
     t->amount++;
 
     return true;
 }
 
-bool tableAddPtr(Table *t, char *str) {
-    if (!tableResize(t) || !str) return false;
-    t->data[t->amount++] = str;
+bool tableAddPtr(Table *t, uint8_t *num) {
+    if (!tableResize(t) || !num) return false;
+    t->data[t->amount++] = num;
     return true;
 }
 
@@ -97,7 +167,7 @@ void tableFree(Table *t) {
     free(t);
 }
 
-char *tableGet(Table *t, size_t idx) {
+uint8_t *tableGet(Table *t, size_t idx) {
     if (!t || idx > t->amount) return NULL;
     return t->data[idx];
 }
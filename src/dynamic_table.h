@@ -1,6 +1,6 @@
 /** @file
- * Interfejs klasy obsługującej dynamiczną tablicę poprawnych ciągów
- * znaków (zdefiniowanych w @ref alphabet.h)
+ * Interfejs klasy obsługującej dynamiczną tablicę upakowanych numerów
+ * (zdefiniowanych w @ref packed.h)
  *
  * @author Adam Greloch <ag438473@students.mimuw.edu.pl>
  * @copyright Uniwersytet Warszawski
@@ -10,6 +10,10 @@
 #ifndef __DYNAMIC_TABLE_H__
 #define __DYNAMIC_TABLE_H__
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 struct Table;
 
 typedef struct Table Table; /**< @struct Table */
@@ -21,37 +25,47 @@ typedef struct Table Table; /**< @struct Table */
 Table *tableNew();
 
 /**
- * @brief Sortuje tablicę @p t za pomocą podanego komparatora @p cmp.
+ * @brief Sortuje tablicę @p t upakowanych numerów w porządku
+ * leksykograficznym (zobacz packedCompare()).
  * @param t - wskaźnik na tablicę do posortowania.
- * @param cmp - wskaźnik na komparator.
  */
-void tableSort(Table *t, int (*cmp)(const void *, const void *));
+void tableSort(Table *t);
+
+/**
+ * @brief Sortuje elementy tablicy @p t o indeksach od @p from do @p to - 1
+ * tak jak tableSort().
+ * @param t - wskaźnik na tablicę.
+ * @param from - indeks pierwszego sortowanego elementu.
+ * @param to - indeks za ostatnim sortowanym elementem, nie większy od
+ *             liczby elementów tablicy.
+ */
+void tableSortRange(Table *t, size_t from, size_t to);
 
-/** @brief Dodaje na koniec tablicy @p t kopię poprawnego ciągu znaków @p str
+/** @brief Dodaje na koniec tablicy @p t kopię upakowanego numeru @p num
  * Jeśli tablica jest zapełniona, podwaja jej rozmiar.
  * @param[in, out] t – wskaźnik na tablicę.
- * @param[in] str - wskaźnik na dodawany poprawny ciąg znaków.
- * @return Wartość @p true, jeśli udało się dodać ciąg. Wartość @p false,
+ * @param[in] num - wskaźnik na dodawany upakowany numer.
+ * @return Wartość @p true, jeśli udało się dodać numer. Wartość @p false,
  * jeśli nie udało się alokować pamięci.
  */
-bool tableAdd(Table *t, const char *str);
+bool tableAdd(Table *t, uint8_t const *num);
 
-/** @brief Dodaje na koniec tablicy @p t wskaźnik na poprawny ciąg znaków @p
- * str. Jeśli tablica jest zapełniona, podwaja jej rozmiar.
+/** @brief Dodaje na koniec tablicy @p t wskaźnik na upakowany numer @p num.
+ * Jeśli tablica jest zapełniona, podwaja jej rozmiar.
  * @param[in, out] t – wskaźnik na tablicę.
- * @param[in] str - wskaźnik na dodawany poprawny ciąg znaków.
- * @return Wartość @p true, jeśli udało się dodać ciąg. Wartość @p false,
+ * @param[in] num - wskaźnik na dodawany upakowany numer.
+ * @return Wartość @p true, jeśli udało się dodać numer. Wartość @p false,
  * jeśli nie udało się alokować pamięci.
  */
-bool tableAddPtr(Table *t, char *str);
+bool tableAddPtr(Table *t, uint8_t *num);
 
-/** @brief Zwraca poprawny ciąg znaków zawarty w @p t pod indeksem @p idx.
+/** @brief Zwraca upakowany numer zawarty w @p t pod indeksem @p idx.
  * @param[in] t – wskaźnik na tablicę.
  * @param[in] idx - indeks tablicy.
- * @return Wskaźnik na poprawny ciąg znaków, lub NULL, jeśli @p t ma wartość
+ * @return Wskaźnik na upakowany numer, lub NULL, jeśli @p t ma wartość
  * NULL, bądź @p idx wykracza poza liczbę elementów w tablicy.
  */
-char *tableGet(Table *t, size_t idx);
+uint8_t *tableGet(Table *t, size_t idx);
 
 /** @brief Usuwa tablicę.
  * Usuwa tablicę wskazywaną przez @p t. Nic nie robi, jeśli wskaźnik ten ma
@@ -0,0 +1,185 @@
+/** @file
+ * Implementacja klasy wykonującej wsadowo zapytania o przekierowania na wielu
+ * wątkach.
+ *
+ * @author Adam Greloch <ag438473@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "executor.h"
+
+#define CHUNK 64 /**< Liczba numerów we fragmencie pobieranym przez wątek. */
+
+/**
+ * Struktura przechowująca pulę wątków wraz z bieżącym wsadem.
+ */
+struct PhfwdExecutor {
+    pthread_t *threads; /**< Wątki robocze. */
+    size_t workers; /**< Liczba wątków roboczych. */
+
+    pthread_mutex_t lock; /**< Chroni pola @p generation, @p stop
+                               i @p running. */
+    pthread_cond_t start; /**< Sygnalizuje nowy wsad lub zakończenie. */
+    pthread_cond_t done; /**< Sygnalizuje zakończenie wsadu przez wszystkie
+                              wątki robocze. */
+    unsigned long generation; /**< Numer bieżącego wsadu. */
+    bool stop; /**< Czy wątki robocze mają się zakończyć. */
+    size_t running; /**< Liczba wątków roboczych wykonujących bieżący
+                         wsad. */
+
+    PhoneForward const *pf; /**< Struktura, której dotyczą zapytania. */
+    PhfwdQuery kind; /**< Rodzaj zapytań. */
+    char const *const *nums; /**< Numery wsadu. */
+    size_t n; /**< Liczba numerów wsadu. */
+    PhoneNumbers **out; /**< Tablica wyników wsadu. */
+    atomic_size_t next; /**< Początek następnego nie pobranego fragmentu. */
+    atomic_bool failed; /**< Czy któregoś wyniku nie udało się wyznaczyć. */
+};
+
+/**
+ * @brief Wykonuje fragmenty bieżącego wsadu, dopóki jakieś pozostały.
+ * Każdy fragment zapisuje wyniki wyłącznie na swoich pozycjach tablicy
+ * wyjściowej, zaś struktura przekierowań jest tylko odczytywana.
+ * @param[in,out] ex - wskaźnik na wykonawcę.
+ */
+static void runChunks(PhfwdExecutor *ex) {
+    size_t from, to;
+    bool ok = true;
+
+    while ((from = atomic_fetch_add(&ex->next, CHUNK)) < ex->n) {
+        to = ex->n - from < CHUNK ? ex->n : from + CHUNK;
+        if (ex->kind == PHFWD_QUERY_GET) {
+            ok &= phfwdGetBatch(ex->pf, ex->nums + from, to - from,
+                                ex->out + from);
+        }
+        else {
+            for (size_t i = from; i < to; i++) {
+                ex->out[i] = phfwdReverse(ex->pf, ex->nums[i]);
+                ok &= ex->out[i] != NULL;
+            }
+        }
+    }
+
+    if (!ok) atomic_store(&ex->failed, true);
+}
+
+/**
+ * @brief Pętla wątku roboczego.
+ * Czeka na kolejne wsady i wykonuje ich fragmenty.
+ * @param[in] arg - wskaźnik na wykonawcę.
+ * @return Wartość NULL.
+ */
+static void *workerLoop(void *arg) {
+    PhfwdExecutor *ex = arg;
+    unsigned long seen = 0;
+
+    pthread_mutex_lock(&ex->lock);
+    for (;;) {
+        while (ex->generation == seen && !ex->stop)
+            pthread_cond_wait(&ex->start, &ex->lock);
+        if (ex->stop) break;
+        seen = ex->generation;
+        pthread_mutex_unlock(&ex->lock);
+
+        runChunks(ex);
+
+        pthread_mutex_lock(&ex->lock);
+        if (--ex->running == 0)
+            pthread_cond_signal(&ex->done);
+    }
+    pthread_mutex_unlock(&ex->lock);
+    return NULL;
+}
+
+/**
+ * @brief Kończy @p started pierwszych wątków roboczych.
+ * @param[in,out] ex - wskaźnik na wykonawcę.
+ * @param[in] started - liczba uruchomionych wątków.
+ */
+static void stopWorkers(PhfwdExecutor *ex, size_t started) {
+    pthread_mutex_lock(&ex->lock);
+    ex->stop = true;
+    pthread_cond_broadcast(&ex->start);
+    pthread_mutex_unlock(&ex->lock);
+
+    for (size_t i = 0; i < started; i++)
+        pthread_join(ex->threads[i], NULL);
+}
+
+PhfwdExecutor *phfwdExecutorNew(size_t workers) {
+    PhfwdExecutor *ex = malloc(sizeof(PhfwdExecutor));
+    if (!ex) return NULL;
+
+    ex->threads = workers ? malloc(workers * sizeof(pthread_t)) : NULL;
+    if (workers && !ex->threads) {
+        free(ex);
+        return NULL;
+    }
+
+    ex->workers = workers;
+    ex->generation = 0;
+    ex->stop = false;
+    ex->running = 0;
+    ex->n = 0;
+    atomic_init(&ex->next, 0);
+    atomic_init(&ex->failed, false);
+    pthread_mutex_init(&ex->lock, NULL);
+    pthread_cond_init(&ex->start, NULL);
+    pthread_cond_init(&ex->done, NULL);
+
+    for (size_t i = 0; i < workers; i++)
+        if (pthread_create(&ex->threads[i], NULL, workerLoop, ex) != 0) {
+            stopWorkers(ex, i);
+            ex->workers = 0;
+            phfwdExecutorDelete(ex);
+            return NULL;
+        }
+
+    return ex;
+}
+
+void phfwdExecutorDelete(PhfwdExecutor *ex) {
+    if (!ex) return;
+    if (ex->workers) stopWorkers(ex, ex->workers);
+
+    pthread_cond_destroy(&ex->done);
+    pthread_cond_destroy(&ex->start);
+    pthread_mutex_destroy(&ex->lock);
+    free(ex->threads);
+    free(ex);
+}
+
+bool phfwdExecute(PhfwdExecutor *ex, PhoneForward const *pf, PhfwdQuery kind,
+                  char const *const *nums, size_t n, PhoneNumbers **out) {
+    if (!ex || !pf) return false;
+    if (n == 0) return true;
+    if (!nums || !out) return false;
+
+    /* Pola wsadu zapisywane są pod blokadą, więc wątki robocze widzą je po
+     * przebudzeniu. */
+    pthread_mutex_lock(&ex->lock);
+    ex->pf = pf;
+    ex->kind = kind;
+    ex->nums = nums;
+    ex->n = n;
+    ex->out = out;
+    atomic_store(&ex->next, 0);
+    atomic_store(&ex->failed, false);
+    ex->running = ex->workers;
+    ex->generation++;
+    pthread_cond_broadcast(&ex->start);
+    pthread_mutex_unlock(&ex->lock);
+
+    runChunks(ex);
+
+    pthread_mutex_lock(&ex->lock);
+    while (ex->running > 0)
+        pthread_cond_wait(&ex->done, &ex->lock);
+    pthread_mutex_unlock(&ex->lock);
+
+    return !atomic_load(&ex->failed);
+}
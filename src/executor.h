@@ -0,0 +1,80 @@
+/** @file
+ * Interfejs klasy wykonującej wsadowo zapytania o przekierowania na wielu
+ * wątkach.
+ *
+ * Wykonawca utrzymuje stałą pulę wątków roboczych. Wsad numerów dzielony jest
+ * na fragmenty, które wątki, łącznie z wątkiem wywołującym, pobierają kolejno
+ * ze wspólnego licznika, dopóki fragmenty się nie skończą. Wątek, który
+ * skończy swoje fragmenty wcześniej, przejmuje więc pracę pozostałych.
+ * Wyniki trafiają na pozycje tablicy wyjściowej odpowiadające pozycjom
+ * numerów we wsadzie, więc kolejność wyników jest zgodna z kolejnością
+ * zapytań.
+ *
+ * Zapytania nie modyfikują struktury @ref PhoneForward, zatem w czasie
+ * wykonywania wsadu nie wolno jej modyfikować w żaden inny sposób.
+ *
+ * @author Adam Greloch <ag438473@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef __EXECUTOR_H__
+#define __EXECUTOR_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "phone_forward.h"
+
+/**
+ * To jest struktura przechowująca pulę wątków wykonujących zapytania.
+ */
+struct PhfwdExecutor;
+typedef struct PhfwdExecutor PhfwdExecutor; /**< @struct PhfwdExecutor */
+
+/**
+ * Rodzaj zapytań wykonywanych we wsadzie.
+ */
+typedef enum PhfwdQuery {
+    PHFWD_QUERY_GET, /**< Zapytania phfwdGet(). */
+    PHFWD_QUERY_REVERSE /**< Zapytania phfwdReverse(). */
+} PhfwdQuery;
+
+/** @brief Tworzy nowego wykonawcę.
+ * Uruchamia @p workers wątków roboczych, które czekają na wsady. Wsad
+ * wykonywany jest także przez wątek wywołujący phfwdExecute(), więc wartość
+ * zero oznacza wykonywanie zapytań wyłącznie w tym wątku.
+ * @param[in] workers – liczba wątków roboczych.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         alokować pamięci lub uruchomić wątków.
+ */
+PhfwdExecutor *phfwdExecutorNew(size_t workers);
+
+/** @brief Usuwa wykonawcę.
+ * Kończy wątki robocze i zwalnia pamięć struktury wskazywanej przez @p ex.
+ * Nic nie robi, jeśli wskaźnik ten ma wartość NULL.
+ * @param[in] ex – wskaźnik na usuwaną strukturę.
+ */
+void phfwdExecutorDelete(PhfwdExecutor *ex);
+
+/** @brief Wykonuje wsad zapytań.
+ * Dla każdego numeru @p nums[i] wyznacza wynik zapytania rodzaju @p kind
+ * i zapisuje go w @p out[i]. Wraca, gdy wszystkie zapytania zostały
+ * wykonane. Wyniki należy zwolnić za pomocą funkcji @ref phnumDelete.
+ * @param[in] ex    – wskaźnik na wykonawcę;
+ * @param[in] pf    – wskaźnik na strukturę przechowującą przekierowania
+ *                    numerów, niemodyfikowaną w czasie wykonywania wsadu;
+ * @param[in] kind  – rodzaj zapytań;
+ * @param[in] nums  – tablica @p n wskaźników na napisy reprezentujące
+ *                    numery;
+ * @param[in] n     – liczba numerów;
+ * @param[out] out  – tablica @p n wskaźników, w której zostaną zapisane
+ *                    wyniki. Wynik, którego nie udało się wyznaczyć, ma
+ *                    wartość NULL.
+ * @return Wartość @p true, jeśli wyznaczono wszystkie wyniki. Wartość
+ *         @p false, jeśli któregoś nie udało się wyznaczyć lub @p ex albo
+ *         @p pf ma wartość NULL.
+ */
+bool phfwdExecute(PhfwdExecutor *ex, PhoneForward const *pf, PhfwdQuery kind,
+                  char const *const *nums, size_t n, PhoneNumbers **out);
+
+#endif /* __EXECUTOR_H__ */
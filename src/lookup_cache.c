@@ -0,0 +1,228 @@
+/** @file
+ * Implementacja klasy obsługującej ograniczoną pamięć podręczną wyników
+ * zapytań o przekierowania numerów.
+ *
+ * @author Adam Greloch <ag438473@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "lookup_cache.h"
+#include "packed.h"
+
+#define NONE UINT32_MAX /**< Pozycja oznaczająca brak elementu. */
+
+/**
+ * Para numer–wynik. Elementy łączone są w listę wszystkich elementów
+ * uporządkowaną od ostatnio używanego oraz w listy elementów o tym samym
+ * kubełku tablicy haszującej.
+ */
+typedef struct CacheEntry {
+    uint8_t key[CACHE_KEY_BYTES]; /**< Upakowany numer dopełniony zerami. */
+    uint8_t target[CACHE_KEY_BYTES]; /**< Upakowany wynik. */
+    uint32_t hash; /**< Hasz klucza. */
+    uint32_t generation; /**< Licznik zmian z chwili wyznaczenia wyniku. */
+    uint32_t prev; /**< Poprzedni element na liście używania. */
+    uint32_t next; /**< Następny element na liście używania. */
+    uint32_t chain; /**< Następny element w kubełku. */
+} CacheEntry;
+
+/**
+ * Struktura przechowująca pamięć podręczną.
+ */
+struct LookupCache {
+    pthread_mutex_t lock; /**< Chroni wszystkie pozostałe pola. */
+    CacheEntry *entries; /**< Elementy; zajęte są pierwsze @p used. */
+    uint32_t *buckets; /**< Pierwsze elementy kubełków. */
+    size_t capacity; /**< Największa liczba elementów. */
+    size_t used; /**< Liczba zajętych elementów. */
+    size_t mask; /**< Liczba kubełków pomniejszona o jeden. */
+    uint32_t head; /**< Ostatnio używany element. */
+    uint32_t tail; /**< Najdawniej używany element. */
+    size_t hits; /**< Liczba trafień. */
+    size_t misses; /**< Liczba chybień. */
+};
+
+/**
+ * @brief Wyszukuje element o kluczu @p key.
+ * @param[in] cache - wskaźnik na pamięć podręczną.
+ * @param[in] key - wskaźnik na ważny klucz.
+ * @return Pozycja elementu lub @ref NONE, jeśli go nie ma.
+ */
+static uint32_t entryFind(LookupCache const *cache, CacheKey const *key) {
+    uint32_t i = cache->buckets[key->hash & cache->mask];
+    while (i != NONE) {
+        CacheEntry const *entry = &cache->entries[i];
+        if (entry->hash == key->hash &&
+            memcmp(entry->key, key->bytes, CACHE_KEY_BYTES) == 0)
+            break;
+        i = entry->chain;
+    }
+    return i;
+}
+
+/**
+ * @brief Wypina element @p i z listy używania.
+ * @param[in,out] cache - wskaźnik na pamięć podręczną.
+ * @param[in] i - pozycja elementu.
+ */
+static void usageUnlink(LookupCache *cache, uint32_t i) {
+    CacheEntry *entry = &cache->entries[i];
+    if (entry->prev != NONE) cache->entries[entry->prev].next = entry->next;
+    else cache->head = entry->next;
+    if (entry->next != NONE) cache->entries[entry->next].prev = entry->prev;
+    else cache->tail = entry->prev;
+}
+
+/**
+ * @brief Wstawia element @p i na początek listy używania.
+ * @param[in,out] cache - wskaźnik na pamięć podręczną.
+ * @param[in] i - pozycja elementu.
+ */
+static void usagePush(LookupCache *cache, uint32_t i) {
+    CacheEntry *entry = &cache->entries[i];
+    entry->prev = NONE;
+    entry->next = cache->head;
+    if (cache->head != NONE) cache->entries[cache->head].prev = i;
+    else cache->tail = i;
+    cache->head = i;
+}
+
+/**
+ * @brief Wypina element @p i z jego kubełka.
+ * @param[in,out] cache - wskaźnik na pamięć podręczną.
+ * @param[in] i - pozycja elementu.
+ */
+static void chainUnlink(LookupCache *cache, uint32_t i) {
+    uint32_t *link = &cache->buckets[cache->entries[i].hash & cache->mask];
+    while (*link != i)
+        link = &cache->entries[*link].chain;
+    *link = cache->entries[i].chain;
+}
+
+LookupCache *cacheNew(size_t capacity) {
+    if (capacity == 0 || capacity >= NONE) return NULL;
+
+    LookupCache *cache = malloc(sizeof(LookupCache));
+    if (!cache) return NULL;
+
+    size_t buckets = 1;
+    while (buckets < capacity)
+        buckets <<= 1;
+
+    cache->entries = malloc(capacity * sizeof(CacheEntry));
+    cache->buckets = malloc(buckets * sizeof(uint32_t));
+    if (!cache->entries || !cache->buckets) {
+        free(cache->entries);
+        free(cache->buckets);
+        free(cache);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < buckets; i++)
+        cache->buckets[i] = NONE;
+    cache->capacity = capacity;
+    cache->used = 0;
+    cache->mask = buckets - 1;
+    cache->head = cache->tail = NONE;
+    cache->hits = cache->misses = 0;
+    pthread_mutex_init(&cache->lock, NULL);
+    return cache;
+}
+
+void cacheDelete(LookupCache *cache) {
+    if (!cache) return;
+
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->entries);
+    free(cache->buckets);
+    free(cache);
+}
+
+void cacheKey(CacheKey *key, char const *num, size_t length) {
+    key->valid = length <= CACHE_MAX_LENGTH;
+    if (!key->valid) return;
+
+    memset(key->bytes, 0, CACHE_KEY_BYTES);
+    numPack(key->bytes, num, length);
+
+    /* Hasz łączy kolejne słowa klucza mnożeniem, zamiast przetwarzać go
+     * bajt po bajcie. */
+    uint64_t words[2], hash = key->bytes[CACHE_KEY_BYTES - 1];
+    memcpy(words, key->bytes, sizeof(words));
+    for (size_t i = 0; i < 2; i++)
+        hash = (hash ^ words[i]) * 0x9e3779b97f4a7c15ull;
+    key->hash = (uint32_t) (hash >> 32);
+}
+
+void *cacheFind(LookupCache *cache, CacheKey const *key, uint32_t generation,
+                CacheBuild build) {
+    void *result = NULL;
+    pthread_mutex_lock(&cache->lock);
+    uint32_t i = key->valid ? entryFind(cache, key) : NONE;
+    if (i != NONE && cache->entries[i].generation == generation) {
+        usageUnlink(cache, i);
+        usagePush(cache, i);
+        /* Wynik tworzony jest pod blokadą, ponieważ element może zostać
+         * zastąpiony przez inny wątek zaraz po jej zwolnieniu. */
+        result = build(cache->entries[i].target);
+    }
+    if (result) cache->hits++;
+    else cache->misses++;
+    pthread_mutex_unlock(&cache->lock);
+
+    return result;
+}
+
+void cachePut(LookupCache *cache, CacheKey const *key, uint32_t generation,
+              uint8_t const *target) {
+    size_t targetLength = packedLength(target);
+    if (!key->valid || targetLength > CACHE_MAX_LENGTH) return;
+
+    pthread_mutex_lock(&cache->lock);
+    uint32_t i = entryFind(cache, key);
+    if (i != NONE) {
+        usageUnlink(cache, i);
+    }
+    else {
+        if (cache->used < cache->capacity) {
+            i = (uint32_t) cache->used++;
+        }
+        else {
+            i = cache->tail;
+            usageUnlink(cache, i);
+            chainUnlink(cache, i);
+        }
+
+        CacheEntry *entry = &cache->entries[i];
+        memcpy(entry->key, key->bytes, CACHE_KEY_BYTES);
+        entry->hash = key->hash;
+        entry->chain = cache->buckets[key->hash & cache->mask];
+        cache->buckets[key->hash & cache->mask] = i;
+    }
+    cache->entries[i].generation = generation;
+    memcpy(cache->entries[i].target, target, packedSize(targetLength));
+    usagePush(cache, i);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void cacheClear(LookupCache *cache) {
+    if (!cache) return;
+
+    pthread_mutex_lock(&cache->lock);
+    for (size_t i = 0; i <= cache->mask; i++)
+        cache->buckets[i] = NONE;
+    cache->used = 0;
+    cache->head = cache->tail = NONE;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void cacheGetStats(LookupCache *cache, size_t *hits, size_t *misses) {
+    pthread_mutex_lock(&cache->lock);
+    *hits = cache->hits;
+    *misses = cache->misses;
+    pthread_mutex_unlock(&cache->lock);
+}
@@ -0,0 +1,123 @@
+/** @file
+ * Interfejs klasy obsługującej ograniczoną pamięć podręczną wyników
+ * zapytań o przekierowania numerów.
+ *
+ * Pamięć przechowuje co najwyżej ustaloną liczbę par numer–wynik, a gdy jest
+ * pełna, zastępuje parę najdawniej używaną. Każda para pamięta licznik zmian
+ * (zobacz trieGeneration()) z chwili wyznaczenia wyniku; para z innym
+ * licznikiem niż podany przy wyszukiwaniu jest nieaktualna i traktowana jak
+ * jej brak. Numery i wyniki przechowywane są jako upakowane numery (zobacz
+ * @ref packed.h) w elementach o stałym rozmiarze, więc zapamiętywane są
+ * jedynie pary, w których numer i wynik mają długość co najwyżej
+ * @ref CACHE_MAX_LENGTH.
+ *
+ * Wszystkie operacje wykonywane są pod blokadą, więc z pamięci może
+ * korzystać wiele wątków jednocześnie.
+ *
+ * @author Adam Greloch <ag438473@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef __LOOKUP_CACHE_H__
+#define __LOOKUP_CACHE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CACHE_MAX_LENGTH 32 /**< Największa długość zapamiętywanych numerów
+                                 i wyników. */
+
+#define CACHE_KEY_BYTES (1 + CACHE_MAX_LENGTH / 2) /**< Rozmiar upakowanego
+                                                        numeru o długości
+                                                        @ref CACHE_MAX_LENGTH.
+                                                        */
+
+/**
+ * To jest struktura przechowująca pamięć podręczną.
+ */
+struct LookupCache;
+typedef struct LookupCache LookupCache; /**< @struct LookupCache */
+
+/**
+ * Klucz numeru wyznaczany raz dla wyszukiwania i ewentualnego zapamiętania
+ * wyniku.
+ */
+typedef struct CacheKey {
+    uint8_t bytes[CACHE_KEY_BYTES]; /**< Upakowany numer dopełniony zerami. */
+    uint32_t hash; /**< Hasz numeru. */
+    bool valid; /**< Czy numer nie jest za długi, by go zapamiętać. */
+} CacheKey;
+
+/**
+ * Funkcja tworząca wynik zapytania z zapamiętanego upakowanego numeru.
+ */
+typedef void *(*CacheBuild)(uint8_t const *target);
+
+/** @brief Tworzy pustą pamięć podręczną.
+ * @param[in] capacity - największa liczba przechowywanych par, dodatnia.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ * alokować pamięci lub @p capacity jest zerem.
+ */
+LookupCache *cacheNew(size_t capacity);
+
+/** @brief Usuwa pamięć podręczną @p cache wraz z zapamiętanymi wynikami.
+ * Nic nie robi, jeśli @p cache ma wartość NULL.
+ * @param[in] cache - wskaźnik na usuwaną strukturę.
+ */
+void cacheDelete(LookupCache *cache);
+
+/** @brief Wyznacza klucz numeru @p num.
+ * @param[out] key - wskaźnik na wypełniany klucz.
+ * @param[in] num - poprawny ciąg znaków w kodowaniu wewnętrznym.
+ * @param[in] length - długość @p num.
+ */
+void cacheKey(CacheKey *key, char const *num, size_t length);
+
+/** @brief Wyszukuje wynik dla numeru o kluczu @p key.
+ * Jeśli pamięć ma aktualny wynik dla numeru, to oznacza go jako ostatnio
+ * używany i zwraca obiekt utworzony z niego funkcją @p build.
+ * @param[in,out] cache - wskaźnik na pamięć podręczną.
+ * @param[in] key - klucz numeru wyznaczony funkcją cacheKey().
+ * @param[in] generation - bieżący licznik zmian dla numeru.
+ * @param[in] build - funkcja tworząca wynik.
+ * @return Wynik funkcji @p build lub NULL, jeśli pamięć nie ma aktualnego
+ * wyniku.
+ */
+void *cacheFind(LookupCache *cache, CacheKey const *key, uint32_t generation,
+                CacheBuild build);
+
+/** @brief Zapamiętuje wynik @p target dla numeru o kluczu @p key.
+ * Zastępuje wcześniejszy wynik dla numeru, a jeśli go nie było i pamięć jest
+ * pełna, to najdawniej używaną parę. Nic nie robi, jeśli numer lub
+ * @p target jest za długi.
+ * @param[in,out] cache - wskaźnik na pamięć podręczną.
+ * @param[in] key - klucz numeru wyznaczony funkcją cacheKey().
+ * @param[in] generation - licznik zmian dla numeru z chwili przed
+ *                         wyznaczeniem wyniku.
+ * @param[in] target - wskaźnik na upakowany wynik, który zostanie
+ *                     skopiowany.
+ */
+void cachePut(LookupCache *cache, CacheKey const *key, uint32_t generation,
+              uint8_t const *target);
+
+/** @brief Usuwa wszystkie zapamiętane wyniki.
+ * Wywoływana, gdy wyniki przestają odpowiadać licznikom zmian, np. po
+ * zastąpieniu drzew, z których pochodzą liczniki. Nie zeruje liczników
+ * trafień i chybień.
+ * @param[in,out] cache - wskaźnik na pamięć podręczną lub NULL.
+ */
+void cacheClear(LookupCache *cache);
+
+/** @brief Odczytuje liczniki trafień i chybień pamięci @p cache.
+ * Chybieniem jest każde wyszukiwanie, które nie zwróciło wyniku.
+ * @param[in] cache - wskaźnik na pamięć podręczną.
+ * @param[out] hits - wskaźnik na zmienną, w której zostanie zapisana liczba
+ *                    trafień.
+ * @param[out] misses - wskaźnik na zmienną, w której zostanie zapisana
+ *                      liczba chybień.
+ */
+void cacheGetStats(LookupCache *cache, size_t *hits, size_t *misses);
+
+#endif /* __LOOKUP_CACHE_H__ */
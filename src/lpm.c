@@ -0,0 +1,734 @@
+/** @file
+ * Implementacja klasy obsługującej indeks najdłuższych prefiksów drzewa
+ * przekierowań.
+ *
+ * @author Adam Greloch <ag438473@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "lpm.h"
+#include "packed.h"
+#include "alphabet.h"
+
+#define INIT_SLOTS 8 /**< Początkowa liczba miejsc tablicy haszującej. */
+#define FNV_OFFSET 2166136261u /**< Wartość początkowa haszu FNV-1a. */
+#define FNV_PRIME 16777619u /**< Mnożnik haszu FNV-1a. */
+#define NO_TABLE SIZE_MAX /**< Brak tablicy w drzewie wyszukiwania. */
+
+/**
+ * Element tablicy haszującej. Element jest prefiksem, jeśli długość jego
+ * najdłuższego przekierowanego prefiksu równa się długości tablicy,
+ * a znacznikiem w przeciwnym wypadku. Element może być jednocześnie
+ * prefiksem i znacznikiem.
+ */
+typedef struct LpmEntry {
+    uint8_t const *key; /**< Upakowany ciąg elementu lub NULL dla wolnego
+                             miejsca. Klucz prefiksu należy do wywołującego,
+                             zaś klucz znacznika do indeksu. */
+    TrieNode *best; /**< Węzeł najdłuższego przekierowanego prefiksu ciągu
+                         elementu lub NULL. */
+    uint32_t hash; /**< Hasz ciągu elementu. */
+    uint32_t markers; /**< Liczba prefiksów, których wyszukiwanie wymaga
+                           tego elementu jako znacznika. */
+    uint32_t bestLength; /**< Długość prefiksu @p best. */
+} LpmEntry;
+
+/**
+ * Tablica haszująca ciągów jednej długości z adresowaniem otwartym.
+ */
+typedef struct LpmTable {
+    size_t length; /**< Długość ciągów tablicy. */
+    size_t amount; /**< Liczba zajętych miejsc. */
+    size_t markersOnly; /**< Liczba znaczników, które nie są prefiksami. */
+    size_t mask; /**< Liczba miejsc pomniejszona o jeden. */
+    LpmEntry *slots; /**< Miejsca tablicy lub NULL. */
+    size_t left; /**< Indeks tablicy odwiedzanej po chybieniu lub
+                      @ref NO_TABLE. */
+    size_t right; /**< Indeks tablicy odwiedzanej po trafieniu lub
+                       @ref NO_TABLE. */
+} LpmTable;
+
+/**
+ * Struktura przechowująca indeks.
+ */
+struct LpmIndex {
+    bool valid; /**< Czy indeks odpowiada drzewu. */
+    bool loading; /**< Czy trwa odbudowa rozpoczęta funkcją lpmReset(), więc
+                       indeksowi brakuje prefiksów. */
+    size_t count; /**< Liczba tablic. */
+    size_t size; /**< Pojemność tablicy @p tables. */
+    LpmTable *tables; /**< Tablice posortowane rosnąco po długości. */
+    size_t root; /**< Indeks tablicy odwiedzanej jako pierwsza lub
+                      @ref NO_TABLE. */
+    size_t depth; /**< Największa liczba sond wyszukiwania. */
+};
+
+/**
+ * Ciąg, którego prefiksy są wyszukiwane w tablicach. Jest to albo ciąg
+ * w kodowaniu wewnętrznym, albo bajty znaków upakowanego numeru.
+ */
+typedef struct LpmQuery {
+    char const *str; /**< Ciąg znaków lub NULL. */
+    uint8_t const *digits; /**< Bajty znaków, jeśli @p str ma wartość NULL. */
+} LpmQuery;
+
+/**
+ * @brief Rozprasza bity haszu FNV-1a, by jego młodsze bity nadawały się na
+ * indeks w tablicy.
+ * @param hash - hasz.
+ * @return Przekształcony hasz.
+ */
+static inline uint32_t hashFinish(uint32_t hash) {
+    hash ^= hash >> 15;
+    hash *= 0x2c1b3c6du;
+    hash ^= hash >> 12;
+    return hash;
+}
+
+/**
+ * @brief Wyznacza hasz @p length początkowych znaków zapytania @p q.
+ * Upakowany numer i ciąg o tych samych znakach mają ten sam hasz.
+ * @param q - wskaźnik na zapytanie.
+ * @param length - liczba znaków.
+ * @return Hasz prefiksu.
+ */
+static uint32_t queryHash(LpmQuery const *q, size_t length) {
+    uint32_t hash = FNV_OFFSET;
+    if (q->str)
+        for (size_t i = 0; i < length; i++)
+            hash = (hash ^ (uint32_t) symbolValue(q->str[i])) * FNV_PRIME;
+    else
+        for (size_t i = 0; i < length; i++)
+            hash = (hash ^ (uint32_t) packedSymbol(q->digits, i)) * FNV_PRIME;
+    return hashFinish(hash);
+}
+
+/**
+ * @brief Sprawdza, czy klucz @p key składa się z @p length początkowych
+ * znaków zapytania @p q.
+ * @param q - wskaźnik na zapytanie.
+ * @param key - upakowany ciąg o długości @p length.
+ * @param length - liczba porównywanych znaków.
+ * @return Wartość @p true, jeśli znaki są równe.
+ */
+static bool queryMatches(LpmQuery const *q, uint8_t const *key,
+                         size_t length) {
+    size_t keyLength;
+    uint8_t const *digits = packedDigits(key, &keyLength);
+
+    if (!q->str) {
+        if (memcmp(digits, q->digits, length / 2) != 0) return false;
+        return !(length & 1) ||
+               !((digits[length / 2] ^ q->digits[length / 2]) & 0xF0);
+    }
+
+    size_t i = 0;
+    for (; i + 1 < length; i += 2)
+        if (digits[i / 2] != ((symbolValue(q->str[i]) + 1) << 4 |
+                              (symbolValue(q->str[i + 1]) + 1)))
+            return false;
+    return i == length || packedSymbol(digits, i) == symbolValue(q->str[i]);
+}
+
+/**
+ * @brief Sprawdza, czy element @p entry jest prefiksem.
+ * @param table - wskaźnik na tablicę elementu.
+ * @param entry - wskaźnik na element.
+ * @return Wartość @p true, jeśli element jest przekierowanym prefiksem.
+ */
+static inline bool entryIsReal(LpmTable const *table, LpmEntry const *entry) {
+    return entry->bestLength == table->length;
+}
+
+/**
+ * @brief Znajduje w tablicy @p table element prefiksu zapytania @p q.
+ * @param table - wskaźnik na tablicę.
+ * @param q - wskaźnik na zapytanie o długości co najmniej długości tablicy.
+ * @param hash - hasz prefiksu.
+ * @return Wskaźnik na element lub NULL, jeśli tablica go nie zawiera.
+ */
+static LpmEntry *tableFind(LpmTable const *table, LpmQuery const *q,
+                           uint32_t hash) {
+    if (!table->slots) return NULL;
+
+    for (size_t i = hash & table->mask;; i = (i + 1) & table->mask) {
+        LpmEntry *entry = &table->slots[i];
+        if (!entry->key) return NULL;
+        if (entry->hash == hash && queryMatches(q, entry->key, table->length))
+            return entry;
+    }
+}
+
+/**
+ * @brief Umieszcza element @p entry w pierwszym wolnym miejscu ciągu sond.
+ * Zakłada, że tablica ma wolne miejsce.
+ * @param slots - miejsca tablicy.
+ * @param mask - liczba miejsc pomniejszona o jeden.
+ * @param entry - wskaźnik na umieszczany element.
+ * @return Wskaźnik na umieszczony element.
+ */
+static LpmEntry *slotsPlace(LpmEntry *slots, size_t mask,
+                            LpmEntry const *entry) {
+    size_t i = entry->hash & mask;
+    while (slots[i].key)
+        i = (i + 1) & mask;
+    slots[i] = *entry;
+    return &slots[i];
+}
+
+/**
+ * @brief Przenosi elementy tablicy @p table do nowych miejsc.
+ * @param table - wskaźnik na tablicę.
+ * @param slots - liczba nowych miejsc, potęga dwójki większa od liczby
+ *                elementów.
+ * @return Wartość @p true, jeśli się udało, lub @p false, gdy nie udało się
+ * alokować pamięci. W tym drugim wypadku tablica pozostaje bez zmian.
+ */
+static bool tableRehash(LpmTable *table, size_t slots) {
+    LpmEntry *moved = calloc(slots, sizeof(LpmEntry));
+    if (!moved) return false;
+
+    for (size_t i = 0; table->slots && i <= table->mask; i++)
+        if (table->slots[i].key)
+            slotsPlace(moved, slots - 1, &table->slots[i]);
+
+    free(table->slots);
+    table->slots = moved;
+    table->mask = slots - 1;
+    return true;
+}
+
+/**
+ * @brief Dodaje element @p entry do tablicy @p table, powiększając ją
+ * w razie potrzeby.
+ * @param table - wskaźnik na tablicę.
+ * @param entry - wskaźnik na dodawany element.
+ * @return Wartość @p true, jeśli się udało, lub @p false, gdy nie udało się
+ * alokować pamięci.
+ */
+static bool tableAdd(LpmTable *table, LpmEntry const *entry) {
+    size_t slots = table->slots ? table->mask + 1 : 0;
+    if (4 * (table->amount + 1) > 3 * slots &&
+        !tableRehash(table, slots ? 2 * slots : INIT_SLOTS))
+        return false;
+
+    slotsPlace(table->slots, table->mask, entry);
+    table->amount++;
+    return true;
+}
+
+/**
+ * @brief Usuwa element @p entry z tablicy @p table.
+ * Przesuwa wstecz elementy dalszej części ciągu sond, tak by żaden nie był
+ * oddzielony od swojej pozycji wolnym miejscem. Nie zwalnia klucza.
+ * @param table - wskaźnik na tablicę.
+ * @param entry - wskaźnik na usuwany element tablicy.
+ */
+static void tableErase(LpmTable *table, LpmEntry *entry) {
+    size_t hole = (size_t) (entry - table->slots), i = hole, home;
+
+    for (;;) {
+        i = (i + 1) & table->mask;
+        if (!table->slots[i].key) break;
+
+        /* Element może wypełnić dziurę, jeśli jego pozycja nie leży
+         * cyklicznie między dziurą a nim samym. */
+        home = table->slots[i].hash & table->mask;
+        if (((i - home) & table->mask) >= ((i - hole) & table->mask)) {
+            table->slots[hole] = table->slots[i];
+            hole = i;
+        }
+    }
+
+    table->slots[hole].key = NULL;
+    table->amount--;
+}
+
+/**
+ * @brief Wyszukuje binarnie tablicę ciągów długości @p length.
+ * @param lpm - wskaźnik na indeks.
+ * @param length - długość.
+ * @param pos - wskaźnik na zmienną, w której zostanie zapisany indeks
+ *              pierwszej tablicy o długości nie mniejszej od @p length.
+ * @return Wartość @p true, jeśli tablica tej długości istnieje.
+ */
+static bool findTable(LpmIndex const *lpm, size_t length, size_t *pos) {
+    size_t low = 0, high = lpm->count, mid;
+    while (low < high) {
+        mid = low + (high - low) / 2;
+        if (lpm->tables[mid].length < length) low = mid + 1;
+        else high = mid;
+    }
+    *pos = low;
+    return low < lpm->count && lpm->tables[low].length == length;
+}
+
+/**
+ * @brief Wyszukuje najdłuższy przekierowany prefiks zapytania @p q o długości
+ * nie większej od @p limit.
+ * Tablice o długości większej od @p limit traktowane są jak chybienia.
+ * @param lpm - wskaźnik na indeks.
+ * @param q - wskaźnik na zapytanie o długości co najmniej @p limit.
+ * @param limit - długość zapytania.
+ * @param found - wskaźnik na zmienną, w której zostanie zapisana długość
+ *                znalezionego prefiksu lub zero.
+ * @return Wskaźnik na węzeł prefiksu lub NULL.
+ */
+static TrieNode *search(LpmIndex const *lpm, LpmQuery const *q, size_t limit,
+                        size_t *found) {
+    size_t j = lpm->root, bestLength = 0;
+    TrieNode *best = NULL;
+    LpmTable const *table;
+    LpmEntry const *entry;
+
+    while (j != NO_TABLE) {
+        table = &lpm->tables[j];
+        entry = table->length <= limit ?
+                tableFind(table, q, queryHash(q, table->length)) : NULL;
+        if (entry) {
+            best = entry->best;
+            bestLength = entry->bestLength;
+            j = table->right;
+        }
+        else {
+            j = table->left;
+        }
+    }
+    *found = bestLength;
+    return best;
+}
+
+/**
+ * @brief Dodaje jedno odwołanie do znacznika z początkowych znaków
+ * prefiksu @p prefix w tablicy o indeksie @p idx.
+ * Nowy znacznik zapamiętuje najdłuższy przekierowany prefiks swojego ciągu.
+ * @param lpm - wskaźnik na indeks.
+ * @param idx - indeks tablicy.
+ * @param prefix - upakowany prefiks dłuższy od długości tablicy.
+ * @return Wartość @p true, jeśli się udało, lub @p false, gdy nie udało się
+ * alokować pamięci.
+ */
+static bool markerAdd(LpmIndex *lpm, size_t idx, uint8_t const *prefix) {
+    LpmTable *table = &lpm->tables[idx];
+    size_t length;
+    LpmQuery q = {NULL, packedDigits(prefix, &length)};
+    uint32_t hash = queryHash(&q, table->length);
+
+    LpmEntry *entry = tableFind(table, &q, hash);
+    if (entry) {
+        entry->markers++;
+        return true;
+    }
+
+    size_t bestLength;
+    TrieNode *best = search(lpm, &q, table->length, &bestLength);
+
+    uint8_t *key = malloc(packedSize(table->length));
+    if (!key) return false;
+    packedPrefix(key, prefix, table->length);
+
+    LpmEntry added = {key, best, hash, 1, (uint32_t) bestLength};
+    if (!tableAdd(table, &added)) {
+        free(key);
+        return false;
+    }
+    table->markersOnly++;
+    return true;
+}
+
+/**
+ * @brief Usuwa jedno odwołanie do znacznika z początkowych znaków prefiksu
+ * @p prefix w tablicy o indeksie @p idx.
+ * @param lpm - wskaźnik na indeks.
+ * @param idx - indeks tablicy.
+ * @param prefix - upakowany prefiks dłuższy od długości tablicy.
+ */
+static void markerRemove(LpmIndex *lpm, size_t idx, uint8_t const *prefix) {
+    LpmTable *table = &lpm->tables[idx];
+    size_t length;
+    LpmQuery q = {NULL, packedDigits(prefix, &length)};
+    LpmEntry *entry = tableFind(table, &q, queryHash(&q, table->length));
+
+    if (!entry || entry->markers == 0) return;
+    if (--entry->markers == 0 && !entryIsReal(table, entry)) {
+        free((void *) entry->key);
+        tableErase(table, entry);
+        table->markersOnly--;
+    }
+}
+
+/**
+ * @brief Wyznacza długości tablic, w których prefiksy tablicy o indeksie
+ * @p target mają znaczniki.
+ * Znaczniki leżą w tablicach, które wyszukiwanie długości prefiksu odwiedza
+ * przed dotarciem do niej i po których przesuwa się ku dłuższym długościom.
+ * @param lpm - wskaźnik na indeks.
+ * @param target - indeks tablicy.
+ * @return Maska bitowa, w której bit o numerze @p n odpowiada długości
+ * @p n + 1.
+ */
+static uint64_t markerLengths(LpmIndex const *lpm, size_t target) {
+    uint64_t lengths = 0;
+    size_t length = lpm->tables[target].length;
+    for (size_t j = lpm->root; j != target;) {
+        LpmTable const *table = &lpm->tables[j];
+        if (table->length > length) {
+            j = table->left;
+            continue;
+        }
+        lengths |= UINT64_C(1) << (table->length - 1);
+        j = table->right;
+    }
+    return lengths;
+}
+
+/**
+ * @brief Dodaje lub usuwa znaczniki prefiksu @p prefix w tablicach długości
+ * @p lengths.
+ * Długości, których tablic nie ma w indeksie, są pomijane.
+ * @param lpm - wskaźnik na indeks.
+ * @param prefix - upakowany prefiks dłuższy od długości @p lengths.
+ * @param lengths - maska długości jak w markerLengths().
+ * @param add - czy dodać znaczniki.
+ * @return Wartość @p true, jeśli się udało, lub @p false, gdy nie udało się
+ * alokować pamięci.
+ */
+static bool markersUpdate(LpmIndex *lpm, uint8_t const *prefix,
+                          uint64_t lengths, bool add) {
+    size_t pos;
+    for (; lengths; lengths &= lengths - 1) {
+        if (!findTable(lpm, (size_t) __builtin_ctzll(lengths) + 1, &pos))
+            continue;
+        if (add && !markerAdd(lpm, pos, prefix)) return false;
+        if (!add) markerRemove(lpm, pos, prefix);
+    }
+    return true;
+}
+
+/**
+ * @brief Zapamiętuje długości znaczników prefiksów każdej tablicy przed
+ * zmianą drzewa długości.
+ * @param lpm - wskaźnik na indeks.
+ * @param paths - tablica indeksowana długościami, w której zostaną
+ *                zapisane maski markerLengths() tablic; pozostałe
+ *                długości otrzymują maskę pustą.
+ */
+static void pathsSave(LpmIndex const *lpm, uint64_t *paths) {
+    memset(paths, 0, (LPM_MAX_LENGTH + 1) * sizeof(uint64_t));
+    for (size_t j = 0; j < lpm->count; j++)
+        paths[lpm->tables[j].length] = markerLengths(lpm, j);
+}
+
+/**
+ * @brief Przenosi znaczniki po zmianie drzewa długości.
+ * Znaczniki zmieniają się jedynie dla tablic, których wyszukiwanie odwiedza
+ * teraz inne tablice niż przed zmianą; pozostałe tablice nie są
+ * przeglądane. Tablice przetwarzane są od najkrótszych, dzięki czemu nowy
+ * znacznik wyznacza swój najdłuższy prefiks z indeksu, w którym wszystkie
+ * krótsze prefiksy mają już swoje znaczniki. Nieaktualne znaczniki nie
+ * psują wyszukiwania, ponieważ pamiętają najdłuższe prefiksy swoich
+ * ciągów.
+ * @param lpm - wskaźnik na indeks.
+ * @param paths - maski zapisane przez pathsSave() przed zmianą.
+ * @return Wartość @p true, jeśli się udało, lub @p false, gdy nie udało się
+ * alokować pamięci.
+ */
+static bool reshape(LpmIndex *lpm, uint64_t const *paths) {
+    for (size_t j = 0; j < lpm->count; j++) {
+        LpmTable *table = &lpm->tables[j];
+        uint64_t before = paths[table->length], after = markerLengths(lpm, j);
+        if (before == after) continue;
+
+        for (size_t i = 0; table->slots && i <= table->mask; i++) {
+            /* Znaczniki trafiają do tablic krótszych długości, więc
+             * przeglądana tablica nie zmienia się. */
+            LpmEntry *entry = &table->slots[i];
+            if (!entry->key || !entryIsReal(table, entry)) continue;
+            markersUpdate(lpm, entry->key, before & ~after, false);
+            if (!markersUpdate(lpm, entry->key, after & ~before, true))
+                return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Zwiększa o jeden indeks tablicy @p idx, jeśli jest on nie mniejszy
+ * od @p pos.
+ * @param idx - wskaźnik na indeks tablicy lub @ref NO_TABLE.
+ * @param pos - pozycja wstawionej tablicy.
+ */
+static inline void shiftIndex(size_t *idx, size_t pos) {
+    if (*idx != NO_TABLE && *idx >= pos) (*idx)++;
+}
+
+/**
+ * @brief Dodaje pustą tablicę ciągów długości @p length na pozycji @p pos.
+ * Tablica staje się liściem drzewa wyszukiwania, więc wyszukiwanie innych
+ * długości nie zmienia się, a ich znaczniki pozostają na miejscu.
+ * @param lpm - wskaźnik na indeks.
+ * @param pos - pozycja zachowująca porządek długości.
+ * @param length - długość.
+ * @return Wartość @p true, jeśli się udało, lub @p false, gdy nie udało się
+ * alokować pamięci.
+ */
+static bool addTable(LpmIndex *lpm, size_t pos, size_t length) {
+    if (lpm->count == lpm->size) {
+        size_t size = lpm->size ? 2 * lpm->size : INIT_SLOTS;
+        LpmTable *tables = realloc(lpm->tables, size * sizeof(LpmTable));
+        if (!tables) return false;
+        lpm->tables = tables;
+        lpm->size = size;
+    }
+
+    memmove(&lpm->tables[pos + 1], &lpm->tables[pos],
+            (lpm->count - pos) * sizeof(LpmTable));
+    lpm->tables[pos] = (LpmTable) {length, 0, 0, 0, NULL, NO_TABLE,
+                                   NO_TABLE};
+    lpm->count++;
+
+    shiftIndex(&lpm->root, pos);
+    for (size_t j = 0; j < lpm->count; j++) {
+        shiftIndex(&lpm->tables[j].left, pos);
+        shiftIndex(&lpm->tables[j].right, pos);
+    }
+
+    size_t *link = &lpm->root, depth = 1;
+    while (*link != NO_TABLE) {
+        LpmTable *table = &lpm->tables[*link];
+        link = table->length < length ? &table->right : &table->left;
+        depth++;
+    }
+    *link = pos;
+    if (depth > lpm->depth) lpm->depth = depth;
+    return true;
+}
+
+/**
+ * @brief Buduje zrównoważone drzewo wyszukiwania tablic o indeksach od
+ * @p low do @p high - 1.
+ * Korzeniem jest środkowa tablica, jak w wyszukiwaniu binarnym.
+ * @param lpm - wskaźnik na indeks.
+ * @param low - indeks pierwszej tablicy.
+ * @param high - indeks za ostatnią tablicą.
+ * @param depth - głębokość korzenia, licząc od jedynki.
+ * @return Indeks korzenia lub @ref NO_TABLE, jeśli przedział jest pusty.
+ */
+static size_t balance(LpmIndex *lpm, size_t low, size_t high, size_t depth) {
+    if (low >= high) return NO_TABLE;
+
+    size_t mid = low + (high - low) / 2;
+    if (depth > lpm->depth) lpm->depth = depth;
+    lpm->tables[mid].left = balance(lpm, low, mid, depth + 1);
+    lpm->tables[mid].right = balance(lpm, mid + 1, high, depth + 1);
+    return mid;
+}
+
+LpmIndex *lpmNew(void) {
+    LpmIndex *lpm = malloc(sizeof(LpmIndex));
+    if (!lpm) return NULL;
+
+    lpm->valid = true;
+    lpm->loading = false;
+    lpm->count = 0;
+    lpm->size = 0;
+    lpm->tables = NULL;
+    lpm->root = NO_TABLE;
+    lpm->depth = 0;
+    return lpm;
+}
+
+void lpmInvalidate(LpmIndex *lpm) {
+    for (size_t j = 0; j < lpm->count; j++) {
+        LpmTable *table = &lpm->tables[j];
+        for (size_t i = 0; table->slots && i <= table->mask; i++)
+            if (table->slots[i].key && !entryIsReal(table, &table->slots[i]))
+                free((void *) table->slots[i].key);
+        free(table->slots);
+    }
+
+    free(lpm->tables);
+    lpm->tables = NULL;
+    lpm->count = 0;
+    lpm->size = 0;
+    lpm->root = NO_TABLE;
+    lpm->depth = 0;
+    lpm->valid = false;
+    lpm->loading = false;
+}
+
+void lpmAbandon(LpmIndex *lpm) {
+    lpm->valid = false;
+}
+
+void lpmDelete(LpmIndex *lpm) {
+    if (!lpm) return;
+    lpmInvalidate(lpm);
+    free(lpm);
+}
+
+bool lpmIsValid(LpmIndex const *lpm) {
+    return lpm->valid && !lpm->loading;
+}
+
+size_t lpmLengths(LpmIndex const *lpm) {
+    return lpm->count;
+}
+
+size_t lpmDepth(LpmIndex const *lpm) {
+    return lpm->depth;
+}
+
+uint64_t lpmMarkedLengths(LpmIndex const *lpm) {
+    uint64_t marked = 0;
+    for (size_t j = 0; lpm->valid && j < lpm->count; j++)
+        if (lpm->tables[j].markersOnly)
+            marked |= UINT64_C(1) << (lpm->tables[j].length - 1);
+    return marked;
+}
+
+TrieNode *lpmFind(LpmIndex const *lpm, char const *str, size_t length,
+                  size_t *found) {
+    LpmQuery q = {str, NULL};
+    return search(lpm, &q, length, found);
+}
+
+bool lpmInsert(LpmIndex *lpm, TrieNode *node, uint8_t const *key,
+               TrieNode **previous) {
+    *previous = NULL;
+    if (!lpm->valid) return false;
+
+    size_t length, pos, ignored;
+    uint8_t const *digits = packedDigits(key, &length);
+    if (length > LPM_MAX_LENGTH) {
+        lpmInvalidate(lpm);
+        return false;
+    }
+
+    if (!findTable(lpm, length, &pos) && !addTable(lpm, pos, length)) {
+        lpmInvalidate(lpm);
+        return false;
+    }
+
+    LpmQuery q = {NULL, digits};
+    *previous = search(lpm, &q, length - 1, &ignored);
+    if (!markersUpdate(lpm, key, markerLengths(lpm, pos), true)) {
+        lpmInvalidate(lpm);
+        return false;
+    }
+
+    LpmTable *table = &lpm->tables[pos];
+    uint32_t hash = queryHash(&q, length);
+    LpmEntry *entry = tableFind(table, &q, hash);
+    if (entry) {
+        /* Znacznik staje się prefiksem, więc jego kluczem zostaje klucz
+         * prefiksu. */
+        free((void *) entry->key);
+        table->markersOnly--;
+        entry->key = key;
+        entry->best = node;
+        entry->bestLength = (uint32_t) length;
+    }
+    else {
+        LpmEntry added = {key, node, hash, 0, (uint32_t) length};
+        if (!tableAdd(table, &added)) {
+            lpmInvalidate(lpm);
+            return false;
+        }
+    }
+    return true;
+}
+
+void lpmRetarget(LpmIndex *lpm, char const *str, size_t length,
+                 TrieNode *from, TrieNode *to, size_t toLength) {
+    size_t pos;
+    if (!lpm->valid || !findTable(lpm, length, &pos)) return;
+
+    LpmTable *table = &lpm->tables[pos];
+    LpmQuery q = {str, NULL};
+    LpmEntry *entry = tableFind(table, &q, queryHash(&q, length));
+    if (entry && entry->best == from) {
+        entry->best = to;
+        entry->bestLength = (uint32_t) toLength;
+    }
+}
+
+void lpmRemove(LpmIndex *lpm, uint8_t const *key) {
+    if (!lpm->valid) return;
+
+    size_t length, pos;
+    uint8_t const *digits = packedDigits(key, &length);
+    LpmQuery q = {NULL, digits};
+    LpmEntry *entry = NULL;
+    if (findTable(lpm, length, &pos))
+        entry = tableFind(&lpm->tables[pos], &q, queryHash(&q, length));
+
+    /* Element wciąż potrzebny jako znacznik oznacza naruszenie warunku
+     * usuwania od najdłuższych prefiksów. */
+    if (!entry || !entryIsReal(&lpm->tables[pos], entry) || entry->markers) {
+        lpmInvalidate(lpm);
+        return;
+    }
+
+    tableErase(&lpm->tables[pos], entry);
+    markersUpdate(lpm, key, markerLengths(lpm, pos), false);
+}
+
+void lpmReset(LpmIndex *lpm, uint64_t lengths) {
+    lpmInvalidate(lpm);
+
+    size_t count = (size_t) __builtin_popcountll(lengths);
+    lpm->tables = count ? malloc(count * sizeof(LpmTable)) : NULL;
+    if (count && !lpm->tables) return;
+    for (; lengths; lengths &= lengths - 1)
+        lpm->tables[lpm->count++] = (LpmTable) {
+            (size_t) __builtin_ctzll(lengths) + 1, 0, 0, 0, NULL, NO_TABLE,
+            NO_TABLE};
+    lpm->size = count;
+    lpm->root = balance(lpm, 0, count, 1);
+    lpm->valid = true;
+    lpm->loading = true;
+}
+
+bool lpmIsLoading(LpmIndex const *lpm) {
+    return lpm->valid && lpm->loading;
+}
+
+bool lpmCompact(LpmIndex *lpm) {
+    if (!lpm->valid) return false;
+
+    uint64_t paths[LPM_MAX_LENGTH + 1];
+    pathsSave(lpm, paths);
+
+    /* Tablica bez prefiksów przechowuje wyłącznie znaczniki, których
+     * klucze należą do indeksu. */
+    size_t kept = 0;
+    for (size_t j = 0; j < lpm->count; j++) {
+        LpmTable *table = &lpm->tables[j];
+        if (table->amount > table->markersOnly) {
+            lpm->tables[kept++] = *table;
+            continue;
+        }
+        for (size_t i = 0; table->slots && i <= table->mask; i++)
+            free((void *) table->slots[i].key);
+        free(table->slots);
+    }
+    /* Dodane długości wydłużają wyszukiwanie, więc drzewo równoważone jest
+     * dopiero, gdy stanie się ponad dwukrotnie głębsze od zrównoważonego. */
+    size_t balanced = 0;
+    while (kept >> balanced) balanced++;
+    lpm->loading = false;
+    if (kept == lpm->count && lpm->depth <= 2 * balanced) return true;
+
+    lpm->count = kept;
+    lpm->depth = 0;
+    lpm->root = balance(lpm, 0, kept, 1);
+    if (!reshape(lpm, paths)) {
+        lpmInvalidate(lpm);
+        return false;
+    }
+    return true;
+}
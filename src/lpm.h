@@ -0,0 +1,193 @@
+/** @file
+ * Interfejs klasy obsługującej indeks najdłuższych prefiksów drzewa
+ * przekierowań. Klasa implementuje strukturę @p LpmIndex zadeklarowaną
+ * w interfejsie @ref structs.h.
+ *
+ * Indeks przechowuje osobną tablicę haszującą dla każdej długości, jaką
+ * miał kiedykolwiek któryś z przekierowanych prefiksów. Najdłuższy prefiks
+ * ciągu wyszukiwany jest w drzewie poszukiwań binarnych długości: trafienie
+ * w tablicy przesuwa wyszukiwanie ku dłuższym długościom, chybienie ku
+ * krótszym. Aby trafienie nie pominęło dłuższego prefiksu, każdy prefiks
+ * umieszcza w tablicach krótszych długości, które odwiedza wyszukiwanie
+ * jego długości, znaczniki ze swoimi początkowymi znakami. Każdy element
+ * tablicy pamięta najdłuższy przekierowany prefiks swojego ciągu, więc
+ * wynikiem jest prefiks zapamiętany w ostatnim trafionym elemencie.
+ * Wyszukiwanie w zrównoważonym drzewie wykonuje zatem co najwyżej tyle sond,
+ * ile wynosi logarytm z liczby długości, zamiast przechodzić po węzłach
+ * drzewa przekierowań.
+ *
+ * Nowa długość staje się liściem drzewa długości, więc jej dodanie nie
+ * zmienia wyszukiwania innych długości ani ich znaczników. Długości, których
+ * ostatnie prefiksy zniknęły, usuwa dopiero lpmCompact(), która równoważy
+ * wtedy drzewo, podobnie jak wtedy, gdy dodane długości uczyniły je ponad
+ * dwukrotnie głębszym od zrównoważonego. Przenosi przy tym znaczniki
+ * wszystkich prefiksów tych długości, których wyszukiwanie odwiedza odtąd
+ * inne tablice; prefiksy pozostałych długości nie są przeglądane. Jeśli nie
+ * uda się alokować pamięci na uaktualnienie indeksu lub dodawany prefiks
+ * jest dłuższy niż @ref LPM_MAX_LENGTH znaków, to indeks zostaje porzucony
+ * i przestaje być ważny (zobacz lpmIsValid()); drzewo pozostaje wówczas
+ * jedynym źródłem wyników, dopóki wywołujący nie odbuduje indeksu. Odbudowa
+ * rozpoczęta funkcją lpmReset() może trwać przez wiele operacji: wywołujący
+ * dodaje prefiksy funkcją lpmInsert() porcjami, a indeks przyjmuje w tym
+ * czasie również zwykłe uaktualnienia, lecz nie jest ważny aż do wywołania
+ * lpmCompact().
+ *
+ * Klucze prefiksów są upakowanymi numerami (zobacz @ref packed.h) należącymi
+ * do wywołującego, zaś ciągi zapytań są w kodowaniu wewnętrznym (zobacz
+ * @ref alphabet.h).
+ *
+ * @author Adam Greloch <ag438473@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef __LPM_H__
+#define __LPM_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "structs.h"
+
+#define LPM_MAX_LENGTH 64 /**< Największa długość indeksowanych prefiksów.
+                               Przy dłuższych prefiksach hasze i przebudowy
+                               znaczników kosztowałyby więcej niż przejście
+                               po drzewie. */
+
+/** @brief Tworzy nowy, pusty i ważny indeks.
+ * @return Wskaźnik na utworzony indeks lub NULL, gdy nie udało się alokować
+ * pamięci.
+ */
+LpmIndex *lpmNew(void);
+
+/** @brief Usuwa indeks @p lpm. Nic nie robi, jeśli @p lpm ma wartość NULL.
+ * @param[in] lpm - wskaźnik na usuwany indeks.
+ */
+void lpmDelete(LpmIndex *lpm);
+
+/** @brief Sprawdza, czy indeks @p lpm odpowiada drzewu.
+ * @param[in] lpm - wskaźnik na indeks.
+ * @return Wartość @p true, jeśli wyniki lpmFind() są poprawne. Wartość
+ * @p false, jeśli indeks został porzucony lub jest odbudowywany.
+ */
+bool lpmIsValid(LpmIndex const *lpm);
+
+/** @brief Zwraca liczbę długości indeksu @p lpm.
+ * @param[in] lpm - wskaźnik na indeks.
+ * @return Liczba tablic haszujących, w tym tablic długości, których
+ * prefiksy zniknęły przed ostatnim wywołaniem lpmCompact().
+ */
+size_t lpmLengths(LpmIndex const *lpm);
+
+/** @brief Zwraca głębokość drzewa długości indeksu @p lpm.
+ * @param[in] lpm - wskaźnik na indeks.
+ * @return Największa liczba sond wyszukiwania.
+ */
+size_t lpmDepth(LpmIndex const *lpm);
+
+/** @brief Wyznacza długości, w których leżą znaczniki niebędące prefiksami.
+ * Tylko takie elementy mogą wymagać uaktualnienia funkcją lpmRetarget() po
+ * dodaniu prefiksu.
+ * @param[in] lpm - wskaźnik na indeks.
+ * @return Maska bitowa, w której bit o numerze @p n odpowiada długości
+ * @p n + 1, lub zero, jeśli indeks nie jest ważny.
+ */
+uint64_t lpmMarkedLengths(LpmIndex const *lpm);
+
+/** @brief Porzuca indeks @p lpm.
+ * Zwalnia pamięć wszystkich tablic. Indeks nie jest odtąd ważny, a dalsze
+ * uaktualnienia nic nie robią.
+ * @param[in,out] lpm - wskaźnik na indeks.
+ */
+void lpmInvalidate(LpmIndex *lpm);
+
+/** @brief Sprawdza, czy indeks @p lpm jest odbudowywany.
+ * @param[in] lpm - wskaźnik na indeks.
+ * @return Wartość @p true, jeśli od wywołania lpmReset() indeks nie został
+ * porzucony ani ukończony funkcją lpmCompact().
+ */
+bool lpmIsLoading(LpmIndex const *lpm);
+
+/** @brief Porzuca indeks @p lpm w czasie stałym.
+ * Działa jak lpmInvalidate(), lecz nie zwalnia tablic. Ich pamięć zwalnia
+ * dopiero lpmReset() przed odbudową lub lpmDelete().
+ * @param[in,out] lpm - wskaźnik na indeks.
+ */
+void lpmAbandon(LpmIndex *lpm);
+
+/** @brief Znajduje najdłuższy przekierowany prefiks ciągu @p str.
+ * @param[in] lpm - wskaźnik na ważny indeks.
+ * @param[in] str - ciąg znaków w kodowaniu wewnętrznym.
+ * @param[in] length - długość @p str.
+ * @param[out] found - wskaźnik na zmienną, w której zostanie zapisana
+ *                     długość znalezionego prefiksu lub zero.
+ * @return Wskaźnik na węzeł prefiksu lub NULL, jeśli żaden prefiks @p str
+ * nie jest przekierowany.
+ */
+TrieNode *lpmFind(LpmIndex const *lpm, char const *str, size_t length,
+                  size_t *found);
+
+/** @brief Dodaje do indeksu nowo przekierowany prefiks.
+ * Dodaje element prefiksu i jego znaczniki. Nie uaktualnia elementów
+ * dłuższych ciągów, których najdłuższym przekierowanym prefiksem staje się
+ * @p key; należy to zrobić funkcją lpmRetarget().
+ * @param[in,out] lpm - wskaźnik na indeks.
+ * @param[in] node - wskaźnik na węzeł prefiksu.
+ * @param[in] key - upakowany prefiks, niezmieniony i niezwolniony, dopóki
+ *                  prefiks nie zostanie usunięty z indeksu.
+ * @param[out] previous - wskaźnik na zmienną, w której zostanie zapisany
+ *                        najdłuższy przekierowany właściwy prefiks @p key
+ *                        lub NULL.
+ * @return Wartość @p true, jeśli prefiks został dodany. Wartość @p false,
+ * jeśli indeks nie był ważny ani odbudowywany lub został porzucony z braku
+ * pamięci albo z powodu długości prefiksu.
+ */
+bool lpmInsert(LpmIndex *lpm, TrieNode *node, uint8_t const *key,
+               TrieNode **previous);
+
+/** @brief Uaktualnia najdłuższy przekierowany prefiks elementu ciągu @p str.
+ * Jeśli indeks ma element ciągu @p str, którego najdłuższym przekierowanym
+ * prefiksem jest @p from, to zastępuje go prefiksem @p to. Nic nie robi
+ * w przeciwnym wypadku.
+ * @param[in,out] lpm - wskaźnik na indeks.
+ * @param[in] str - ciąg znaków w kodowaniu wewnętrznym.
+ * @param[in] length - długość @p str.
+ * @param[in] from - wskaźnik na węzeł poprzedniego prefiksu lub NULL.
+ * @param[in] to - wskaźnik na węzeł nowego prefiksu.
+ * @param[in] toLength - długość nowego prefiksu.
+ */
+void lpmRetarget(LpmIndex *lpm, char const *str, size_t length,
+                 TrieNode *from, TrieNode *to, size_t toLength);
+
+/** @brief Usuwa z indeksu przekierowany prefiks @p key.
+ * Zakłada, że wcześniej usunięto wszystkie dłuższe prefiksy zaczynające się
+ * od @p key, co zapewnia usuwanie poddrzewa od liści.
+ * @param[in,out] lpm - wskaźnik na indeks.
+ * @param[in] key - klucz przekazany do lpmInsert().
+ */
+void lpmRemove(LpmIndex *lpm, uint8_t const *key);
+
+/** @brief Opróżnia indeks @p lpm i rozpoczyna jego odbudowę.
+ * Tworzy puste tablice długości @p lengths w zrównoważonym drzewie
+ * długości, więc prefiksy tych długości dodawane funkcją lpmInsert() nie
+ * wydłużają wyszukiwania. Indeks nie jest ważny, dopóki lpmCompact() nie
+ * zakończy odbudowy. Jeśli nie uda się alokować pamięci, to indeks zostaje
+ * porzucony.
+ * @param[in,out] lpm - wskaźnik na indeks.
+ * @param[in] lengths - maska długości jak w lpmMarkedLengths().
+ */
+void lpmReset(LpmIndex *lpm, uint64_t lengths);
+
+/** @brief Usuwa długości bez prefiksów i kończy odbudowę indeksu.
+ * Jeśli indeks ma tablice, w których zostały same znaczniki, lub drzewo
+ * długości jest ponad dwukrotnie głębsze od zrównoważonego, to usuwa te
+ * tablice, równoważy drzewo i przenosi znaczniki prefiksów, których
+ * wyszukiwanie się zmieniło. W pozostałych przypadkach jedynie przegląda
+ * tablice. Odbudowywany indeks staje się ważny.
+ * @param[in,out] lpm - wskaźnik na indeks.
+ * @return Wartość @p true, jeśli indeks jest ważny. Wartość @p false, jeśli
+ * był porzucony lub został porzucony z braku pamięci.
+ */
+bool lpmCompact(LpmIndex *lpm);
+
+#endif /* __LPM_H__ */
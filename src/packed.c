@@ -0,0 +1,199 @@
+/** @file
+ * Implementacja klasy obsługującej upakowane numery.
+ *
+ * @author Adam Greloch <ag438473@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <string.h>
+#include "packed.h"
+#include "alphabet.h"
+
+/**
+ * Znaki alfabetu w kolejności ich wartości.
+ */
+static const char symbols[ALLNUM] = {'0', '1', '2', '3', '4', '5', '6', '7',
+                                     '8', '9', '*', '#'};
+
+/**
+ * @brief Zwraca półbajt zapisujący znak @p c.
+ * @param c - znak w kodowaniu wewnętrznym.
+ * @return Wartość znaku powiększona o jeden.
+ */
+static inline uint8_t nibbleOf(char c) {
+    return (uint8_t) (symbolValue(c) + 1);
+}
+
+/**
+ * @brief Zapisuje nagłówek numeru o długości @p length.
+ * @param out - bufor na nagłówek.
+ * @param length - liczba znaków numeru.
+ * @return Liczba zapisanych bajtów.
+ */
+static size_t writeHeader(uint8_t *out, size_t length) {
+    size_t i = 0;
+    while (length >= 128) {
+        out[i++] = (uint8_t) (length | 128);
+        length >>= 7;
+    }
+    out[i++] = (uint8_t) length;
+    return i;
+}
+
+size_t packedSize(size_t length) {
+    size_t header = 1;
+    for (size_t rest = length >> 7; rest; rest >>= 7)
+        header++;
+    return header + (length + 1) / 2;
+}
+
+uint8_t const *packedDigits(uint8_t const *packed, size_t *length) {
+    size_t value = 0;
+    unsigned shift = 0;
+    while (*packed & 128) {
+        value |= (size_t) (*packed++ & 127) << shift;
+        shift += 7;
+    }
+    *length = value | (size_t) *packed++ << shift;
+    return packed;
+}
+
+size_t packedLength(uint8_t const *packed) {
+    size_t length;
+    packedDigits(packed, &length);
+    return length;
+}
+
+/**
+ * @brief Pakuje znaki @p str od pozycji @p pos wyniku.
+ * @param digits - bajty znaków wyniku, wypełnione do pozycji @p pos.
+ * @param pos - liczba znaków już zapisanych w @p digits.
+ * @param str - ciąg znaków w kodowaniu wewnętrznym.
+ * @param length - liczba pakowanych znaków.
+ */
+static void packFrom(uint8_t *digits, size_t pos, char const *str,
+                     size_t length) {
+    size_t i = 0;
+    if (pos & 1 && i < length) {
+        digits[pos >> 1] |= nibbleOf(str[i++]);
+        pos++;
+    }
+
+    uint8_t *out = digits + (pos >> 1);
+    for (; i + 1 < length; i += 2)
+        *out++ = (uint8_t) (nibbleOf(str[i]) << 4 | nibbleOf(str[i + 1]));
+    if (i < length)
+        *out = (uint8_t) (nibbleOf(str[i]) << 4);
+}
+
+size_t numPack(uint8_t *out, char const *str, size_t length) {
+    size_t header = writeHeader(out, length);
+    packFrom(out + header, 0, str, length);
+    return header + (length + 1) / 2;
+}
+
+size_t packedPrefix(uint8_t *out, uint8_t const *packed, size_t length) {
+    size_t total;
+    uint8_t const *digits = packedDigits(packed, &total);
+    size_t header = writeHeader(out, length);
+
+    memcpy(out + header, digits, (length + 1) / 2);
+    if (length & 1) out[header + length / 2] &= 0xF0;
+    return header + (length + 1) / 2;
+}
+
+void numUnpack(uint8_t const *packed, char *out) {
+    size_t length;
+    uint8_t const *digits = packedDigits(packed, &length);
+
+    for (size_t i = 0; i < length / 2; i++) {
+        out[2 * i] = symbols[(digits[i] >> 4) - 1];
+        out[2 * i + 1] = symbols[(digits[i] & 15) - 1];
+    }
+    if (length & 1)
+        out[length - 1] = symbols[(digits[length / 2] >> 4) - 1];
+    out[length] = '\0';
+}
+
+void numUnpackEncoded(uint8_t const *packed, char *out) {
+    size_t length;
+    uint8_t const *digits = packedDigits(packed, &length);
+
+    for (size_t i = 0; i < length; i++)
+        out[i] = (char) ('0' + packedSymbol(digits, i));
+    out[length] = '\0';
+}
+
+bool packedIsPrefix(uint8_t const *prefix, uint8_t const *packed) {
+    size_t prefixLength, length;
+    uint8_t const *prefixDigits = packedDigits(prefix, &prefixLength);
+    uint8_t const *digits = packedDigits(packed, &length);
+
+    if (prefixLength >= length ||
+        memcmp(prefixDigits, digits, prefixLength / 2) != 0)
+        return false;
+    return !(prefixLength & 1) ||
+           (prefixDigits[prefixLength / 2] >> 4) ==
+           (digits[prefixLength / 2] >> 4);
+}
+
+int packedCompare(uint8_t const *a, uint8_t const *b) {
+    size_t lengthA, lengthB;
+    uint8_t const *digitsA = packedDigits(a, &lengthA);
+    uint8_t const *digitsB = packedDigits(b, &lengthB);
+
+    /* Zerowa połowa bajtu za końcem krótszego numeru jest mniejsza od
+     * każdego znaku, więc porównanie bajtów rozstrzyga wszystko poza
+     * przypadkiem, gdy jeden numer jest prefiksem drugiego. */
+    size_t bytes = (lengthA < lengthB ? lengthA + 1 : lengthB + 1) / 2;
+    int cmp = memcmp(digitsA, digitsB, bytes);
+    if (cmp != 0) return cmp;
+    return (lengthA > lengthB) - (lengthA < lengthB);
+}
+
+int packedComparePrefix(uint8_t const *packed, uint8_t const *prefix) {
+    size_t length, prefixLength;
+    uint8_t const *digits = packedDigits(packed, &length);
+    uint8_t const *prefixDigits = packedDigits(prefix, &prefixLength);
+
+    for (size_t i = 0; i < length && i < prefixLength; i++)
+        if (packedSymbol(digits, i) != packedSymbol(prefixDigits, i))
+            return packedSymbol(digits, i) - packedSymbol(prefixDigits, i);
+    return length < prefixLength ? -1 : 0;
+}
+
+bool packedIsReplaced(uint8_t const *num, uint8_t const *prefix,
+                      uint8_t const *source, size_t toReplace) {
+    size_t length, prefixLength, sourceLength;
+    uint8_t const *digits = packedDigits(num, &length);
+    uint8_t const *prefixDigits = packedDigits(prefix, &prefixLength);
+    uint8_t const *sourceDigits = packedDigits(source, &sourceLength);
+
+    if (toReplace > sourceLength ||
+        length != prefixLength + sourceLength - toReplace)
+        return false;
+
+    for (size_t i = 0; i < prefixLength; i++)
+        if (packedSymbol(digits, i) != packedSymbol(prefixDigits, i))
+            return false;
+    for (size_t i = toReplace; i < sourceLength; i++)
+        if (packedSymbol(digits, prefixLength + i - toReplace) !=
+            packedSymbol(sourceDigits, i))
+            return false;
+    return true;
+}
+
+size_t packedReplacePrefix(uint8_t *out, uint8_t const *prefix,
+                           char const *num, size_t length, size_t toReplace) {
+    size_t prefixLength;
+    uint8_t const *prefixDigits = packedDigits(prefix, &prefixLength);
+    size_t total = prefixLength + length - toReplace;
+
+    size_t header = writeHeader(out, total);
+    uint8_t *digits = out + header;
+    memcpy(digits, prefixDigits, (prefixLength + 1) / 2);
+    packFrom(digits, prefixLength, num + toReplace, length - toReplace);
+
+    return header + (total + 1) / 2;
+}
@@ -0,0 +1,147 @@
+/** @file
+ * Interfejs klasy obsługującej upakowane numery, czyli poprawne ciągi znaków
+ * (zdefiniowane w @ref alphabet.h) zapisane po cztery bity na znak.
+ *
+ * Upakowany numer składa się z nagłówka z długością numeru, zapisaną po
+ * siedem bitów na bajt (najmłodsze najpierw, najstarszy bit bajtu oznacza
+ * kontynuację), oraz z bajtów znaków. Każdy bajt przechowuje dwa kolejne
+ * znaki, pierwszy w starszej połowie. Znak o wartości @p v zapisywany jest
+ * jako @p v+1, zaś połowa bajtu za ostatnim znakiem numeru o nieparzystej
+ * długości jest zerowa. Dzięki temu porządek bajtów znaków jest zgodny
+ * z porządkiem leksykograficznym alfabetu, a numer dziesięciocyfrowy zajmuje
+ * sześć bajtów zamiast jedenastu.
+ *
+ * @author Adam Greloch <ag438473@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef __PACKED_H__
+#define __PACKED_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Zwraca rozmiar upakowanego numeru o długości @p length.
+ * @param[in] length - liczba znaków numeru.
+ * @return Liczba bajtów nagłówka i znaków.
+ */
+size_t packedSize(size_t length);
+
+/** @brief Zwraca wskaźnik na bajty znaków upakowanego numeru @p packed.
+ * @param[in] packed - wskaźnik na upakowany numer.
+ * @param[out] length - wskaźnik na zmienną, w której zostanie zapisana
+ *                      liczba znaków numeru.
+ * @return Wskaźnik na pierwszy bajt za nagłówkiem.
+ */
+uint8_t const *packedDigits(uint8_t const *packed, size_t *length);
+
+/** @brief Zwraca liczbę znaków upakowanego numeru @p packed.
+ * @param[in] packed - wskaźnik na upakowany numer.
+ * @return Liczba znaków numeru.
+ */
+size_t packedLength(uint8_t const *packed);
+
+/** @brief Zwraca wartość @p i-tego znaku numeru o bajtach znaków @p digits.
+ * @param[in] digits - wskaźnik zwrócony przez packedDigits().
+ * @param[in] i - pozycja znaku, mniejsza od długości numeru.
+ * @return Wartość znaku z przedziału od @p 0 do @p 11.
+ */
+static inline int packedSymbol(uint8_t const *digits, size_t i) {
+    return ((digits[i >> 1] >> (i & 1 ? 0 : 4)) & 15) - 1;
+}
+
+/** @brief Pakuje ciąg @p str.
+ * @param[out] out - bufor o rozmiarze co najmniej packedSize(@p length).
+ * @param[in] str - poprawny ciąg znaków w kodowaniu wewnętrznym.
+ * @param[in] length - długość @p str.
+ * @return Liczba zapisanych bajtów.
+ */
+size_t numPack(uint8_t *out, char const *str, size_t length);
+
+/** @brief Pakuje @p length początkowych znaków numeru @p packed.
+ * @param[out] out - bufor o rozmiarze co najmniej packedSize(@p length).
+ * @param[in] packed - wskaźnik na upakowany numer.
+ * @param[in] length - liczba znaków prefiksu, nie większa od długości
+ *                     numeru.
+ * @return Liczba zapisanych bajtów.
+ */
+size_t packedPrefix(uint8_t *out, uint8_t const *packed, size_t length);
+
+/** @brief Rozpakowuje numer @p packed do znaków alfabetu.
+ * @param[in] packed - wskaźnik na upakowany numer.
+ * @param[out] out - bufor o rozmiarze co najmniej packedLength(@p packed)
+ *                   + 1, w którym zostanie zapisany ciąg zakończony znakiem
+ *                   terminującym.
+ */
+void numUnpack(uint8_t const *packed, char *out);
+
+/** @brief Rozpakowuje numer @p packed do kodowania wewnętrznego.
+ * Działa jak numUnpack(), lecz zapisuje znaki w kodowaniu wewnętrznym
+ * (zobacz @ref alphabet.h), w którym numer może być przekazany drzewom.
+ * @param[in] packed - wskaźnik na upakowany numer.
+ * @param[out] out - bufor o rozmiarze co najmniej packedLength(@p packed)
+ *                   + 1, w którym zostanie zapisany ciąg zakończony znakiem
+ *                   terminującym.
+ */
+void numUnpackEncoded(uint8_t const *packed, char *out);
+
+/** @brief Sprawdza, czy upakowany numer @p prefix jest właściwym prefiksem
+ * upakowanego numeru @p packed.
+ * @param[in] prefix - wskaźnik na upakowany numer.
+ * @param[in] packed - wskaźnik na upakowany numer.
+ * @return Wartość @p true, jeśli @p prefix jest krótszy od @p packed i jest
+ * jego prefiksem.
+ */
+bool packedIsPrefix(uint8_t const *prefix, uint8_t const *packed);
+
+/** @brief Porównuje dwa upakowane numery w porządku leksykograficznym.
+ * Porównuje bajty znaków funkcją @p memcmp, a przy wspólnym prefiksie
+ * rozstrzyga długość.
+ * @param[in] a - wskaźnik na pierwszy upakowany numer.
+ * @param[in] b - wskaźnik na drugi upakowany numer.
+ * @return Wartość ujemna, zero lub dodatnia, jeśli @p a jest odpowiednio
+ * mniejszy, równy lub większy od @p b.
+ */
+int packedCompare(uint8_t const *a, uint8_t const *b);
+
+/** @brief Porównuje początkowe znaki upakowanego numeru @p packed
+ * z upakowanym numerem @p prefix.
+ * @param[in] packed - wskaźnik na upakowany numer.
+ * @param[in] prefix - wskaźnik na upakowany numer.
+ * @return Zero, jeśli @p prefix jest prefiksem @p packed lub mu równy.
+ * W przeciwnym wypadku wartość ujemna lub dodatnia, jeśli @p packed jest
+ * odpowiednio mniejszy lub większy od @p prefix.
+ */
+int packedComparePrefix(uint8_t const *packed, uint8_t const *prefix);
+
+/** @brief Sprawdza, czy upakowany numer @p num powstaje z @p source przez
+ * zastąpienie jego początkowych @p toReplace znaków numerem @p prefix.
+ * @param[in] num - wskaźnik na upakowany numer.
+ * @param[in] prefix - wskaźnik na upakowany nowy prefiks.
+ * @param[in] source - wskaźnik na upakowany numer.
+ * @param[in] toReplace - liczba zastępowanych znaków.
+ * @return Wartość @p true, jeśli @p num jest równy @p prefix z dopisanymi
+ * znakami @p source od pozycji @p toReplace.
+ */
+bool packedIsReplaced(uint8_t const *num, uint8_t const *prefix,
+                      uint8_t const *source, size_t toReplace);
+
+/** @brief Pakuje numer powstały z @p num przez zastąpienie jego początkowych
+ * @p toReplace znaków numerem @p prefix.
+ * Bajty znaków @p prefix kopiowane są w całości, zaś pozostałe znaki @p num
+ * pakowane są parami.
+ * @param[out] out - bufor o rozmiarze co najmniej packedSize() długości
+ *                   wyniku.
+ * @param[in] prefix - wskaźnik na upakowany nowy prefiks.
+ * @param[in] num - poprawny ciąg znaków w kodowaniu wewnętrznym.
+ * @param[in] length - długość @p num.
+ * @param[in] toReplace - liczba zastępowanych znaków, nie większa od
+ *                        @p length.
+ * @return Liczba zapisanych bajtów.
+ */
+size_t packedReplacePrefix(uint8_t *out, uint8_t const *prefix,
+                           char const *num, size_t length, size_t toReplace);
+
+#endif /* __PACKED_H__ */
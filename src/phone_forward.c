@@ -8,10 +8,26 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <stdatomic.h>
+#include <sched.h>
 #include "phone_forward.h"
 #include "trie.h"
 #include "alphabet.h"
 #include "dynamic_table.h"
+#include "string_pool.h"
+#include "packed.h"
+#include "lookup_cache.h"
+
+#define GET_BATCH 32 /**< Liczba numerów tłumaczonych i wyszukiwanych naraz
+                          przez phfwdGetBatch(). */
+#define VERIFY_BUFFER 64 /**< Największa długość numeru przeciwobrazu
+                              składanego w buforze przy sprawdzaniu, czy jest
+                              przekierowywany na dany numer. */
+#ifndef SWEEP_STEP
+#define SWEEP_STEP 64 /**< Liczba węzłów usuniętych poddrzew zwalnianych
+                           przy każdej modyfikacji przekierowań. Można ją
+                           ustawić przy kompilacji. */
+#endif
 
 /** @brief Struktura przechowująca przekierowania telefonów.
  * Struktura przechowująca przekierowania telefonów trzyma je w postaci
@@ -30,28 +46,68 @@
  * @see trie.h
  */
 struct PhoneForward {
+    TrieArena *arena; /**< Wskaźnik na arenę, z której przydzielane są węzły
+                           obu drzew. */
     TrieNode *fwds; /**< Wskaźnik na korzeń struktury przechowującej jako węzły
                          prefiksy, dla których ustalono przekierowanie. */
     TrieNode *revs; /**< Wskaźnik na korzeń struktury przechowującej jako węzły
                          przekierowania. */
+    LookupCache *cache; /**< Pamięć podręczna wyników phfwdGet() lub NULL,
+                             jeśli jest wyłączona. */
+    atomic_size_t *owners; /**< Licznik struktur współdzielących drzewa
+                                (zobacz phfwdSnapshot()) lub NULL, jeśli
+                                drzewa należą wyłącznie do tej struktury. */
+    bool snapshot; /**< Czy struktura jest migawką tylko do odczytu. */
 };
 
+#define UNPACK_NONE 0 /**< Numery nie zostały jeszcze rozpakowane. */
+#define UNPACK_BUSY 1 /**< Jeden z wątków rozpakowuje numery. */
+#define UNPACK_DONE 2 /**< Numery zostały rozpakowane. */
+
+/**
+ * Położenie numeru w bloku struktury @ref PhoneNumbers.
+ */
+typedef struct PhnumEntry {
+    size_t packed; /**< Przesunięcie upakowanego numeru względem
+                        @p PhoneNumbers::packed. */
+    size_t text; /**< Przesunięcie rozpakowanego numeru względem
+                      @p PhoneNumbers::text. */
+} PhnumEntry;
+
 /**
  * Struktura przechowująca przekierowania numerów telefonów.
+ * Zajmuje jeden blok pamięci o rozmiarze ustalonym przy alokacji: za
+ * nagłówkiem leży tablica położeń numerów, za nią upakowane numery, a na
+ * końcu miejsce na ich rozpakowane znaki.
  */
 struct PhoneNumbers {
-    Table *nums; /**< Dynamiczna tablica w której przechowywane
-                      są numery telefonów. */
+    size_t amount; /**< Liczba numerów. */
+    atomic_uint unpack; /**< Stan rozpakowania numerów do @p text:
+                             @ref UNPACK_NONE, @ref UNPACK_BUSY lub
+                             @ref UNPACK_DONE. */
+    uint8_t *packed; /**< Wskaźnik na upakowane numery. */
+    char *text; /**< Wskaźnik na miejsce na rozpakowane numery. */
+    PhnumEntry entries[]; /**< Położenia kolejnych numerów. */
 };
 
 PhoneForward *phfwdNew(void) {
     PhoneForward *pf = malloc(sizeof(PhoneForward));
     if (!pf) return NULL;
 
-    pf->fwds = trieNodeNew(NULL, false, &pf->fwds);
+    pf->arena = trieArenaNew();
+    if (!pf->arena) {
+        free(pf);
+        return NULL;
+    }
+
+    pf->fwds = trieNodeNew(pf->arena, false);
     pf->revs = NULL;
+    pf->cache = NULL;
+    pf->owners = NULL;
+    pf->snapshot = false;
 
     if (!pf->fwds) {
+        trieArenaDelete(pf->arena);
         free(pf);
         return NULL;
     }
@@ -59,113 +115,410 @@ PhoneForward *phfwdNew(void) {
     return pf;
 }
 
+/**
+ * @brief Zrzeka się drzew struktury @p pf.
+ * Usuwa je, jeśli nie współdzieli ich żadna inna struktura. Nie zmienia pól
+ * @p pf.
+ * @param[in,out] pf - wskaźnik na strukturę.
+ */
+static void phfwdRelease(PhoneForward *pf) {
+    if (!pf->owners || atomic_fetch_sub(pf->owners, 1) == 1) {
+        trieArenaDelete(pf->arena);
+        free(pf->owners);
+    }
+}
+
 void phfwdDelete(PhoneForward *pf) {
     if (!pf) return;
-    trieDelete(pf->fwds);
-    trieDelete(pf->revs);
+    cacheDelete(pf->cache);
+    phfwdRelease(pf);
     free(pf);
 }
 
+/**
+ * @brief Zapewnia strukturze @p pf drzewa, których nie współdzieli z żadną
+ * migawką.
+ * Jeśli drzewa są współdzielone, to buduje pełną kopię z przekierowań
+ * wypisanych w porządku prefiksów (zobacz trieCollect()), w czasie liniowym
+ * względem ich liczby, zaś pamięć podręczną wyników opróżnia, ponieważ
+ * liczniki zmian kopii są inne. To jest odroczona kopia migawki (zobacz
+ * phfwdSnapshot()); węzły nie są kopiowane pojedynczo.
+ * @param[in,out] pf - wskaźnik na strukturę.
+ * @return Wartość @p true, jeśli struktura może być modyfikowana. Wartość
+ * @p false, jeśli jest migawką lub nie udało się alokować pamięci; wówczas
+ * pozostaje bez zmian.
+ */
+static bool phfwdUnshare(PhoneForward *pf) {
+    if (pf->snapshot) return false;
+    if (!pf->owners) return true;
+
+    if (atomic_load(pf->owners) > 1) {
+        TrieRule *rules;
+        char *text;
+        size_t count;
+        if (!trieCollect(pf->arena, pf->fwds, &rules, &count, &text))
+            return false;
+
+        TrieArena *arena = trieArenaNew();
+        TrieNode *fwds = arena ? trieNodeNew(arena, false) : NULL;
+        TrieNode *revs = fwds && count ? trieNodeNew(arena, true) : NULL;
+        bool ok = fwds && (count == 0 ||
+                           (revs && trieBindSorted(arena, &fwds, &revs, rules,
+                                                   count)));
+        free(rules);
+        free(text);
+        if (!ok) {
+            trieArenaDelete(arena);
+            return false;
+        }
+
+        phfwdRelease(pf);
+        pf->arena = arena;
+        pf->fwds = fwds;
+        pf->revs = revs;
+        cacheClear(pf->cache);
+    }
+    else {
+        /* Migawki zostały usunięte, więc licznik nie jest już potrzebny. */
+        free(pf->owners);
+    }
+    pf->owners = NULL;
+    return true;
+}
+
+PhoneForward *phfwdSnapshot(PhoneForward *pf) {
+    if (!pf) return NULL;
+
+    PhoneForward *snapshot = malloc(sizeof(PhoneForward));
+    if (!snapshot) return NULL;
+
+    if (!pf->owners) {
+        pf->owners = malloc(sizeof(atomic_size_t));
+        if (!pf->owners) {
+            free(snapshot);
+            return NULL;
+        }
+        atomic_init(pf->owners, 1);
+    }
+    atomic_fetch_add(pf->owners, 1);
+
+    *snapshot = *pf;
+    snapshot->cache = NULL;
+    snapshot->snapshot = true;
+    return snapshot;
+}
+
+bool phfwdRestore(PhoneForward *pf, PhoneForward const *snapshot) {
+    if (!pf || !snapshot || pf->snapshot || !snapshot->snapshot) return false;
+    if (pf->arena == snapshot->arena) return true;
+
+    atomic_fetch_add(snapshot->owners, 1);
+    phfwdRelease(pf);
+    pf->arena = snapshot->arena;
+    pf->fwds = snapshot->fwds;
+    pf->revs = snapshot->revs;
+    pf->owners = snapshot->owners;
+    cacheClear(pf->cache);
+    return true;
+}
+
+/**
+ * @brief Dodaje przekierowanie numerów w kodowaniu wewnętrznym.
+ * Działa jak phfwdAdd(), lecz zakłada poprawność i różność obu numerów.
+ * @param[in,out] pf - wskaźnik na strukturę przechowującą przekierowania.
+ * @param[in] num1 - prefiks przekierowywany w kodowaniu wewnętrznym.
+ * @param[in] len1 - długość @p num1.
+ * @param[in] num2 - prefiks docelowy w kodowaniu wewnętrznym.
+ * @param[in] len2 - długość @p num2.
+ * @return Wartość @p true, jeśli przekierowanie zostało dodane. Wartość
+ * @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool phfwdAddEncoded(PhoneForward *pf, char const *num1, size_t len1,
+                            char const *num2, size_t len2) {
+    if (!pf->revs) pf->revs = trieNodeNew(pf->arena, true);
+    if (!pf->revs) return false;
+
+    trieSettle(pf->arena, num1, len1);
+    TrieNode *fwd = trieInsertStr(pf->arena, &(pf->fwds), num1, false);
+    TrieNode *rev = trieInsertStr(pf->arena, &(pf->revs), num2, true);
+
+    if (!fwd || !rev ||
+        !trieNodeBind(pf->arena, fwd, rev, num1, len1, num2, len2)) {
+        /* Usuwamy puste węzły, które mogły powstać w obu drzewach. */
+        trieCutLeaves(pf->arena, rev);
+        trieCutLeaves(pf->arena, fwd);
+        return false;
+    }
+    return true;
+}
+
 bool phfwdAdd(PhoneForward *pf, char const *num1, char const *num2) {
     if (!pf) return false;
-    size_t len1, len2;
-    if (!(len1 = isCorrect(num1)) || !(len2 = isCorrect(num2))) return false;
-    if (strcmp(num1, num2) == 0) return false;
 
-    if (!pf->revs) pf->revs = trieNodeNew(NULL, true, &pf->revs);
-    if (!pf->revs) return false;
+    char const *enc1, *enc2;
+    size_t len1 = numEncode(num1, &enc1), len2 = numEncode(num2, &enc2);
+    bool added = enc1 && enc2 && strcmp(enc1, enc2) != 0 &&
+                 phfwdUnshare(pf) &&
+                 phfwdAddEncoded(pf, enc1, len1, enc2, len2);
 
-    TrieNode *fwd = trieInsertStr(&(pf->fwds), num1, false);
-    TrieNode *rev = trieInsertStr(&(pf->revs), num2, true);
+    numFreeEncoded(enc1, num1);
+    numFreeEncoded(enc2, num2);
+    if (!pf->owners) trieSweep(pf->arena, SWEEP_STEP);
+    return added;
+}
 
-    if (!fwd || !rev) return false;
+/**
+ * Przekierowanie wsadu w kodowaniu wewnętrznym wraz z jego pozycją we
+ * wsadzie.
+ */
+typedef struct BatchRule {
+    TrieRule rule; /**< Przekierowanie w kodowaniu wewnętrznym. */
+    size_t index; /**< Indeks przekierowania we wsadzie. */
+} BatchRule;
 
-    return trieNodeSetSeq(fwd, num2, len2) &&
-           trieNodeBind(fwd, trieAddToList(rev, num1, len1));
+/**
+ * @brief Porównuje przekierowania @p a i @p b według przekierowywanego
+ * prefiksu, a następnie według pozycji we wsadzie.
+ * @param[in] a - wskaźnik na @ref BatchRule.
+ * @param[in] b - wskaźnik na @ref BatchRule.
+ * @return Wartość ujemna, zero lub dodatnia, jeśli pierwsze przekierowanie
+ * jest odpowiednio mniejsze, równe lub większe od drugiego.
+ */
+static int batchCompare(void const *a, void const *b) {
+    BatchRule const *x = a, *y = b;
+    int cmp = strcmp(x->rule.source, y->rule.source);
+    if (cmp != 0) return cmp;
+    return (x->index > y->index) - (x->index < y->index);
+}
+
+bool phfwdAddBatch(PhoneForward *pf, PhfwdRule const *rules, size_t n) {
+    if (!pf || (n && !rules)) return false;
+    if (n == 0) return true;
+
+    BatchRule *batch = malloc(n * sizeof(BatchRule));
+    TrieRule *sorted = malloc(n * sizeof(TrieRule));
+    bool ok = batch && sorted;
+    size_t encoded = 0, count = 0;
+
+    for (; ok && encoded < n; encoded++) {
+        BatchRule *curr = &batch[encoded];
+        curr->rule.sourceLength = numEncode(rules[encoded].num1,
+                                            &curr->rule.source);
+        curr->rule.targetLength = numEncode(rules[encoded].num2,
+                                            &curr->rule.target);
+        curr->index = encoded;
+        ok = curr->rule.source && curr->rule.target &&
+             strcmp(curr->rule.source, curr->rule.target) != 0;
+    }
+
+    if (ok) ok = phfwdUnshare(pf);
+    if (ok) {
+        /* Z przekierowań o tym samym prefiksie zostaje ostatnie. */
+        qsort(batch, n, sizeof(BatchRule), batchCompare);
+        for (size_t i = 0; i < n; i++)
+            if (i + 1 == n ||
+                strcmp(batch[i].rule.source, batch[i + 1].rule.source) != 0)
+                sorted[count++] = batch[i].rule;
+
+        for (size_t i = 0; i < count; i++)
+            trieSettle(pf->arena, sorted[i].source, sorted[i].sourceLength);
+        if (!pf->revs) pf->revs = trieNodeNew(pf->arena, true);
+        ok = pf->revs && trieBindSorted(pf->arena, &(pf->fwds), &(pf->revs),
+                                        sorted, count);
+    }
+
+    for (size_t i = 0; i < encoded; i++) {
+        numFreeEncoded(batch[i].rule.source, rules[batch[i].index].num1);
+        numFreeEncoded(batch[i].rule.target, rules[batch[i].index].num2);
+    }
+    free(batch);
+    free(sorted);
+    if (!pf->owners) trieSweep(pf->arena, SWEEP_STEP);
+    return ok;
+}
+
+bool phfwdTryRemove(PhoneForward *pf, char const *num) {
+    if (!pf) return false;
+
+    char const *encoded;
+    bool ok = true;
+    if (numEncode(num, &encoded)) {
+        ok = encoded && phfwdUnshare(pf);
+        if (ok) trieRemoveStr(pf->arena, pf->fwds, encoded);
+    }
+    numFreeEncoded(encoded, num);
+    if (!pf->owners) trieSweep(pf->arena, SWEEP_STEP);
+    return ok;
 }
 
 void phfwdRemove(PhoneForward *pf, char const *num) {
-    if (pf && isCorrect(num))
-        trieRemoveStr(&(pf->fwds), num);
+    phfwdTryRemove(pf, num);
+}
+
+bool phfwdMaintain(PhoneForward *pf, size_t budget) {
+    if (!pf) return true;
+    /* Współdzielonych drzew nie wolno zmieniać. */
+    if (pf->snapshot || (pf->owners && atomic_load(pf->owners) > 1))
+        return !trieHasDetached(pf->arena);
+    if (!phfwdUnshare(pf) || !trieSweep(pf->arena, budget)) return false;
+    trieIndexRefresh(pf->arena);
+    return true;
 }
 
 /**
- * @brief Alokuje nową strukturę @p PhoneNumbers.
+ * @brief Alokuje nową strukturę @p PhoneNumbers w jednym bloku pamięci.
+ * Położenia numerów wypełnia wywołujący.
+ * @param[in] amount - liczba numerów.
+ * @param[in] packedBytes - łączny rozmiar upakowanych numerów.
+ * @param[in] textBytes - łączna długość numerów wraz ze znakami
+ *                        terminującymi.
  * @return Wskaźnik na strukturę @p PhoneNumbers lub NULL, gdy nie udało się
  * alokować pamięci.
  */
-static PhoneNumbers *phnumNew() {
-    PhoneNumbers *pnum = malloc(sizeof(PhoneNumbers));
+static PhoneNumbers *phnumAlloc(size_t amount, size_t packedBytes,
+                                size_t textBytes) {
+    PhoneNumbers *pnum = malloc(sizeof(PhoneNumbers) +
+                                amount * sizeof(PhnumEntry) +
+                                packedBytes + textBytes);
     if (!pnum) return NULL;
 
-    pnum->nums = tableNew();
-    if (!pnum->nums) {
-        free(pnum);
-        return NULL;
+    pnum->amount = amount;
+    atomic_init(&pnum->unpack, UNPACK_NONE);
+    pnum->packed = (uint8_t *) (pnum->entries + amount);
+    pnum->text = (char *) (pnum->packed + packedBytes);
+    return pnum;
+}
+
+/**
+ * @brief Alokuje strukturę @p PhoneNumbers zawierającą kopie upakowanych
+ * numerów @p nums.
+ * @param[in] nums - wskaźnik na tablicę upakowanych numerów.
+ * @param[in] amount - liczba numerów.
+ * @return Wskaźnik na strukturę @p PhoneNumbers lub NULL, gdy nie udało się
+ * alokować pamięci.
+ */
+static PhoneNumbers *phnumFromNums(uint8_t const *const *nums,
+                                   size_t amount) {
+    size_t packedBytes = 0, textBytes = 0;
+    for (size_t i = 0; i < amount; i++) {
+        size_t length = packedLength(nums[i]);
+        packedBytes += packedSize(length);
+        textBytes += length + 1;
     }
 
+    PhoneNumbers *pnum = phnumAlloc(amount, packedBytes, textBytes);
+    if (!pnum) return NULL;
+
+    packedBytes = textBytes = 0;
+    for (size_t i = 0; i < amount; i++) {
+        size_t length = packedLength(nums[i]);
+        pnum->entries[i] = (PhnumEntry) {packedBytes, textBytes};
+        memcpy(pnum->packed + packedBytes, nums[i], packedSize(length));
+        packedBytes += packedSize(length);
+        textBytes += length + 1;
+    }
     return pnum;
 }
 
 /**
- * @brief Dodaje ciąg znaków @p num do @p pnum.
+ * @brief Alokuje strukturę @p PhoneNumbers zawierającą kopię numeru
+ * zapamiętanego w pamięci podręcznej.
+ * @param[in] target - wskaźnik na upakowany numer.
+ * @return Wskaźnik na strukturę @p PhoneNumbers lub NULL, gdy nie udało się
+ * alokować pamięci.
+ */
+static void *phnumFromCached(uint8_t const *target) {
+    return phnumFromNums(&target, 1);
+}
+
+/**
+ * @brief Dodaje na koniec tablicy @p t upakowany ciąg @p str.
+ * @param[in,out] t - wskaźnik na tablicę.
+ * @param[in] str - poprawny ciąg znaków w kodowaniu wewnętrznym.
+ * @param[in] length - długość @p str.
  * @return Wartość @p true, jeśli operacja się powiodła, wartość @p false w
  * przeciwnym wypadku.
  */
-static bool phnumAdd(PhoneNumbers *pnum, const char *num) {
-    if (!pnum) return false;
-    return tableAdd(pnum->nums, num);
+static bool tableAddPacked(Table *t, char const *str, size_t length) {
+    uint8_t *packed = malloc(packedSize(length));
+    if (!packed) return false;
+
+    numPack(packed, str, length);
+    if (!tableAddPtr(t, packed)) {
+        free(packed);
+        return false;
+    }
+    return true;
 }
 
 /**
  * @brief Zmienia prefiks podanego numeru na nowy.
- * Alokuje tablicę znaków o długości nowego numeru. Wstawia do niej nowy
- * prefiks a po nich cyfry, które pozostają bez zmian. Zakłada poprawność
+ * Alokuje upakowany numer o długości nowego numeru, złożony z nowego
+ * prefiksu i znaków, które pozostają bez zmian. Zakłada poprawność
  * wszystkich danych wejściowych.
- * @param[in] num - wskaźnik na numer.
- * @param[in] fwdPrefix - wskaźnik na nowy prefiks.
+ * @param[in] num - wskaźnik na numer w kodowaniu wewnętrznym.
+ * @param[in] fwdPrefix - wskaźnik na upakowany nowy prefiks.
  * @param[in] numLength - długość numeru.
  * @param[in] toReplace - liczba początkowych znaków numeru, które zastępuje
  *                        nowy prefiks.
- * @return Wskaźnik na napis reprezentujący numer telefonu z nowym prefiksem
- * lub NULL, gdy nie udało się alokować pamięci.
+ * @return Wskaźnik na upakowany numer z nowym prefiksem lub NULL, gdy nie
+ * udało się alokować pamięci.
  */
-static char *
-replacePrefix(char const *num, char const *fwdPrefix, size_t numLength,
+static uint8_t *
+replacePrefix(char const *num, uint8_t const *fwdPrefix, size_t numLength,
               size_t toReplace) {
-    size_t fwdPrefixLength = strlen(fwdPrefix);
-    size_t newNumLength = numLength + fwdPrefixLength - toReplace;
+    size_t newNumLength = numLength + packedLength(fwdPrefix) - toReplace;
 
-    char *new = calloc((newNumLength + 1), sizeof(char));
+    uint8_t *new = malloc(packedSize(newNumLength));
     if (!new) return NULL;
 
-    size_t i = 0, j = 0;
-
-    while (i + j < newNumLength)
-        if (i < fwdPrefixLength) {
-            new[i] = fwdPrefix[i];
-            i++;
-        }
-        else {
-            new[fwdPrefixLength + j] = num[j + toReplace];
-            j++;
-        }
-
+    packedReplacePrefix(new, fwdPrefix, num, numLength, toReplace);
     return new;
 }
 
 /**
  * Alokuje strukturę @p PhoneNumbers i umieszcza w niej tylko ciąg @p num.
  * Zakłada poprawność tego ciągu.
- * @param pnum - wskaźnik na strukturę;
- * @param num - poprawny ciąg znaków reprezentujący numer.
- * @return Wskaźnik na strukturę przechowującą podany numer.
- */
-static PhoneNumbers *phnumWithOne(PhoneNumbers *pnum, const char *num) {
-    if (!pnum) pnum = phnumNew();
-    if (!phnumAdd(pnum, num)) {
-        phnumDelete(pnum);
-        return NULL;
+ * @param num - poprawny ciąg znaków w kodowaniu wewnętrznym.
+ * @param length - długość @p num.
+ * @return Wskaźnik na strukturę przechowującą podany numer lub NULL, gdy nie
+ * udało się alokować pamięci.
+ */
+static PhoneNumbers *phnumWithOne(const char *num, size_t length) {
+    PhoneNumbers *pnum = phnumAlloc(1, packedSize(length), length + 1);
+    if (!pnum) return NULL;
+
+    pnum->entries[0] = (PhnumEntry) {0, 0};
+    numPack(pnum->packed, num, length);
+    return pnum;
+}
+
+/**
+ * @brief Alokuje strukturę @p PhoneNumbers z przekierowaniem numeru @p num.
+ * @param[in] num - poprawny ciąg znaków w kodowaniu wewnętrznym.
+ * @param[in] length - długość @p num.
+ * @param[in] found - węzeł kończący najdłuższy przekierowany prefiks @p num
+ *                    lub NULL, jeśli taki nie istnieje.
+ * @param[in] toReplace - długość tego prefiksu.
+ * @return Wskaźnik na strukturę przechowującą przekierowany numer lub NULL,
+ * gdy nie udało się alokować pamięci.
+ */
+static PhoneNumbers *phnumForwarded(char const *num, size_t length,
+                                    TrieNode *found, size_t toReplace) {
+    PhoneNumbers *pnum;
+    if (found) {
+        /* Długość wyniku jest znana, więc numer z nowym prefiksem powstaje
+         * od razu w bloku struktury. */
+        uint8_t const *seq = trieNodeGetSeq(found);
+        size_t newLength = length + packedLength(seq) - toReplace;
+        pnum = phnumAlloc(1, packedSize(newLength), newLength + 1);
+        if (pnum) {
+            pnum->entries[0] = (PhnumEntry) {0, 0};
+            packedReplacePrefix(pnum->packed, seq, num, length, toReplace);
+        }
+    }
+    else {
+        pnum = phnumWithOne(num, length);
     }
     return pnum;
 }
@@ -173,180 +526,1189 @@ static PhoneNumbers *phnumWithOne(PhoneNumbers *pnum, const char *num) {
 PhoneNumbers *phfwdGet(PhoneForward const *pf, char const *num) {
     if (!pf) return NULL;
 
-    PhoneNumbers *pnum = phnumNew();
-    if (!pnum) return NULL;
+    char const *encoded;
+    size_t length = numEncode(num, &encoded);
+    if (!length) return phnumAlloc(0, 0, 0);
+    if (!encoded) return NULL;
 
-    size_t length = isCorrect(num);
-    if (!length) return pnum;
+    /* Licznik zmian odczytywany jest przed wyszukiwaniem, więc wynik
+     * zapamiętany z tym licznikiem nie może być nowszy niż drzewo. */
+    uint32_t generation = 0;
+    CacheKey key;
+    PhoneNumbers *pnum = NULL;
+    if (pf->cache) {
+        generation = trieGeneration(pf->arena, encoded);
+        cacheKey(&key, encoded, length);
+        pnum = cacheFind(pf->cache, &key, generation, phnumFromCached);
+    }
+
+    if (!pnum) {
+        size_t toReplace;
+        TrieNode *found = trieFindSeqIndexed(pf->arena, pf->fwds, encoded,
+                                             length, &toReplace);
+        pnum = phnumForwarded(encoded, length, found, toReplace);
+        if (pnum && pf->cache)
+            cachePut(pf->cache, &key, generation,
+                     pnum->packed + pnum->entries[0].packed);
+    }
 
-    size_t toReplace;
-    TrieNode *found = trieFindSeq(pf->fwds, num, &toReplace);
-    if (!found) return phnumWithOne(pnum, num);
+    numFreeEncoded(encoded, num);
+    return pnum;
+}
 
-    char *replaced = replacePrefix(num, trieNodeGetSeq(found), length,
-                                   toReplace);
+bool phfwdSetCache(PhoneForward *pf, size_t capacity) {
+    if (!pf) return false;
 
-    if (!replaced || !phnumAdd(pnum, replaced)) {
-        free(replaced);
-        phnumDelete(pnum);
-        return NULL;
+    LookupCache *cache = NULL;
+    if (capacity > 0) {
+        cache = cacheNew(capacity);
+        if (!cache) return false;
     }
 
-    free(replaced);
-    return pnum;
+    cacheDelete(pf->cache);
+    pf->cache = cache;
+    return true;
 }
 
-/** @brief Zbiera wskaźniki do nowych prefiksów ze wszystkich list na ścieżce z
+bool phfwdGetBatch(PhoneForward const *pf, char const *const *nums, size_t n,
+                   PhoneNumbers **out) {
+    if (!pf || (n > 0 && (!nums || !out))) return false;
+
+    char const *encoded[GET_BATCH];
+    size_t lengths[GET_BATCH], toReplace[GET_BATCH];
+    TrieNode *found[GET_BATCH];
+    bool all = true;
+
+    for (size_t from = 0; from < n; from += GET_BATCH) {
+        size_t count = n - from < GET_BATCH ? n - from : GET_BATCH;
+
+        /* Numery niepoprawne, jak i te, których nie udało się przetłumaczyć,
+         * wyszukiwane są jako ciągi puste. */
+        for (size_t i = 0; i < count; i++) {
+            lengths[i] = numEncode(nums[from + i], &encoded[i]);
+            if (!encoded[i]) encoded[i] = "";
+        }
+
+        trieFindSeqBatch(pf->arena, pf->fwds, encoded, count, found,
+                         toReplace);
+
+        for (size_t i = 0; i < count; i++) {
+            if (!lengths[i])
+                out[from + i] = phnumAlloc(0, 0, 0);
+            else if (encoded[i][0] == '\0')
+                out[from + i] = NULL;
+            else
+                out[from + i] = phnumForwarded(encoded[i], lengths[i],
+                                               found[i], toReplace[i]);
+            all &= out[from + i] != NULL;
+
+            if (encoded[i][0] != '\0')
+                numFreeEncoded(encoded[i], nums[from + i]);
+        }
+    }
+    return all;
+}
+
+bool phfwdGetInto(PhoneForward const *pf, char const *num, char *buf,
+                  size_t cap, size_t *len) {
+    if (!pf || !len) return false;
+    *len = 0;
+
+    /* Przetłumaczony numer trafia do bufora wyniku, jeśli ten go mieści.
+     * Bufor jest nadpisywany wynikiem dopiero po przejściu drzewa, zaś
+     * niezmienione znaki kopiowane są z oryginalnego numeru. */
+    char const *encoded;
+    size_t length = numEncodeInto(num, buf, cap, &encoded);
+    if (!length) {
+        if (cap > 0) buf[0] = '\0';
+        return true;
+    }
+    if (!encoded) return false;
+
+    size_t toReplace = 0;
+    TrieNode *found = trieFindSeqIndexed(pf->arena, pf->fwds, encoded, length,
+                                         &toReplace);
+    if (encoded != buf) numFreeEncoded(encoded, num);
+
+    uint8_t const *seq = found ? trieNodeGetSeq(found) : NULL;
+    size_t seqLength = seq ? packedLength(seq) : 0;
+    if (!seq) toReplace = 0;
+
+    *len = seqLength + length - toReplace;
+    if (*len < cap) {
+        if (seq) numUnpack(seq, buf);
+        memcpy(buf + seqLength, num + toReplace, length - toReplace + 1);
+    }
+    return true;
+}
+
+/**
+ * Fragment dynamicznej tablicy numerów posortowanych rosnąco, scalany z innymi
+ * takimi fragmentami w phfwdReverse().
+ */
+typedef struct Run {
+    size_t pos; /**< Indeks najmniejszego jeszcze nie scalonego numeru. */
+    size_t end; /**< Indeks za ostatnim numerem fragmentu. */
+} Run;
+
+/**
+ * @brief Sortuje numery tablicy @p t o indeksach od @p from do @p to - 1,
+ * jeśli nie są posortowane.
+ * Zastąpienie wspólnego sufiksu uporządkowanymi prefiksami zachowuje ich
+ * porządek, chyba że jeden z prefiksów jest prefiksem innego. Tylko wtedy
+ * fragment jest sortowany.
+ * @param[in,out] t - wskaźnik na tablicę.
+ * @param[in] from - indeks pierwszego numeru fragmentu.
+ * @param[in] to - indeks za ostatnim numerem fragmentu.
+ */
+static void runSort(Table *t, size_t from, size_t to) {
+    for (size_t i = from + 1; i < to; i++)
+        if (packedCompare(tableGet(t, i - 1), tableGet(t, i)) > 0) {
+            tableSortRange(t, from, to);
+            return;
+        }
+}
+
+/**
+ * Stan sprawdzania, czy numery przeciwobrazu są przekierowywane na numer,
+ * dla którego zostały wyznaczone.
+ */
+typedef struct Verifier {
+    TrieNode *fwds; /**< Korzeń drzewa przekierowań. */
+    TrieWalk walk; /**< Przejście po drzewie przekierowań dla numerów, które
+                        nie mieszczą się w @p buf. */
+    char buf[VERIFY_BUFFER + 1]; /**< Miejsce na sprawdzany numer. */
+} Verifier;
+
+/**
+ * @brief Sprawdza, czy @p prefix jest najdłuższym przekierowanym prefiksem
+ * numeru powstałego z dołączenia do niego @p rest.
+ * Numer mieszczący się w buforze stanu składany jest w nim, a jego
+ * najdłuższy przekierowany prefiks wyznacza indeks (zobacz lpm.h). Dłuższe
+ * numery sprawdzane są przejściem po drzewie od węzła wspólnego prefiksu
+ * z poprzednio sprawdzanym prefiksem. Nie alokuje pamięci.
+ * @param[in] arena - wskaźnik na arenę, z której pochodzą węzły drzewa.
+ * @param[in,out] v - wskaźnik na stan sprawdzania.
+ * @param[in] prefix - upakowany przekierowany prefiks.
+ * @param[in] rest - ciąg znaków w kodowaniu wewnętrznym.
+ * @param[in] restLength - długość @p rest.
+ * @return Wartość @p true, jeśli @p prefix jest najdłuższy.
+ */
+static bool verifyLongest(TrieArena const *arena, Verifier *v,
+                          uint8_t const *prefix, char const *rest,
+                          size_t restLength) {
+    size_t length = packedLength(prefix), found;
+    if (length + restLength > VERIFY_BUFFER)
+        return trieWalkIsLongest(arena, &v->walk, prefix, rest);
+
+    numUnpackEncoded(prefix, v->buf);
+    memcpy(v->buf + length, rest, restLength + 1);
+    trieFindSeqIndexed(arena, v->fwds, v->buf, length + restLength, &found);
+    return found == length;
+}
+
+/** @brief Zbiera wskaźniki do nowych prefiksów ze wszystkich zbiorów na ścieżce z
  * wierzchołka @p from do korzenia drzewa w którym się znajduje.
  * Umieszcza w @p revs numery powstałe z * @p num z zastąpionymi
- * odpowiednimi prefiksami.
+ * odpowiednimi prefiksami. Numery pochodzące z jednego wierzchołka tworzą
+ * posortowany fragment tablicy, opisany kolejnym elementem @p runs.
+ * @param[in] arena - wskaźnik na arenę, z której pochodzą węzły drzewa.
  * @param[in] from - wskaźnik na początek ścieżki.
  * @param[in,out] revs - wskaźnik na docelową tablicę
+ * @param[out] runs - wskaźnik na tablicę fragmentów, mieszczącą co najmniej
+ *                    tyle elementów, ile wierzchołków ma ścieżka.
+ * @param[out] runCount - wskaźnik na zmienną, w której zostanie zapisana
+ *                        liczba fragmentów.
  * @param[in] num - wskaźnik na ciąg znaków, którego prefiksy będą
  *                  zastępowane nowymi.
  * @param[in] length - długość @p num.
  * @param[in] depth - głębokość wierzchołka, czyli długość w.w. ścieżki.
+ * @param[in,out] verify - wskaźnik na stan sprawdzania numerów lub NULL.
+ *                         Numer jest pomijany, jeśli zastąpiony prefiks nie
+ *                         jest jego najdłuższym przekierowanym prefiksem.
  * @return Wartość @p true, jeśli operacja się powiodła. Wartość @p false, jeśli
  * nie udało sie alokować pamięci.
  */
 static bool
-findAllRevs(TrieNode *from, Table *revs, char const *num, size_t length,
-            size_t depth) {
+findAllRevs(TrieArena const *arena, TrieNode *from, Table *revs, Run *runs,
+            size_t *runCount, char const *num, size_t length, size_t depth,
+            Verifier *verify) {
     TrieNode *curr = from;
-    char **arr = NULL;
-    size_t size;
-    char *replaced;
+    SortedSet *sources;
+    uint8_t *replaced;
+    size_t start;
 
+    *runCount = 0;
     while (curr) {
-        free(arr);
-        arr = NULL;
-
-        if (trieGetList(curr) && !isEmpty(trieGetList(curr))) {
-            arr = listToArray(trieGetList(curr), &size);
-            if (!arr) return false;
-            qsort(arr, size, sizeof(char *), strCompare);
-            for (size_t i = 0; i < size; i++) {
-                replaced = replacePrefix(num, arr[i], length, depth);
-                if (!tableAddPtr(revs, replaced)) {
-                    free(arr);
-                    free(replaced);
-                    return false;
-                }
+        /* Zbiór jest uporządkowany, więc prefiksy odczytujemy wprost. */
+        sources = trieGetSources(curr);
+        start = tableGetAmount(revs);
+        for (size_t i = 0; i < setGetAmount(sources); i++) {
+            /* Usunięte prefiksy pozostają w zbiorach do czasu zwolnienia. */
+            if (trieIsDetached(arena, setGet(sources, i))) continue;
+            /* Prefiks ze zbioru jest przekierowany, więc bez dalszych znaków
+             * numeru jest swoim najdłuższym przekierowanym prefiksem. */
+            if (verify && depth < length &&
+                !verifyLongest(arena, verify, setGet(sources, i), num + depth,
+                               length - depth))
+                continue;
+            replaced = replacePrefix(num, setGet(sources, i), length, depth);
+            if (!tableAddPtr(revs, replaced)) {
+                free(replaced);
+                return false;
             }
         }
 
-        curr = trieGetParent(curr);
-        depth--;
+        if (start < tableGetAmount(revs)) {
+            runSort(revs, start, tableGetAmount(revs));
+            runs[(*runCount)++] = (Run) {start, tableGetAmount(revs)};
+        }
+
+        depth -= trieNodeGetLabelLength(curr);
+        curr = trieGetParent(arena, curr);
     }
 
     return true;
 }
 
 /**
- * @brief Dodaje do struktury @p pnum wszystkie rozróżnialne elementy z
- * tablicy @p duplicated. Dodawane elementy są posortowane leksykograficzne.
- * Dopuszcza, że w @p duplicated istnieją duplikaty.
- * @param[in,out] pnum - wskaźnik na strukturę, do której dodawane są elementy.
- * @param[in] duplicated - wskaźnik na tablicę, z której dodawane będą elementy.
+ * @brief Przywraca własność kopca w poddrzewie fragmentu @p heap[i].
+ * Kopiec uporządkowany jest według najmniejszych nie scalonych numerów
+ * fragmentów.
+ * @param[in] t - wskaźnik na tablicę, w której leżą fragmenty.
+ * @param[in,out] heap - wskaźnik na kopiec fragmentów.
+ * @param[in] count - liczba fragmentów w kopcu.
+ * @param[in] i - indeks przesuwanego fragmentu.
+ */
+static void heapSiftDown(Table *t, Run *heap, size_t count, size_t i) {
+    Run moved = heap[i];
+    size_t child;
+
+    while ((child = 2 * i + 1) < count) {
+        if (child + 1 < count &&
+            packedCompare(tableGet(t, heap[child + 1].pos),
+                       tableGet(t, heap[child].pos)) < 0)
+            child++;
+        if (packedCompare(tableGet(t, heap[child].pos),
+                       tableGet(t, moved.pos)) >= 0)
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = moved;
+}
+
+/**
+ * @brief Zapisuje w @p out wszystkie rozróżnialne numery z posortowanych
+ * fragmentów @p runs tablicy @p t.
+ * Scala fragmenty za pomocą kopca, więc numery trafiają do @p out
+ * posortowane leksykograficznie, a duplikaty są pomijane w tym samym
+ * przejściu.
+ * @param[out] out - wskaźnik na tablicę mieszczącą wszystkie numery @p t.
+ * @param[in] t - wskaźnik na tablicę, w której leżą fragmenty.
+ * @param[in,out] runs - wskaźnik na tablicę fragmentów; jej zawartość ulega
+ *                       zmianie.
+ * @param[in] count - liczba fragmentów.
+ * @return Liczba zapisanych numerów.
+ */
+static size_t mergeRuns(uint8_t const **out, Table *t, Run *runs,
+                        size_t count) {
+    for (size_t i = count; i-- > 0;)
+        heapSiftDown(t, runs, count, i);
+
+    size_t amount = 0;
+    uint8_t const *elem;
+    while (count > 0) {
+        elem = tableGet(t, runs[0].pos);
+        if (amount == 0 || packedCompare(elem, out[amount - 1]) != 0)
+            out[amount++] = elem;
+
+        if (++runs[0].pos == runs[0].end) runs[0] = runs[--count];
+        heapSiftDown(t, runs, count, 0);
+    }
+
+    return amount;
+}
+
+/**
+ * Rozróżnialne numery przeciwobrazu wraz z pamięcią, w której leżą.
+ */
+typedef struct Reverse {
+    Table *revs; /**< Tablica upakowanych numerów, na które wskazuje
+                      @p merged. */
+    uint8_t const **merged; /**< Numery posortowane leksykograficznie. */
+    size_t amount; /**< Liczba numerów w @p merged. */
+} Reverse;
+
+/**
+ * @brief Wyznacza przeciwobraz numeru w kodowaniu wewnętrznym.
+ * Zbiera numery opisane w phfwdReverse(), zakładając poprawność @p num.
+ * Jeśli @p exact ma wartość @p true, to zbiera jedynie numery opisane
+ * w phfwdGetReverse(): numer powstały z zastąpienia prefiksu jest
+ * przekierowywany na @p num wtedy i tylko wtedy, gdy zastąpiony prefiks jest
+ * jego najdłuższym przekierowanym prefiksem, zaś sam @p num, gdy nie ma
+ * żadnego. Sprawdzenie przechodzi po drzewie przekierowań w miejscu, bez
+ * wyznaczania phfwdGet() dla numerów.
+ * Niezależnie od wyniku @p rev należy zwolnić za pomocą reverseFree().
+ * @param[in] pf - wskaźnik na strukturę przechowującą przekierowania.
+ * @param[in] num - numer w kodowaniu wewnętrznym.
+ * @param[in] length - długość @p num.
+ * @param[in] exact - czy pominąć numery, które nie są przekierowywane na
+ *                    @p num.
+ * @param[out] rev - wskaźnik na wypełniany przeciwobraz.
  * @return Wartość @p true, jeśli operacja się powiodła. Wartość @p false, jeśli
  * nie udało sie alokować pamięci.
  */
-static bool phnumConsumeDistinct(PhoneNumbers *pnum, Table *duplicated) {
-    tableSort(duplicated, strCompare);
+static bool reverseCollect(PhoneForward const *pf, char const *num,
+                           size_t length, bool exact, Reverse *rev) {
+    rev->merged = NULL;
+    rev->amount = 0;
+    rev->revs = tableNew();
+    if (!rev->revs) return false;
 
-    char *prev = NULL;
-    char *elem;
+    size_t toReplace = 0, runCount = 0;
+    TrieNode *longest = trieFindSeq(pf->arena, pf->revs, num, &toReplace);
+    Verifier verify;
+    verify.fwds = pf->fwds;
+    trieWalkStart(&verify.walk, pf->fwds);
 
-    for (size_t i = 0; i < tableGetAmount(duplicated); i++) {
-        elem = tableGet(duplicated, i);
-        if (!prev || strCompare(&elem, &prev) != 0) {
-            prev = elem;
-            if (!phnumAdd(pnum, tableGet(duplicated, i)))
-                return false;
-        }
+    /* Ścieżka ma co najwyżej toReplace + 1 wierzchołków, zaś sam numer num
+     * stanowi dodatkowy fragment. */
+    Run *runs = malloc((toReplace + 2) * sizeof(Run));
+    bool collected = runs &&
+                     (!longest ||
+                      findAllRevs(pf->arena, longest, rev->revs, runs,
+                                  &runCount, num, length, toReplace,
+                                  exact ? &verify : NULL));
+
+    size_t found;
+    if (collected && (!exact || !trieFindSeqIndexed(pf->arena, pf->fwds, num,
+                                                    length, &found))) {
+        size_t amount = tableGetAmount(rev->revs);
+        runs[runCount++] = (Run) {amount, amount + 1};
+        collected = tableAddPacked(rev->revs, num, length);
+    }
+    if (collected) {
+        rev->merged = malloc(tableGetAmount(rev->revs) *
+                             sizeof(uint8_t const *));
+        collected = rev->merged != NULL;
     }
+    if (collected)
+        rev->amount = mergeRuns(rev->merged, rev->revs, runs, runCount);
 
-    return true;
+    free(runs);
+    return collected;
+}
+
+/**
+ * @brief Zwalnia pamięć przeciwobrazu @p rev.
+ * @param[in,out] rev - wskaźnik na przeciwobraz.
+ */
+static void reverseFree(Reverse *rev) {
+    free(rev->merged);
+    tableFree(rev->revs);
+}
+
+/**
+ * @brief Wyznacza przeciwobraz numeru w kodowaniu wewnętrznym.
+ * Działa jak phfwdReverse() lub, jeśli @p exact ma wartość @p true, jak
+ * phfwdGetReverse(), lecz zakłada poprawność @p num.
+ * @param[in] pf - wskaźnik na strukturę przechowującą przekierowania.
+ * @param[in] num - numer w kodowaniu wewnętrznym.
+ * @param[in] length - długość @p num.
+ * @param[in] exact - czy pominąć numery, które nie są przekierowywane na
+ *                    @p num.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy nie
+ * udało się alokować pamięci.
+ */
+static PhoneNumbers *phfwdReverseEncoded(PhoneForward const *pf,
+                                         char const *num, size_t length,
+                                         bool exact) {
+    /* Po scaleniu liczba i rozmiary numerów są znane, więc wynik alokowany
+     * jest jednym blokiem. */
+    Reverse rev;
+    PhoneNumbers *pnum = NULL;
+    if (reverseCollect(pf, num, length, exact, &rev))
+        pnum = phnumFromNums(rev.merged, rev.amount);
+    reverseFree(&rev);
+    return pnum;
 }
 
 PhoneNumbers *phfwdReverse(PhoneForward const *pf, char const *num) {
-    size_t length, toReplace = 0;
     if (!pf) return NULL;
-    if (!(length = isCorrect(num))) return phnumNew();
 
-    TrieNode *longest = trieFindSeq(pf->revs, num, &toReplace);
-    if (!longest) return phnumWithOne(NULL, num);
+    char const *encoded;
+    size_t length = numEncode(num, &encoded);
+    if (!length) return phnumAlloc(0, 0, 0);
+    if (!encoded) return NULL;
 
-    Table *duplicated = tableNew();
-    if (!duplicated ||
-        !findAllRevs(longest, duplicated, num, length, toReplace)) {
-        tableFree(duplicated);
-        return NULL;
+    PhoneNumbers *pnum = phfwdReverseEncoded(pf, encoded, length, false);
+    numFreeEncoded(encoded, num);
+    return pnum;
+}
+
+bool phfwdReverseInto(PhoneForward const *pf, char const *num, char *buf,
+                      size_t cap, size_t *len, size_t *count) {
+    if (!pf || !len || !count) return false;
+    *len = *count = 0;
+
+    char const *encoded;
+    size_t length = numEncode(num, &encoded);
+    if (!length) return true;
+    if (!encoded) return false;
+
+    Reverse rev;
+    bool collected = reverseCollect(pf, encoded, length, false, &rev);
+    numFreeEncoded(encoded, num);
+
+    if (collected) {
+        for (size_t i = 0; i < rev.amount; i++)
+            *len += packedLength(rev.merged[i]) + 1;
+        *count = rev.amount;
+
+        if (*len <= cap)
+            for (size_t i = 0; i < rev.amount; i++) {
+                numUnpack(rev.merged[i], buf);
+                buf += packedLength(rev.merged[i]) + 1;
+            }
     }
 
-    if (tableIsEmpty(duplicated)) {
-        tableFree(duplicated);
-        return phnumWithOne(NULL, num);
+    reverseFree(&rev);
+    return collected;
+}
+
+/**
+ * Numer przeciwobrazu powstały z zastąpienia początkowych znaków numeru
+ * iteratora prefiksem.
+ */
+typedef struct RevCandidate {
+    uint8_t const *prefix; /**< Upakowany nowy prefiks lub NULL, jeśli numer
+                                jest numerem iteratora. */
+    size_t depth; /**< Liczba zastępowanych znaków numeru iteratora. */
+} RevCandidate;
+
+/**
+ * Pozycja iteratora w zbiorze prefiksów jednego wierzchołka ścieżki numeru
+ * w drzewie @p revs.
+ *
+ * Numery powstałe z prefiksów zbioru są uporządkowane tak jak prefiksy,
+ * chyba że jeden z prefiksów jest prefiksem innego. Prefiks, który jest
+ * prefiksem następnego w zbiorze, odkładany jest więc do czasu, aż jego numer
+ * okaże się najmniejszym z numerów odłożonych prefiksów i bieżącego
+ * prefiksu. Odłożone prefiksy są prefiksami jeden drugiego, więc jest ich
+ * nie więcej niż znaków najdłuższego z nich.
+ */
+typedef struct RevLevel {
+    SortedSet const *sources; /**< Zbiór prefiksów wierzchołka. */
+    SortedSet const *shadowed; /**< Przysłonięte prefiksy zbioru (zobacz
+                                    trieGetShadowed()). */
+    size_t depth; /**< Długość ciągu wierzchołka. */
+    size_t pos; /**< Indeks bieżącego prefiksu zbioru. */
+    uint8_t const **deferred; /**< Odłożone prefiksy. */
+    size_t deferredCount; /**< Liczba odłożonych prefiksów. */
+    size_t deferredCap; /**< Rozmiar tablicy @p deferred. */
+    bool hasHead; /**< Czy w zbiorze pozostał jakiś numer. */
+    RevCandidate head; /**< Najmniejszy pozostały numer zbioru. */
+    size_t headIdx; /**< Indeks odłożonego prefiksu numeru @p head lub
+                         @p deferredCount, jeśli jest nim bieżący prefiks. */
+} RevLevel;
+
+/**
+ * Struktura przechowująca stan iteratora po wyniku phfwdReverse().
+ */
+struct PhfwdReverseIter {
+    TrieArena const *arena; /**< Arena drzew struktury iteratora. */
+    char *encoded; /**< Numer iteratora w kodowaniu wewnętrznym. */
+    char *text; /**< Numer iteratora. */
+    size_t length; /**< Długość numeru iteratora. */
+    RevLevel *levels; /**< Pozycje w zbiorach wierzchołków ścieżki. */
+    size_t levelCount; /**< Liczba niepustych zbiorów na ścieżce. */
+    bool self; /**< Czy numer iteratora nie został jeszcze zwrócony. */
+    bool hasLast; /**< Czy zwrócono już jakiś numer. */
+    RevCandidate last; /**< Ostatnio zwrócony numer. */
+    char *buf; /**< Miejsce na zwracany numer. */
+    size_t cap; /**< Rozmiar @p buf. */
+    bool failed; /**< Czy nie udało się alokować pamięci. */
+};
+
+/**
+ * @brief Porównuje dwa numery przeciwobrazu bez ich składania.
+ * @param[in] it - wskaźnik na iterator.
+ * @param[in] a - pierwszy numer.
+ * @param[in] b - drugi numer.
+ * @return Wartość ujemna, zero lub dodatnia, jeśli @p a jest odpowiednio
+ * mniejszy, równy lub większy od @p b.
+ */
+static int revCompare(PhfwdReverseIter const *it, RevCandidate a,
+                      RevCandidate b) {
+    size_t prefixA = 0, prefixB = 0;
+    uint8_t const *digitsA = a.prefix ? packedDigits(a.prefix, &prefixA) : NULL;
+    uint8_t const *digitsB = b.prefix ? packedDigits(b.prefix, &prefixB) : NULL;
+    size_t lengthA = prefixA + it->length - a.depth;
+    size_t lengthB = prefixB + it->length - b.depth;
+
+    for (size_t i = 0; i < lengthA && i < lengthB; i++) {
+        int symbolA = i < prefixA ?
+                      packedSymbol(digitsA, i) :
+                      symbolValue(it->encoded[a.depth + i - prefixA]);
+        int symbolB = i < prefixB ?
+                      packedSymbol(digitsB, i) :
+                      symbolValue(it->encoded[b.depth + i - prefixB]);
+        if (symbolA != symbolB) return symbolA - symbolB;
     }
+    return (lengthA > lengthB) - (lengthA < lengthB);
+}
 
-    PhoneNumbers *pnum = phnumNew();
-    if (!pnum || !tableAdd(duplicated, num) ||
-        !phnumConsumeDistinct(pnum, duplicated)) {
-        tableFree(duplicated);
-        phnumDelete(pnum);
-        return NULL;
+/**
+ * @brief Odkłada prefiks @p prefix zbioru @p level.
+ * @param[in,out] level - wskaźnik na pozycję w zbiorze.
+ * @param[in] prefix - wskaźnik na element zbioru.
+ * @return Wartość @p true, jeśli operacja się powiodła. Wartość @p false,
+ * jeśli nie udało się alokować pamięci.
+ */
+static bool revLevelDefer(RevLevel *level, uint8_t const *prefix) {
+    if (level->deferredCount == level->deferredCap) {
+        size_t cap = level->deferredCap ? 2 * level->deferredCap : 4;
+        uint8_t const **deferred = realloc(level->deferred,
+                                           cap * sizeof(uint8_t const *));
+        if (!deferred) return false;
+        level->deferred = deferred;
+        level->deferredCap = cap;
     }
+    level->deferred[level->deferredCount++] = prefix;
+    return true;
+}
 
-    tableFree(duplicated);
-    return pnum;
+/**
+ * @brief Wyznacza najmniejszy pozostały numer zbioru @p level.
+ * Odkłada kolejne prefiksy, dopóki bieżący jest prefiksem następnego.
+ * @param[in] it - wskaźnik na iterator.
+ * @param[in,out] level - wskaźnik na pozycję w zbiorze.
+ * @return Wartość @p true, jeśli operacja się powiodła. Wartość @p false,
+ * jeśli nie udało się alokować pamięci.
+ */
+static bool revLevelHead(PhfwdReverseIter const *it, RevLevel *level) {
+    size_t amount = setGetAmount(level->sources);
+    while (level->pos + 1 < amount &&
+           packedIsPrefix(setGet(level->sources, level->pos),
+                          setGet(level->sources, level->pos + 1)))
+        if (!revLevelDefer(level, setGet(level->sources, level->pos++)))
+            return false;
+
+    level->hasHead = level->pos < amount;
+    level->headIdx = level->deferredCount;
+    if (level->hasHead)
+        level->head = (RevCandidate) {setGet(level->sources, level->pos),
+                                      level->depth};
+
+    RevCandidate candidate;
+    for (size_t i = 0; i < level->deferredCount; i++) {
+        candidate = (RevCandidate) {level->deferred[i], level->depth};
+        if (!level->hasHead || revCompare(it, candidate, level->head) < 0) {
+            level->hasHead = true;
+            level->head = candidate;
+            level->headIdx = i;
+        }
+    }
+    return true;
 }
 
 /**
- * Zwraca liczbę numerów w strukturze. Zakłada, że @p pnum nie jest NULL-em.
- * @param pnum - wskaźnik na strukturę.
- * @return Wartość liczbowa reprezentująca liczbę numerów.
+ * @brief Usuwa najmniejszy pozostały numer zbioru @p level i wyznacza
+ * kolejny.
+ * @param[in] it - wskaźnik na iterator.
+ * @param[in,out] level - wskaźnik na pozycję w zbiorze z niepustym
+ *                        @p head.
+ * @return Wartość @p true, jeśli operacja się powiodła. Wartość @p false,
+ * jeśli nie udało się alokować pamięci.
  */
-static size_t phnumGetAmount(PhoneNumbers *pnum) {
-    return tableGetAmount(pnum->nums);
+static bool revLevelPop(PhfwdReverseIter const *it, RevLevel *level) {
+    if (level->headIdx == level->deferredCount) {
+        level->pos++;
+    }
+    else {
+        level->deferredCount--;
+        memmove(level->deferred + level->headIdx,
+                level->deferred + level->headIdx + 1,
+                (level->deferredCount - level->headIdx) *
+                sizeof(uint8_t const *));
+    }
+    return revLevelHead(it, level);
 }
 
-PhoneNumbers *phfwdGetReverse(PhoneForward const *pf, char const *num) {
+PhfwdReverseIter *phfwdReverseIterNew(PhoneForward const *pf,
+                                      char const *num) {
     if (!pf) return NULL;
-    PhoneNumbers *revs = phfwdReverse(pf, num);
-    PhoneNumbers *realRevs = phnumNew();
-    if (!revs || !realRevs) {
-        phnumDelete(realRevs);
-        phnumDelete(revs);
+
+    PhfwdReverseIter *it = calloc(1, sizeof(PhfwdReverseIter));
+    if (!it) return NULL;
+
+    char const *encoded;
+    size_t length = numEncode(num, &encoded);
+    if (!length) return it;
+    if (!encoded) {
+        free(it);
         return NULL;
     }
-    size_t numCount = phnumGetAmount(revs);
-    PhoneNumbers *got;
-
-    char *rev;
-    for (size_t i = 0; i < numCount; i++) {
-        rev = (char *) phnumGet(revs, i);
-        got = phfwdGet(pf, rev);
-        if (got && strcmp(phnumGet(got, 0), num) == 0)
-            if (!phnumAdd(realRevs, rev)) {
-                phnumDelete(realRevs);
-                phnumDelete(revs);
-                phnumDelete(got);
-                return NULL;
+
+    /* Pamięć iteratora zależy jedynie od długości numeru: każdy wierzchołek
+     * ścieżki ma co najwyżej jeden zbiór. */
+    size_t depth, count = 0;
+    TrieNode *longest = trieFindSeq(pf->arena, pf->revs, encoded, &depth);
+    for (TrieNode *node = longest; node; node = trieGetParent(pf->arena, node))
+        count++;
+
+    it->arena = pf->arena;
+    it->length = length;
+    it->self = true;
+    it->encoded = malloc(2 * (length + 1));
+    it->levels = count ? calloc(count, sizeof(RevLevel)) : NULL;
+    bool ok = it->encoded && (!count || it->levels);
+    if (ok) {
+        it->text = it->encoded + length + 1;
+        memcpy(it->encoded, encoded, length + 1);
+        memcpy(it->text, num, length + 1);
+    }
+
+    for (TrieNode *node = longest; ok && node;
+         node = trieGetParent(pf->arena, node)) {
+        RevLevel *level = &it->levels[it->levelCount];
+        level->sources = trieGetSources(node);
+        level->shadowed = trieGetShadowed(pf->arena, node);
+        level->depth = depth;
+        depth -= trieNodeGetLabelLength(node);
+        if (setGetAmount(level->sources) == 0) continue;
+
+        it->levelCount++;
+        ok = revLevelHead(it, level);
+    }
+    numFreeEncoded(encoded, num);
+
+    if (!ok) {
+        phfwdReverseIterDelete(it);
+        return NULL;
+    }
+    return it;
+}
+
+/**
+ * @brief Usuwa z iteratora najmniejszy pozostały numer przeciwobrazu.
+ * Pomija numery równe ostatnio zwróconemu oraz numery usuniętych prefiksów,
+ * które pozostają w zbiorach do czasu zwolnienia (zobacz trieIsDetached()).
+ * @param[in,out] it - wskaźnik na iterator.
+ * @param[out] next - wskaźnik na zmienną, w której zostanie zapisany numer.
+ * @return Wartość @p true, jeśli numer został zapisany. Wartość @p false,
+ * jeśli iterator się wyczerpał lub nie udało się alokować pamięci; w tym
+ * drugim wypadku ustawiana jest flaga @p failed.
+ */
+static bool revPop(PhfwdReverseIter *it, RevCandidate *next) {
+    RevLevel *from;
+    bool found;
+    do {
+        /* Poziomów jest nie więcej niż znaków numeru, więc najmniejszy numer
+         * wybierany jest przeglądaniem wszystkich. */
+        found = it->self;
+        *next = (RevCandidate) {NULL, 0};
+        from = NULL;
+        for (size_t i = 0; i < it->levelCount; i++) {
+            RevLevel *level = &it->levels[i];
+            if (level->hasHead &&
+                (!found || revCompare(it, level->head, *next) < 0)) {
+                found = true;
+                *next = level->head;
+                from = level;
+            }
+        }
+
+        if (!found) return false;
+        if (!from) it->self = false;
+        else if (!revLevelPop(it, from)) it->failed = true;
+    } while (!it->failed &&
+             ((next->prefix && trieIsDetached(it->arena, next->prefix)) ||
+              (it->hasLast && revCompare(it, *next, it->last) == 0)));
+
+    it->hasLast = true;
+    it->last = *next;
+    return !it->failed;
+}
+
+bool phfwdReverseIterNext(PhfwdReverseIter *it, char const **num) {
+    if (!it || !num || it->failed) return false;
+
+    RevCandidate next;
+    if (!revPop(it, &next)) {
+        *num = NULL;
+        return !it->failed;
+    }
+
+    size_t prefixLength = next.prefix ? packedLength(next.prefix) : 0;
+    size_t length = prefixLength + it->length - next.depth;
+    if (length + 1 > it->cap) {
+        size_t cap = 2 * (length + 1);
+        char *buf = realloc(it->buf, cap);
+        if (buf) {
+            it->buf = buf;
+            it->cap = cap;
+        }
+        else {
+            it->failed = true;
+        }
+    }
+    if (it->failed) return false;
+
+    if (next.prefix) numUnpack(next.prefix, it->buf);
+    memcpy(it->buf + prefixLength, it->text + next.depth,
+           it->length - next.depth + 1);
+    *num = it->buf;
+    return true;
+}
+
+void phfwdReverseIterDelete(PhfwdReverseIter *it) {
+    if (!it) return;
+
+    for (size_t i = 0; i < it->levelCount; i++)
+        free(it->levels[i].deferred);
+    free(it->levels);
+    free(it->encoded);
+    free(it->buf);
+    free(it);
+}
+
+/**
+ * @brief Wyszukuje w zbiorze @p set element równy @p num.
+ * @param[in] set - wskaźnik na zbiór lub NULL.
+ * @param[in] num - wskaźnik na upakowany numer.
+ * @return Element zbioru równy @p num lub NULL, jeśli go nie ma.
+ */
+static uint8_t const *setFindEqual(SortedSet const *set, uint8_t const *num) {
+    uint8_t const *found = setGet(set, setRank(set, num));
+    return found && packedCompare(found, num) == 0 ? found : NULL;
+}
+
+/**
+ * @brief Porównuje dwa ciągi znaków w kodowaniu wewnętrznym o podanych
+ * długościach.
+ * @param[in] a - pierwszy ciąg.
+ * @param[in] lengthA - długość @p a.
+ * @param[in] b - drugi ciąg.
+ * @param[in] lengthB - długość @p b.
+ * @return Wartość ujemna, zero lub dodatnia, jeśli @p a jest odpowiednio
+ * mniejszy, równy lub większy od @p b.
+ */
+static int strCompare(char const *a, size_t lengthA, char const *b,
+                      size_t lengthB) {
+    int cmp = memcmp(a, b, lengthA < lengthB ? lengthA : lengthB);
+    if (cmp != 0) return cmp;
+    return (lengthA > lengthB) - (lengthA < lengthB);
+}
+
+/**
+ * @brief Zlicza numery powstałe z prefiksów zbioru @p set poziomu @p level,
+ * które zaczynają się od ciągu @p str.
+ * Numer powstały z prefiksu P zaczyna się od @p str, jeśli P zaczyna się od
+ * @p str albo P jest prefiksem @p str, a pozostałe znaki @p str są początkiem
+ * dalszej części numeru iteratora. Pierwsze zlicza się dwoma wyszukiwaniami
+ * binarnymi, zaś drugie sprawdza się dla każdej długości P z osobna.
+ * Prefiksy usuniętych poddrzew, które czekają na zwolnienie, są pomijane
+ * (zobacz trieCountDetached()).
+ * @param[in] it - wskaźnik na iterator.
+ * @param[in] level - wskaźnik na poziom.
+ * @param[in] set - wskaźnik na podzbiór prefiksów poziomu lub NULL.
+ * @param[in] str - ciąg znaków w kodowaniu wewnętrznym.
+ * @param[in] length - długość @p str.
+ * @param[out] packed - bufor o rozmiarze co najmniej packedSize() @p length.
+ * @return Liczba numerów.
+ */
+static size_t rangeLevelPrefixed(PhfwdReverseIter const *it,
+                                 RevLevel const *level, SortedSet const *set,
+                                 char const *str, size_t length,
+                                 uint8_t *packed) {
+    if (!setGetAmount(set)) return 0;
+
+    char const *rest = it->encoded + level->depth;
+    size_t restLength = it->length - level->depth;
+    numPack(packed, str, length);
+    size_t count = setCountPrefixed(set, packed) -
+                   trieCountDetached(it->arena, set, packed);
+
+    for (size_t j = length > restLength ? length - restLength : 1;
+         j < length; j++)
+        if (memcmp(str + j, rest, length - j) == 0) {
+            numPack(packed, str, j);
+            count += setFindEqual(set, packed) &&
+                     !trieIsDetached(it->arena, packed);
+        }
+    return count;
+}
+
+/**
+ * @brief Zlicza numery przeciwobrazu iteratora @p it zaczynające się od
+ * ciągu @p str. Numery z przysłoniętych prefiksów powtarzają numery
+ * płytszych poziomów, więc nie są zliczane.
+ * @param[in] it - wskaźnik na iterator.
+ * @param[in] str - ciąg znaków w kodowaniu wewnętrznym.
+ * @param[in] length - długość @p str.
+ * @param[out] packed - bufor o rozmiarze co najmniej packedSize() @p length.
+ * @return Liczba numerów.
+ */
+static size_t rangePrefixed(PhfwdReverseIter const *it, char const *str,
+                            size_t length, uint8_t *packed) {
+    size_t count = length <= it->length &&
+                   memcmp(it->encoded, str, length) == 0;
+    for (size_t i = 0; i < it->levelCount; i++) {
+        RevLevel const *level = &it->levels[i];
+        count += rangeLevelPrefixed(it, level, level->sources, str, length,
+                                    packed) -
+                 rangeLevelPrefixed(it, level, level->shadowed, str, length,
+                                    packed);
+    }
+    return count;
+}
+
+/**
+ * @brief Sprawdza, czy ciąg @p str należy do przeciwobrazu iteratora @p it.
+ * @param[in] it - wskaźnik na iterator.
+ * @param[in] str - ciąg znaków w kodowaniu wewnętrznym.
+ * @param[in] length - długość @p str.
+ * @param[out] packed - bufor o rozmiarze co najmniej packedSize() @p length.
+ * @return Wartość @p true, jeśli @p str należy do przeciwobrazu.
+ */
+static bool rangeHas(PhfwdReverseIter const *it, char const *str,
+                     size_t length, uint8_t *packed) {
+    if (strCompare(it->encoded, it->length, str, length) == 0) return true;
+
+    for (size_t i = 0; i < it->levelCount; i++) {
+        RevLevel const *level = &it->levels[i];
+        size_t restLength = it->length - level->depth;
+        if (length <= restLength ||
+            memcmp(str + length - restLength, it->encoded + level->depth,
+                   restLength) != 0)
+            continue;
+
+        numPack(packed, str, length - restLength);
+        if (setFindEqual(level->sources, packed) &&
+            !setFindEqual(level->shadowed, packed) &&
+            !trieIsDetached(it->arena, packed))
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Ustawia iterator @p it tak, by zwracał numery nie mniejsze od
+ * @p str.
+ * Na każdym poziomie bieżącym prefiksem staje się pierwszy prefiks nie
+ * mniejszy od @p str, zaś odłożonymi te prefiksy @p str, z których powstają
+ * numery nie mniejsze od @p str.
+ * @param[in,out] it - wskaźnik na nowo utworzony iterator.
+ * @param[in] str - ciąg znaków w kodowaniu wewnętrznym.
+ * @param[in] length - długość @p str.
+ * @param[out] packed - bufor o rozmiarze co najmniej packedSize() @p length.
+ * @return Wartość @p true, jeśli operacja się powiodła. Wartość @p false,
+ * jeśli nie udało się alokować pamięci.
+ */
+static bool revSeek(PhfwdReverseIter *it, char const *str, size_t length,
+                    uint8_t *packed) {
+    it->self = strCompare(it->encoded, it->length, str, length) >= 0;
+
+    for (size_t i = 0; i < it->levelCount; i++) {
+        RevLevel *level = &it->levels[i];
+        char const *rest = it->encoded + level->depth;
+        size_t restLength = it->length - level->depth;
+
+        numPack(packed, str, length);
+        level->pos = setRank(level->sources, packed);
+        level->deferredCount = 0;
+        for (size_t j = 1; j < length; j++) {
+            if (strCompare(rest, restLength, str + j, length - j) < 0)
+                continue;
+            numPack(packed, str, j);
+            uint8_t const *prefix = setFindEqual(level->sources, packed);
+            if (prefix && !revLevelDefer(level, prefix)) return false;
+        }
+        if (!revLevelHead(it, level)) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Ustawia iterator @p it na numerze przeciwobrazu o indeksie
+ * @p offset.
+ * Numer wyznaczany jest znak po znaku: spośród dwunastu przedłużeń
+ * bieżącego prefiksu wybierane jest to, od którego zaczyna się szukany
+ * numer, na podstawie liczby numerów zaczynających się od każdego z nich.
+ * Koszt zależy więc od długości numerów, a nie od @p offset. Wymaga
+ * aktualnych zbiorów przysłoniętych prefiksów.
+ * @param[in,out] it - wskaźnik na nowo utworzony iterator.
+ * @param[in] offset - indeks numeru.
+ * @return Wartość @p true, jeśli operacja się powiodła. Wartość @p false,
+ * jeśli nie udało się alokować pamięci.
+ */
+static bool rangeSeek(PhfwdReverseIter *it, size_t offset) {
+    size_t cap = it->length + 1, length = 0;
+    char *str = malloc(cap);
+    uint8_t *packed = malloc(packedSize(cap));
+    bool found = false, descended = true;
+
+    while (str && packed && !found && descended) {
+        if (length && rangeHas(it, str, length, packed)) {
+            if (offset == 0) {
+                found = true;
+                break;
             }
-        phnumDelete(got);
+            offset--;
+        }
+
+        if (length == cap) {
+            char *grown = realloc(str, 2 * cap);
+            if (!grown) break;
+            str = grown;
+            uint8_t *grownPacked = realloc(packed, packedSize(2 * cap));
+            if (!grownPacked) break;
+            packed = grownPacked;
+            cap *= 2;
+        }
+
+        descended = false;
+        for (int c = 0; c < ALLNUM && !descended; c++) {
+            str[length] = (char) ('0' + c);
+            size_t count = rangePrefixed(it, str, length + 1, packed);
+            if (offset < count) descended = true;
+            else offset -= count;
+        }
+        if (descended) length++;
     }
 
-    phnumDelete(revs);
-    return realRevs;
+    bool ok = found || !descended;
+    if (found) {
+        ok = revSeek(it, str, length, packed);
+    }
+    else if (ok) {
+        /* Przeciwobraz ma nie więcej niż offset numerów. */
+        it->self = false;
+        for (size_t i = 0; i < it->levelCount; i++)
+            it->levels[i].hasHead = false;
+    }
+    free(str);
+    free(packed);
+    return ok;
+}
+
+/**
+ * @brief Alokuje strukturę @p PhoneNumbers zawierającą numery @p nums
+ * przeciwobrazu iteratora @p it.
+ * @param[in] it - wskaźnik na iterator.
+ * @param[in] nums - wskaźnik na tablicę numerów.
+ * @param[in] amount - liczba numerów.
+ * @return Wskaźnik na strukturę @p PhoneNumbers lub NULL, gdy nie udało się
+ * alokować pamięci.
+ */
+static PhoneNumbers *phnumFromCandidates(PhfwdReverseIter const *it,
+                                         RevCandidate const *nums,
+                                         size_t amount) {
+    size_t packedBytes = 0, textBytes = 0, length;
+    for (size_t i = 0; i < amount; i++) {
+        length = (nums[i].prefix ? packedLength(nums[i].prefix) : 0) +
+                 it->length - nums[i].depth;
+        packedBytes += packedSize(length);
+        textBytes += length + 1;
+    }
+
+    PhoneNumbers *pnum = phnumAlloc(amount, packedBytes, textBytes);
+    if (!pnum) return NULL;
+
+    packedBytes = textBytes = 0;
+    for (size_t i = 0; i < amount; i++) {
+        pnum->entries[i] = (PhnumEntry) {packedBytes, textBytes};
+        uint8_t *out = pnum->packed + packedBytes;
+        if (nums[i].prefix)
+            packedBytes += packedReplacePrefix(out, nums[i].prefix,
+                                               it->encoded, it->length,
+                                               nums[i].depth);
+        else
+            packedBytes += numPack(out, it->encoded, it->length);
+        textBytes += packedLength(out) + 1;
+    }
+    return pnum;
+}
+
+bool phfwdReverseCount(PhoneForward const *pf, char const *num,
+                       size_t *count) {
+    if (!count) return false;
+    *count = 0;
+
+    PhfwdReverseIter *it = phfwdReverseIterNew(pf, num);
+    if (!it) return false;
+
+    if (trieShadowedIsValid(pf->arena)) {
+        /* Każdy nieprzysłonięty prefiks daje inny numer, zaś prefiksy
+         * usuniętych poddrzew czekają w zbiorach na zwolnienie. */
+        *count = it->self;
+        for (size_t i = 0; i < it->levelCount; i++) {
+            RevLevel const *level = &it->levels[i];
+            *count += setGetAmount(level->sources) -
+                      trieCountDetached(pf->arena, level->sources, NULL) -
+                      setGetAmount(level->shadowed) +
+                      trieCountDetached(pf->arena, level->shadowed, NULL);
+        }
+    }
+    else {
+        RevCandidate next;
+        while (revPop(it, &next))
+            (*count)++;
+    }
+
+    bool ok = !it->failed;
+    phfwdReverseIterDelete(it);
+    return ok;
+}
+
+PhoneNumbers *phfwdReverseRange(PhoneForward const *pf, char const *num,
+                                size_t offset, size_t limit) {
+    PhfwdReverseIter *it = phfwdReverseIterNew(pf, num);
+    if (!it) return NULL;
+
+    RevCandidate next, *slice = NULL, *grown;
+    size_t amount = 0, cap = 0;
+    bool ok;
+    if (trieShadowedIsValid(pf->arena)) {
+        ok = rangeSeek(it, offset);
+    }
+    else {
+        for (; offset && revPop(it, &next); offset--);
+        ok = !it->failed;
+    }
+
+    while (ok && amount < limit && revPop(it, &next)) {
+        if (amount == cap) {
+            cap = cap ? 2 * cap : 16;
+            grown = realloc(slice, cap * sizeof(RevCandidate));
+            if (!grown) {
+                ok = false;
+                break;
+            }
+            slice = grown;
+        }
+        slice[amount++] = next;
+    }
+
+    PhoneNumbers *pnum = NULL;
+    if (ok && !it->failed) pnum = phnumFromCandidates(it, slice, amount);
+    free(slice);
+    phfwdReverseIterDelete(it);
+    return pnum;
+}
+
+PhoneNumbers *phfwdGetReverse(PhoneForward const *pf, char const *num) {
+    if (!pf) return NULL;
+
+    char const *encoded;
+    size_t length = numEncode(num, &encoded);
+    if (!length) return phnumAlloc(0, 0, 0);
+    if (!encoded) return NULL;
+
+    PhoneNumbers *pnum = phfwdReverseEncoded(pf, encoded, length, true);
+    numFreeEncoded(encoded, num);
+    return pnum;
+}
+
+void phfwdGetStats(PhoneForward const *pf, PhoneForwardStats *stats) {
+    if (!pf || !stats) return;
+
+    PoolStats pool;
+    poolGetStats(trieArenaGetPool(pf->arena), &pool);
+    stats->strings = pool.strings;
+    stats->references = pool.references;
+    stats->bytes = pool.bytes;
+    stats->savedBytes = pool.savedBytes;
+
+    stats->cacheHits = stats->cacheMisses = 0;
+    if (pf->cache)
+        cacheGetStats(pf->cache, &stats->cacheHits, &stats->cacheMisses);
+    stats->indexValid = trieIndexState(pf->arena, &stats->indexLengths,
+                                       &stats->indexDepth);
 }
 
 void phnumDelete(PhoneNumbers *pnum) {
-    if (!pnum) return;
-    tableFree(pnum->nums);
     free(pnum);
 }
 
+PhoneNumbers *phnumMerge(PhoneNumbers const *const *parts, size_t count) {
+    size_t total = 0;
+    for (size_t k = 0; k < count; k++) {
+        if (!parts[k]) return NULL;
+        total += parts[k]->amount;
+    }
+
+    uint8_t const **nums = malloc((total ? total : 1) * sizeof(uint8_t *));
+    size_t *next = calloc(count ? count : 1, sizeof(size_t));
+    if (!nums || !next) {
+        free(nums);
+        free(next);
+        return NULL;
+    }
+
+    /* Części jest niewiele, więc najmniejszy z ich bieżących numerów
+     * wybierany jest przeglądaniem wszystkich. Z wybranej części
+     * przepisywane są od razu wszystkie numery nie większe od drugiego
+     * najmniejszego, bo części zwykle zajmują rozłączne przedziały. */
+    size_t amount = 0;
+    for (;;) {
+        uint8_t const *least = NULL, *second = NULL, *num;
+        size_t from = count;
+        for (size_t k = 0; k < count; k++) {
+            if (next[k] == parts[k]->amount) continue;
+            num = parts[k]->packed + parts[k]->entries[next[k]].packed;
+            if (!least || packedCompare(num, least) < 0) {
+                second = least;
+                least = num;
+                from = k;
+            }
+            else if (!second || packedCompare(num, second) < 0) {
+                second = num;
+            }
+        }
+        if (!least) break;
+
+        PhoneNumbers const *part = parts[from];
+        do {
+            if (amount == 0 || packedCompare(nums[amount - 1], least) != 0)
+                nums[amount++] = least;
+            if (++next[from] == part->amount) break;
+            least = part->packed + part->entries[next[from]].packed;
+        } while (!second || packedCompare(least, second) <= 0);
+    }
+
+    PhoneNumbers *pnum = phnumFromNums(nums, amount);
+    free(nums);
+    free(next);
+    return pnum;
+}
+
 char const *phnumGet(PhoneNumbers const *pnum, size_t idx) {
-    if (!pnum) return NULL;
-    return tableGet(pnum->nums, idx);
+    if (!pnum || idx >= pnum->amount) return NULL;
+
+    /* Miejsce na rozpakowane numery zarezerwowano przy alokacji, więc ich
+     * zapisanie nie zmienia ciągu numerów widocznego dla użytkownika
+     * i struktura pozostaje logicznie stała. Rozpakowuje je wątek, który
+     * pierwszy zmieni stan, a pozostałe czekają, aż skończy, więc ten sam
+     * wynik może być odczytywany współbieżnie. */
+    PhoneNumbers *mutable = (PhoneNumbers *) pnum;
+    if (atomic_load_explicit(&mutable->unpack, memory_order_acquire) !=
+        UNPACK_DONE) {
+        unsigned state = UNPACK_NONE;
+        if (atomic_compare_exchange_strong(&mutable->unpack, &state,
+                                           UNPACK_BUSY)) {
+            for (size_t i = 0; i < pnum->amount; i++)
+                numUnpack(pnum->packed + pnum->entries[i].packed,
+                          mutable->text + pnum->entries[i].text);
+            atomic_store_explicit(&mutable->unpack, UNPACK_DONE,
+                                  memory_order_release);
+        } else {
+            while (atomic_load_explicit(&mutable->unpack,
+                                        memory_order_acquire) != UNPACK_DONE)
+                sched_yield();
+        }
+    }
+    return pnum->text + pnum->entries[idx].text;
 }
@@ -24,6 +24,48 @@ typedef struct PhoneForward PhoneForward; /**< @struct PhoneForward */
 struct PhoneNumbers;
 typedef struct PhoneNumbers PhoneNumbers; /**< @struct PhoneNumbers */
 
+/**
+ * To jest struktura przechowująca stan iteratora po wyniku phfwdReverse().
+ */
+struct PhfwdReverseIter;
+typedef struct PhfwdReverseIter PhfwdReverseIter; /**< @struct PhfwdReverseIter */
+
+/**
+ * To jest struktura przechowująca statystyki pamięci struktury
+ * @ref PhoneForward.
+ */
+typedef struct PhoneForwardStats {
+    size_t strings;    /**< Liczba różnych przechowywanych numerów. */
+    size_t references; /**< Liczba odwołań do tych numerów z przekierowań. */
+    size_t bytes;      /**< Liczba bajtów zajmowanych przez te numery
+                            w postaci upakowanej (zobacz packed.h). */
+    size_t savedBytes; /**< Liczba bajtów zaoszczędzonych dzięki temu, że
+                            każdy numer jest przechowywany tylko raz. */
+    size_t cacheHits;  /**< Liczba wywołań phfwdGet(), których wynik pochodził
+                            z pamięci podręcznej (zobacz phfwdSetCache()). */
+    size_t cacheMisses; /**< Liczba wywołań phfwdGet(), których wynik
+                             wyznaczono mimo włączonej pamięci podręcznej. */
+    bool indexValid;   /**< Czy phfwdGet() korzysta z indeksu najdłuższych
+                            prefiksów. Indeks porzucony z braku pamięci lub
+                            z powodu prefiksu dłuższego niż 64 cyfry
+                            odbudowywany jest porcjami przy kolejnych
+                            modyfikacjach i przez phfwdMaintain(). */
+    size_t indexLengths; /**< Liczba długości prefiksów w indeksie. */
+    size_t indexDepth; /**< Największa liczba sond wyszukiwania w indeksie,
+                            logarytmiczna względem liczby długości po
+                            phfwdMaintain(). */
+} PhoneForwardStats;
+
+/**
+ * To jest struktura opisująca pojedyncze przekierowanie we wsadzie
+ * phfwdAddBatch().
+ */
+typedef struct PhfwdRule {
+    char const *num1; /**< Prefiks numerów przekierowywanych. */
+    char const *num2; /**< Prefiks numerów, na które jest wykonywane
+                           przekierowanie. */
+} PhfwdRule;
+
 /** @brief Tworzy nową strukturę.
  * Tworzy nową strukturę niezawierającą żadnych przekierowań.
  * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
@@ -57,16 +99,119 @@ void phfwdDelete(PhoneForward *pf);
  */
 bool phfwdAdd(PhoneForward *pf, char const *num1, char const *num2);
 
+/** @brief Dodaje wsad przekierowań.
+ * Działa jak wywołanie phfwdAdd() dla kolejnych elementów @p rules, więc
+ * późniejsze przekierowanie z takim samym parametrem @p num1 zastępuje
+ * wcześniejsze. Przekierowania sortowane są według @p num1 i wstawiane do
+ * obu drzew w porządku przejścia w głąb, a pamięć na węzły i zbiory
+ * alokowana jest dużymi blokami przed wprowadzeniem jakiejkolwiek zmiany.
+ * Wsad dodawany jest w całości albo wcale.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] rules  – tablica przekierowań;
+ * @param[in] n      – liczba przekierowań.
+ * @return Wartość @p true, jeśli wszystkie przekierowania zostały dodane.
+ *         Wartość @p false, jeśli któreś z nich jest niepoprawne w sensie
+ *         phfwdAdd() lub nie udało się alokować pamięci; wówczas struktura
+ *         @p pf pozostaje bez zmian.
+ */
+bool phfwdAddBatch(PhoneForward *pf, PhfwdRule const *rules, size_t n);
+
 /** @brief Usuwa przekierowania.
  * Usuwa wszystkie przekierowania, w których parametr @p num jest prefiksem
  * parametru @p num1 użytego przy dodawaniu. Jeśli nie ma takich przekierowań
  * lub napis nie reprezentuje numeru, nic nie robi.
+ * Czas działania zależy jedynie od długości @p num: usunięte przekierowania
+ * przestają być widoczne od razu, zaś zajmowana przez nie pamięć zwalniana
+ * jest stopniowo przy kolejnych modyfikacjach @p pf lub przez
+ * phfwdMaintain().
  * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
  *                     numerów;
  * @param[in] num    – wskaźnik na napis reprezentujący prefiks numerów.
  */
 void phfwdRemove(PhoneForward *pf, char const *num);
 
+/** @brief Usuwa przekierowania, zgłaszając niepowodzenie.
+ * Działa jak phfwdRemove(), lecz informuje, czy usunięcie się powiodło.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] num    – wskaźnik na napis reprezentujący prefiks numerów.
+ * @return Wartość @p true, jeśli przekierowania zostały usunięte lub napis
+ *         nie reprezentuje numeru. Wartość @p false, jeśli nie udało się
+ *         alokować pamięci, @p pf jest migawką lub ma wartość NULL; wówczas
+ *         przekierowania pozostają bez zmian.
+ */
+bool phfwdTryRemove(PhoneForward *pf, char const *num);
+
+/** @brief Zwalnia pamięć usuniętych przekierowań.
+ * Zwalnia co najwyżej @p budget węzłów drzewa przekierowań usuniętych przez
+ * phfwdRemove(), w kolejności usuwania, a następnie dodaje do indeksu
+ * najdłuższych prefiksów przekierowania dodane wewnątrz usuniętych prefiksów
+ * przed ich zwolnieniem. Dopóki obie czynności nie zostaną wykonane,
+ * phfwdGet() nie korzysta z indeksu, a phfwdReverseCount()
+ * i phfwdReverseRange() odejmują numery usuniętych prefiksów, które
+ * czekają na zwolnienie. Usunięte numery uwzględnia również
+ * phfwdGetStats().
+ * Pozostała część @p budget przypada odbudowie indeksu porzuconego z braku
+ * pamięci lub z powodu prefiksu dłuższego niż 64 cyfry, która zaczyna się,
+ * gdy przekierowań o takich prefiksach już nie ma, a następnie odbudowie
+ * zbiorów prefiksów przysłoniętych, porzuconych z braku pamięci; do tego
+ * czasu phfwdReverseCount() i phfwdReverseRange() przeglądają numery po
+ * kolei. Odbudowy, tak jak zwalnianie pamięci, posuwają naprzód również
+ * kolejne modyfikacje @p pf.
+ * Po wykonaniu wszystkich tych czynności usuwa z indeksu długości, których
+ * prefiksy zniknęły; ta przebudowa trwa liniowo względem liczby
+ * przekierowań i nie wlicza się do @p budget (zobacz phfwdGetStats()).
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] budget – największa łączna liczba zwalnianych węzłów
+ *                     i dodawanych do indeksu przekierowań.
+ * @return Wartość @p true, jeśli pamięć wszystkich usuniętych przekierowań
+ *         została zwolniona, a żadna odbudowa nie czeka, lub @p pf ma
+ *         wartość NULL. Wartość @p false, jeśli pozostały jeszcze węzły do
+ *         zwolnienia, przekierowania do dodania do indeksu lub węzły do
+ *         przejrzenia przez odbudowę.
+ */
+bool phfwdMaintain(PhoneForward *pf, size_t budget);
+
+/** @brief Tworzy migawkę przekierowań w stałym czasie z odroczoną pełną
+ * kopią.
+ * Tworzy strukturę tylko do odczytu, widzącą przekierowania @p pf z chwili
+ * wywołania. Migawka współdzieli z @p pf wszystkie węzły i numery, więc jej
+ * utworzenie zajmuje stały czas, a zapytania o migawkę kosztują tyle samo co
+ * zapytania o @p pf. Kopiowanie nie odbywa się jednak na poziomie węzłów:
+ * pierwsza modyfikacja @p pf po utworzeniu migawki buduje pełną prywatną
+ * kopię wszystkich przekierowań, w czasie liniowym względem ich liczby.
+ * Kolejne modyfikacje kosztują tyle co zwykle, lecz każdy cykl złożony
+ * z utworzenia migawki i modyfikacji kosztuje czas liniowy, więc migawki nie
+ * nadają się do tanich wersji po każdym małym wsadzie zmian; struktura nie
+ * ma trybu kopiującego jedynie modyfikowaną ścieżkę. Migawkę można
+ * odpytywać z innego wątku niż ten, który modyfikuje @p pf. Funkcje
+ * modyfikujące wywołane dla migawki zwracają wartość @p false lub nic nie
+ * robią. Migawka musi zostać usunięta za pomocą funkcji @ref phfwdDelete,
+ * niezależnie od @p pf. Usunięte przekierowania @p pf, których pamięć nie
+ * została jeszcze zwolniona, są zwalniane dopiero po modyfikacji @p pf.
+ * @param[in,out] pf – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów.
+ * @return Wskaźnik na migawkę lub NULL, gdy nie udało się alokować pamięci
+ *         lub @p pf ma wartość NULL.
+ */
+PhoneForward *phfwdSnapshot(PhoneForward *pf);
+
+/** @brief Przywraca przekierowania z migawki.
+ * Zastępuje przekierowania @p pf przekierowaniami migawki @p snapshot
+ * w stałym czasie, zwalniając dotychczasowe, o ile nie współdzieli ich żadna
+ * migawka. Migawka pozostaje ważna i nadal musi zostać usunięta.
+ * @param[in,out] pf   – wskaźnik na strukturę przechowującą przekierowania
+ *                       numerów, nie będącą migawką;
+ * @param[in] snapshot – wskaźnik na migawkę utworzoną przez
+ *                       phfwdSnapshot().
+ * @return Wartość @p true, jeśli przekierowania zostały przywrócone. Wartość
+ *         @p false, jeśli któryś ze wskaźników ma wartość NULL, @p pf jest
+ *         migawką lub @p snapshot nie jest migawką.
+ */
+bool phfwdRestore(PhoneForward *pf, PhoneForward const *snapshot);
+
 /** @brief Wyznacza przekierowanie numeru.
  * Wyznacza przekierowanie podanego numeru. Szuka najdłuższego pasującego
  * prefiksu. Wynikiem jest ciąg zawierający co najwyżej jeden numer. Jeśli dany
@@ -81,6 +226,52 @@ void phfwdRemove(PhoneForward *pf, char const *num);
  */
 PhoneNumbers *phfwdGet(PhoneForward const *pf, char const *num);
 
+/** @brief Wyznacza przekierowania wielu numerów.
+ * Działa jak wywołanie phfwdGet() dla każdego z numerów @p nums, lecz
+ * przeszukuje strukturę dla wielu numerów naraz, przeplatając ich kroki.
+ * Pozwala to ukryć opóźnienia odczytów z pamięci, gdy przekierowań jest
+ * dużo. Alokuje @p n struktur @p PhoneNumbers, które muszą być zwolnione za
+ * pomocą funkcji @ref phnumDelete.
+ * @param[in] pf    – wskaźnik na strukturę przechowującą przekierowania
+ *                    numerów;
+ * @param[in] nums  – tablica @p n wskaźników na napisy reprezentujące
+ *                    numery;
+ * @param[in] n     – liczba numerów;
+ * @param[out] out  – tablica @p n wskaźników, w której zostaną zapisane
+ *                    wyniki. Wynik, którego nie udało się wyznaczyć, ma
+ *                    wartość NULL.
+ * @return Wartość @p true, jeśli wyznaczono wszystkie wyniki. Wartość
+ *         @p false, jeśli dla któregoś numeru nie udało się alokować pamięci
+ *         lub @p pf ma wartość NULL.
+ */
+bool phfwdGetBatch(PhoneForward const *pf, char const *const *nums, size_t n,
+                   PhoneNumbers **out);
+
+/** @brief Wyznacza przekierowanie numeru do bufora.
+ * Działa jak phfwdGet(), lecz zamiast alokować strukturę @p PhoneNumbers,
+ * zapisuje wynikowy numer wraz ze znakiem terminującym w buforze @p buf
+ * dostarczonym przez wywołującego. Nie alokuje pamięci, o ile @p num składa
+ * się z samych cyfr lub bufor mieści również sam numer @p num.
+ * Jeśli podany napis nie reprezentuje numeru, wynik jest pusty: w @p len
+ * zapisywane jest zero, a w buforze, jeśli @p cap jest dodatnie, pusty napis.
+ * Numer zapisywany jest tylko wtedy, gdy *@p len < @p cap. W przeciwnym
+ * wypadku zawartość bufora jest nieokreślona, a wywołanie należy powtórzyć
+ * z buforem o rozmiarze co najmniej *@p len + 1.
+ * @param[in] pf   – wskaźnik na strukturę przechowującą przekierowania
+ *                   numerów;
+ * @param[in] num  – wskaźnik na napis reprezentujący numer, nie leżący
+ *                   w buforze @p buf;
+ * @param[out] buf – wskaźnik na bufor lub NULL, jeśli @p cap wynosi zero;
+ * @param[in] cap  – rozmiar bufora @p buf;
+ * @param[out] len – wskaźnik na zmienną, w której zostanie zapisana długość
+ *                   wynikowego numeru bez znaku terminującego.
+ * @return Wartość @p true, jeśli wynik został wyznaczony. Wartość @p false,
+ *         jeśli nie udało się alokować pamięci lub @p pf albo @p len ma
+ *         wartość NULL.
+ */
+bool phfwdGetInto(PhoneForward const *pf, char const *num, char *buf,
+                  size_t cap, size_t *len);
+
 /** @brief Wyznacza przekierowania na dany numer.
  * Wyznacza następujący ciąg numerów: jeśli istnieje numer @p x, taki że wynik
  * wywołania @p phfwdGet z dowolnym prefiksem @p x zawiera numer @p num, to
@@ -96,6 +287,109 @@ PhoneNumbers *phfwdGet(PhoneForward const *pf, char const *num);
  */
 PhoneNumbers *phfwdReverse(PhoneForward const *pf, char const *num);
 
+/** @brief Wyznacza przekierowania na dany numer do bufora.
+ * Działa jak phfwdReverse(), lecz zamiast alokować strukturę
+ * @p PhoneNumbers, zapisuje wynikowe numery w buforze @p buf dostarczonym
+ * przez wywołującego, jeden za drugim, każdy zakończony znakiem
+ * terminującym. Pamięć pomocnicza potrzebna do scalenia numerów jest nadal
+ * alokowana i zwalniana przed powrotem.
+ * Numery zapisywane są tylko wtedy, gdy *@p len <= @p cap. W przeciwnym
+ * wypadku bufor pozostaje bez zmian, a wywołanie należy powtórzyć
+ * z buforem o rozmiarze co najmniej *@p len.
+ * @param[in] pf     – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] num    – wskaźnik na napis reprezentujący numer;
+ * @param[out] buf   – wskaźnik na bufor lub NULL, jeśli @p cap wynosi zero;
+ * @param[in] cap    – rozmiar bufora @p buf;
+ * @param[out] len   – wskaźnik na zmienną, w której zostanie zapisany łączny
+ *                     rozmiar numerów wraz ze znakami terminującymi;
+ * @param[out] count – wskaźnik na zmienną, w której zostanie zapisana liczba
+ *                     numerów.
+ * @return Wartość @p true, jeśli wynik został wyznaczony. Wartość @p false,
+ *         jeśli nie udało się alokować pamięci lub któryś ze wskaźników
+ *         @p pf, @p len, @p count ma wartość NULL.
+ */
+bool phfwdReverseInto(PhoneForward const *pf, char const *num, char *buf,
+                      size_t cap, size_t *len, size_t *count);
+
+/** @brief Tworzy iterator po przekierowaniach na dany numer.
+ * Iterator zwraca kolejno, w porządku leksykograficznym i bez powtórzeń, te
+ * same numery co phfwdReverse(), lecz wyznacza je dopiero na żądanie.
+ * Pamięta jedynie po jednej pozycji w każdym ze zbiorów prefiksów na ścieżce
+ * numeru @p num w drzewie przekierowań, więc jego utworzenie i pobranie
+ * pierwszych numerów kosztuje tyle, ile tych numerów, niezależnie od rozmiaru
+ * całego wyniku. Jeśli podany napis nie reprezentuje numeru, iterator nie
+ * zwraca żadnego numeru. Struktury @p pf nie wolno modyfikować, dopóki
+ * iterator nie zostanie usunięty za pomocą funkcji
+ * @ref phfwdReverseIterDelete.
+ * @param[in] pf  – wskaźnik na strukturę przechowującą przekierowania numerów;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na utworzony iterator lub NULL, gdy nie udało się
+ *         alokować pamięci lub @p pf ma wartość NULL.
+ */
+PhfwdReverseIter *phfwdReverseIterNew(PhoneForward const *pf,
+                                      char const *num);
+
+/** @brief Pobiera kolejny numer iteratora.
+ * Zapisuje w *@p num wskaźnik na napis reprezentujący kolejny numer, ważny do
+ * następnego wywołania z tym samym iteratorem lub do jego usunięcia, albo
+ * NULL, jeśli numery się skończyły.
+ * @param[in,out] it – wskaźnik na iterator;
+ * @param[out] num   – wskaźnik na zmienną, w której zostanie zapisany
+ *                     wskaźnik na napis.
+ * @return Wartość @p true, jeśli operacja się powiodła. Wartość @p false,
+ *         jeśli nie udało się alokować pamięci lub któryś ze wskaźników ma
+ *         wartość NULL; iterator można wówczas jedynie usunąć.
+ */
+bool phfwdReverseIterNext(PhfwdReverseIter *it, char const **num);
+
+/** @brief Usuwa iterator.
+ * Usuwa iterator wskazywany przez @p it. Nic nie robi, jeśli wskaźnik ten ma
+ * wartość NULL.
+ * @param[in] it – wskaźnik na usuwany iterator.
+ */
+void phfwdReverseIterDelete(PhfwdReverseIter *it);
+
+/** @brief Zlicza przekierowania na dany numer.
+ * Zapisuje w *@p count liczbę numerów wyniku phfwdReverse() dla @p num, nie
+ * tworząc ich. Liczba sumowana jest z rozmiarów zbiorów prefiksów na
+ * ścieżce numeru @p num w drzewie przekierowań, pomniejszonych o prefiksy
+ * dające te same numery co krótsze prefiksy, więc koszt zależy jedynie od
+ * długości @p num. Prefiksy usunięte, lecz jeszcze niezwolnione (zobacz
+ * phfwdMaintain()), zliczane są w przedziałach usuniętych prefiksów, więc
+ * koszt rośnie o liczbę tych przedziałów. Jeśli podany napis nie
+ * reprezentuje numeru, wynikiem jest zero.
+ * @param[in] pf     – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] num    – wskaźnik na napis reprezentujący numer;
+ * @param[out] count – wskaźnik na zmienną, w której zostanie zapisana liczba
+ *                     numerów.
+ * @return Wartość @p true, jeśli liczba została wyznaczona. Wartość
+ *         @p false, jeśli nie udało się alokować pamięci lub @p pf albo
+ *         @p count ma wartość NULL.
+ */
+bool phfwdReverseCount(PhoneForward const *pf, char const *num,
+                       size_t *count);
+
+/** @brief Wyznacza fragment przekierowań na dany numer.
+ * Wyznacza numery wyniku phfwdReverse() dla @p num o indeksach od
+ * @p offset do @p offset + @p limit - 1, z pominięciem indeksów spoza
+ * wyniku. Pierwszy numer fragmentu wyszukiwany jest na podstawie liczności
+ * zbiorów prefiksów, bez tworzenia poprzedzających go numerów, a kolejne
+ * pobierane są jak z iteratora phfwdReverseIterNew(). Alokuje strukturę
+ * @p PhoneNumbers, która musi być zwolniona za pomocą funkcji
+ * @ref phnumDelete.
+ * @param[in] pf     – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[in] num    – wskaźnik na napis reprezentujący numer;
+ * @param[in] offset – indeks pierwszego numeru fragmentu;
+ * @param[in] limit  – największa liczba numerów fragmentu.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy np.
+ *         nie udało się alokować pamięci, lub @p pf ma wartość NULL.
+ */
+PhoneNumbers *phfwdReverseRange(PhoneForward const *pf, char const *num,
+                                size_t offset, size_t limit);
+
 /** @brief Wyznacza przeciwobraz funkcji phfwdGet() dla danego numer.
  * Wyznacza następujący ciąg numerów: numer @p x należy do wyniku wywołania
  * @ref phfwdGetReverse z numerem @p num wtedy i tylko wtedy, gdy
@@ -111,6 +405,39 @@ PhoneNumbers *phfwdReverse(PhoneForward const *pf, char const *num);
  */
 PhoneNumbers *phfwdGetReverse(PhoneForward const *pf, char const *num);
 
+/** @brief Ustawia pamięć podręczną wyników phfwdGet().
+ * Włącza pamięć przechowującą wyniki co najwyżej @p capacity ostatnio
+ * używanych numerów, zastępując wcześniejszą pamięć wraz z jej zawartością
+ * i licznikami. Wartość zero wyłącza pamięć. Zapamiętany wynik jest zwracany
+ * tylko wtedy, gdy od jego wyznaczenia nie zmieniło się żadne przekierowanie
+ * prefiksu numeru, więc wyniki phfwdGet() nie zależą od pamięci. Zmiany są
+ * jednak śledzone dokładnie jedynie dla prefiksów krótszych od głów tablicy
+ * skoków drzewa, czyli domyślnie od trzech znaków. Zmiana przekierowania
+ * dłuższego prefiksu unieważnia wyniki wszystkich numerów o tej samej
+ * głowie, także tych, których nie dotyczy.
+ * Zapamiętywane są jedynie wyniki, w których numer i wynik mają długość co
+ * najwyżej 32.
+ * @param[in,out] pf   – wskaźnik na strukturę przechowującą przekierowania
+ *                       numerów;
+ * @param[in] capacity – największa liczba zapamiętanych wyników.
+ * @return Wartość @p true, jeśli pamięć została ustawiona. Wartość @p false,
+ *         jeśli nie udało się alokować pamięci, @p capacity jest za duże lub
+ *         @p pf ma wartość NULL; wcześniejsza pamięć pozostaje wówczas bez
+ *         zmian.
+ */
+bool phfwdSetCache(PhoneForward *pf, size_t capacity);
+
+/** @brief Wyznacza statystyki pamięci.
+ * Wypełnia @p stats statystykami numerów przechowywanych w strukturze
+ * @p pf. Każdy numer, będący prefiksem przekierowywanym lub docelowym,
+ * przechowywany jest tylko raz, niezależnie od liczby przekierowań, w których
+ * występuje. Nic nie robi, jeśli @p pf lub @p stats ma wartość NULL.
+ * @param[in] pf     – wskaźnik na strukturę przechowującą przekierowania
+ *                     numerów;
+ * @param[out] stats – wskaźnik na wypełniane statystyki.
+ */
+void phfwdGetStats(PhoneForward const *pf, PhoneForwardStats *stats);
+
 /** @brief Usuwa strukturę.
  * Usuwa strukturę wskazywaną przez @p pnum. Nic nie robi, jeśli wskaźnik ten ma
  * wartość NULL.
@@ -118,9 +445,24 @@ PhoneNumbers *phfwdGetReverse(PhoneForward const *pf, char const *num);
  */
 void phnumDelete(PhoneNumbers *pnum);
 
+/** @brief Scala posortowane ciągi numerów.
+ * Tworzy ciąg numerów wszystkich struktur @p parts, posortowany
+ * leksykograficznie i bez powtórzeń. Zakłada, że numery każdej ze struktur
+ * są posortowane i nie powtarzają się, jak w wyniku phfwdReverse(). Alokuje
+ * strukturę @p PhoneNumbers, która musi być zwolniona za pomocą funkcji
+ * @ref phnumDelete.
+ * @param[in] parts – tablica @p count wskaźników na scalane struktury;
+ * @param[in] count – liczba struktur.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy
+ *         nie udało się alokować pamięci lub któraś ze struktur ma wartość
+ *         NULL.
+ */
+PhoneNumbers *phnumMerge(PhoneNumbers const *const *parts, size_t count);
+
 /** @brief Udostępnia numer.
  * Udostępnia wskaźnik na napis reprezentujący numer. Napisy są indeksowane
- * kolejno od zera.
+ * kolejno od zera. Numery rozpakowywane są przy pierwszym wywołaniu, zaś
+ * ten sam ciąg może odczytywać wiele wątków jednocześnie.
  * @param[in] pnum – wskaźnik na strukturę przechowującą ciąg numerów telefonów;
  * @param[in] idx  – indeks numeru telefonu.
  * @return Wskaźnik na napis reprezentujący numer telefonu. Wartość NULL, jeśli
@@ -0,0 +1,998 @@
+/** @file
+ * Program mierzący wydajność operacji modułu @ref PhoneForward na dużych,
+ * deterministycznie generowanych zbiorach przekierowań.
+ *
+ * Użycie:
+ * @code
+ * phone_forward_bench nazwa_pomiaru [liczba_przekierowań]
+ * @endcode
+ *
+ * @author Adam Greloch <ag438473@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/resource.h>
+#include "phone_forward.h"
+#include "executor.h"
+#include "concurrent.h"
+#include "sharded.h"
+
+#define DEFAULT_RULES 2000000 /**< Domyślna liczba generowanych
+                                   przekierowań. */
+#define TARGETS 4096 /**< Liczba różnych prefiksów docelowych. */
+#define NUM_LEN 10 /**< Długość generowanych prefiksów przekierowywanych. */
+#define TARGET_LEN 6 /**< Długość generowanych prefiksów docelowych. */
+#define CACHE_ENTRIES 4096 /**< Pojemność pamięci podręcznej w pomiarze
+                                zapytań o skośnym rozkładzie. */
+#define PAGE 10 /**< Liczba numerów odczytywanych iteratorem w pomiarze
+                     pierwszej strony przekierowań odwrotnych. */
+#define RANGE_LIMIT 100 /**< Liczba numerów fragmentu w pomiarze fragmentów
+                             przekierowań odwrotnych. */
+#define MAINTAIN_BUDGET 4096 /**< Liczba węzłów zwalnianych jednym wywołaniem
+                                  phfwdMaintain() w pomiarze usuwania. */
+#define READD_STEPS 8 /**< Liczba kroków phfwdMaintain() przed dodaniem
+                          przekierowań poza usuniętym prefiksem. */
+#define READD_BUDGET 64 /**< Liczba węzłów zwalnianych każdym z tych
+                             kroków. */
+#define FAN_IN_TARGETS 8 /**< Liczba różnych prefiksów docelowych w pomiarze
+                              usuwania przekierowań o wspólnych celach. */
+#define WRITE_PAUSE 100000 /**< Odstęp między modyfikacjami w pomiarze
+                                współbieżnym, w nanosekundach. */
+
+/**
+ * Zbiór przekierowań, na którym wykonywane są pomiary.
+ */
+typedef struct {
+    size_t count; /**< Liczba przekierowań. */
+    char (*from)[NUM_LEN + 1]; /**< Prefiksy przekierowywane. */
+    char (*to)[TARGET_LEN + 1]; /**< Prefiksy docelowe. */
+} Dataset;
+
+/**
+ * @brief Zwraca następną wartość deterministycznego generatora xorshift.
+ * @param[in,out] state - wskaźnik na stan generatora.
+ * @return Pseudolosowa wartość 64-bitowa.
+ */
+static unsigned long long nextRandom(unsigned long long *state) {
+    unsigned long long x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+/**
+ * @brief Wypełnia @p buf losowymi cyframi.
+ * @param[in,out] state - wskaźnik na stan generatora.
+ * @param[out] buf - bufor o rozmiarze co najmniej @p length + 1.
+ * @param[in] length - liczba generowanych cyfr.
+ */
+static void randomDigits(unsigned long long *state, char *buf, size_t length) {
+    for (size_t i = 0; i < length; i++)
+        buf[i] = (char) ('0' + nextRandom(state) % 10);
+    buf[length] = '\0';
+}
+
+/**
+ * @brief Generuje zbiór @p count przekierowań wskazujących na @ref TARGETS
+ * różnych prefiksów docelowych.
+ * @param[out] data - wskaźnik na wypełniany zbiór.
+ * @param[in] count - liczba przekierowań.
+ * @return Wartość @p true, jeśli udało się alokować pamięć.
+ */
+static bool datasetNew(Dataset *data, size_t count) {
+    unsigned long long state = 88172645463325252ULL;
+    char targets[TARGETS][TARGET_LEN + 1];
+
+    data->count = count;
+    data->from = malloc(count * sizeof(*data->from));
+    data->to = malloc(count * sizeof(*data->to));
+    if (!data->from || !data->to) {
+        free(data->from);
+        free(data->to);
+        return false;
+    }
+
+    for (size_t i = 0; i < TARGETS; i++)
+        randomDigits(&state, targets[i], TARGET_LEN);
+
+    for (size_t i = 0; i < count; i++) {
+        randomDigits(&state, data->from[i], NUM_LEN);
+        strcpy(data->to[i], targets[nextRandom(&state) % TARGETS]);
+    }
+    return true;
+}
+
+/**
+ * @brief Zwalnia pamięć zbioru @p data.
+ * @param[in,out] data - wskaźnik na zbiór.
+ */
+static void datasetDelete(Dataset *data) {
+    free(data->from);
+    free(data->to);
+}
+
+/**
+ * @brief Zwraca bieżący czas monotoniczny w sekundach.
+ * @return Czas w sekundach.
+ */
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + (double) ts.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Zwraca szczytowe zużycie pamięci rezydentnej procesu.
+ * @return Rozmiar w megabajtach.
+ */
+static double peakMemory(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (double) usage.ru_maxrss / 1024.0;
+}
+
+/**
+ * @brief Ładuje wszystkie przekierowania zbioru @p data do nowej struktury.
+ * @param[in] data - wskaźnik na zbiór.
+ * @return Wskaźnik na strukturę lub NULL, gdy wystąpił błąd.
+ */
+static PhoneForward *load(Dataset const *data) {
+    PhoneForward *pf = phfwdNew();
+    if (!pf) return NULL;
+    for (size_t i = 0; i < data->count; i++)
+        if (!phfwdAdd(pf, data->from[i], data->to[i])) {
+            phfwdDelete(pf);
+            return NULL;
+        }
+    return pf;
+}
+
+/**
+ * @brief Mierzy czas ładowania i usuwania struktury.
+ * @param[in] data - wskaźnik na zbiór.
+ * @return Wartość @p true, jeśli pomiar się powiódł.
+ */
+static bool benchLoad(Dataset const *data) {
+    double start = now();
+    PhoneForward *pf = load(data);
+    if (!pf) return false;
+    double loaded = now();
+    PhoneForwardStats stats;
+    phfwdGetStats(pf, &stats);
+    phfwdDelete(pf);
+    double deleted = now();
+
+    printf("load     %zu rules: %8.3f s\n", data->count, loaded - start);
+    printf("peak RSS after load: %8.1f MB\n", peakMemory());
+    printf("strings: %zu distinct, %zu references, %.1f MB, %.1f MB saved\n",
+           stats.strings, stats.references, (double) stats.bytes / 1048576.0,
+           (double) stats.savedBytes / 1048576.0);
+    printf("teardown %zu rules: %8.3f s\n", data->count, deleted - loaded);
+    return true;
+}
+
+/**
+ * @brief Mierzy czas ładowania struktury jednym wsadem phfwdAddBatch()
+ * i porównuje go z ładowaniem kolejnymi wywołaniami phfwdAdd().
+ * @param[in] data - wskaźnik na zbiór.
+ * @return Wartość @p true, jeśli pomiar się powiódł.
+ */
+static bool benchLoadBatch(Dataset const *data) {
+    PhfwdRule *rules = malloc(data->count * sizeof(PhfwdRule));
+    if (!rules) return false;
+    for (size_t i = 0; i < data->count; i++)
+        rules[i] = (PhfwdRule) {data->from[i], data->to[i]};
+
+    double start = now();
+    PhoneForward *pf = load(data);
+    double loaded = now();
+    phfwdDelete(pf);
+
+    double batchStart = now();
+    PhoneForward *batch = phfwdNew();
+    bool ok = pf && batch && phfwdAddBatch(batch, rules, data->count);
+    double batchLoaded = now();
+    phfwdDelete(batch);
+    free(rules);
+    if (!ok) return false;
+
+    printf("phfwdAdd      %zu rules: %8.3f s\n", data->count, loaded - start);
+    printf("phfwdAddBatch %zu rules: %8.3f s\n", data->count,
+           batchLoaded - batchStart);
+    return true;
+}
+
+/**
+ * @brief Mierzy czas dodawania i zmiany pojedynczych przekierowań o krótkich
+ * prefiksach, których poddrzewa obejmują dużą część zbioru.
+ * @param[in] data - wskaźnik na zbiór.
+ * @return Wartość @p true, jeśli pomiar się powiódł.
+ */
+static bool benchAddShort(Dataset const *data) {
+    static char const *const rules[][2] = {
+        {"1", "2"}, {"12", "3"}, {"1", "4"}, {"5", "6"}, {"5", "61"},
+        {"34", "7"}, {"3", "8"}, {"1", "2"},
+    };
+    PhoneForward *pf = load(data);
+    if (!pf) return false;
+
+    bool ok = true;
+    for (size_t i = 0; ok && i < sizeof(rules) / sizeof(rules[0]); i++) {
+        double start = now();
+        ok = phfwdAdd(pf, rules[i][0], rules[i][1]);
+        double elapsed = now() - start;
+        if (ok)
+            printf("add      %-2s -> %-2s over %zu rules: %8.6f s\n",
+                   rules[i][0], rules[i][1], data->count, elapsed);
+    }
+    phfwdDelete(pf);
+    return ok;
+}
+
+/**
+ * @brief Mierzy czas usuwania przekierowań o kolejnych jednocyfrowych
+ * prefiksach, z których każde obejmuje około dziesiątej części zbioru, oraz
+ * czas zwalniania ich pamięci krokami phfwdMaintain().
+ * @param[in] data - wskaźnik na zbiór.
+ * @return Wartość @p true, jeśli pomiar się powiódł.
+ */
+static bool benchRemove(Dataset const *data) {
+    PhoneForward *pf = load(data);
+    if (!pf) return false;
+
+    double removeTotal = 0, removeMax = 0, start, elapsed;
+    for (char digit = '0'; digit <= '9'; digit++) {
+        char prefix[2] = {digit, '\0'};
+        start = now();
+        phfwdRemove(pf, prefix);
+        elapsed = now() - start;
+        removeTotal += elapsed;
+        if (elapsed > removeMax) removeMax = elapsed;
+    }
+
+    double maintainTotal = 0, maintainMax = 0;
+    size_t steps = 0;
+    bool done = false;
+    while (!done) {
+        start = now();
+        done = phfwdMaintain(pf, MAINTAIN_BUDGET);
+        elapsed = now() - start;
+        maintainTotal += elapsed;
+        if (elapsed > maintainMax) maintainMax = elapsed;
+        steps++;
+    }
+    phfwdDelete(pf);
+
+    printf("remove   10 prefixes: %8.6f s total, %8.6f s max\n", removeTotal,
+           removeMax);
+    printf("maintain %zu steps of %d nodes: %8.3f s total, %8.6f s max\n",
+           steps, MAINTAIN_BUDGET, maintainTotal, maintainMax);
+    return true;
+}
+
+/**
+ * @brief Mierzy czas dodawania przekierowań zaraz po usunięciu przekierowań
+ * o jednocyfrowym prefiksie, zanim ich pamięć zostanie zwolniona: najpierw
+ * wewnątrz usuniętego prefiksu, a następnie poza nim.
+ * @param[in] data - wskaźnik na zbiór.
+ * @return Wartość @p true, jeśli pomiar się powiódł.
+ */
+static bool benchReadd(Dataset const *data) {
+    static char const *const rules[][2] = {
+        {"1234", "5"}, {"21", "7"}, {"22", "7"}, {"23", "7"},
+    };
+    PhoneForward *pf = load(data);
+    if (!pf) return false;
+
+    double start = now();
+    phfwdRemove(pf, "1");
+    printf("remove   1 over %zu rules: %8.6f s\n", data->count,
+           now() - start);
+
+    bool ok = true;
+    for (size_t i = 0; ok && i < sizeof(rules) / sizeof(rules[0]); i++) {
+        start = now();
+        ok = phfwdAdd(pf, rules[i][0], rules[i][1]);
+        double elapsed = now() - start;
+        if (ok)
+            printf("add      %-4s -> %s after removal: %8.6f s\n",
+                   rules[i][0], rules[i][1], elapsed);
+        /* Poza usuniętym prefiksem dodajemy po kilku krokach zwalniania. */
+        for (size_t k = 0; i == 0 && k < READD_STEPS; k++)
+            phfwdMaintain(pf, READD_BUDGET);
+    }
+    phfwdDelete(pf);
+    return ok;
+}
+
+/**
+ * @brief Mierzy czas usuwania przekierowań o kolejnych jednocyfrowych
+ * prefiksach wraz ze zwolnieniem ich pamięci, gdy wszystkie przekierowania
+ * prowadzą do @ref FAN_IN_TARGETS celów, więc zbiory drzewa odwrotnego są
+ * bardzo liczne.
+ * @param[in] data - wskaźnik na zbiór.
+ * @return Wartość @p true, jeśli pomiar się powiódł.
+ */
+static bool benchRemoveFanIn(Dataset const *data) {
+    PhoneForward *pf = phfwdNew();
+    bool ok = pf != NULL;
+    for (size_t i = 0; ok && i < data->count; i++)
+        ok = phfwdAdd(pf, data->from[i], data->to[i % FAN_IN_TARGETS]);
+    if (!ok) {
+        phfwdDelete(pf);
+        return false;
+    }
+
+    double start = now();
+    for (char digit = '0'; digit <= '9'; digit++) {
+        char prefix[2] = {digit, '\0'};
+        phfwdRemove(pf, prefix);
+        while (!phfwdMaintain(pf, MAINTAIN_BUDGET));
+    }
+    double end = now();
+    phfwdDelete(pf);
+
+    printf("remove   %zu rules to %d targets: %8.3f s\n", data->count,
+           FAN_IN_TARGETS, end - start);
+    return true;
+}
+
+/**
+ * @brief Mierzy czas wyznaczania przekierowań w strukturze i w jej migawce,
+ * czas utworzenia migawki oraz czas pierwszej modyfikacji struktury po jej
+ * utworzeniu.
+ * @param[in] data - wskaźnik na zbiór.
+ * @return Wartość @p true, jeśli pomiar się powiódł.
+ */
+static bool benchSnapshot(Dataset const *data) {
+    PhoneForward *pf = load(data);
+    if (!pf) return false;
+
+    double start = now();
+    for (size_t i = 0; i < data->count; i++)
+        phnumDelete(phfwdGet(pf, data->from[i]));
+    double liveRead = now();
+    PhoneForward *snapshot = phfwdSnapshot(pf);
+    double taken = now();
+    if (snapshot)
+        for (size_t i = 0; i < data->count; i++)
+            phnumDelete(phfwdGet(snapshot, data->from[i]));
+    double snapshotRead = now();
+    bool ok = snapshot && phfwdAdd(pf, "0", "1");
+    double written = now();
+    phfwdDelete(snapshot);
+    phfwdDelete(pf);
+    if (!ok) return false;
+
+    printf("get      %zu queries on live:     %8.3f s\n", data->count,
+           liveRead - start);
+    printf("get      %zu queries on snapshot: %8.3f s\n", data->count,
+           snapshotRead - taken);
+    printf("snapshot of %zu rules: %8.6f s\n", data->count, taken - liveRead);
+    printf("first write after snapshot (deferred full copy): %8.3f s\n",
+           written - snapshotRead);
+    return true;
+}
+
+/**
+ * @brief Mierzy czas wyznaczania przekierowań dla wszystkich numerów zbioru.
+ * @param[in] data - wskaźnik na zbiór.
+ * @return Wartość @p true, jeśli pomiar się powiódł.
+ */
+static bool benchGet(Dataset const *data) {
+    PhoneForward *pf = load(data);
+    if (!pf) return false;
+
+    double start = now();
+    for (size_t i = 0; i < data->count; i++)
+        phnumDelete(phfwdGet(pf, data->from[i]));
+    double end = now();
+
+    printf("get      %zu queries: %8.3f s\n", data->count, end - start);
+    phfwdDelete(pf);
+    return true;
+}
+
+/**
+ * @brief Mierzy czas wyznaczania przekierowań do bufora dla wszystkich
+ * numerów zbioru.
+ * @param[in] data - wskaźnik na zbiór.
+ * @return Wartość @p true, jeśli pomiar się powiódł.
+ */
+static bool benchGetInto(Dataset const *data) {
+    PhoneForward *pf = load(data);
+    if (!pf) return false;
+
+    char buf[64];
+    size_t len;
+    double start = now();
+    for (size_t i = 0; i < data->count; i++)
+        phfwdGetInto(pf, data->from[i], buf, sizeof buf, &len);
+    double end = now();
+
+    printf("getinto  %zu queries: %8.3f s\n", data->count, end - start);
+    phfwdDelete(pf);
+    return true;
+}
+
+/**
+ * @brief Mierzy czas wyznaczania przekierowań dla wszystkich numerów zbioru
+ * w partiach po 1, 8 i 32 numery.
+ * @param[in] data - wskaźnik na zbiór.
+ * @return Wartość @p true, jeśli pomiar się powiódł.
+ */
+static bool benchGetBatch(Dataset const *data) {
+    static const size_t sizes[] = {1, 8, 32};
+    char const *nums[32];
+    PhoneNumbers *out[32];
+
+    PhoneForward *pf = load(data);
+    if (!pf) return false;
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        double start = now();
+        for (size_t i = 0; i < data->count; i += sizes[s]) {
+            size_t n = data->count - i < sizes[s] ? data->count - i : sizes[s];
+            for (size_t j = 0; j < n; j++)
+                nums[j] = data->from[i + j];
+            phfwdGetBatch(pf, nums, n, out);
+            for (size_t j = 0; j < n; j++)
+                phnumDelete(out[j]);
+        }
+        double end = now();
+        printf("batch %2zu %zu queries: %8.3f s\n", sizes[s], data->count,
+               end - start);
+    }
+
+    phfwdDelete(pf);
+    return true;
+}
+
+/**
+ * @brief Mierzy czas wykonywania wsadów zapytań phfwdGet() i phfwdReverse()
+ * na wszystkich procesorach.
+ * @param[in] data - wskaźnik na zbiór.
+ * @return Wartość @p true, jeśli pomiar się powiódł.
+ */
+static bool benchParallel(Dataset const *data) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t workers = cpus > 1 ? (size_t) cpus - 1 : 0;
+    size_t reverses = data->count < TARGETS ? data->count : TARGETS;
+
+    PhoneForward *pf = load(data);
+    PhfwdExecutor *ex = phfwdExecutorNew(workers);
+    char const **nums = malloc(data->count * sizeof(char const *));
+    PhoneNumbers **out = malloc(data->count * sizeof(PhoneNumbers *));
+    bool ok = pf && ex && nums && out;
+
+    if (ok) {
+        for (size_t i = 0; i < data->count; i++)
+            nums[i] = data->from[i];
+        double start = now();
+        ok = phfwdExecute(ex, pf, PHFWD_QUERY_GET, nums, data->count, out);
+        double end = now();
+        for (size_t i = 0; i < data->count; i++)
+            phnumDelete(out[i]);
+        printf("parallel get     %zu queries, %zu threads: %8.3f s\n",
+               data->count, workers + 1, end - start);
+    }
+    if (ok) {
+        for (size_t i = 0; i < reverses; i++)
+            nums[i] = data->to[i];
+        double start = now();
+        ok = phfwdExecute(ex, pf, PHFWD_QUERY_REVERSE, nums, reverses, out);
+        double end = now();
+        for (size_t i = 0; i < reverses; i++)
+            phnumDelete(out[i]);
+        printf("parallel reverse %zu queries, %zu threads: %8.3f s\n",
+               reverses, workers + 1, end - start);
+    }
+
+    free(out);
+    free(nums);
+    phfwdExecutorDelete(ex);
+    phfwdDelete(pf);
+    return ok;
+}
+
+/**
+ * Zadanie wątku czytelnika w pomiarze współbieżnym.
+ */
+typedef struct {
+    PhfwdConcurrent *pc; /**< Struktura współbieżna lub NULL, jeśli
+                              czytelnik korzysta z @p pf pod blokadą. */
+    PhoneForward *pf; /**< Struktura chroniona blokadą @p lock. */
+    pthread_mutex_t *lock; /**< Blokada chroniąca @p pf. */
+    Dataset const *data; /**< Zbiór, z którego pochodzą numery. */
+    size_t from; /**< Pierwszy numer zadania. */
+    size_t to; /**< Numer za ostatnim numerem zadania. */
+    atomic_size_t *running; /**< Liczba czytelników, którzy nie skończyli. */
+} ReaderJob;
+
+/**
+ * @brief Wyznacza przekierowania numerów zadania.
+ * @param[in] arg - wskaźnik na zadanie @ref ReaderJob.
+ * @return Wartość NULL.
+ */
+static void *readerRun(void *arg) {
+    ReaderJob *job = arg;
+    for (size_t i = job->from; i < job->to; i++) {
+        char const *num = job->data->from[i];
+        if (job->pc) {
+            phnumDelete(phfwdConcurrentGet(job->pc, num));
+        }
+        else {
+            pthread_mutex_lock(job->lock);
+            PhoneNumbers *result = phfwdGet(job->pf, num);
+            pthread_mutex_unlock(job->lock);
+            phnumDelete(result);
+        }
+    }
+    atomic_fetch_sub(job->running, 1);
+    return NULL;
+}
+
+/**
+ * @brief Wykonuje wszystkie zapytania zbioru na @p threads wątkach, podczas
+ * gdy wątek wywołujący co @ref WRITE_PAUSE nanosekund przekierowuje kolejny
+ * prefiks zbioru na inny cel.
+ * @param[in] data - wskaźnik na zbiór.
+ * @param[in] pc - wskaźnik na strukturę współbieżną lub NULL.
+ * @param[in] pf - wskaźnik na strukturę odpytywaną pod blokadą, jeśli @p pc
+ *                 ma wartość NULL.
+ * @param[in] threads - liczba wątków czytelników.
+ * @param[out] writes - wskaźnik na zmienną, w której zostanie zapisana
+ *                      liczba modyfikacji.
+ * @return Czas w sekundach lub wartość ujemna, gdy wystąpił błąd.
+ */
+static double concurrentRun(Dataset const *data, PhfwdConcurrent *pc,
+                            PhoneForward *pf, size_t threads,
+                            size_t *writes) {
+    pthread_t *ids = malloc(threads * sizeof(pthread_t));
+    ReaderJob *jobs = malloc(threads * sizeof(ReaderJob));
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    atomic_size_t running;
+    struct timespec pause = {0, WRITE_PAUSE};
+    size_t started = 0;
+    bool ok = ids && jobs;
+
+    atomic_init(&running, threads);
+    double start = now();
+    for (; ok && started < threads; started++) {
+        jobs[started] = (ReaderJob) {pc, pf, &lock, data,
+                                     data->count * started / threads,
+                                     data->count * (started + 1) / threads,
+                                     &running};
+        ok = pthread_create(&ids[started], NULL, readerRun,
+                            &jobs[started]) == 0;
+    }
+
+    *writes = 0;
+    while (ok && atomic_load(&running) > (threads - started)) {
+        size_t i = *writes % data->count;
+        char const *target = data->to[(i + *writes / data->count + 1) %
+                                      data->count];
+        if (pc) {
+            ok = phfwdConcurrentAdd(pc, data->from[i], target);
+        }
+        else {
+            pthread_mutex_lock(&lock);
+            ok = phfwdAdd(pf, data->from[i], target);
+            pthread_mutex_unlock(&lock);
+        }
+        (*writes)++;
+        nanosleep(&pause, NULL);
+    }
+
+    for (size_t i = 0; i < started; i++)
+        pthread_join(ids[i], NULL);
+    double end = now();
+    free(ids);
+    free(jobs);
+    return ok ? end - start : -1;
+}
+
+/**
+ * @brief Mierzy przepustowość zapytań phfwdGet() wykonywanych przez rosnącą
+ * liczbę wątków w czasie modyfikowania struktury przez jeden wątek, dla
+ * struktury współbieżnej oraz dla struktury chronionej jedną blokadą.
+ * @param[in] data - wskaźnik na zbiór.
+ * @return Wartość @p true, jeśli pomiar się powiódł.
+ */
+static bool benchConcurrent(Dataset const *data) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t maxThreads = cpus > 2 ? 2 * (size_t) cpus : 4;
+    PhfwdRule *rules = malloc(data->count * sizeof(PhfwdRule));
+    PhfwdConcurrent *pc = phfwdConcurrentNew();
+    PhoneForward *pf = phfwdNew();
+    bool ok = rules && pc && pf;
+
+    /* Obie struktury ładowane są tak samo, więc mają ten sam układ węzłów
+     * w pamięci. */
+    for (size_t i = 0; ok && i < data->count; i++)
+        rules[i] = (PhfwdRule) {data->from[i], data->to[i]};
+    ok = ok && phfwdConcurrentAddBatch(pc, rules, data->count) &&
+         phfwdAddBatch(pf, rules, data->count);
+
+    for (size_t threads = 1; ok && threads <= maxThreads; threads *= 2) {
+        size_t writes, lockedWrites;
+        double elapsed = concurrentRun(data, pc, NULL, threads, &writes);
+        double locked = concurrentRun(data, NULL, pf, threads, &lockedWrites);
+        ok = elapsed >= 0 && locked >= 0;
+        printf("%2zu readers: concurrent %6.2f Mq/s (%zu writes), "
+               "mutex %6.2f Mq/s (%zu writes)\n", threads,
+               (double) data->count / elapsed / 1e6, writes,
+               (double) data->count / locked / 1e6, lockedWrites);
+    }
+
+    phfwdDelete(pf);
+    phfwdConcurrentDelete(pc);
+    free(rules);
+    return ok;
+}
+
+/**
+ * Zadanie wątku dodającego przekierowania w pomiarze struktury podzielonej.
+ */
+typedef struct {
+    PhfwdSharded *ps; /**< Struktura podzielona lub NULL, jeśli wątek
+                           korzysta z @p pf pod blokadą. */
+    PhoneForward *pf; /**< Struktura chroniona blokadą @p lock. */
+    pthread_mutex_t *lock; /**< Blokada chroniąca @p pf. */
+    Dataset const *data; /**< Zbiór, z którego pochodzą przekierowania. */
+    size_t from; /**< Pierwsze przekierowanie zadania. */
+    size_t to; /**< Przekierowanie za ostatnim przekierowaniem zadania. */
+    bool ok; /**< Czy wszystkie przekierowania zostały dodane. */
+} WriterJob;
+
+/**
+ * @brief Dodaje przekierowania zadania.
+ * @param[in] arg - wskaźnik na zadanie @ref WriterJob.
+ * @return Wartość NULL.
+ */
+static void *writerRun(void *arg) {
+    WriterJob *job = arg;
+    job->ok = true;
+    for (size_t i = job->from; job->ok && i < job->to; i++) {
+        char const *num1 = job->data->from[i], *num2 = job->data->to[i];
+        if (job->ps) {
+            job->ok = phfwdShardedAdd(job->ps, num1, num2);
+        }
+        else {
+            pthread_mutex_lock(job->lock);
+            job->ok = phfwdAdd(job->pf, num1, num2);
+            pthread_mutex_unlock(job->lock);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Dodaje wszystkie przekierowania zbioru na @p threads wątkach.
+ * @param[in] data - wskaźnik na zbiór.
+ * @param[in] ps - wskaźnik na strukturę podzieloną lub NULL.
+ * @param[in] pf - wskaźnik na strukturę modyfikowaną pod blokadą, jeśli
+ *                 @p ps ma wartość NULL.
+ * @param[in] threads - liczba wątków.
+ * @return Czas w sekundach lub wartość ujemna, gdy wystąpił błąd.
+ */
+static double shardedRun(Dataset const *data, PhfwdSharded *ps,
+                         PhoneForward *pf, size_t threads) {
+    pthread_t *ids = malloc(threads * sizeof(pthread_t));
+    WriterJob *jobs = malloc(threads * sizeof(WriterJob));
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    size_t started = 0;
+    bool ok = ids && jobs;
+
+    double start = now();
+    for (; ok && started < threads; started++) {
+        jobs[started] = (WriterJob) {ps, pf, &lock, data,
+                                     data->count * started / threads,
+                                     data->count * (started + 1) / threads,
+                                     false};
+        ok = pthread_create(&ids[started], NULL, writerRun,
+                            &jobs[started]) == 0;
+    }
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(ids[i], NULL);
+        ok &= jobs[i].ok;
+    }
+    double end = now();
+    free(ids);
+    free(jobs);
+    return ok ? end - start : -1;
+}
+
+/**
+ * @brief Mierzy czas dodawania przekierowań przez rosnącą liczbę wątków do
+ * struktury podzielonej oraz do struktury chronionej jedną blokadą, a także
+ * czas wyznaczania przekierowań odwrotnych w obu strukturach. Powtarza
+ * pomiar dodawania dla prefiksów o wspólnym numerze kierunkowym kraju.
+ * @param[in] data - wskaźnik na zbiór.
+ * @return Wartość @p true, jeśli pomiar się powiódł.
+ */
+static bool benchSharded(Dataset const *data) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t maxThreads = cpus > 2 ? 2 * (size_t) cpus : 4;
+    size_t reverses = data->count < TARGETS ? data->count : TARGETS;
+    bool ok = true;
+
+    Dataset country = {data->count, malloc(data->count * sizeof(*data->from)),
+                       data->to};
+    if (!country.from) return false;
+    for (size_t i = 0; i < data->count; i++) {
+        memcpy(country.from[i], data->from[i], sizeof(*data->from));
+        memcpy(country.from[i], "48", 2);
+    }
+
+    for (size_t threads = 1; ok && threads <= maxThreads; threads *= 2) {
+        PhfwdSharded *ps = phfwdShardedNew();
+        PhoneForward *pf = phfwdNew();
+        double elapsed = ps ? shardedRun(data, ps, NULL, threads) : -1;
+        double locked = pf ? shardedRun(data, NULL, pf, threads) : -1;
+        ok = elapsed >= 0 && locked >= 0;
+        if (ok)
+            printf("%2zu writers: sharded %8.3f s, mutex %8.3f s\n", threads,
+                   elapsed, locked);
+
+        if (ok && threads == 1) {
+            double start = now();
+            for (size_t i = 0; i < reverses; i++)
+                phnumDelete(phfwdShardedReverse(ps, data->to[i]));
+            double shardedEnd = now();
+            for (size_t i = 0; i < reverses; i++)
+                phnumDelete(phfwdReverse(pf, data->to[i]));
+            double end = now();
+            printf("reverse    %zu queries: sharded %8.3f s, single %8.3f s\n",
+                   reverses, shardedEnd - start, end - shardedEnd);
+        }
+        phfwdShardedDelete(ps);
+        phfwdDelete(pf);
+    }
+
+    for (size_t threads = 1; ok && threads <= maxThreads; threads *= 2) {
+        PhfwdSharded *ps = phfwdShardedNew();
+        PhoneForward *pf = phfwdNew();
+        double elapsed = ps ? shardedRun(&country, ps, NULL, threads) : -1;
+        double locked = pf ? shardedRun(&country, NULL, pf, threads) : -1;
+        ok = elapsed >= 0 && locked >= 0;
+        if (ok)
+            printf("%2zu writers, one country code: sharded %8.3f s, "
+                   "mutex %8.3f s\n", threads, elapsed, locked);
+        phfwdShardedDelete(ps);
+        phfwdDelete(pf);
+    }
+    free(country.from);
+    return ok;
+}
+
+/**
+ * @brief Mierzy czas wyznaczania przekierowań odwrotnych dla prefiksów
+ * docelowych zbioru.
+ * @param[in] data - wskaźnik na zbiór.
+ * @return Wartość @p true, jeśli pomiar się powiódł.
+ */
+static bool benchReverse(Dataset const *data) {
+    PhoneForward *pf = load(data);
+    if (!pf) return false;
+
+    size_t queries = data->count < TARGETS ? data->count : TARGETS;
+    double start = now();
+    for (size_t i = 0; i < queries; i++)
+        phnumDelete(phfwdReverse(pf, data->to[i]));
+    double end = now();
+
+    printf("reverse  %zu queries: %8.3f s\n", queries, end - start);
+    phfwdDelete(pf);
+    return true;
+}
+
+/**
+ * @brief Mierzy czas odczytania iteratorem pierwszych @ref PAGE przekierowań
+ * odwrotnych dla prefiksów docelowych zbioru.
+ * @param[in] data - wskaźnik na zbiór.
+ * @return Wartość @p true, jeśli pomiar się powiódł.
+ */
+static bool benchReversePage(Dataset const *data) {
+    PhoneForward *pf = load(data);
+    if (!pf) return false;
+
+    size_t queries = data->count < TARGETS ? data->count : TARGETS;
+    size_t read = 0;
+    bool ok = true;
+    double start = now();
+    for (size_t i = 0; ok && i < queries; i++) {
+        PhfwdReverseIter *it = phfwdReverseIterNew(pf, data->to[i]);
+        char const *num = "";
+        ok = it;
+        for (size_t k = 0; ok && num && k < PAGE; k++) {
+            ok = phfwdReverseIterNext(it, &num);
+            if (ok && num) read++;
+        }
+        phfwdReverseIterDelete(it);
+    }
+    double end = now();
+
+    if (ok)
+        printf("page     %zu queries: %8.3f s (%zu numbers)\n", queries,
+               end - start, read);
+    phfwdDelete(pf);
+    return ok;
+}
+
+/**
+ * @brief Mierzy czas zliczania przekierowań odwrotnych dla prefiksów
+ * docelowych zbioru oraz wyznaczania fragmentu ze środka każdego wyniku.
+ * @param[in] data - wskaźnik na zbiór.
+ * @return Wartość @p true, jeśli pomiar się powiódł.
+ */
+static bool benchReverseRange(Dataset const *data) {
+    PhoneForward *pf = load(data);
+    if (!pf) return false;
+
+    size_t queries = data->count < TARGETS ? data->count : TARGETS;
+    size_t *counts = malloc(queries * sizeof(size_t));
+    bool ok = counts;
+
+    double start = now();
+    for (size_t i = 0; ok && i < queries; i++)
+        ok = phfwdReverseCount(pf, data->to[i], &counts[i]);
+    double counted = now();
+    for (size_t i = 0; ok && i < queries; i++) {
+        PhoneNumbers *pnum = phfwdReverseRange(pf, data->to[i],
+                                               counts[i] / 2, RANGE_LIMIT);
+        ok = pnum;
+        phnumDelete(pnum);
+    }
+    double end = now();
+
+    if (ok) {
+        printf("count    %zu queries: %8.3f s\n", queries, counted - start);
+        printf("range    %zu queries: %8.3f s\n", queries, end - counted);
+    }
+    free(counts);
+    phfwdDelete(pf);
+    return ok;
+}
+
+/**
+ * @brief Mierzy czas wyznaczania przeciwobrazów funkcji phfwdGet() dla
+ * prefiksów docelowych zbioru.
+ * @param[in] data - wskaźnik na zbiór.
+ * @return Wartość @p true, jeśli pomiar się powiódł.
+ */
+static bool benchGetReverse(Dataset const *data) {
+    PhoneForward *pf = load(data);
+    if (!pf) return false;
+
+    size_t queries = data->count < TARGETS ? data->count : TARGETS;
+    double start = now();
+    for (size_t i = 0; i < queries; i++)
+        phnumDelete(phfwdGetReverse(pf, data->to[i]));
+    double end = now();
+
+    printf("getreverse %zu queries: %8.3f s\n", queries, end - start);
+    phfwdDelete(pf);
+    return true;
+}
+
+/**
+ * @brief Mierzy czas wyznaczania przekierowań dla zapytań o skośnym rozkładzie
+ * bez pamięci podręcznej i z nią.
+ * Numer zapytania wybierany jest z pierwszych 2^e numerów zbioru dla
+ * wykładnika e losowanego jednostajnie, więc częstość numeru maleje mniej
+ * więcej odwrotnie proporcjonalnie do jego pozycji, jak w rozkładzie Zipfa.
+ * @param[in] data - wskaźnik na zbiór.
+ * @return Wartość @p true, jeśli pomiar się powiódł.
+ */
+static bool benchZipf(Dataset const *data) {
+    PhoneForward *pf = load(data);
+    size_t *picks = malloc(data->count * sizeof(size_t));
+    if (!pf || !picks) {
+        phfwdDelete(pf);
+        free(picks);
+        return false;
+    }
+
+    unsigned long long state = 2463534242ULL;
+    for (size_t i = 0; i < data->count; i++) {
+        unsigned exponent = (unsigned) (nextRandom(&state) % 22);
+        picks[i] = (nextRandom(&state) & ((1ULL << exponent) - 1))
+                   % data->count;
+    }
+
+    double start = now();
+    for (size_t i = 0; i < data->count; i++)
+        phnumDelete(phfwdGet(pf, data->from[picks[i]]));
+    double uncached = now();
+
+    bool ok = phfwdSetCache(pf, CACHE_ENTRIES);
+    double cachedStart = now();
+    for (size_t i = 0; ok && i < data->count; i++)
+        phnumDelete(phfwdGet(pf, data->from[picks[i]]));
+    double cached = now();
+
+    if (ok) {
+        PhoneForwardStats stats;
+        phfwdGetStats(pf, &stats);
+        printf("zipf     %zu queries: %8.3f s\n", data->count,
+               uncached - start);
+        printf("cached   %zu queries: %8.3f s (%zu hits, %zu misses)\n",
+               data->count, cached - cachedStart, stats.cacheHits,
+               stats.cacheMisses);
+    }
+    phfwdDelete(pf);
+    free(picks);
+    return ok;
+}
+
+/**
+ * Pomiar wydajności wraz z nazwą.
+ */
+typedef struct {
+    char const *name; /**< Nazwa pomiaru. */
+    bool (*function)(Dataset const *); /**< Funkcja wykonująca pomiar. */
+} Benchmark;
+
+/** Tworzy element tablicy @ref benchmarks. */
+#define BENCH(b, f) {#b, f}
+
+/** Lista dostępnych pomiarów. */
+static const Benchmark benchmarks[] = {
+    BENCH(load, benchLoad),
+    BENCH(loadbatch, benchLoadBatch),
+    BENCH(addshort, benchAddShort),
+    BENCH(remove, benchRemove),
+    BENCH(readd, benchReadd),
+    BENCH(removefanin, benchRemoveFanIn),
+    BENCH(snapshot, benchSnapshot),
+    BENCH(get, benchGet),
+    BENCH(getinto, benchGetInto),
+    BENCH(batch, benchGetBatch),
+    BENCH(parallel, benchParallel),
+    BENCH(concurrent, benchConcurrent),
+    BENCH(sharded, benchSharded),
+    BENCH(reverse, benchReverse),
+    BENCH(page, benchReversePage),
+    BENCH(range, benchReverseRange),
+    BENCH(getreverse, benchGetReverse),
+    BENCH(zipf, benchZipf),
+};
+
+/**
+ * Uruchamia pomiar podany w pierwszym argumencie wywołania.
+ * @param[in] argc - liczba argumentów.
+ * @param[in] argv - argumenty wywołania.
+ * @return Kod zakończenia programu.
+ */
+int main(int argc, char *argv[]) {
+    size_t count = DEFAULT_RULES;
+    if (argc == 3) count = strtoull(argv[2], NULL, 10);
+
+    if (argc == 2 || argc == 3)
+        for (size_t i = 0; i < sizeof(benchmarks) / sizeof(*benchmarks); i++)
+            if (strcmp(argv[1], benchmarks[i].name) == 0) {
+                Dataset data;
+                if (!datasetNew(&data, count)) return EXIT_FAILURE;
+                bool ok = benchmarks[i].function(&data);
+                datasetDelete(&data);
+                return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+            }
+
+    fprintf(stderr, "Użycie:\n%s nazwa_pomiaru [liczba_przekierowań]\n",
+            argv[0]);
+    return EXIT_FAILURE;
+}
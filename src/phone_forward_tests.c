@@ -7,8 +7,14 @@
 // włączeniem.
 #include "phone_forward.h"
 #include "phone_forward.h"
+#include "executor.h"
+#include "concurrent.h"
+#include "sharded.h"
+#include "alphabet.h"
 
 #include <malloc.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -128,6 +134,23 @@ char quite_long_magic_string[] = "MAGIC";
     phnumDelete(_p);                         \
   } while (0)
 
+// Oczekiwane odwrotne przekierowania z A zwracane przez iterator
+#define ICHCK(p, A, ...)                                 \
+  do {                                                   \
+    PhfwdReverseIter *_it;                               \
+    char const *_n;                                      \
+    N(_it = phfwdReverseIterNew(p, A));                  \
+    char const *_r[] = {__VA_ARGS__};                    \
+    for (size_t _k = 0; _k < SIZE(_r); ++_k) {           \
+      T(phfwdReverseIterNext(_it, &_n));                 \
+      N(_n);                                             \
+      C(_n, _r[_k]);                                     \
+    }                                                    \
+    T(phfwdReverseIterNext(_it, &_n));                   \
+    Z(_n);                                               \
+    phfwdReverseIterDelete(_it);                         \
+  } while (0)
+
 /** WŁAŚCIWE TESTY **/
 
 // Tylko utworzenie i usunięcie struktury
@@ -717,6 +740,102 @@ static int sort(void) {
   CLEAN(pf);
 }
 
+// Długie prefiksy o wspólnych początkach, rozgałęziające się wewnątrz
+// skompresowanych ścieżek drzewa
+static int shared_heads(void) {
+  INIT(pf);
+
+  T(phfwdAdd(pf, "12345678901234567890", "5"));
+  T(phfwdAdd(pf, "1234567890", "6"));
+  T(phfwdAdd(pf, "12345678909", "7"));
+  CHECK(pf, "123456789012345678901", "51");
+  CHECK(pf, "1234567890123456789", "6123456789");
+  CHECK(pf, "123456789", "123456789");
+  CHECK(pf, "123456789099", "79");
+  RCHCK(pf, "51", "123456789012345678901", "51");
+  RCHCK(pf, "6*", "1234567890*", "6*");
+
+  phfwdRemove(pf, "123456789090");
+  CHECK(pf, "12345678909", "7");
+  phfwdRemove(pf, "12345678901");
+  CHECK(pf, "12345678901234567890", "61234567890");
+  phfwdRemove(pf, "12345");
+  CHECK(pf, "1234567890", "1234567890");
+  RCHCK(pf, "51", "51");
+
+  T(phfwdAdd(pf, "12345678901234567890", "#"));
+  T(phfwdAdd(pf, "123", "*"));
+  CHECK(pf, "12345678901234567890", "#");
+  CHECK(pf, "1234567890123456789", "*4567890123456789");
+  RCHCK(pf, "#*", "12345678901234567890*", "#*");
+
+  CLEAN(pf);
+}
+
+// Prefiksy o wspólnych szesnastu początkowych znakach pozostają
+// uporządkowane po nadpisaniu i usunięciu przekierowań
+static int sorted_sources(void) {
+  INIT(pf);
+
+  T(phfwdAdd(pf, "12345678901234567#", "9"));
+  T(phfwdAdd(pf, "5", "9"));
+  T(phfwdAdd(pf, "123456789012345670", "9"));
+  T(phfwdAdd(pf, "1234567890123456*", "9"));
+  T(phfwdAdd(pf, "12345678901234567*", "9"));
+  T(phfwdAdd(pf, "1234567890123456", "9"));
+  T(phfwdAdd(pf, "5", "9"));
+  RCHCK(pf, "9", "1234567890123456", "123456789012345670", "12345678901234567*",
+        "12345678901234567#", "1234567890123456*", "5", "9");
+
+  T(phfwdAdd(pf, "123456789012345670", "8"));
+  phfwdRemove(pf, "12345678901234567#");
+  RCHCK(pf, "9", "1234567890123456", "12345678901234567*", "1234567890123456*",
+        "5", "9");
+  RCHCK(pf, "80", "1234567890123456700", "80");
+
+  phfwdRemove(pf, "1234567890123456");
+  RCHCK(pf, "9", "5", "9");
+  RCHCK(pf, "8", "8");
+
+  CLEAN(pf);
+}
+
+// Numery występujące w wielu przekierowaniach są przechowywane raz
+static int shared_strings(void) {
+  PhoneForwardStats s;
+
+  INIT(pf);
+
+  T(phfwdAdd(pf, "1", "55"));
+  T(phfwdAdd(pf, "2", "55"));
+  T(phfwdAdd(pf, "3", "55"));
+  phfwdGetStats(pf, &s);
+  if (s.strings != 4 || s.references != 6 || s.bytes != 8 || s.savedBytes != 4)
+    return FAIL;
+
+  T(phfwdAdd(pf, "55", "1"));
+  phfwdGetStats(pf, &s);
+  if (s.strings != 4 || s.references != 8 || s.bytes != 8 || s.savedBytes != 8)
+    return FAIL;
+
+  phfwdRemove(pf, "1");
+  phfwdRemove(pf, "2");
+  phfwdGetStats(pf, &s);
+  if (s.strings != 3 || s.references != 4 || s.bytes != 6 || s.savedBytes != 2)
+    return FAIL;
+  CHECK(pf, "3", "55");
+  CHECK(pf, "55", "1");
+
+  phfwdRemove(pf, "");
+  phfwdRemove(pf, "3");
+  phfwdRemove(pf, "5");
+  phfwdGetStats(pf, &s);
+  if (s.strings != 0 || s.references != 0 || s.bytes != 0 || s.savedBytes != 0)
+    return FAIL;
+
+  CLEAN(pf);
+}
+
 /** TESTY ALOKACJI PAMIĘCI
     Te testy muszą być linkowane z opcjami
     -Wl,--wrap=malloc -Wl,--wrap=calloc -Wl,--wrap=realloc
@@ -1034,6 +1153,1531 @@ static int alloc_fail_2(void) {
   return memory_test(alloc_fail_test_2);
 }
 
+// Sprawdzenie wyznaczania przekierowań do bufora
+static int get_into(void) {
+  char buf[32];
+  size_t len, count;
+  unsigned allocs;
+
+  INIT(pf);
+
+  T(phfwdAdd(pf, "12", "3*"));
+  T(phfwdAdd(pf, "4", "3*"));
+  T(phfwdAdd(pf, "#", "99"));
+
+  T(phfwdGetInto(pf, "1234", buf, sizeof buf, &len));
+  if (len != 4)
+    return FAIL;
+  C(buf, "3*34");
+  T(phfwdGetInto(pf, "#*", buf, sizeof buf, &len));
+  if (len != 3)
+    return FAIL;
+  C(buf, "99*");
+  T(phfwdGetInto(pf, "5", buf, sizeof buf, &len));
+  if (len != 1)
+    return FAIL;
+  C(buf, "5");
+  T(phfwdGetInto(pf, "1a", buf, sizeof buf, &len));
+  if (len != 0)
+    return FAIL;
+  C(buf, "");
+
+  // Za mały bufor
+  T(phfwdGetInto(pf, "1234", buf, 4, &len));
+  if (len != 4)
+    return FAIL;
+  T(phfwdGetInto(pf, "1234", NULL, 0, &len));
+  if (len != 4)
+    return FAIL;
+  F(phfwdGetInto(NULL, "1234", buf, sizeof buf, &len));
+  F(phfwdGetInto(pf, "1234", buf, sizeof buf, NULL));
+
+  // Bez alokacji pamięci
+  allocs = alloc_counter;
+  T(phfwdGetInto(pf, "4*", buf, sizeof buf, &len));
+  C(buf, "3**");
+  if (alloc_counter != allocs)
+    return FAIL;
+
+  T(phfwdReverseInto(pf, "3*5", buf, sizeof buf, &len, &count));
+  if (len != 11 || count != 3)
+    return FAIL;
+  C(buf, "125");
+  C(buf + 4, "3*5");
+  C(buf + 8, "45");
+  T(phfwdReverseInto(pf, "3*5", buf, 10, &len, &count));
+  if (len != 11 || count != 3)
+    return FAIL;
+  T(phfwdReverseInto(pf, "x", buf, sizeof buf, &len, &count));
+  if (len != 0 || count != 0)
+    return FAIL;
+
+  CLEAN(pf);
+}
+
+// Porównanie tłumaczenia numeru przez obie ścieżki numEncodeInto z wynikiem
+// wyznaczonym znak po znaku
+static int encode_compare(char const *str) {
+  size_t (*const encode[])(char const *, char *, size_t, char const **) = {
+    numEncodeInto, numEncodeScalar
+  };
+  char expected[80], buf[80];
+  char const *encoded;
+  bool valid = true, plain = true;
+  size_t length = strlen(str);
+
+  for (size_t k = 0; k < length; ++k) {
+    char c = str[k];
+    valid &= (c >= '0' && c <= '9') || c == '*' || c == '#';
+    plain &= c >= '0' && c <= '9';
+    expected[k] = c == '*' ? ':' : c == '#' ? ';' : c;
+  }
+  expected[length] = '\0';
+  if (!valid)
+    length = 0;
+
+  for (size_t k = 0; k < SIZE(encode); ++k) {
+    if (encode[k](str, buf, sizeof buf, &encoded) != length)
+      return FAIL;
+    if (length == 0)
+      Z(encoded);
+    else if (plain && encoded != str)
+      return FAIL;
+    else if (!plain && encoded != buf)
+      return FAIL;
+    else
+      C(encoded, expected);
+  }
+  return PASS;
+}
+
+// Sprawdzenie tłumaczenia numerów przy każdym wyrównaniu początku i każdym
+// położeniu znaku terminującego w blokach 16 bajtów, w tym na bajtach 0, 15
+// i 16 bloku, ze znakami sąsiadującymi z alfabetem i spoza ASCII
+static int encode_blocks(void) {
+  static char const boundary[] = {
+    '/', ':', ';', '*', '+', '"', '#', '$', ')', '\x80', '\xb0', '\xff'
+  };
+  _Alignas(16) char text[80];
+  char const *encoded;
+
+  for (size_t shift = 0; shift < 16; ++shift) {
+    for (size_t end = shift; end + 16 <= sizeof text; ++end) {
+      for (size_t k = 0; k < sizeof text; ++k)
+        text[k] = k < end ? (char) ('0' + k % 10) : '*';
+      text[end] = '\0';
+      Z(encode_compare(text + shift));
+
+      for (size_t i = 0; i < SIZE(boundary); ++i) {
+        memset(text + end + 1, boundary[i], sizeof text - end - 1);
+        for (size_t j = shift; j < end; ++j) {
+          text[j] = boundary[i];
+          Z(encode_compare(text + shift));
+          text[j] = (char) ('0' + j % 10);
+        }
+      }
+    }
+
+    // Przetłumaczona kopia, która nie mieści się w buforze
+    for (size_t k = 0; k < sizeof text; ++k)
+      text[k] = "0123456789*#"[k % 12];
+    text[sizeof text - 1] = '\0';
+    if (numEncode(text + shift, &encoded) != sizeof text - 1 - shift)
+      return FAIL;
+    N(encoded);
+    if (encoded[11 - shift % 12] != ';')
+      return FAIL;
+    numFreeEncoded(encoded, text + shift);
+  }
+
+  return PASS;
+}
+
+// Sprawdzenie wyznaczania przekierowań wielu numerów naraz
+static int get_batch(void) {
+  char nums[100][8];
+  char const *ptrs[100];
+  PhoneNumbers *out[100], *pn;
+
+  INIT(pf);
+
+  T(phfwdAdd(pf, "1", "9"));
+  T(phfwdAdd(pf, "12", "8*"));
+  T(phfwdAdd(pf, "123", "7"));
+  T(phfwdAdd(pf, "2#", "6"));
+  T(phfwdAdd(pf, "3333", "5"));
+
+  for (int i = 0; i < 100; ++i) {
+    snprintf(nums[i], sizeof nums[i], "%d%s", i * 37, i % 7 ? "#" : "");
+    ptrs[i] = nums[i];
+  }
+  ptrs[10] = "12a";
+  ptrs[20] = "";
+  ptrs[30] = NULL;
+  ptrs[40] = "333";
+
+  T(phfwdGetBatch(pf, ptrs, 0, NULL));
+  F(phfwdGetBatch(NULL, ptrs, 1, out));
+  T(phfwdGetBatch(pf, ptrs, 100, out));
+  for (int i = 0; i < 100; ++i) {
+    N(pn = phfwdGet(pf, ptrs[i]));
+    if (phnumGet(pn, 0) == NULL) {
+      Q(out[i], 0);
+    }
+    else {
+      R(out[i], 0, phnumGet(pn, 0));
+      Q(out[i], 1);
+    }
+    phnumDelete(pn);
+    phnumDelete(out[i]);
+  }
+
+  CLEAN(pf);
+}
+
+// Sprawdzenie wielowątkowego wykonywania wsadów zapytań
+static int executor(void) {
+  static char nums[1000][12];
+  char const *ptrs[1000];
+  PhoneNumbers *out[1000], *pn;
+  static const size_t workers[] = {0, 1, 4};
+
+  INIT(pf);
+
+  for (int i = 0; i < 200; ++i) {
+    snprintf(nums[0], sizeof nums[0], "%d", i * 7919 % 1000);
+    snprintf(nums[1], sizeof nums[1], "%d*", i % 13);
+    T(phfwdAdd(pf, nums[0], nums[1]));
+  }
+  for (int i = 0; i < 1000; ++i) {
+    snprintf(nums[i], sizeof nums[i], "%d%s", i * 31, i % 3 ? "" : "*5");
+    ptrs[i] = nums[i];
+  }
+  ptrs[500] = "x";
+
+  for (size_t w = 0; w < SIZE(workers); ++w) {
+    PhfwdExecutor *ex = phfwdExecutorNew(workers[w]);
+    N(ex);
+    F(phfwdExecute(ex, NULL, PHFWD_QUERY_GET, ptrs, 1000, out));
+    T(phfwdExecute(ex, pf, PHFWD_QUERY_GET, ptrs, 0, NULL));
+
+    T(phfwdExecute(ex, pf, PHFWD_QUERY_GET, ptrs, 1000, out));
+    for (int i = 0; i < 1000; ++i) {
+      N(pn = phfwdGet(pf, ptrs[i]));
+      if (phnumGet(pn, 0) == NULL)
+        Q(out[i], 0);
+      else
+        R(out[i], 0, phnumGet(pn, 0));
+      phnumDelete(pn);
+      phnumDelete(out[i]);
+    }
+
+    T(phfwdExecute(ex, pf, PHFWD_QUERY_REVERSE, ptrs, 1000, out));
+    for (int i = 0; i < 1000; ++i) {
+      N(pn = phfwdReverse(pf, ptrs[i]));
+      size_t k = 0;
+      for (; phnumGet(pn, k) != NULL; ++k)
+        R(out[i], k, phnumGet(pn, k));
+      Q(out[i], k);
+      phnumDelete(pn);
+      phnumDelete(out[i]);
+    }
+
+    phfwdExecutorDelete(ex);
+  }
+  phfwdExecutorDelete(NULL);
+
+  CLEAN(pf);
+}
+
+// Sprawdzenie wyszukiwania najdłuższych prefiksów wielu różnych długości
+static int lpm_lengths(void) {
+  char num[101];
+  PhoneForwardStats stats;
+
+  INIT(pf);
+
+  T(phfwdAdd(pf, "1234567890", "#0"));
+  T(phfwdAdd(pf, "12345", "5"));
+  T(phfwdAdd(pf, "123456789012", "7"));
+  T(phfwdAdd(pf, "1", "*"));
+  CHECK(pf, "1234567890123", "73");
+  CHECK(pf, "12345678901", "#01");
+  CHECK(pf, "123456789", "56789");
+  CHECK(pf, "1234", "*234");
+
+  // Nowy prefiks przejmuje numery, których dotąd najdłuższym prefiksem
+  // był krótszy prefiks.
+  T(phfwdAdd(pf, "1234567", "3"));
+  CHECK(pf, "123456789", "389");
+  CHECK(pf, "12345678", "38");
+  CHECK(pf, "123456", "56");
+  CHECK(pf, "12345678901", "#01");
+  T(phfwdAdd(pf, "12", "0"));
+  CHECK(pf, "1234", "034");
+  CHECK(pf, "123456", "56");
+
+  phfwdRemove(pf, "123456");
+  CHECK(pf, "1234567890123", "567890123");
+  CHECK(pf, "123456", "56");
+  phfwdRemove(pf, "12345");
+  CHECK(pf, "123456", "03456");
+  CHECK(pf, "13", "*3");
+
+  // Długości, których prefiksy zniknęły, opuszczają indeks po zwolnieniu
+  // usuniętych przekierowań.
+  phfwdGetStats(pf, &stats);
+  T(stats.indexValid);
+  T(stats.indexLengths == 6);
+  T(phfwdMaintain(pf, 1000));
+  phfwdGetStats(pf, &stats);
+  T(stats.indexValid);
+  T(stats.indexLengths == 2);
+  CHECK(pf, "123456", "03456");
+  CHECK(pf, "13", "*3");
+
+  // Bardzo długi prefiks nie zmienia wyników.
+  FILL(num, 0, 100, '8');
+  T(phfwdAdd(pf, num, "9"));
+  CHECK(pf, num, "9");
+  CHECK(pf, "88", "88");
+  CHECK(pf, "1234", "034");
+  T(phfwdAdd(pf, "123", "6"));
+  CHECK(pf, "1234", "64");
+
+  // Indeks porzucony przez długi prefiks odbudowuje phfwdMaintain(), gdy
+  // prefiksu już nie ma.
+  T(phfwdMaintain(pf, 1000));
+  phfwdGetStats(pf, &stats);
+  F(stats.indexValid);
+  phfwdRemove(pf, "88");
+  T(phfwdMaintain(pf, 1000));
+  phfwdGetStats(pf, &stats);
+  T(stats.indexValid);
+  T(stats.indexLengths == 3);
+  CHECK(pf, "1234", "64");
+  CHECK(pf, "1299", "099");
+  CHECK(pf, "13", "*3");
+  CHECK(pf, num, num);
+  T(phfwdAdd(pf, "1234", "5"));
+  CHECK(pf, "12345", "55");
+
+  // Po usunięciu długiego prefiksu indeks odbudowują porcjami kolejne
+  // modyfikacje, które w trakcie odbudowy nie zmieniają wyników.
+  char buf[8];
+  size_t i;
+  for (i = 0; i < 1000; ++i) {
+    snprintf(buf, sizeof(buf), "4%zu", i);
+    T(phfwdAdd(pf, buf, "5"));
+  }
+  T(phfwdAdd(pf, num, "9"));
+  phfwdRemove(pf, num);
+  phfwdGetStats(pf, &stats);
+  F(stats.indexValid);
+  T(phfwdAdd(pf, "41", "7"));
+  T(phfwdAdd(pf, "4299", "6"));
+  phfwdRemove(pf, "43");
+  CHECK(pf, "41", "7");
+  CHECK(pf, "42999", "69");
+  CHECK(pf, "4301", "4301");
+  CHECK(pf, "4299", "6");
+  for (i = 0; i < 100 && !stats.indexValid; ++i) {
+    T(phfwdAdd(pf, "6", "7"));
+    phfwdGetStats(pf, &stats);
+  }
+  N(i > 1);
+  T(stats.indexValid);
+  CHECK(pf, "41", "7");
+  CHECK(pf, "42999", "69");
+  CHECK(pf, "4301", "4301");
+  CHECK(pf, "4299", "6");
+  CHECK(pf, "4", "4");
+  CHECK(pf, "12345", "55");
+
+  CLEAN(pf);
+}
+
+// Sprawdzenie znaczników indeksu po dodaniu prefiksu istniejącej długości
+static int lpm_markers(void) {
+  PhoneForwardStats stats;
+
+  INIT(pf);
+
+  T(phfwdAdd(pf, "2", "0"));
+  T(phfwdAdd(pf, "999", "0"));
+  T(phfwdAdd(pf, "55555", "0"));
+  T(phfwdAdd(pf, "7777777", "0"));
+  T(phfwdAdd(pf, "123456789", "0"));
+  T(phfwdAdd(pf, "123499999", "0"));
+  CHECK(pf, "123459", "123459");
+
+  // Znaczniki prefiksów długości 9 leżą w tablicy długości 5, także za
+  // rozgałęzieniem drzewa, i zmieniają najdłuższy prefiks po każdym dodaniu
+  // krótszego prefiksu.
+  T(phfwdAdd(pf, "1", "4"));
+  CHECK(pf, "123459", "423459");
+  CHECK(pf, "1234567", "4234567");
+  CHECK(pf, "123499", "423499");
+  T(phfwdAdd(pf, "123", "6"));
+  CHECK(pf, "123459", "6459");
+  CHECK(pf, "123499", "6499");
+  CHECK(pf, "1299", "4299");
+  CHECK(pf, "1234567899", "09");
+  phfwdRemove(pf, "123");
+  CHECK(pf, "123459", "423459");
+
+  // Długość, w której zostały same znaczniki, opuszcza indeks.
+  phfwdRemove(pf, "55555");
+  T(phfwdMaintain(pf, 1000));
+  phfwdGetStats(pf, &stats);
+  T(stats.indexValid);
+  T(stats.indexLengths == 3);
+  CHECK(pf, "77777777", "07");
+  CHECK(pf, "555555", "555555");
+  CHECK(pf, "9999", "09");
+  CHECK(pf, "123459", "423459");
+
+  // Kolejne dłuższe długości są liśćmi drzewa długości, które
+  // phfwdMaintain() równoważy.
+  char buf[24] = "";
+  for (size_t i = 0; i < 20; ++i) {
+    buf[i] = '3';
+    T(phfwdAdd(pf, buf, i % 2 ? "8" : "6"));
+    buf[i + 1] = '9';
+    CHECK(pf, buf, i % 2 ? "89" : "69");
+    buf[i + 1] = '\0';
+  }
+  CHECK(pf, "33339", "89");
+  CHECK(pf, "3333339", "89");
+  CHECK(pf, "33333339", "69");
+  phfwdGetStats(pf, &stats);
+  T(stats.indexDepth > 10);
+  T(phfwdMaintain(pf, 1000));
+  phfwdGetStats(pf, &stats);
+  T(stats.indexValid);
+  T(stats.indexLengths == 20);
+  T(stats.indexDepth == 5);
+  CHECK(pf, "33339", "89");
+  CHECK(pf, "3333339", "89");
+  CHECK(pf, "33333339", "69");
+  CHECK(pf, "3333333333339", "89");
+  CHECK(pf, "123459", "423459");
+  CHECK(pf, "77777777", "07");
+
+  // Znacznik współdzielony przez prefiks usuniętego poddrzewa i prefiks
+  // dodany po usunięciu nie wskazuje węzła tego poddrzewa.
+  PhoneForward *revived = phfwdNew();
+  N(revived);
+  T(phfwdAdd(revived, "1234", "0"));
+  T(phfwdAdd(revived, "12", "0"));
+  T(phfwdAdd(revived, "125555", "0"));
+  T(phfwdAdd(revived, "2222", "0"));
+  for (size_t i = 0; i < 1000; ++i) {
+    snprintf(buf, sizeof(buf), "19%zu", i);
+    T(phfwdAdd(revived, buf, "0"));
+  }
+  while (!phfwdMaintain(revived, 1000));
+  phfwdRemove(revived, "1");
+  T(phfwdAdd(revived, "125556", "7"));
+  T(phfwdAdd(revived, "12", "5"));
+  while (!phfwdMaintain(revived, 1000));
+  phfwdGetStats(revived, &stats);
+  T(stats.indexValid);
+  CHECK(revived, "1255999", "555999");
+  CHECK(revived, "1255569", "79");
+  CHECK(revived, "12349", "5349");
+  phfwdDelete(revived);
+
+  CLEAN(pf);
+}
+
+// Sprawdzenie wyszukiwań wsadowych po zmianach płytkich poziomów drzewa
+static int shallow_changes(void) {
+  char const *nums[] = {"1", "12", "123", "1234", "12345", "13", "2", "21"};
+  char const *expected[SIZE(nums)];
+  PhoneNumbers *out[SIZE(nums)];
+
+  INIT(pf);
+
+  T(phfwdAdd(pf, "12345", "9"));
+  T(phfwdAdd(pf, "1", "8"));
+  T(phfwdAdd(pf, "123", "7"));
+  T(phfwdAdd(pf, "2", "6"));
+  phfwdRemove(pf, "1234");
+  T(phfwdAdd(pf, "12", "5"));
+  phfwdRemove(pf, "2");
+  T(phfwdAdd(pf, "21", "4"));
+
+  expected[0] = "8";
+  expected[1] = "5";
+  expected[2] = "7";
+  expected[3] = "74";
+  expected[4] = "745";
+  expected[5] = "83";
+  expected[6] = "2";
+  expected[7] = "4";
+  T(phfwdGetBatch(pf, nums, SIZE(nums), out));
+  for (size_t i = 0; i < SIZE(nums); ++i) {
+    R(out[i], 0, expected[i]);
+    phnumDelete(out[i]);
+  }
+
+  phfwdRemove(pf, "1");
+  T(phfwdGetBatch(pf, nums, SIZE(nums), out));
+  for (size_t i = 0; i < SIZE(nums); ++i) {
+    R(out[i], 0, i < 6 ? nums[i] : expected[i]);
+    phnumDelete(out[i]);
+  }
+
+  CLEAN(pf);
+}
+
+// Sprawdzenie pamięci podręcznej wyników phfwdGet
+static int get_cache(void) {
+  PhoneForwardStats stats;
+  char num[100];
+
+  INIT(pf);
+
+  T(phfwdSetCache(pf, 2));
+  T(phfwdAdd(pf, "12", "9"));
+  CHECK(pf, "123", "93");
+  CHECK(pf, "123", "93");
+  phfwdGetStats(pf, &stats);
+  Z(stats.cacheHits != 1 || stats.cacheMisses != 1);
+
+  // Zmiany prefiksów numeru unieważniają zapamiętany wynik.
+  T(phfwdAdd(pf, "123", "8"));
+  CHECK(pf, "123", "8");
+  T(phfwdAdd(pf, "1", "7"));
+  CHECK(pf, "123", "8");
+  CHECK(pf, "13", "73");
+  phfwdRemove(pf, "123");
+  CHECK(pf, "123", "93");
+  phfwdRemove(pf, "1");
+  CHECK(pf, "123", "123");
+  CHECK(pf, "13", "13");
+  T(phfwdAdd(pf, "1", "7"));
+  CHECK(pf, "13", "73");
+
+  // Zmiana krótkiego prefiksu nie unieważnia wyników numerów, które się od
+  // niego nie zaczynają.
+  T(phfwdSetCache(pf, 4));
+  CHECK(pf, "45", "45");
+  CHECK(pf, "456", "456");
+  T(phfwdAdd(pf, "7", "8"));
+  T(phfwdAdd(pf, "46", "8"));
+  CHECK(pf, "45", "45");
+  CHECK(pf, "456", "456");
+  CHECK(pf, "46", "8");
+  phfwdGetStats(pf, &stats);
+  Z(stats.cacheHits != 2 || stats.cacheMisses != 3);
+  phfwdRemove(pf, "46");
+  phfwdRemove(pf, "7");
+  CHECK(pf, "46", "46");
+
+  // Zastępowany jest najdawniej używany wynik.
+  T(phfwdSetCache(pf, 2));
+  CHECK(pf, "41", "41");
+  CHECK(pf, "42", "42");
+  CHECK(pf, "41", "41");
+  CHECK(pf, "43", "43");
+  CHECK(pf, "41", "41");
+  CHECK(pf, "42", "42");
+  phfwdGetStats(pf, &stats);
+  Z(stats.cacheHits != 2 || stats.cacheMisses != 4);
+
+  // Długie numery nie są zapamiętywane.
+  FILL(num, 0, 40, '5');
+  CHECK(pf, num, num);
+  CHECK(pf, num, num);
+  phfwdGetStats(pf, &stats);
+  Z(stats.cacheHits != 2 || stats.cacheMisses != 6);
+
+  T(phfwdSetCache(pf, 0));
+  CHECK(pf, "13", "73");
+  phfwdGetStats(pf, &stats);
+  Z(stats.cacheHits != 0 || stats.cacheMisses != 0);
+  F(phfwdSetCache(NULL, 1));
+
+  CLEAN(pf);
+}
+
+// Sprawdzenie wyznaczania przeciwobrazu funkcji phfwdGet
+static int get_reverse(void) {
+  PhoneNumbers *pnum;
+  char num1[100], num2[100];
+  size_t count;
+
+  INIT(pf);
+
+  // Numer jest wynikiem, jeśli zastąpiony prefiks jest jego najdłuższym
+  // przekierowanym prefiksem.
+  T(phfwdAdd(pf, "1", "2"));
+  T(phfwdAdd(pf, "15", "25"));
+  T(phfwdAdd(pf, "16", "3"));
+  T(phfwdAdd(pf, "178", "29"));
+  T(phfwdAdd(pf, "4", "2"));
+  T(phfwdAdd(pf, "42", "7"));
+  RCHCK(pf, "256", "156", "256", "456");
+  N(pnum = phfwdGetReverse(pf, "256"));
+  R(pnum, 0, "156");
+  R(pnum, 1, "256");
+  R(pnum, 2, "456");
+  Q(pnum, 3);
+  phnumDelete(pnum);
+
+  N(pnum = phfwdGetReverse(pf, "26"));
+  R(pnum, 0, "26");
+  R(pnum, 1, "46");
+  Q(pnum, 2);
+  phnumDelete(pnum);
+
+  N(pnum = phfwdGetReverse(pf, "298"));
+  R(pnum, 0, "1788");
+  R(pnum, 1, "198");
+  R(pnum, 2, "298");
+  R(pnum, 3, "498");
+  Q(pnum, 4);
+  phnumDelete(pnum);
+
+  // Numer należy do swojego przeciwobrazu, jeśli nie ma przekierowanych
+  // prefiksów.
+  N(pnum = phfwdGetReverse(pf, "9"));
+  R(pnum, 0, "9");
+  Q(pnum, 1);
+  phnumDelete(pnum);
+  N(pnum = phfwdGetReverse(pf, "12"));
+  Q(pnum, 0);
+  phnumDelete(pnum);
+
+  phfwdRemove(pf, "1");
+  N(pnum = phfwdGetReverse(pf, "256"));
+  R(pnum, 0, "256");
+  R(pnum, 1, "456");
+  Q(pnum, 2);
+  phnumDelete(pnum);
+
+  N(pnum = phfwdGetReverse(pf, "2a"));
+  Q(pnum, 0);
+  phnumDelete(pnum);
+
+  T(phfwdAdd(pf, "*1", "#"));
+  N(pnum = phfwdGetReverse(pf, "#2"));
+  R(pnum, 0, "*12");
+  R(pnum, 1, "#2");
+  Q(pnum, 2);
+  phnumDelete(pnum);
+  T(phfwdAdd(pf, "*12", "5"));
+  N(pnum = phfwdGetReverse(pf, "#2"));
+  R(pnum, 0, "#2");
+  Q(pnum, 1);
+  phnumDelete(pnum);
+
+  // Zmiana celu przodka odsłania przekierowania, które przysłaniał, także
+  // gdy węzeł poprzedniego celu został usunięty.
+  T(phfwdAdd(pf, "01", "31"));
+  T(phfwdAdd(pf, "0", "3"));
+  T(phfwdReverseCount(pf, "31", &count));
+  if (count != 2)
+    return FAIL;
+  T(phfwdAdd(pf, "0", "9"));
+  T(phfwdReverseCount(pf, "31", &count));
+  if (count != 2)
+    return FAIL;
+  N(pnum = phfwdGetReverse(pf, "31"));
+  R(pnum, 0, "01");
+  R(pnum, 1, "31");
+  Q(pnum, 2);
+  phnumDelete(pnum);
+  N(pnum = phfwdGetReverse(pf, "91"));
+  R(pnum, 0, "91");
+  Q(pnum, 1);
+  phnumDelete(pnum);
+  T(phfwdAdd(pf, "0", "3"));
+  T(phfwdReverseCount(pf, "31", &count));
+  if (count != 2)
+    return FAIL;
+  N(pnum = phfwdGetReverse(pf, "31"));
+  R(pnum, 0, "01");
+  R(pnum, 1, "31");
+  Q(pnum, 2);
+  phnumDelete(pnum);
+
+  // Długie numery sprawdzane są przejściem po drzewie.
+  FILL(num1, 0, 70, '5');
+  num1[0] = '6';
+  T(phfwdAdd(pf, "6", "8"));
+  T(phfwdAdd(pf, num1, "7"));
+  FILL(num2, 0, 71, '5');
+  num2[0] = '8';
+  N(pnum = phfwdGetReverse(pf, num2));
+  C(phnumGet(pnum, 0), num2);
+  Q(pnum, 1);
+  phnumDelete(pnum);
+  num1[69] = '\0';
+  num2[69] = '\0';
+  N(pnum = phfwdGetReverse(pf, num2));
+  R(pnum, 0, num1);
+  R(pnum, 1, num2);
+  Q(pnum, 2);
+  phnumDelete(pnum);
+
+  CLEAN(pf);
+}
+
+// Iterator zwraca te same numery co phfwdReverse()
+static int reverse_iter(void) {
+  PhfwdReverseIter *it;
+  PhoneNumbers *pnum;
+  char const *num;
+  char buf[100];
+  size_t i;
+
+  INIT(pf);
+
+  N(it = phfwdReverseIterNew(pf, "123"));
+  T(phfwdReverseIterNext(it, &num));
+  C(num, "123");
+  T(phfwdReverseIterNext(it, &num));
+  Z(num);
+  T(phfwdReverseIterNext(it, &num));
+  Z(num);
+  phfwdReverseIterDelete(it);
+
+  N(it = phfwdReverseIterNew(pf, "12a"));
+  T(phfwdReverseIterNext(it, &num));
+  Z(num);
+  phfwdReverseIterDelete(it);
+  Z(phfwdReverseIterNew(NULL, "123"));
+  F(phfwdReverseIterNext(NULL, &num));
+  phfwdReverseIterDelete(NULL);
+
+  // Prefiksy przekierowane na ten sam numer są swoimi prefiksami.
+  T(phfwdAdd(pf, "1", "5"));
+  T(phfwdAdd(pf, "12", "5"));
+  T(phfwdAdd(pf, "125", "5"));
+  T(phfwdAdd(pf, "13", "5"));
+  T(phfwdAdd(pf, "2", "56"));
+  T(phfwdAdd(pf, "#", "567"));
+  T(phfwdAdd(pf, "*0", "5"));
+  RCHCK(pf, "5678", "125678", "12678", "13678", "1678", "278", "5678",
+        "*0678", "#8");
+  ICHCK(pf, "5678", "125678", "12678", "13678", "1678", "278", "5678",
+        "*0678", "#8");
+
+  // Powtarzające się numery zwracane są raz.
+  T(phfwdAdd(pf, "9", "56"));
+  T(phfwdAdd(pf, "98", "5"));
+  T(phfwdAdd(pf, "986", "56"));
+  RCHCK(pf, "566", "12566", "1266", "1366", "166", "26", "566", "96", "9866",
+        "*066");
+  ICHCK(pf, "566", "12566", "1266", "1366", "166", "26", "566", "96", "9866",
+        "*066");
+
+  // Iterator i phfwdReverse() zwracają to samo dla wielu numerów.
+  for (i = 0; i < 1000; i++) {
+    snprintf(buf, sizeof(buf), "%zu", i * 7919 % 100000);
+    T(phfwdAdd(pf, buf, i % 3 ? "56" : "5"));
+  }
+  for (i = 0; i < 100; i++) {
+    snprintf(buf, sizeof(buf), "56%zu", i);
+    N(pnum = phfwdReverse(pf, buf));
+    N(it = phfwdReverseIterNew(pf, buf));
+    for (size_t k = 0; phnumGet(pnum, k); k++) {
+      T(phfwdReverseIterNext(it, &num));
+      N(num);
+      C(num, phnumGet(pnum, k));
+    }
+    T(phfwdReverseIterNext(it, &num));
+    Z(num);
+    phfwdReverseIterDelete(it);
+    phnumDelete(pnum);
+  }
+
+  CLEAN(pf);
+}
+
+// Liczba przekierowań odwrotnych i ich fragmenty
+static int reverse_range(void) {
+  PhoneNumbers *pnum, *part;
+  size_t count, i, k;
+  char buf[100];
+
+  INIT(pf);
+
+  T(phfwdReverseCount(pf, "123", &count));
+  Z(count - 1);
+  T(phfwdReverseCount(pf, "12a", &count));
+  Z(count);
+  F(phfwdReverseCount(NULL, "123", &count));
+  F(phfwdReverseCount(pf, "123", NULL));
+  Z(phfwdReverseRange(NULL, "123", 0, 1));
+  E(phfwdReverseRange(pf, "12a", 0, 1));
+  E(phfwdReverseRange(pf, "123", 1, 1));
+  E(phfwdReverseRange(pf, "123", 0, 0));
+
+  // Numer 9866 powstaje z prefiksów 98 i 986, więc jest liczony raz.
+  T(phfwdAdd(pf, "1", "5"));
+  T(phfwdAdd(pf, "12", "5"));
+  T(phfwdAdd(pf, "125", "5"));
+  T(phfwdAdd(pf, "*0", "5"));
+  T(phfwdAdd(pf, "9", "56"));
+  T(phfwdAdd(pf, "98", "5"));
+  T(phfwdAdd(pf, "986", "56"));
+  T(phfwdReverseCount(pf, "566", &count));
+  Z(count - 7);
+  N(pnum = phfwdReverseRange(pf, "566", 2, 3));
+  R(pnum, 0, "166");
+  R(pnum, 1, "566");
+  R(pnum, 2, "96");
+  Q(pnum, 3);
+  phnumDelete(pnum);
+  N(pnum = phfwdReverseRange(pf, "566", 5, 100));
+  R(pnum, 0, "9866");
+  R(pnum, 1, "*066");
+  Q(pnum, 2);
+  phnumDelete(pnum);
+
+  // Przekierowanie 98 przestaje przysłaniać 986, gdy zmienia cel.
+  T(phfwdAdd(pf, "98", "4"));
+  T(phfwdReverseCount(pf, "566", &count));
+  Z(count - 7);
+  RCHCK(pf, "566", "12566", "1266", "166", "566", "96", "9866", "*066");
+  T(phfwdAdd(pf, "9", "4"));
+  T(phfwdReverseCount(pf, "466", &count));
+  Z(count - 3);
+  T(phfwdReverseCount(pf, "566", &count));
+  Z(count - 6);
+  phfwdRemove(pf, "98");
+  T(phfwdReverseCount(pf, "466", &count));
+  Z(count - 2);
+
+  // Fragmenty odpowiadają kolejnym numerom phfwdReverse().
+  for (i = 0; i < 1000; i++) {
+    snprintf(buf, sizeof(buf), "%zu", i * 7919 % 100000);
+    T(phfwdAdd(pf, buf, i % 3 ? "56" : "5"));
+  }
+  for (i = 0; i < 30; i++) {
+    snprintf(buf, sizeof(buf), "56%zu", i);
+    N(pnum = phfwdReverse(pf, buf));
+    T(phfwdReverseCount(pf, buf, &count));
+    Q(pnum, count);
+    N(phnumGet(pnum, count - 1));
+    for (k = 0; k < count + 2; k += 7) {
+      N(part = phfwdReverseRange(pf, buf, k, 10));
+      for (size_t j = 0; j < 10 && phnumGet(pnum, k + j); j++)
+        R(part, j, phnumGet(pnum, k + j));
+      Q(part, k + 10 <= count ? 10 : k < count ? count - k : 0);
+      phnumDelete(part);
+    }
+    phnumDelete(pnum);
+  }
+
+  CLEAN(pf);
+}
+
+// Porównanie przekierowań i odwrotnych przekierowań dwóch struktur
+#define SAME(p, q, A)                                  \
+  do {                                                 \
+    PhoneNumbers *_a, *_b;                             \
+    N(_a = phfwdGet(p, A));                            \
+    N(_b = phfwdGet(q, A));                            \
+    R(_a, 0, phnumGet(_b, 0));                         \
+    phnumDelete(_a);                                   \
+    phnumDelete(_b);                                   \
+    N(_a = phfwdReverse(p, A));                        \
+    N(_b = phfwdReverse(q, A));                        \
+    for (size_t _k = 0; phnumGet(_b, _k) != NULL; ++_k) \
+      R(_a, _k, phnumGet(_b, _k));                     \
+    phnumDelete(_a);                                   \
+    phnumDelete(_b);                                   \
+  } while (0)
+
+// Sprawdzenie dodawania wsadu przekierowań
+static int add_batch(void) {
+  static char nums[600][2][16];
+  PhfwdRule many[600];
+  PhoneForwardStats before, after;
+  char buf[32];
+  size_t i;
+
+  PhfwdRule rules[] = {
+    {"12", "4"}, {"1", "5"}, {"*0", "5"}, {"12", "56"}, {"123", "4"},
+    {"9", "56"}, {"98", "5"},
+  };
+  PhfwdRule bad1[] = {{"3", "7"}, {"4", "4"}};
+  PhfwdRule bad2[] = {{"3", "7"}, {"4a", "1"}};
+  PhfwdRule bad3[] = {{"3", "7"}, {"4", NULL}};
+  PhfwdRule more[] = {
+    {"12", "7"}, {"1", "5"}, {"0", "5"}, {"98", "56"}, {"#", "4"},
+  };
+
+  INIT(pf);
+
+  T(phfwdAddBatch(pf, rules, 0));
+  F(phfwdAddBatch(NULL, rules, SIZE(rules)));
+  F(phfwdAddBatch(pf, NULL, 1));
+
+  // Późniejsze przekierowanie prefiksu 12 zastępuje wcześniejsze.
+  T(phfwdAddBatch(pf, rules, SIZE(rules)));
+  CHECK(pf, "1299", "5699");
+  CHECK(pf, "1239", "49");
+  CHECK(pf, "17", "57");
+  CHECK(pf, "*01", "51");
+  CHECK(pf, "985", "55");
+  RCHCK(pf, "566", "126", "166", "566", "96", "9866", "*066");
+
+  // Niepoprawne przekierowanie odrzuca cały wsad.
+  F(phfwdAddBatch(pf, bad1, SIZE(bad1)));
+  F(phfwdAddBatch(pf, bad2, SIZE(bad2)));
+  F(phfwdAddBatch(pf, bad3, SIZE(bad3)));
+  CHECK(pf, "31", "31");
+
+  // Nieudana alokacja pozostawia strukturę bez zmian.
+  phfwdGetStats(pf, &before);
+  for (unsigned k = 1; ; ++k) {
+    fail_counter = call_counter + k;
+    bool added = phfwdAddBatch(pf, more, SIZE(more));
+    fail_counter = 0;
+    if (added)
+      break;
+    phfwdGetStats(pf, &after);
+    if (after.strings != before.strings ||
+        after.references != before.references)
+      return FAIL;
+    CHECK(pf, "1299", "5699");
+    CHECK(pf, "01", "01");
+    RCHCK(pf, "566", "126", "166", "566", "96", "9866", "*066");
+  }
+  CHECK(pf, "1299", "799");
+  CHECK(pf, "01", "51");
+  CHECK(pf, "#1", "41");
+  RCHCK(pf, "566", "066", "166", "566", "96", "986", "*066");
+
+  // Wsad działa jak kolejne wywołania phfwdAdd().
+  INIT(ref);
+  for (i = 0; i < SIZE(rules); ++i)
+    T(phfwdAdd(ref, rules[i].num1, rules[i].num2));
+  for (i = 0; i < SIZE(more); ++i)
+    T(phfwdAdd(ref, more[i].num1, more[i].num2));
+  for (i = 0; i < SIZE(many); ++i) {
+    snprintf(nums[i][0], 16, "%zu", i * 7919 % 1000);
+    snprintf(nums[i][1], 16, "%zu%s", i * 31 % 50, i % 7 ? "" : "*");
+    if (strcmp(nums[i][0], nums[i][1]) == 0)
+      strcat(nums[i][1], "#");
+    many[i] = (PhfwdRule) {nums[i][0], nums[i][1]};
+    T(phfwdAdd(ref, nums[i][0], nums[i][1]));
+  }
+  T(phfwdAddBatch(pf, many, SIZE(many)));
+  for (i = 0; i < 1000; i += 3) {
+    snprintf(buf, sizeof(buf), "%zu9", i);
+    SAME(pf, ref, buf);
+  }
+  for (i = 0; i < 60; ++i) {
+    snprintf(buf, sizeof(buf), "%zu", i);
+    SAME(pf, ref, buf);
+  }
+  phfwdGetStats(pf, &before);
+  phfwdGetStats(ref, &after);
+  if (after.strings != before.strings || after.references != before.references)
+    return FAIL;
+
+  phfwdDelete(ref);
+  CLEAN(pf);
+}
+
+// Sprawdzenie usuwania przekierowań ze stopniowym zwalnianiem pamięci
+static int lazy_remove(void) {
+  PhoneForwardStats before, after;
+  PhoneNumbers *pnum;
+  size_t count, i;
+  char buf[32], target[32];
+
+  INIT(pf);
+  INIT(ref);
+
+  T(phfwdMaintain(NULL, 1));
+  T(phfwdMaintain(pf, 0));
+
+  for (i = 0; i < 3000; ++i) {
+    snprintf(buf, sizeof(buf), "7%zu", i * 7919 % 100000);
+    snprintf(target, sizeof(target), "%s", i % 2 ? "56" : "5");
+    T(phfwdAdd(pf, buf, target));
+  }
+  T(phfwdAdd(pf, "8", "56"));
+  T(phfwdAdd(ref, "8", "56"));
+  T(phfwdAdd(pf, "6", "5"));
+  T(phfwdAdd(ref, "6", "5"));
+
+  // Usunięte przekierowania znikają od razu, choć pamięć nie jest zwolniona.
+  phfwdGetStats(pf, &before);
+  phfwdRemove(pf, "7");
+  F(phfwdMaintain(pf, 1));
+  CHECK(pf, "77919", "77919");
+  CHECK(pf, "89", "569");
+  RCHCK(pf, "569", "569", "669", "89");
+  ICHCK(pf, "569", "569", "669", "89");
+  T(phfwdReverseCount(pf, "569", &count));
+  Z(count - 3);
+  N(pnum = phfwdReverseRange(pf, "569", 1, 5));
+  R(pnum, 0, "669");
+  R(pnum, 1, "89");
+  Q(pnum, 2);
+  phnumDelete(pnum);
+  N(pnum = phfwdGetReverse(pf, "569"));
+  R(pnum, 0, "569");
+  R(pnum, 1, "669");
+  R(pnum, 2, "89");
+  Q(pnum, 3);
+  phnumDelete(pnum);
+  for (i = 0; i < 100; ++i) {
+    snprintf(buf, sizeof(buf), "%zu", i);
+    SAME(pf, ref, buf);
+  }
+
+  // Usunięcie wewnątrz usuniętego poddrzewa niczego nie zmienia.
+  phfwdRemove(pf, "71");
+  phfwdRemove(pf, "7");
+  CHECK(pf, "71", "71");
+
+  // Przekierowania obok usuniętego poddrzewa i nad nim.
+  T(phfwdAdd(pf, "9", "5"));
+  T(phfwdAdd(ref, "9", "5"));
+  CHECK(pf, "99", "59");
+  RCHCK(pf, "59", "59", "69", "99");
+
+  // Zwolnienie pamięci przebiega w kilku krokach.
+  for (i = 0; !phfwdMaintain(pf, 100); ++i);
+  N(i > 3);
+  phfwdGetStats(pf, &after);
+  N(after.strings < before.strings);
+  T(phfwdReverseCount(pf, "569", &count));
+  Z(count - 4);
+  for (i = 0; i < 100; ++i) {
+    snprintf(buf, sizeof(buf), "%zu", i);
+    SAME(pf, ref, buf);
+  }
+  phfwdGetStats(ref, &before);
+  if (after.strings != before.strings || after.references != before.references)
+    return FAIL;
+
+  // Przekierowanie wewnątrz usuniętego poddrzewa nie czeka na jego
+  // zwolnienie i nie porzuca indeksu.
+  for (i = 0; i < 300; ++i) {
+    snprintf(buf, sizeof(buf), "7%zu", i);
+    T(phfwdAdd(pf, buf, "4"));
+  }
+  phfwdRemove(pf, "7");
+  F(phfwdMaintain(pf, 0));
+  T(phfwdAdd(pf, "712", "4"));
+  F(phfwdMaintain(pf, 0));
+  phfwdGetStats(pf, &after);
+  T(after.indexValid);
+  CHECK(pf, "7129", "49");
+  CHECK(pf, "7139", "7139");
+  RCHCK(pf, "49", "49", "7129");
+  ICHCK(pf, "49", "49", "7129");
+  T(phfwdReverseCount(pf, "49", &count));
+  Z(count - 2);
+  N(pnum = phfwdGetReverse(pf, "49"));
+  R(pnum, 0, "49");
+  R(pnum, 1, "7129");
+  Q(pnum, 2);
+  phnumDelete(pnum);
+
+  // Ponowne usunięcie wewnątrz czekającego poddrzewa.
+  phfwdRemove(pf, "71");
+  CHECK(pf, "7129", "7129");
+  RCHCK(pf, "49", "49");
+  T(phfwdAdd(pf, "712", "5"));
+  T(phfwdAdd(ref, "712", "5"));
+  T(phfwdAdd(pf, "71", "4"));
+  T(phfwdAdd(ref, "71", "4"));
+  CHECK(pf, "7129", "59");
+  CHECK(pf, "7139", "439");
+  RCHCK(pf, "49", "49", "719");
+  RCHCK(pf, "59", "59", "69", "7129", "99");
+
+  // Zliczanie i fragmenty przeciwobrazu korzystają ze zbiorów
+  // przysłoniętych prefiksów także wtedy, gdy usunięte poddrzewo czeka na
+  // zwolnienie.
+  for (i = 0; i < 300; ++i) {
+    snprintf(buf, sizeof(buf), "29%zu", i);
+    T(phfwdAdd(pf, buf, "0"));
+  }
+  T(phfwdAdd(pf, "2", "3"));
+  T(phfwdAdd(pf, "21", "31"));
+  T(phfwdAdd(pf, "22", "31"));
+  T(phfwdReverseCount(pf, "319", &count));
+  Z(count - 3);
+  phfwdRemove(pf, "2");
+  F(phfwdMaintain(pf, 0));
+  T(phfwdReverseCount(pf, "319", &count));
+  Z(count - 1);
+  T(phfwdAdd(pf, "21", "31"));
+  T(phfwdAdd(ref, "21", "31"));
+  F(phfwdMaintain(pf, 0));
+  T(phfwdReverseCount(pf, "319", &count));
+  Z(count - 2);
+  N(pnum = phfwdReverseRange(pf, "319", 1, 5));
+  R(pnum, 0, "319");
+  Q(pnum, 1);
+  phnumDelete(pnum);
+  T(phfwdAdd(pf, "2", "3"));
+  T(phfwdAdd(ref, "2", "3"));
+  F(phfwdMaintain(pf, 0));
+  T(phfwdReverseCount(pf, "319", &count));
+  Z(count - 2);
+  N(pnum = phfwdReverseRange(pf, "319", 0, 5));
+  R(pnum, 0, "219");
+  R(pnum, 1, "319");
+  Q(pnum, 2);
+  phnumDelete(pnum);
+  RCHCK(pf, "319", "219", "319");
+
+  while (!phfwdMaintain(pf, 100));
+  T(phfwdReverseCount(pf, "319", &count));
+  Z(count - 2);
+  RCHCK(pf, "49", "49", "719");
+  for (i = 0; i < 100; ++i) {
+    snprintf(buf, sizeof(buf), "7%zu", i);
+    SAME(pf, ref, buf);
+  }
+  phfwdGetStats(pf, &after);
+  phfwdGetStats(ref, &before);
+  if (after.strings != before.strings || after.references != before.references)
+    return FAIL;
+  T(after.indexValid);
+
+  phfwdDelete(ref);
+  CLEAN(pf);
+}
+
+// Sprawdzenie usuwania wielu przekierowań o wspólnych celach
+static int remove_fan_in(void) {
+  PhoneForwardStats pfStats, refStats;
+  size_t count, refCount, i;
+  char buf[32], prefix[2] = "0";
+
+  INIT(pf);
+  INIT(ref);
+
+  for (i = 0; i < 3000; ++i) {
+    snprintf(buf, sizeof(buf), "%zu", i * 7919 % 100000 + 100000);
+    buf[0] = (char) ('0' + i % 10);
+    T(phfwdAdd(pf, buf, i % 3 ? "5" : "56"));
+    if (buf[0] == '0' || buf[0] == '9')
+      T(phfwdAdd(ref, buf, i % 3 ? "5" : "56"));
+  }
+
+  // Nieudana alokacja podczas usuwania nie zmienia jego wyniku.
+  for (unsigned k = 1; k <= 8; ++k) {
+    prefix[0] = (char) ('0' + k);
+    fail_counter = call_counter + k;
+    phfwdRemove(pf, prefix);
+    phfwdMaintain(pf, 1000);
+    fail_counter = 0;
+  }
+  while (!phfwdMaintain(pf, 100));
+
+  for (i = 0; i < 100; ++i) {
+    snprintf(buf, sizeof(buf), "5%zu", i);
+    SAME(pf, ref, buf);
+    T(phfwdReverseCount(pf, buf, &count));
+    T(phfwdReverseCount(ref, buf, &refCount));
+    Z(count - refCount);
+  }
+  phfwdGetStats(pf, &pfStats);
+  phfwdGetStats(ref, &refStats);
+  if (pfStats.strings != refStats.strings ||
+      pfStats.references != refStats.references)
+    return FAIL;
+
+  // Usunięcie wszystkich przekierowań usuwa zbiory obu celów.
+  phfwdRemove(pf, "0");
+  phfwdRemove(pf, "9");
+  while (!phfwdMaintain(pf, 100));
+  RCHCK(pf, "56", "56");
+  phfwdGetStats(pf, &pfStats);
+  Z(pfStats.strings);
+
+  phfwdDelete(ref);
+  CLEAN(pf);
+}
+
+// Sprawdzenie migawek i przywracania przekierowań
+static int snapshot(void) {
+  PhoneForward *snap, *empty;
+  PhfwdRule rule = {"3", "4"};
+
+  INIT(pf);
+  T(phfwdSetCache(pf, 8));
+  N(empty = phfwdSnapshot(pf));
+  T(phfwdAdd(pf, "12", "5"));
+  T(phfwdAdd(pf, "13", "5"));
+  T(phfwdAdd(pf, "7", "56"));
+  CHECK(pf, "123", "53");
+  N(snap = phfwdSnapshot(pf));
+
+  // Zmiany po utworzeniu migawki nie są w niej widoczne.
+  phfwdRemove(pf, "1");
+  T(phfwdAdd(pf, "7", "8"));
+  T(phfwdAdd(pf, "9", "5"));
+  CHECK(pf, "123", "123");
+  CHECK(pf, "71", "81");
+  RCHCK(pf, "56", "56", "96");
+  CHECK(snap, "123", "53");
+  CHECK(snap, "71", "561");
+  RCHCK(snap, "56", "126", "136", "56", "7");
+  CHECK(empty, "123", "123");
+  RCHCK(empty, "56", "56");
+
+  // Migawka jest tylko do odczytu.
+  F(phfwdAdd(snap, "2", "3"));
+  F(phfwdAddBatch(snap, &rule, 1));
+  phfwdRemove(snap, "7");
+  CHECK(snap, "71", "561");
+  T(phfwdMaintain(snap, 10));
+  F(phfwdRestore(snap, empty));
+  F(phfwdRestore(pf, pf));
+
+  // Przywrócenie migawki nie zmienia jej, a kolejna zmiana jej nie dotyczy.
+  T(phfwdRestore(pf, snap));
+  CHECK(pf, "123", "53");
+  CHECK(pf, "91", "91");
+  phfwdRemove(pf, "13");
+  CHECK(pf, "131", "131");
+  CHECK(snap, "131", "51");
+  T(phfwdRestore(pf, empty));
+  CHECK(pf, "71", "71");
+  phfwdDelete(empty);
+  T(phfwdAdd(pf, "1", "2"));
+  CHECK(pf, "13", "23");
+
+  // Nieudana alokacja przy tworzeniu kopii nie zmienia struktury.
+  T(phfwdRestore(pf, snap));
+  for (unsigned k = 1;; ++k) {
+    fail_counter = call_counter + k;
+    bool added = phfwdAdd(pf, "2", "3");
+    fail_counter = 0;
+    CHECK(snap, "21", "21");
+    if (added)
+      break;
+    CHECK(pf, "21", "21");
+  }
+  CHECK(pf, "123", "53");
+  CHECK(pf, "21", "31");
+
+  // Migawka przeżywa strukturę, z której powstała.
+  phfwdDelete(pf);
+  CHECK(snap, "71", "561");
+  RCHCK(snap, "53", "123", "133", "53");
+  phfwdDelete(snap);
+  return PASS;
+}
+
+// Argumenty wątku odczytującego wspólny ciąg numerów
+typedef struct {
+  PhoneNumbers const *pnum;
+  size_t amount;
+  int result;
+} phnum_arg_t;
+
+// Czytelnik sprawdzający wszystkie numery wspólnego ciągu
+static void *phnum_reader(void *arg) {
+  phnum_arg_t *r = arg;
+  char expected[16];
+
+  r->result = FAIL;
+  for (size_t i = 0; i < r->amount; ++i) {
+    snprintf(expected, sizeof expected, "%zu9", 1000 + i);
+    char const *num = phnumGet(r->pnum, i);
+    if (num == NULL || strcmp(num, expected) != 0)
+      return NULL;
+  }
+  char const *last = phnumGet(r->pnum, r->amount);
+  if (last == NULL || strcmp(last, "99") != 0 ||
+      phnumGet(r->pnum, r->amount + 1) != NULL)
+    return NULL;
+  r->result = PASS;
+  return NULL;
+}
+
+// Sprawdzenie współbieżnego odczytywania jednego wyniku przez wiele wątków
+static int shared_result(void) {
+  PhoneForward *pf;
+  PhoneNumbers *pn;
+  pthread_t threads[4];
+  phnum_arg_t args[4];
+  char num[16];
+
+  N(pf = phfwdNew());
+  for (size_t i = 0; i < 500; ++i) {
+    snprintf(num, sizeof num, "%zu", 1000 + i);
+    T(phfwdAdd(pf, num, "9"));
+  }
+  for (int round = 0; round < 20; ++round) {
+    N(pn = phfwdReverse(pf, "99"));
+    for (size_t i = 0; i < SIZE(threads); ++i) {
+      args[i] = (phnum_arg_t) {pn, 500, FAIL};
+      Z(pthread_create(&threads[i], NULL, phnum_reader, &args[i]));
+    }
+    for (size_t i = 0; i < SIZE(threads); ++i) {
+      Z(pthread_join(threads[i], NULL));
+      Z(args[i].result);
+    }
+    phnumDelete(pn);
+  }
+  phfwdDelete(pf);
+  return PASS;
+}
+
+// Argumenty wątku odpytującego strukturę współbieżną
+typedef struct {
+  PhfwdConcurrent *pc;
+  atomic_bool *stop;
+  int result;
+} reader_arg_t;
+
+// Czytelnik sprawdzający spójność wyników i to, że nie cofają się w czasie
+static void *concurrent_reader(void *arg) {
+  reader_arg_t *r = arg;
+  long last = 0;
+
+  r->result = FAIL;
+  while (!atomic_load(r->stop)) {
+    PhoneNumbers *get = phfwdConcurrentGet(r->pc, "15");
+    char const *num = phnumGet(get, 0);
+    if (num == NULL || phnumGet(get, 1) != NULL)
+      return NULL;
+    if (strcmp(num, "15") != 0) {
+      long version = strtol(num + 1, NULL, 10) / 10;
+      if (strlen(num) != 8 || num[0] != '2' || num[7] != '5' ||
+          version < last)
+        return NULL;
+      last = version;
+    }
+
+    // Wynik odwrotny pochodzi z tego lub z późniejszego stanu.
+    PhoneNumbers *rev = phfwdConcurrentReverse(r->pc, num);
+    char const *first = phnumGet(rev, 0);
+    if (first == NULL)
+      return NULL;
+    size_t count = strcmp(num, "15") == 0 || strcmp(first, num) == 0 ? 1 : 2;
+    if (phnumGet(rev, count) != NULL ||
+        strcmp(phnumGet(rev, count - 1), num) != 0)
+      return NULL;
+    phnumDelete(rev);
+    phnumDelete(get);
+  }
+  r->result = PASS;
+  return NULL;
+}
+
+// Sprawdzenie współbieżnego odpytywania modyfikowanej struktury
+static int concurrent(void) {
+  PhfwdConcurrent *pc;
+  PhoneNumbers *pn;
+  PhfwdRule rule = {"6", "7"};
+  atomic_bool stop;
+  pthread_t threads[3];
+  reader_arg_t args[3];
+  char num[16], prev[16] = "3";
+
+  N(pc = phfwdConcurrentNew());
+  F(phfwdConcurrentAdd(NULL, "1", "2"));
+  F(phfwdConcurrentAdd(pc, "1", "1"));
+  F(phfwdConcurrentRemove(NULL, "1"));
+  T(phfwdConcurrentRemove(pc, "x"));
+  Z(phfwdConcurrentGet(NULL, "1"));
+  F(phfwdConcurrentAddBatch(pc, NULL, 1));
+  T(phfwdConcurrentAddBatch(pc, &rule, 1));
+  N(pn = phfwdConcurrentGet(pc, "61"));
+  R(pn, 0, "71");
+  phnumDelete(pn);
+
+  atomic_init(&stop, false);
+  for (size_t i = 0; i < SIZE(threads); ++i) {
+    args[i] = (reader_arg_t) {pc, &stop, FAIL};
+    Z(pthread_create(&threads[i], NULL, concurrent_reader, &args[i]));
+  }
+  for (int i = 1; i <= 2000; ++i) {
+    snprintf(num, sizeof num, "2%06d", i);
+    T(phfwdConcurrentAdd(pc, "1", num));
+    if (i % 7 == 0)
+      T(phfwdConcurrentRemove(pc, "1"));
+  }
+  atomic_store(&stop, true);
+  for (size_t i = 0; i < SIZE(threads); ++i) {
+    Z(pthread_join(threads[i], NULL));
+    Z(args[i].result);
+  }
+
+  // Modyfikacja, której nie udało się powtórzyć na drugiej kopii, jest
+  // widoczna w obu kopiach, odpytywanych na przemian po kolejnych zmianach,
+  // także gdy zawiedzie również jej pierwsze powtórzenie.
+  for (unsigned k = 1; k <= 24; ++k) {
+    snprintf(num, sizeof num, "4%u", k);
+    fail_counter = call_counter + k;
+    bool added = phfwdConcurrentAdd(pc, "3", num);
+    if (added)
+      strcpy(prev, num);
+    for (int i = 0; i < 3; ++i) {
+      fail_counter = i ? 0 : call_counter + 1;
+      bool changed = phfwdConcurrentAdd(pc, "5*", i % 2 ? "8" : "9");
+      fail_counter = 0;
+      if (i)
+        T(changed);
+      N(pn = phfwdConcurrentGet(pc, "3"));
+      R(pn, 0, prev);
+      phnumDelete(pn);
+      N(pn = phfwdConcurrentReverse(pc, prev));
+      R(pn, 0, "3");
+      phnumDelete(pn);
+    }
+  }
+
+  phfwdConcurrentDelete(pc);
+  phfwdConcurrentDelete(NULL);
+  return PASS;
+}
+
+// Argumenty wątku dodającego przekierowania do struktury podzielonej
+typedef struct {
+  PhfwdSharded *ps;
+  char first;
+  int result;
+} writer_arg_t;
+
+// Wątek dodający i usuwający przekierowania o prefiksach z jednej części
+static void *sharded_writer(void *arg) {
+  writer_arg_t *w = arg;
+  char num1[16], num2[16];
+
+  w->result = FAIL;
+  for (int i = 0; i < 500; ++i) {
+    snprintf(num1, sizeof num1, "%c%d", w->first, i);
+    snprintf(num2, sizeof num2, "%d", i % 10);
+    if (!phfwdShardedAdd(w->ps, num1, num2))
+      return NULL;
+  }
+  snprintf(num1, sizeof num1, "%c4", w->first);
+  phfwdShardedRemove(w->ps, num1);
+  w->result = PASS;
+  return NULL;
+}
+
+// Sprawdzenie struktury podzielonej na części
+static int sharded(void) {
+  static char const *nums[] = {"1", "12", "2", "21", "*", "*3", "#", "#0",
+                               "0", "05", "9", "99", "1234", "12345", "123",
+                               "2222", "21*#0", "*3*3", "#0#0", "0505",
+                               "9999", "99999"};
+  PhfwdSharded *ps;
+  PhoneNumbers *pn, *parts[3];
+  pthread_t threads[4];
+  writer_arg_t args[4];
+  char num[16];
+
+  // Scalanie ciągów numerów pomija powtórzenia.
+  INIT(pf);
+  T(phfwdAdd(pf, "3", "1"));
+  T(phfwdAdd(pf, "#", "1"));
+  N(parts[1] = phfwdReverse(pf, "12"));
+  N(parts[2] = phfwdReverse(pf, "1"));
+  parts[0] = NULL;
+  Z(phnumMerge((PhoneNumbers const *const *) parts, 3));
+  N(parts[0] = phfwdReverse(pf, "9"));
+  N(pn = phnumMerge((PhoneNumbers const *const *) parts, 3));
+  R(pn, 0, "1");
+  R(pn, 1, "12");
+  R(pn, 2, "3");
+  R(pn, 3, "32");
+  R(pn, 4, "9");
+  R(pn, 5, "#");
+  R(pn, 6, "#2");
+  Q(pn, 7);
+  phnumDelete(pn);
+  for (int i = 0; i < 3; ++i)
+    phnumDelete(parts[i]);
+  N(pn = phnumMerge(NULL, 0));
+  Q(pn, 0);
+  phnumDelete(pn);
+  phfwdDelete(pf);
+
+  // Struktura podzielona odpowiada zwykłej strukturze.
+  N(ps = phfwdShardedNew());
+  INIT(ref);
+  F(phfwdShardedAdd(NULL, "1", "2"));
+  F(phfwdShardedAdd(ps, "", "2"));
+  F(phfwdShardedAdd(ps, "1x", "2"));
+  F(phfwdShardedAdd(ps, "1", "1"));
+  Z(phfwdShardedGet(NULL, "1"));
+  Z(phfwdShardedReverse(NULL, "1"));
+  phfwdShardedRemove(NULL, "1");
+  phfwdShardedRemove(ps, "x");
+  E(phfwdShardedGet(ps, "x"));
+  E(phfwdShardedReverse(ps, "1x"));
+  for (size_t i = 0; i < SIZE(nums); ++i)
+    for (size_t j = 0; j < SIZE(nums); ++j)
+      if ((i * 7 + j * 3) % 5 == 0 && strcmp(nums[i], nums[j]) != 0) {
+        T(phfwdShardedAdd(ps, nums[i], nums[j]));
+        T(phfwdAdd(ref, nums[i], nums[j]));
+      }
+  phfwdShardedRemove(ps, "2");
+  phfwdRemove(ref, "2");
+  phfwdShardedRemove(ps, "1234");
+  phfwdRemove(ref, "1234");
+  for (size_t i = 0; i < SIZE(nums); ++i) {
+    for (size_t j = 0; j < 3; ++j) {
+      snprintf(num, sizeof num, "%s%zu", nums[i], j);
+      PhoneNumbers *a, *b;
+      N(a = phfwdShardedGet(ps, num));
+      N(b = phfwdGet(ref, num));
+      R(a, 0, phnumGet(b, 0));
+      phnumDelete(a);
+      phnumDelete(b);
+      N(a = phfwdShardedReverse(ps, num));
+      N(b = phfwdReverse(ref, num));
+      size_t k = 0;
+      for (; phnumGet(b, k) != NULL; ++k)
+        R(a, k, phnumGet(b, k));
+      Q(a, k);
+      phnumDelete(a);
+      phnumDelete(b);
+    }
+  }
+  phfwdDelete(ref);
+  phfwdShardedDelete(ps);
+
+  // Wątki modyfikujące różne części nie przeszkadzają sobie nawzajem.
+  N(ps = phfwdShardedNew());
+  for (size_t i = 0; i < SIZE(threads); ++i) {
+    args[i] = (writer_arg_t) {ps, "13*#"[i], FAIL};
+    Z(pthread_create(&threads[i], NULL, sharded_writer, &args[i]));
+  }
+  for (size_t i = 0; i < SIZE(threads); ++i) {
+    Z(pthread_join(threads[i], NULL));
+    Z(args[i].result);
+  }
+  N(pn = phfwdShardedReverse(ps, "7"));
+  R(pn, 0, "1107");
+  R(pn, 1, "1117");
+  R(pn, 156, "#97");
+  Q(pn, 157);
+  phnumDelete(pn);
+  N(pn = phfwdShardedGet(ps, "*499"));
+  R(pn, 0, "*499");
+  phnumDelete(pn);
+  N(pn = phfwdShardedGet(ps, "*3991"));
+  R(pn, 0, "91");
+  phnumDelete(pn);
+  phfwdShardedDelete(ps);
+  phfwdShardedDelete(NULL);
+  return PASS;
+}
+
 /** URUCHAMIANIE TESTÓW **/
 
 typedef struct {
@@ -1066,8 +2710,29 @@ static const test_list_t test_list[] = {
   TEST(twelve_digits),
   TEST(cycle),
   TEST(sort),
+  TEST(shared_heads),
+  TEST(sorted_sources),
+  TEST(shared_strings),
   TEST(alloc_fail_1),
   TEST(alloc_fail_2),
+  TEST(get_into),
+  TEST(encode_blocks),
+  TEST(get_batch),
+  TEST(executor),
+  TEST(lpm_lengths),
+  TEST(lpm_markers),
+  TEST(shallow_changes),
+  TEST(get_cache),
+  TEST(get_reverse),
+  TEST(reverse_iter),
+  TEST(reverse_range),
+  TEST(add_batch),
+  TEST(lazy_remove),
+  TEST(remove_fan_in),
+  TEST(snapshot),
+  TEST(shared_result),
+  TEST(concurrent),
+  TEST(sharded),
 };
 
 static int do_test(int (*function)(void)) {
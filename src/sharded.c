@@ -0,0 +1,188 @@
+/** @file
+ * Implementacja klasy przechowującej przekierowania numerów telefonów
+ * podzielone na niezależne części, które wiele wątków może modyfikować
+ * równolegle.
+ *
+ * @author Adam Greloch <ag438473@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "sharded.h"
+#include "alphabet.h"
+
+#define KEY 4 /**< Liczba początkowych znaków prefiksu wyznaczających jego
+                   część. */
+#define SHARD_BITS 4 /**< Logarytm liczby części prefiksów długich. */
+#define SHARDS (1 << SHARD_BITS) /**< Liczba części prefiksów długich. */
+#define LINE 64 /**< Rozmiar linii pamięci podręcznej w bajtach. */
+
+/**
+ * Część przekierowań wraz z jej blokadą. Dopełnienie rozdziela blokady
+ * sąsiednich części do różnych linii pamięci podręcznej.
+ */
+typedef struct Shard {
+    pthread_rwlock_t lock; /**< Chroni przekierowania części. */
+    PhoneForward *pf; /**< Przekierowania części. */
+    char padding[LINE]; /**< Dopełnienie. */
+} Shard;
+
+/**
+ * Struktura przechowująca wszystkie części. Kilka blokad zakładanych jest
+ * zawsze w kolejności części w tablicy, więc blokada części prefiksów
+ * krótkich jest zakładana jako ostatnia.
+ */
+struct PhfwdSharded {
+    Shard shards[SHARDS + 1]; /**< Części prefiksów o długości co najmniej
+                                   @ref KEY, a za nimi część prefiksów
+                                   krótszych. */
+};
+
+/**
+ * @brief Zwraca część przekierowań o prefiksach krótszych niż @ref KEY.
+ * @param[in] ps - wskaźnik na strukturę.
+ * @return Wskaźnik na część.
+ */
+static inline Shard *shardShort(PhfwdSharded *ps) {
+    return &ps->shards[SHARDS];
+}
+
+/**
+ * @brief Wyznacza część, do której należą przekierowania o prefiksie
+ * @p num.
+ * Prefiksy o długości co najmniej @ref KEY rozkładane są między części
+ * mieszaniem multiplikatywnym ich pierwszych @ref KEY znaków, tak by
+ * przekierowania o wspólnym numerze kierunkowym kraju trafiały do wielu
+ * części. Krótsze prefiksy należą do osobnej części.
+ * @param[in] ps - wskaźnik na strukturę.
+ * @param[in] num - wskaźnik na napis lub NULL.
+ * @return Wskaźnik na część lub NULL, jeśli napis jest pusty, ma wartość
+ * NULL lub jeden z jego pierwszych @ref KEY znaków nie należy do alfabetu,
+ * więc nie reprezentuje numeru.
+ */
+static Shard *shardOf(PhfwdSharded *ps, char const *num) {
+    if (!num || num[0] == '\0') return NULL;
+
+    uint32_t key = 0;
+    for (size_t i = 0; i < KEY; i++) {
+        if (num[i] == '\0') return shardShort(ps);
+        int value = getValue(num[i]);
+        if (value < 0) return NULL;
+        key = key * ALLNUM + (uint32_t) value;
+    }
+    return &ps->shards[(key * UINT32_C(2654435761)) >> (32 - SHARD_BITS)];
+}
+
+PhfwdSharded *phfwdShardedNew(void) {
+    PhfwdSharded *ps = malloc(sizeof(PhfwdSharded));
+    if (!ps) return NULL;
+
+    for (size_t k = 0; k <= SHARDS; k++) {
+        ps->shards[k].pf = phfwdNew();
+        if (!ps->shards[k].pf) {
+            while (k--)
+                phfwdDelete(ps->shards[k].pf);
+            free(ps);
+            return NULL;
+        }
+    }
+    for (size_t k = 0; k <= SHARDS; k++)
+        pthread_rwlock_init(&ps->shards[k].lock, NULL);
+    return ps;
+}
+
+void phfwdShardedDelete(PhfwdSharded *ps) {
+    if (!ps) return;
+
+    for (size_t k = 0; k <= SHARDS; k++) {
+        pthread_rwlock_destroy(&ps->shards[k].lock);
+        phfwdDelete(ps->shards[k].pf);
+    }
+    free(ps);
+}
+
+bool phfwdShardedAdd(PhfwdSharded *ps, char const *num1, char const *num2) {
+    Shard *shard = ps ? shardOf(ps, num1) : NULL;
+    if (!shard) return false;
+
+    pthread_rwlock_wrlock(&shard->lock);
+    bool added = phfwdAdd(shard->pf, num1, num2);
+    pthread_rwlock_unlock(&shard->lock);
+    return added;
+}
+
+void phfwdShardedRemove(PhfwdSharded *ps, char const *num) {
+    Shard *shard = ps ? shardOf(ps, num) : NULL;
+    if (!shard) return;
+
+    if (shard != shardShort(ps)) {
+        pthread_rwlock_wrlock(&shard->lock);
+        phfwdRemove(shard->pf, num);
+        pthread_rwlock_unlock(&shard->lock);
+        return;
+    }
+
+    /* Krótki prefiks może poprzedzać prefiksy każdej części. Usuwanie jest
+     * leniwe, więc wszystkie blokady trzymane są krótko. */
+    for (size_t k = 0; k <= SHARDS; k++)
+        pthread_rwlock_wrlock(&ps->shards[k].lock);
+    for (size_t k = 0; k <= SHARDS; k++)
+        phfwdRemove(ps->shards[k].pf, num);
+    for (size_t k = 0; k <= SHARDS; k++)
+        pthread_rwlock_unlock(&ps->shards[k].lock);
+}
+
+PhoneNumbers *phfwdShardedGet(PhfwdSharded *ps, char const *num) {
+    if (!ps) return NULL;
+
+    /* Napis, który nie reprezentuje numeru, nie należy do żadnej części,
+     * lecz wynik dla niego wyznacza dowolna. */
+    Shard *shard = shardOf(ps, num);
+    if (!shard) return phfwdGet(shardShort(ps)->pf, num);
+
+    Shard *rest = shardShort(ps);
+    pthread_rwlock_rdlock(&shard->lock);
+    PhoneNumbers *result = phfwdGet(shard->pf, num);
+
+    /* Przekierowanie zmienia numer, więc wynik równy numerowi oznacza, że
+     * w części nie ma pasującego prefiksu. Pasować może wtedy jedynie
+     * krótszy prefiks z części prefiksów krótkich. */
+    char const *forwarded = phnumGet(result, 0);
+    if (shard != rest && forwarded && strcmp(forwarded, num) == 0) {
+        pthread_rwlock_rdlock(&rest->lock);
+        phnumDelete(result);
+        result = phfwdGet(rest->pf, num);
+        pthread_rwlock_unlock(&rest->lock);
+    }
+    pthread_rwlock_unlock(&shard->lock);
+    return result;
+}
+
+PhoneNumbers *phfwdShardedReverse(PhfwdSharded *ps, char const *num) {
+    if (!ps) return NULL;
+    if (!shardOf(ps, num)) return phfwdReverse(shardShort(ps)->pf, num);
+
+    /* Wynik każdej części zależy jedynie od jej przekierowań, więc części
+     * odpytywane są kolejno, a każda jest blokowana tylko na czas własnego
+     * zapytania. */
+    PhoneNumbers *parts[SHARDS + 1];
+    for (size_t k = 0; k <= SHARDS; k++) {
+        pthread_rwlock_rdlock(&ps->shards[k].lock);
+        parts[k] = phfwdReverse(ps->shards[k].pf, num);
+        pthread_rwlock_unlock(&ps->shards[k].lock);
+    }
+
+    PhoneNumbers *result = phnumMerge((PhoneNumbers const *const *) parts,
+                                      SHARDS + 1);
+    for (size_t k = 0; k <= SHARDS; k++)
+        phnumDelete(parts[k]);
+    return result;
+}
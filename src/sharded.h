@@ -0,0 +1,102 @@
+/** @file
+ * Interfejs klasy przechowującej przekierowania numerów telefonów
+ * podzielone na niezależne części, które wiele wątków może modyfikować
+ * równolegle.
+ *
+ * Przekierowanie o prefiksie długości co najmniej czterech znaków trafia do
+ * jednej z szesnastu części, wyznaczonej skrótem czterech pierwszych znaków
+ * prefiksu, a przekierowanie o krótszym prefiksie do osobnej części prefiksów
+ * krótkich. Przekierowania o wspólnym numerze kierunkowym kraju rozkładają
+ * się więc na wiele części. Każda część ma własne drzewa przekierowań oraz
+ * własną blokadę, którą zapytania zakładają do odczytu, a modyfikacje do
+ * zapisu. Modyfikacje różnych części wykonywane są więc równolegle.
+ *
+ * Najdłuższy pasujący prefiks numeru leży w części wyznaczonej przez jego
+ * cztery pierwsze znaki, a jeśli takiego nie ma, to w części prefiksów
+ * krótkich, więc phfwdGet() odpytuje co najwyżej dwie części. Usunięcie
+ * przekierowań o długim prefiksie dotyczy jednej części, a o krótkim
+ * wszystkich, zablokowanych na czas leniwego usuwania.
+ *
+ * Prefiks docelowy przekierowania może natomiast leżeć w dowolnej części,
+ * więc przekierowania odwrotne wyznaczane są we wszystkich częściach,
+ * a ich wyniki scalane (zobacz phnumMerge()). Wynik każdej części zależy
+ * jedynie od jej przekierowań, więc części odpytywane są kolejno, każda pod
+ * własną blokadą. Modyfikacje, które w tym czasie zmieniają różne części,
+ * mogą więc zostać uwzględnione tylko częściowo.
+ *
+ * @author Adam Greloch <ag438473@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef __SHARDED_H__
+#define __SHARDED_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "phone_forward.h"
+
+/**
+ * To jest struktura przechowująca przekierowania numerów telefonów
+ * podzielone na części.
+ */
+struct PhfwdSharded;
+typedef struct PhfwdSharded PhfwdSharded; /**< @struct PhfwdSharded */
+
+/** @brief Tworzy nową strukturę.
+ * Tworzy nową strukturę niezawierającą żadnych przekierowań.
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ *         alokować pamięci.
+ */
+PhfwdSharded *phfwdShardedNew(void);
+
+/** @brief Usuwa strukturę.
+ * Usuwa strukturę wskazywaną przez @p ps. Nic nie robi, jeśli wskaźnik ten
+ * ma wartość NULL. W czasie usuwania żaden inny wątek nie może korzystać ze
+ * struktury.
+ * @param[in] ps – wskaźnik na usuwaną strukturę.
+ */
+void phfwdShardedDelete(PhfwdSharded *ps);
+
+/** @brief Dodaje przekierowanie.
+ * Działa jak phfwdAdd(), blokując jedynie część prefiksu @p num1.
+ * @param[in,out] ps – wskaźnik na strukturę;
+ * @param[in] num1   – wskaźnik na napis reprezentujący prefiks numerów
+ *                     przekierowywanych;
+ * @param[in] num2   – wskaźnik na napis reprezentujący prefiks numerów,
+ *                     na które jest wykonywane przekierowanie.
+ * @return Wartość @p true, jeśli przekierowanie zostało dodane.
+ *         Wartość @p false, jeśli wystąpił błąd w sensie phfwdAdd() lub
+ *         @p ps ma wartość NULL.
+ */
+bool phfwdShardedAdd(PhfwdSharded *ps, char const *num1, char const *num2);
+
+/** @brief Usuwa przekierowania.
+ * Działa jak phfwdRemove(). Blokuje jedynie część prefiksu @p num, a jeśli
+ * jest on krótszy niż cztery znaki, to wszystkie części.
+ * @param[in,out] ps – wskaźnik na strukturę;
+ * @param[in] num    – wskaźnik na napis reprezentujący prefiks numerów.
+ */
+void phfwdShardedRemove(PhfwdSharded *ps, char const *num);
+
+/** @brief Wyznacza przekierowanie numeru.
+ * Działa jak phfwdGet(), blokując do odczytu jedynie część numeru @p num
+ * oraz, jeśli nie ma w niej pasującego prefiksu, część prefiksów krótkich.
+ * @param[in] ps  – wskaźnik na strukturę;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy
+ *         nie udało się alokować pamięci lub @p ps ma wartość NULL.
+ */
+PhoneNumbers *phfwdShardedGet(PhfwdSharded *ps, char const *num);
+
+/** @brief Wyznacza przekierowania na dany numer.
+ * Działa jak phfwdReverse(). Wyznacza przekierowania odwrotne kolejno
+ * w każdej części, blokując do odczytu tylko odpytywaną część, i scala je.
+ * @param[in] ps  – wskaźnik na strukturę;
+ * @param[in] num – wskaźnik na napis reprezentujący numer.
+ * @return Wskaźnik na strukturę przechowującą ciąg numerów lub NULL, gdy
+ *         nie udało się alokować pamięci lub @p ps ma wartość NULL.
+ */
+PhoneNumbers *phfwdShardedReverse(PhfwdSharded *ps, char const *num);
+
+#endif /* __SHARDED_H__ */
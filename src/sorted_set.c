@@ -0,0 +1,263 @@
+/** @file
+ * Implementacja klasy obsługującej uporządkowany zbiór upakowanych numerów
+ * przechowywany w ciągłej tablicy.
+ *
+ * @author Adam Greloch <ag438473@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "sorted_set.h"
+#include "packed.h"
+
+#define INIT_SIZE 2 /**< Początkowa pojemność zbioru. Większość przekierowań
+                         ma niewiele prefiksów. */
+#define KEY_BYTES 8 /**< Liczba początkowych bajtów znaków numeru zapisanych
+                         w kluczu elementu. */
+
+/**
+ * Element zbioru. Klucz pozwala porównać większość par elementów bez
+ * odczytywania numerów, które leżą w losowych miejscach pamięci.
+ */
+typedef struct SetEntry {
+    uint64_t key; /**< Początkowe bajty znaków upakowanego numeru, pierwszy
+                       w najstarszym bajcie klucza, zaś pozycje za końcem
+                       numeru są zerowe. Porządek kluczy jest więc zgodny
+                       z porządkiem numerów. */
+    uint8_t const *num; /**< Wskaźnik na upakowany numer. */
+} SetEntry;
+
+/**
+ * Struktura przechowująca zbiór. Elementy leżą bezpośrednio za nagłówkiem.
+ */
+struct SortedSet {
+    size_t amount; /**< Liczba elementów zbioru. */
+    size_t size; /**< Pojemność tablicy @p data. */
+    SetEntry data[]; /**< Elementy posortowane rosnąco. */
+};
+
+/**
+ * @brief Wyznacza klucz numeru @p num.
+ * @param[in] num - wskaźnik na upakowany numer.
+ * @return Klucz opisany w @ref SetEntry.
+ */
+static uint64_t keyOf(uint8_t const *num) {
+    size_t length;
+    uint8_t const *digits = packedDigits(num, &length);
+    size_t bytes = (length + 1) / 2;
+    uint64_t key = 0;
+    for (size_t i = 0; i < KEY_BYTES; i++)
+        key = key << 8 | (i < bytes ? digits[i] : 0);
+    return key;
+}
+
+/**
+ * @brief Porównuje element @p entry z numerem @p num o kluczu @p key.
+ * @param[in] entry - wskaźnik na element zbioru.
+ * @param[in] num - wskaźnik na upakowany numer.
+ * @param[in] key - klucz numeru @p num.
+ * @return Wartość ujemna, zero lub dodatnia, jeśli numer elementu jest
+ * odpowiednio mniejszy, równy lub większy od @p num.
+ */
+static int entryCompare(SetEntry const *entry, uint8_t const *num,
+                        uint64_t key) {
+    if (entry->key != key) return entry->key < key ? -1 : 1;
+    if (entry->num == num) return 0;
+    return packedCompare(entry->num, num);
+}
+
+/**
+ * @brief Zmienia pojemność zbioru @p set na @p size.
+ * @param[in,out] set - wskaźnik na zbiór lub NULL.
+ * @param[in] size - nowa pojemność, nie mniejsza od liczby elementów.
+ * @return Wskaźnik na zbiór o nowej pojemności lub NULL, gdy nie udało się
+ * alokować pamięci. W tym drugim wypadku zbiór @p set pozostaje bez zmian.
+ */
+static SortedSet *setResize(SortedSet *set, size_t size) {
+    SortedSet *resized = realloc(set, sizeof(SortedSet) +
+                                      size * sizeof(SetEntry));
+    if (!resized) return NULL;
+    if (!set) resized->amount = 0;
+    resized->size = size;
+    return resized;
+}
+
+/**
+ * @brief Wyszukuje binarnie pozycję numeru @p num w zbiorze @p set.
+ * @param[in] set - wskaźnik na niepusty zbiór.
+ * @param[in] num - wskaźnik na upakowany numer.
+ * @param[in] key - klucz numeru @p num.
+ * @param[out] found - wskaźnik na zmienną, w której zostanie zapisane, czy
+ *                     zbiór zawiera numer równy @p num.
+ * @return Indeks pierwszego elementu nie mniejszego od @p num.
+ */
+static size_t setFind(SortedSet const *set, uint8_t const *num, uint64_t key,
+                      bool *found) {
+    size_t low = 0, high = set->amount, mid;
+    int cmp;
+    *found = false;
+
+    while (low < high) {
+        mid = low + (high - low) / 2;
+        cmp = entryCompare(&set->data[mid], num, key);
+        if (cmp < 0) {
+            low = mid + 1;
+        }
+        else {
+            if (cmp == 0) *found = true;
+            high = mid;
+        }
+    }
+    return low;
+}
+
+SortedSet *setInsert(SortedSet *set, uint8_t const *num) {
+    if (!num) return NULL;
+
+    uint64_t key = keyOf(num);
+    size_t pos = 0;
+    bool found = false;
+    if (set) pos = setFind(set, num, key, &found);
+    if (found) return set;
+
+    if (!set || set->amount == set->size) {
+        SortedSet *resized = setResize(set, set ? 2 * set->size : INIT_SIZE);
+        if (!resized) return NULL;
+        set = resized;
+    }
+
+    memmove(&set->data[pos + 1], &set->data[pos],
+            (set->amount - pos) * sizeof(SetEntry));
+    set->data[pos] = (SetEntry) {key, num};
+    set->amount++;
+    return set;
+}
+
+SortedSet *setMerge(SortedSet const *set, uint8_t const *const *nums,
+                    size_t count) {
+    size_t amount = setGetAmount(set), size = amount + count;
+    SortedSet *merged = setResize(NULL, size < INIT_SIZE ? INIT_SIZE : size);
+    if (!merged) return NULL;
+
+    size_t i = 0, j = 0;
+    while (i < amount || j < count) {
+        uint8_t const *num = j < count ? nums[j] : NULL;
+        uint64_t key = num ? keyOf(num) : 0;
+        int cmp = i == amount ? 1 : !num ? -1
+                                        : entryCompare(&set->data[i], num, key);
+        if (cmp <= 0) {
+            merged->data[merged->amount++] = set->data[i++];
+            if (cmp == 0) j++;
+        }
+        else {
+            merged->data[merged->amount++] = (SetEntry) {key, num};
+            j++;
+        }
+    }
+    return merged;
+}
+
+SortedSet *setRemove(SortedSet *set, uint8_t const *num) {
+    if (!set || !num) return set;
+
+    bool found;
+    size_t pos = setFind(set, num, keyOf(num), &found);
+    if (!found || set->data[pos].num != num) return set;
+
+    if (--set->amount == 0) {
+        free(set);
+        return NULL;
+    }
+
+    memmove(&set->data[pos], &set->data[pos + 1],
+            (set->amount - pos) * sizeof(SetEntry));
+
+    /* Zmniejszenie pojemności nie jest konieczne, więc jego niepowodzenie
+     * pozostawia zbiór bez zmian. */
+    if (set->size > INIT_SIZE && 4 * set->amount <= set->size) {
+        SortedSet *resized = setResize(set, set->size / 2);
+        if (resized) set = resized;
+    }
+    return set;
+}
+
+SortedSet *setRemoveSorted(SortedSet *set, uint8_t const *const *nums,
+                           size_t count) {
+    if (!set) return NULL;
+
+    if (count == 0) return set;
+
+    /* Elementy mniejsze od najmniejszego usuwanego numeru nie przesuwają
+     * się. */
+    bool found;
+    uint64_t key = keyOf(nums[0]);
+    size_t kept = setFind(set, nums[0], key, &found), j = 0;
+    for (size_t i = kept; i < set->amount; i++) {
+        SetEntry const *entry = &set->data[i];
+        /* Pomijamy numery mniejsze od elementu, których nie ma w zbiorze. */
+        while (j < count && entryCompare(entry, nums[j], key) > 0)
+            if (++j < count) key = keyOf(nums[j]);
+
+        if (j < count && entry->num == nums[j]) {
+            if (++j < count) key = keyOf(nums[j]);
+        }
+        else {
+            set->data[kept++] = *entry;
+        }
+    }
+    set->amount = kept;
+
+    if (kept == 0) {
+        free(set);
+        return NULL;
+    }
+
+    size_t size = set->size;
+    while (size > INIT_SIZE && 4 * kept <= size)
+        size /= 2;
+    if (size < set->size) {
+        SortedSet *resized = setResize(set, size);
+        if (resized) set = resized;
+    }
+    return set;
+}
+
+size_t setGetAmount(SortedSet const *set) {
+    return set ? set->amount : 0;
+}
+
+uint8_t const *setGet(SortedSet const *set, size_t idx) {
+    if (!set || idx >= set->amount) return NULL;
+    return set->data[idx].num;
+}
+
+size_t setRank(SortedSet const *set, uint8_t const *num) {
+    if (!set) return 0;
+
+    bool found;
+    return setFind(set, num, keyOf(num), &found);
+}
+
+size_t setCountPrefixed(SortedSet const *set, uint8_t const *prefix) {
+    size_t first = setRank(set, prefix);
+    size_t low = first, high = setGetAmount(set), mid;
+
+    /* Elementy od indeksu first są nie mniejsze od prefix, więc do końca
+     * przedziału zaczynają się od niego. */
+    while (low < high) {
+        mid = low + (high - low) / 2;
+        if (packedComparePrefix(set->data[mid].num, prefix) == 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low - first;
+}
+
+void setDelete(SortedSet *set) {
+    free(set);
+}
@@ -0,0 +1,114 @@
+/** @file
+ * Interfejs klasy obsługującej uporządkowany zbiór upakowanych numerów
+ * (zobacz @ref packed.h). Zbiór ma być przechowywany
+ * w wierzchołkach drzew @p TrieNode. Klasa implementuje strukturę
+ * @p SortedSet zadeklarowaną w interfejsie @ref structs.h.
+ *
+ * Elementy zbioru leżą w jednym ciągłym bloku pamięci, posortowane rosnąco
+ * w porządku leksykograficznym (zobacz packedCompare()). Wstawianie i usuwanie
+ * wyszukują pozycję elementu binarnie i przesuwają elementy za nią, dzięki
+ * czemu odczyt zbioru w kolejności nie wymaga ani alokacji, ani sortowania.
+ * Pusty zbiór reprezentowany jest przez wskaźnik NULL. Obok wskaźnika na
+ * numer element przechowuje klucz z jego początkowych znaków, więc większość
+ * porównań nie sięga do pamięci numerów.
+ *
+ * Zbiór przechowuje jedynie wskaźniki na numery i nie zarządza ich
+ * pamięcią.
+ *
+ * @author Adam Greloch <ag438473@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef __SORTED_SET_H__
+#define __SORTED_SET_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "structs.h"
+
+/** @brief Wstawia numer @p num do zbioru @p set.
+ * Jeśli zbiór zawiera już numer równy @p num, to pozostawia go bez zmian.
+ * Wstawienie może przenieść zbiór w inne miejsce pamięci, zatem należy
+ * posługiwać się odtąd zwróconym wskaźnikiem.
+ * @param[in,out] set - wskaźnik na zbiór lub NULL, jeśli zbiór jest pusty.
+ * @param[in] num - wskaźnik na upakowany numer.
+ * @return Wskaźnik na zbiór zawierający @p num lub NULL, gdy nie udało się
+ * alokować pamięci. W tym drugim wypadku zbiór @p set pozostaje bez zmian.
+ */
+SortedSet *setInsert(SortedSet *set, uint8_t const *num);
+
+/** @brief Tworzy zbiór złożony z elementów @p set oraz numerów @p nums.
+ * Pozostawia @p set bez zmian. Pojemność nowego zbioru równa jest liczbie
+ * jego elementów, więc numery wstawiane hurtowo nie alokują pamięci
+ * wielokrotnie.
+ * @param[in] set - wskaźnik na zbiór lub NULL, jeśli zbiór jest pusty.
+ * @param[in] nums - tablica wskaźników na upakowane numery, posortowanych
+ *                   rosnąco i parami różnych.
+ * @param[in] count - liczba numerów, dodatnia.
+ * @return Wskaźnik na nowy zbiór lub NULL, gdy nie udało się alokować
+ * pamięci.
+ */
+SortedSet *setMerge(SortedSet const *set, uint8_t const *const *nums,
+                    size_t count);
+
+/** @brief Usuwa numer @p num ze zbioru @p set.
+ * Numer porównywany jest ze wskaźnikami zbioru, zatem @p num musi być tym
+ * samym wskaźnikiem, który wstawiono. Usunięcie może przenieść zbiór w inne
+ * miejsce pamięci, zaś usunięcie ostatniego elementu zwalnia zbiór.
+ * @param[in,out] set - wskaźnik na zbiór lub NULL.
+ * @param[in] num - wskaźnik na usuwany numer.
+ * @return Wskaźnik na zbiór lub NULL, jeśli zbiór stał się pusty.
+ */
+SortedSet *setRemove(SortedSet *set, uint8_t const *num);
+
+/** @brief Usuwa numery @p nums ze zbioru @p set jednym przejściem.
+ * Działa jak kolejne wywołania setRemove(), lecz przesuwa każdy pozostały
+ * element zbioru co najwyżej raz. Numery spoza zbioru są pomijane.
+ * @param[in,out] set - wskaźnik na zbiór lub NULL.
+ * @param[in] nums - tablica wskaźników na usuwane numery, posortowanych
+ *                   rosnąco.
+ * @param[in] count - liczba numerów.
+ * @return Wskaźnik na zbiór lub NULL, jeśli zbiór stał się pusty.
+ */
+SortedSet *setRemoveSorted(SortedSet *set, uint8_t const *const *nums,
+                           size_t count);
+
+/** @brief Zwraca liczbę elementów zbioru @p set.
+ * @param[in] set - wskaźnik na zbiór lub NULL.
+ * @return Liczba elementów zbioru.
+ */
+size_t setGetAmount(SortedSet const *set);
+
+/** @brief Zwraca element zbioru @p set o indeksie @p idx.
+ * Elementy są indeksowane w porządku rosnącym.
+ * @param[in] set - wskaźnik na zbiór.
+ * @param[in] idx - indeks elementu.
+ * @return Wskaźnik na upakowany numer lub NULL, jeśli @p set ma wartość NULL
+ * lub @p idx jest poza zakresem.
+ */
+uint8_t const *setGet(SortedSet const *set, size_t idx);
+
+/** @brief Zwraca liczbę elementów zbioru @p set mniejszych od @p num.
+ * @param[in] set - wskaźnik na zbiór lub NULL.
+ * @param[in] num - wskaźnik na upakowany numer, niekoniecznie należący do
+ *                  zbioru.
+ * @return Indeks pierwszego elementu nie mniejszego od @p num.
+ */
+size_t setRank(SortedSet const *set, uint8_t const *num);
+
+/** @brief Zlicza elementy zbioru @p set, których prefiksem jest @p prefix.
+ * Elementy te zajmują w zbiorze spójny przedział indeksów.
+ * @param[in] set - wskaźnik na zbiór lub NULL.
+ * @param[in] prefix - wskaźnik na upakowany numer.
+ * @return Liczba elementów równych @p prefix lub zaczynających się od niego.
+ */
+size_t setCountPrefixed(SortedSet const *set, uint8_t const *prefix);
+
+/** @brief Usuwa zbiór @p set. Zwalnia jego pamięć, lecz nie przechowywane
+ * numery.
+ * @param[in,out] set - wskaźnik na usuwany zbiór lub NULL.
+ */
+void setDelete(SortedSet *set);
+
+#endif /* __SORTED_SET_H__ */
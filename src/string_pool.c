@@ -0,0 +1,200 @@
+/** @file
+ * Implementacja klasy obsługującej pulę współdzielonych upakowanych numerów.
+ * Pula jest tablicą mieszającą z listami w kubełkach.
+ *
+ * @author Adam Greloch <ag438473@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "string_pool.h"
+#include "packed.h"
+
+#define INIT_BUCKETS 64 /**< Początkowa liczba kubełków. */
+#define STACK_BUFFER 64 /**< Rozmiar bufora na stosie, w którym pakowane są
+                             numery przed wstawieniem do puli. */
+
+/**
+ * Struktura przechowująca numer w puli. Numer leży bezpośrednio za
+ * nagłówkiem, dzięki czemu z wskaźnika na numer można odtworzyć wskaźnik na
+ * element.
+ */
+typedef struct PoolEntry {
+    struct PoolEntry *next; /**< Wskaźnik na następny element kubełka. */
+    uint32_t hash; /**< Wartość funkcji mieszającej numeru. */
+    uint32_t references; /**< Liczba odwołań do numeru. */
+    uint8_t num[]; /**< Przechowywany upakowany numer. */
+} PoolEntry;
+
+/**
+ * Struktura przechowująca pulę.
+ */
+struct StringPool {
+    PoolEntry **buckets; /**< Tablica kubełków. */
+    size_t bucketCount; /**< Liczba kubełków, będąca potęgą dwójki. */
+    PoolStats stats; /**< Bieżące statystyki puli. */
+};
+
+/**
+ * @brief Oblicza wartość funkcji mieszającej FNV-1a dla bajtów @p data.
+ * @param[in] data - wskaźnik na bajty.
+ * @param[in] size - liczba bajtów.
+ * @return Wartość funkcji mieszającej.
+ */
+static uint32_t hashBytes(uint8_t const *data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Zwraca element puli przechowujący numer @p num.
+ * @param[in] num - wskaźnik na numer zwrócony przez poolIntern().
+ * @return Wskaźnik na element.
+ */
+static PoolEntry *entryOf(uint8_t const *num) {
+    return (PoolEntry *) (num - offsetof(PoolEntry, num));
+}
+
+StringPool *poolNew(void) {
+    StringPool *pool = malloc(sizeof(StringPool));
+    if (!pool) return NULL;
+
+    pool->buckets = calloc(INIT_BUCKETS, sizeof(PoolEntry *));
+    if (!pool->buckets) {
+        free(pool);
+        return NULL;
+    }
+
+    pool->bucketCount = INIT_BUCKETS;
+    pool->stats = (PoolStats) {0, 0, 0, 0};
+    return pool;
+}
+
+void poolDelete(StringPool *pool) {
+    if (!pool) return;
+
+    PoolEntry *curr, *next;
+    for (size_t i = 0; i < pool->bucketCount; i++)
+        for (curr = pool->buckets[i]; curr; curr = next) {
+            next = curr->next;
+            free(curr);
+        }
+
+    free(pool->buckets);
+    free(pool);
+}
+
+/**
+ * @brief Zmienia liczbę kubełków puli na @p count.
+ * Jeśli nie uda się alokować pamięci, to pozostawia pulę bez zmian; pula
+ * działa wtedy poprawnie, choć wolniej.
+ * @param[in,out] pool - wskaźnik na pulę.
+ * @param[in] count - nowa liczba kubełków, będąca potęgą dwójki.
+ */
+static void poolRehash(StringPool *pool, size_t count) {
+    PoolEntry **buckets = calloc(count, sizeof(PoolEntry *));
+    if (!buckets) return;
+
+    PoolEntry *curr, *next;
+    for (size_t i = 0; i < pool->bucketCount; i++)
+        for (curr = pool->buckets[i]; curr; curr = next) {
+            next = curr->next;
+            curr->next = buckets[curr->hash & (count - 1)];
+            buckets[curr->hash & (count - 1)] = curr;
+        }
+
+    free(pool->buckets);
+    pool->buckets = buckets;
+    pool->bucketCount = count;
+}
+
+uint8_t const *poolIntern(StringPool *pool, uint8_t const *num) {
+    if (!pool || !num) return NULL;
+
+    size_t size = packedSize(packedLength(num));
+    uint32_t hash = hashBytes(num, size);
+    PoolEntry **bucket = &pool->buckets[hash & (pool->bucketCount - 1)];
+
+    for (PoolEntry *curr = *bucket; curr; curr = curr->next)
+        if (curr->hash == hash && memcmp(curr->num, num, size) == 0) {
+            curr->references++;
+            pool->stats.references++;
+            pool->stats.savedBytes += size;
+            return curr->num;
+        }
+
+    PoolEntry *entry = malloc(sizeof(PoolEntry) + size);
+    if (!entry) return NULL;
+
+    memcpy(entry->num, num, size);
+    entry->hash = hash;
+    entry->references = 1;
+    entry->next = *bucket;
+    *bucket = entry;
+
+    pool->stats.strings++;
+    pool->stats.references++;
+    pool->stats.bytes += size;
+
+    if (pool->stats.strings > pool->bucketCount)
+        poolRehash(pool, 2 * pool->bucketCount);
+    return entry->num;
+}
+
+uint8_t const *poolInternStr(StringPool *pool, char const *str,
+                             size_t length) {
+    if (!pool || !str) return NULL;
+
+    uint8_t buffer[STACK_BUFFER];
+    size_t size = packedSize(length);
+    uint8_t *packed = size <= STACK_BUFFER ? buffer : malloc(size);
+    if (!packed) return NULL;
+
+    numPack(packed, str, length);
+    uint8_t const *interned = poolIntern(pool, packed);
+    if (packed != buffer) free(packed);
+    return interned;
+}
+
+void poolReserve(StringPool *pool, size_t count) {
+    if (!pool) return;
+
+    size_t needed = pool->stats.strings + count, buckets = pool->bucketCount;
+    while (buckets < needed && buckets <= SIZE_MAX / 2 / sizeof(PoolEntry *))
+        buckets <<= 1;
+    if (buckets > pool->bucketCount) poolRehash(pool, buckets);
+}
+
+void poolRelease(StringPool *pool, uint8_t const *num) {
+    if (!pool || !num) return;
+
+    PoolEntry *entry = entryOf(num);
+    size_t size = packedSize(packedLength(num));
+    pool->stats.references--;
+
+    if (--entry->references > 0) {
+        pool->stats.savedBytes -= size;
+        return;
+    }
+
+    PoolEntry **prev = &pool->buckets[entry->hash & (pool->bucketCount - 1)];
+    while (*prev != entry)
+        prev = &(*prev)->next;
+    *prev = entry->next;
+
+    pool->stats.strings--;
+    pool->stats.bytes -= size;
+    free(entry);
+}
+
+void poolGetStats(StringPool const *pool, PoolStats *stats) {
+    if (!pool || !stats) return;
+    *stats = pool->stats;
+}
@@ -0,0 +1,96 @@
+/** @file
+ * Interfejs klasy obsługującej pulę współdzielonych upakowanych numerów
+ * (zobacz @ref packed.h).
+ *
+ * Pula przechowuje każdy numer dokładnie raz, niezależnie od tego, ile
+ * razy został do niej wstawiony. Każdy przechowywany numer ma licznik odwołań;
+ * numer jest zwalniany, gdy jego licznik spadnie do zera. Pula jest wspólna
+ * dla obu drzew struktury @ref PhoneForward, więc ten sam numer występujący
+ * jako przekierowanie wielu prefiksów oraz jako prefiks przechowywany w
+ * zbiorze zajmuje pamięć tylko raz.
+ *
+ * @author Adam Greloch <ag438473@students.mimuw.edu.pl>
+ * @copyright Uniwersytet Warszawski
+ * @date 2022
+ */
+
+#ifndef __STRING_POOL_H__
+#define __STRING_POOL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include "structs.h"
+
+/**
+ * Statystyki pamięci puli.
+ */
+typedef struct PoolStats {
+    size_t strings; /**< Liczba różnych przechowywanych numerów. */
+    size_t references; /**< Łączna liczba odwołań do przechowywanych numerów. */
+    size_t bytes; /**< Liczba bajtów zajmowanych przez przechowywane upakowane
+                       numery wraz z ich nagłówkami. */
+    size_t savedBytes; /**< Liczba bajtów, które zajęłyby dodatkowe kopie
+                            numerów, gdyby każde odwołanie miało własną. */
+} PoolStats;
+
+/** @brief Tworzy nową pustą pulę.
+ * Powstała pula musi być zwolniona za pomocą funkcji poolDelete().
+ * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
+ * alokować pamięci.
+ */
+StringPool *poolNew(void);
+
+/** @brief Usuwa pulę.
+ * Zwalnia wszystkie przechowywane ciągi, niezależnie od ich liczników
+ * odwołań. Nic nie robi, jeśli @p pool ma wartość NULL.
+ * @param[in,out] pool - wskaźnik na usuwaną pulę.
+ */
+void poolDelete(StringPool *pool);
+
+/** @brief Zwraca współdzieloną kopię upakowanego numeru @p num.
+ * Jeśli pula zawiera już numer równy @p num, to zwiększa jego licznik odwołań
+ * i zwraca go. W przeciwnym razie wstawia do puli kopię @p num o liczniku
+ * odwołań równym jeden. Każde udane wywołanie musi zostać zrównoważone
+ * wywołaniem poolRelease() dla zwróconego numeru.
+ * @param[in,out] pool - wskaźnik na pulę.
+ * @param[in] num - wskaźnik na upakowany numer.
+ * @return Wskaźnik na numer przechowywany w puli lub NULL, gdy nie udało się
+ * alokować pamięci.
+ */
+uint8_t const *poolIntern(StringPool *pool, uint8_t const *num);
+
+/** @brief Pakuje ciąg @p str i zwraca współdzieloną kopię wyniku.
+ * Działa jak poolIntern() dla upakowanego @p str.
+ * @param[in,out] pool - wskaźnik na pulę.
+ * @param[in] str - wskaźnik na poprawny ciąg znaków w kodowaniu wewnętrznym.
+ * @param[in] length - długość @p str.
+ * @return Wskaźnik na numer przechowywany w puli lub NULL, gdy nie udało się
+ * alokować pamięci.
+ */
+uint8_t const *poolInternStr(StringPool *pool, char const *str,
+                             size_t length);
+
+/** @brief Przygotowuje pulę na wstawienie @p count nowych numerów.
+ * Powiększa z góry tablicę kubełków, by wstawianie numerów nie powiększało
+ * jej wielokrotnie. Jeśli nie uda się alokować pamięci, to pozostawia pulę
+ * bez zmian; pula działa wtedy poprawnie, choć wolniej.
+ * @param[in,out] pool - wskaźnik na pulę.
+ * @param[in] count - liczba numerów, które zostaną wstawione.
+ */
+void poolReserve(StringPool *pool, size_t count);
+
+/** @brief Zwalnia odwołanie do numeru @p num.
+ * Zmniejsza licznik odwołań numeru, a jeśli spadnie on do zera, to usuwa
+ * numer z puli. Nic nie robi, jeśli @p pool lub @p num ma wartość NULL.
+ * @param[in,out] pool - wskaźnik na pulę.
+ * @param[in] num - wskaźnik na numer zwrócony wcześniej przez poolIntern().
+ */
+void poolRelease(StringPool *pool, uint8_t const *num);
+
+/** @brief Wypełnia @p stats statystykami pamięci puli @p pool.
+ * @param[in] pool - wskaźnik na pulę.
+ * @param[out] stats - wskaźnik na wypełniane statystyki.
+ */
+void poolGetStats(StringPool const *pool, PoolStats *stats);
+
+#endif /* __STRING_POOL_H__ */
@@ -9,16 +9,24 @@
 #ifndef __STRUCTS_H__
 #define __STRUCTS_H__
 
-struct ListNode;
+struct SortedSet;
 
-typedef struct ListNode ListNode; /**< @struct ListNode */
-
-struct List;
-
-typedef struct List List; /**< @struct List */
+typedef struct SortedSet SortedSet; /**< @struct SortedSet */
 
 struct TrieNode;
 
 typedef struct TrieNode TrieNode; /**< @struct TrieNode */
 
+struct TrieArena;
+
+typedef struct TrieArena TrieArena; /**< @struct TrieArena */
+
+struct StringPool;
+
+typedef struct StringPool StringPool; /**< @struct StringPool */
+
+struct LpmIndex;
+
+typedef struct LpmIndex LpmIndex; /**< @struct LpmIndex */
+
 #endif /* __STRUCTS_H__ */
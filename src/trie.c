@@ -4,261 +4,2539 @@
  * wzajemnie zależnych drzew. Klasa implementuje strukturę @p TrieNode
  * zadeklarowaną w interfejsie @ref structs.h.
  *
+ * Węzły przechowują dzieci w postaci zwartej: 12-bitowa maska wskazuje, które
+ * dzieci istnieją, zaś indeksy istniejących dzieci leżą kolejno w tablicy,
+ * w której pozycję dziecka wyznacza liczba zapalonych bitów maski na lewo od
+ * niego. Pierwsze @ref INLINE_CHILDREN pozycji tej tablicy mieści się
+ * w samym węźle, który zajmuje dokładnie jedną linię pamięci podręcznej.
+ * Pozostałe pozycje przechowywane są w osobnym bloku.
+ *
+ * Drzewa są skompresowane: krawędź prowadząca do węzła jest etykietowana
+ * ciągiem do @ref LABEL_DIGITS znaków, a nie pojedynczym znakiem. Węzeł bez
+ * wartości, mający jedno dziecko, jest scalany z tym dzieckiem, o ile ich
+ * łączna etykieta się mieści. Dzięki temu długi prefiks bez rozgałęzień zajmuje
+ * jeden węzeł zamiast węzła na każdy znak. Wstawianie ciągu rozbijającego
+ * etykietę dzieli węzeł na dwa.
+ *
  * @author Adam Greloch <ag438473@students.mimuw.edu.pl>
  * @copyright Uniwersytet Warszawski
  * @date 2022
  */
 
+#include <stdlib.h>
 #include <string.h>
 #include "trie.h"
-#include "linked_list.h"
+#include "sorted_set.h"
 #include "alphabet.h"
+#include "string_pool.h"
+#include "packed.h"
+#include "lpm.h"
+
+#define INLINE_CHILDREN 6 /**< Liczba dzieci przechowywanych w węźle. */
+#define OVERFLOW_CHILDREN (ALLNUM - INLINE_CHILDREN) /**< Liczba dzieci
+                                                          przechowywanych
+                                                          w bloku nadmiarowym. */
+#define LABEL_DIGITS 16 /**< Maksymalna długość etykiety węzła. */
+#define BATCH_WIDTH 16 /**< Liczba wyszukiwań przeplatanych jednocześnie
+                            przez trieFindSeqBatch(). */
+#ifndef JUMP_DEPTH
+#define JUMP_DEPTH 3 /**< Długość głów ciągów indeksujących tablicę skoków
+                          drzewa przechowującego ciągi. Można ją ustawić przy
+                          kompilacji na wartość od 2 do 4. */
+#endif
+#if JUMP_DEPTH < 2 || JUMP_DEPTH > 4
+#error "JUMP_DEPTH must be between 2 and 4"
+#endif
+
+/**
+ * Liczba zapalonych bitów każdej 6-bitowej wartości. Dwa odczyty z tej tablicy
+ * wyznaczają pozycję dziecka szybciej niż @p __builtin_popcount, które bez
+ * instrukcji @p popcnt w docelowej architekturze kompiluje się do wywołania
+ * funkcji bibliotecznej.
+ */
+static const uint8_t bitsSet[64] = {
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+    1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
+    1, 2, 2, 3, 2, 3, 3, 4, 2, 3, 3, 4, 3, 4, 4, 5,
+    2, 3, 3, 4, 3, 4, 4, 5, 3, 4, 4, 5, 4, 5, 5, 6
+};
+
+/**
+ * @brief Zlicza zapalone bity 12-bitowej maski.
+ * @param x - maska.
+ * @return Liczba zapalonych bitów.
+ */
+static inline unsigned popcount12(unsigned x) {
+    return bitsSet[x & 63] + bitsSet[(x >> 6) & 63];
+}
 
 /**
- * Struktura przechowująca węzeł drzewa trie.
+ * Struktura przechowująca węzeł drzewa trie. Zajmuje 64 bajty.
  */
 struct TrieNode {
-    struct TrieNode *parent; /**< Wskaźnik na rodzica węzła. */
-    struct TrieNode *children[ALLNUM]; /**< Tablica wskaźników na dzieci węzła. */
-    size_t count; /**< Liczba dzieci węzła. */
+    uint32_t parent; /**< Indeks rodzica węzła lub @ref ARENA_NULL. */
+    uint32_t self; /**< Indeks tego węzła. */
+    uint16_t bitmap; /**< Maska istniejących dzieci. Bit @p i jest zapalony,
+                          jeśli istnieje dziecko dla znaku o wartości @p i. */
+    uint8_t labelLength : 5; /**< Długość etykiety węzła. Zerowa tylko dla
+                                  korzenia. */
+    bool hasList : 1; /**< Wartość @p true, jeśli węzeł zawiera zbiór
+                           prefiksów w @p value, wartość @p false, jeśli
+                           zawiera poprawny ciąg znaków. */
+    bool indexed : 1; /**< Wartość @p true, jeśli ciąg przekierowanego węzła
+                           drzewa ciągów dodano do indeksu najdłuższych
+                           prefiksów (zobacz indexAdd()). */
+    uint32_t overflow; /**< Indeks bloku z dziećmi na pozycjach od
+                            @ref INLINE_CHILDREN wzwyż lub @ref ARENA_NULL. */
+    uint32_t children[INLINE_CHILDREN]; /**< Indeksy dzieci na pierwszych
+                                             pozycjach zwartej tablicy. */
+    uint64_t label; /**< Etykieta krawędzi od rodzica do tego węzła. Wartość
+                         @p i-tego znaku etykiety zajmuje bity od @p 4i do
+                         @p 4i+3. */
 
     /**
      * Wartość węzła, która, jeśli niepusta (ma wartość inną niż NULL), to jest
-     * poprawnym ciągiem znaków lub listą poprawnych ciągów znaków.
+     * poprawnym ciągiem znaków lub zbiorem poprawnych ciągów znaków.
      */
     union {
-        char *seq; /**< Poprawny ciąg znaków. */
-        List *list; /**< Wskaźnik na listę poprawnych ciągów znaków. */
+        uint8_t const *seq; /**< Upakowany numer w puli. */
+        SortedSet *sources; /**< Wskaźnik na uporządkowany zbiór upakowanych
+                                 numerów w puli. */
     } value;
 
-    bool hasList; /**< Wartość @p true, jeśli węzeł zawiera listę w @p value,
-                       wartość @p false, jeśli zawiera poprawny ciąg znaków. */
-    int lastVisited; /**< Ostatnio odwiedzony przez trieDelete() numer
-                          dziecka. Resetowany do @p -1 przy zmianie
-                          struktury poddrzew. */
-    ListNode *bound; /**< Wskaźnik na element listy, znajdujący
-                          się w @p list pewnego węzła, zawierający ciąg
-                          znaków, który reprezentuje ten węzeł. */
-    TrieNode **pointedBy; /**< Wskaźnik na wskaźnik na ten węzeł,
-                               znajdujący się w tablicy rodzica. Przy usuwaniu
-                               węzła służy do ustawiania ewaluowanego
-                               wskaźnika na NULL, co zapobiega dostępowi do
-                               zwolnionej pamięci przy przeszukiwaniu tablicy
-                               dzieci rodzica. */
+    /**
+     * Skojarzenie węzła z drugim drzewem, zależne od typu drzewa.
+     */
+    union {
+        uint8_t const *bound; /**< Numer w puli, który reprezentuje ten węzeł,
+                                   umieszczony w zbiorze @p sources węzła
+                                   drzewa odwrotnego wskazywanego przez
+                                   @p seq, lub NULL. */
+        SortedSet *shadowed; /**< Podzbiór @p sources złożony z prefiksów
+                                  przysłoniętych (zobacz
+                                  trieGetShadowed()). */
+    };
 };
 
-TrieNode *trieNodeNew(TrieNode *parent, bool hasList, TrieNode **pointedBy) {
-    TrieNode *node = malloc(sizeof(TrieNode));
-    if (!node) return NULL;
+/**
+ * Element tablicy skoków opisujący przejście po drzewie wzdłuż głowy ciągu,
+ * czyli jego początkowych @ref JUMP_DEPTH znaków.
+ */
+typedef struct JumpEntry {
+    uint32_t node; /**< Indeks najgłębszego węzła, którego ciąg jest
+                        prefiksem głowy. */
+    uint32_t best; /**< Indeks najgłębszego takiego węzła o niepustej
+                        wartości lub @ref ARENA_NULL. */
+    uint8_t depth; /**< Długość ciągu węzła @p node. */
+    uint8_t bestLength; /**< Długość ciągu węzła @p best. */
+} JumpEntry;
 
-    node->parent = parent;
-    for (int idx = 0; idx < ALLNUM; idx++)
-        node->children[idx] = NULL;
-    node->count = 0;
-    node->lastVisited = -1;
+/**
+ * Poddrzewo drzewa ciągów odłączone przez trieRemoveStr(), którego węzły
+ * zwalnia trieSweep().
+ */
+typedef struct Detached {
+    TrieNode *root; /**< Korzeń poddrzewa. */
+    uint8_t const *prefix; /**< Usunięty ciąg z puli; wszystkie ciągi
+                                poddrzewa zaczynają się od niego. */
+    size_t length; /**< Długość ciągu korzenia. */
+    uint8_t const *cover; /**< Ciąg zbioru @p detached, który zwolnienie
+                               poddrzewa usuwa ze zbioru, lub NULL. Jeśli
+                               różni się od @p prefix, to poddrzewo ma
+                               własne odwołanie do niego. */
+} Detached;
 
-    node->value.seq = NULL;
-    node->hasList = hasList;
+/**
+ * Skojarzenie zwolnionego węzła drzewa ciągów z węzłem drzewa odwrotnego,
+ * którego usunięcie zostało odłożone (zobacz unboundFlush()).
+ */
+typedef struct Unbound {
+    uint8_t const *seq; /**< Wartość zwolnionego węzła, wskazująca węzeł
+                             drzewa odwrotnego. */
+    uint8_t const *bound; /**< Ciąg zwolnionego węzła w zbiorze węzła drzewa
+                               odwrotnego. */
+} Unbound;
 
-    node->bound = NULL;
-    node->pointedBy = pointedBy;
+/**
+ * Struktura przechowująca areny, z których przydzielane są węzły oraz
+ * bloki nadmiarowe, wraz z pulą ciągów znaków przechowywanych w węzłach.
+ */
+struct TrieArena {
+    Arena *nodes; /**< Arena węzłów. */
+    Arena *overflow; /**< Arena bloków nadmiarowych. */
+    StringPool *pool; /**< Pula ciągów znaków obu drzew. */
+    TrieNode *revs; /**< Korzeń drzewa przechowującego zbiory lub NULL. */
+    TrieNode *fwds; /**< Korzeń drzewa przechowującego ciągi lub NULL. */
+    JumpEntry *jump; /**< Tablica skoków drzewa przechowującego ciągi,
+                          indeksowana głowami ciągów jako liczbami
+                          w systemie o podstawie @ref ALLNUM. */
+    uint32_t *generations; /**< Liczniki zmian przekierowań, po jednym na
+                                każdy ciąg nie dłuższy od głów, kolejno
+                                według długości (zobacz
+                                generationIndex()). */
+    LpmIndex *lpm; /**< Indeks najdłuższych prefiksów drzewa
+                        przechowującego ciągi. */
+    size_t oversized; /**< Liczba przekierowanych prefiksów dłuższych niż
+                           @ref LPM_MAX_LENGTH, które uniemożliwiają
+                           odbudowę porzuconego indeksu. */
+    size_t lengths[LPM_MAX_LENGTH + 1]; /**< Liczby przekierowanych
+                                             prefiksów kolejnych długości,
+                                             dla których odbudowa tworzy
+                                             tablice indeksu. */
+    uint8_t const *indexCursor; /**< Ciąg z puli ostatniego węzła
+                                     przejrzanego przez odbudowę indeksu
+                                     lub NULL (zobacz indexRebuild()). */
+    bool shadowedValid; /**< Czy zbiory @p shadowed drzewa odwrotnego są
+                             aktualne. */
+    bool shadowedLoading; /**< Czy trwa przegląd odbudowujący porzucone
+                               zbiory @p shadowed (zobacz
+                               shadowedRebuild()). */
+    uint8_t const *shadowedCursor; /**< Ciąg z puli ostatniego węzła
+                                        przejrzanego przez odbudowę zbiorów
+                                        @p shadowed lub NULL. */
+    Detached *sweep; /**< Kolejka odłączonych poddrzew drzewa ciągów
+                          czekających na zwolnienie. */
+    size_t sweepFirst; /**< Indeks pierwszego poddrzewa kolejki. */
+    size_t sweepCount; /**< Indeks za ostatnim poddrzewem kolejki. */
+    size_t sweepSize; /**< Pojemność tablicy @p sweep. */
+    SortedSet *detached; /**< Ciągi korzeni odłączonych poddrzew, które nie
+                              leżą w innym odłączonym poddrzewie. */
+    size_t *sweepSorted; /**< Indeksy poddrzew kolejki uporządkowane według
+                              ich ciągów, a poddrzewa o równych ciągach
+                              według kolejności odłączenia. */
+    SortedSet *revived; /**< Ciągi z puli, które przypisano ponownie, choć
+                             leżą w odłączonym poddrzewie (zobacz
+                             trieSettle()). */
+    SortedSet *deferred; /**< Ciągi z puli przekierowanych węzłów, których
+                              dodanie do indeksu czeka na zwolnienie
+                              odłączonych poddrzew (zobacz indexAdd()). */
+    Unbound *unbound; /**< Odłożone skojarzenia zwolnionych węzłów. */
+    uint8_t const **unboundNums; /**< Miejsce na ciągi usuwane z jednego
+                                      zbioru. */
+    size_t unboundCount; /**< Liczba odłożonych skojarzeń. */
+    size_t unboundSize; /**< Pojemność tablic @p unbound
+                             i @p unboundNums. */
+};
 
-    return node;
+/**
+ * @brief Zwraca wskaźnik na węzeł o indeksie @p idx.
+ * Odpowiada arenaGet(), lecz korzysta ze stałego rozmiaru węzła.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param idx - indeks węzła.
+ * @return Wskaźnik na węzeł lub NULL, jeśli @p idx ma wartość
+ * @ref ARENA_NULL.
+ */
+static inline TrieNode *nodeAt(TrieArena const *arena, uint32_t idx) {
+    if (idx == ARENA_NULL) return NULL;
+    return (TrieNode *) arena->nodes->slabs[idx >> ARENA_SLAB_SHIFT] +
+           (idx & ((1u << ARENA_SLAB_SHIFT) - 1));
 }
 
 /**
- * @brief Zwalnia węzeł @p node. Jeśli z wierzchołkiem skojarzony jest
- * pewien element listy w innym drzewie, to zostaje on usunięty.
- * @param node - wskaźnik na węzeł drzewa.
+ * @brief Zwraca wartość @p i-tego znaku etykiety węzła @p node.
+ * @param node - wskaźnik na węzeł.
+ * @param i - pozycja znaku w etykiecie.
+ * @return Wartość znaku.
  */
-static void freeTrieNode(TrieNode *node) {
-    if (node->hasList) {
-        listDelete(node->value.list);
-        node->value.list = NULL;
+static inline int labelDigit(TrieNode const *node, unsigned i) {
+    return (int) ((node->label >> (4 * i)) & 15u);
+}
+
+/**
+ * @brief Wczytuje etykietę z początkowych znaków ciągu @p str.
+ * Wczytuje co najwyżej @ref LABEL_DIGITS znaków. Zakłada poprawność @p str.
+ * @param str - ciąg znaków.
+ * @param label - wskaźnik na zmienną, w której zostanie zapisana etykieta.
+ * @return Długość wczytanej etykiety.
+ */
+static unsigned readLabel(const char *str, uint64_t *label) {
+    unsigned length = 0;
+    *label = 0;
+    while (length < LABEL_DIGITS && str[length] != '\0') {
+        *label |= (uint64_t) symbolValue(str[length]) << (4 * length);
+        length++;
     }
-    else {
-        listNodeRemoveAndCut(node->bound);
-        free(node->value.seq);
+    return length;
+}
+
+/**
+ * @brief Zlicza, ile początkowych znaków etykiety węzła @p node zgadza się
+ * z początkowymi znakami ciągu @p str.
+ * @param node - wskaźnik na węzeł.
+ * @param str - poprawny ciąg znaków.
+ * @return Długość najdłuższego wspólnego prefiksu etykiety i @p str.
+ */
+static inline unsigned labelMatch(TrieNode const *node, const char *str) {
+    unsigned i = 0;
+    while (i < node->labelLength && str[i] != '\0' &&
+           symbolValue(str[i]) == labelDigit(node, i))
+        i++;
+    return i;
+}
+
+/**
+ * @brief Zwraca wskaźnik na pozycję @p pos zwartej tablicy dzieci węzła
+ * @p node. Zakłada, że pozycja ta jest zaalokowana.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param node - wskaźnik na węzeł.
+ * @param pos - pozycja w tablicy.
+ * @return Wskaźnik na indeks dziecka.
+ */
+static inline uint32_t *childSlot(TrieArena const *arena, TrieNode *node,
+                                  unsigned pos) {
+    if (pos < INLINE_CHILDREN) return &node->children[pos];
+    uint32_t *block = arenaGet(arena->overflow, node->overflow);
+    return &block[pos - INLINE_CHILDREN];
+}
+
+/**
+ * @brief Zwraca dziecko węzła @p node dla znaku o wartości @p digit.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param node - wskaźnik na węzeł.
+ * @param digit - wartość znaku.
+ * @return Wskaźnik na dziecko lub NULL, jeśli takie dziecko nie istnieje.
+ */
+static inline TrieNode *childAt(TrieArena const *arena, TrieNode *node,
+                                int digit) {
+    unsigned bit = 1u << digit;
+    if (!(node->bitmap & bit)) return NULL;
+    return nodeAt(arena, *childSlot(arena, node,
+                                    popcount12(node->bitmap & (bit - 1u))));
+}
+
+/**
+ * @brief Zwraca liczbę elementów tablicy skoków o głowach zaczynających się
+ * od tych samych @p common znaków.
+ * @param common - liczba wspólnych znaków, nie większa od @ref JUMP_DEPTH.
+ * @return Potęga @ref ALLNUM o wykładniku @ref JUMP_DEPTH - @p common.
+ */
+static inline size_t jumpSpan(unsigned common) {
+    size_t span = 1;
+    for (unsigned i = common; i < JUMP_DEPTH; i++)
+        span *= ALLNUM;
+    return span;
+}
+
+/**
+ * @brief Wyznacza indeks licznika zmian ciągu złożonego z @p length
+ * początkowych znaków @p str.
+ * Liczniki ciągów tej samej długości leżą obok siebie, uporządkowane
+ * według ciągów, a przed nimi leżą liczniki wszystkich ciągów krótszych.
+ * @param str - poprawny ciąg znaków o długości co najmniej @p length.
+ * @param length - długość ciągu, nie większa od @ref JUMP_DEPTH.
+ * @return Indeks licznika.
+ */
+static inline size_t generationIndex(const char *str, size_t length) {
+    size_t offset = 0, span = 1, value = 0;
+    for (size_t i = 0; i < length; i++) {
+        offset += span;
+        span *= ALLNUM;
+        value = value * ALLNUM + (size_t) symbolValue(str[i]);
     }
+    return offset + value;
+}
 
-    free(node);
+/**
+ * @brief Wyznacza indeks elementu tablicy skoków dla głowy ciągu @p str.
+ * @param str - poprawny ciąg znaków.
+ * @param idx - wskaźnik na zmienną, w której zostanie zapisany indeks.
+ * @return Wartość @p true, jeśli @p str ma co najmniej @ref JUMP_DEPTH
+ * znaków. Wartość @p false w przeciwnym wypadku.
+ */
+static inline bool jumpIndex(const char *str, size_t *idx) {
+    size_t value = 0;
+    for (unsigned i = 0; i < JUMP_DEPTH; i++) {
+        if (str[i] == '\0') return false;
+        value = value * ALLNUM + (size_t) symbolValue(str[i]);
+    }
+    *idx = value;
+    return true;
 }
 
-void trieDelete(TrieNode *node) {
-    if (!node) return;
+/**
+ * @brief Wyznacza element tablicy skoków o indeksie @p idx, przechodząc po
+ * drzewie przechowującym ciągi wzdłuż jego głowy.
+ * @param arena - wskaźnik na arenę drzew z niepustym drzewem ciągów.
+ * @param idx - indeks elementu.
+ */
+static void jumpFill(TrieArena *arena, size_t idx) {
+    int head[JUMP_DEPTH];
+    size_t rest = idx;
+    for (unsigned i = JUMP_DEPTH; i-- > 0; rest /= ALLNUM)
+        head[i] = (int) (rest % ALLNUM);
 
-    int idx;
-    TrieNode *toFree;
-    TrieNode *curr = node;
-
-    while (curr)
-        if (curr->count == 0) {
-            /* Jeśli napotkany węzeł nie ma dzieci, to zwalniamy go. */
-            if (curr == node) {
-                freeTrieNode(curr);
-                curr = NULL;
-            }
-            else {
-                toFree = curr;
-                curr = curr->parent;
-                /* Przekazany do zwolnienia curr był dzieckiem nowego curr.
-                 * Musimy więc usunąć skojarzenie między nimi. */
-                curr->children[curr->lastVisited] = NULL;
-                curr->count--;
-                freeTrieNode(toFree);
-            }
-        }
-        else {
-            /* W przeciwnym razie szukamy węzłów bez dzieci do usunięcia. */
-            idx = curr->lastVisited + 1;
-            if (curr->children[idx]) {
-                curr->lastVisited = idx;
-                curr = curr->children[idx];
-            }
-            else
-                curr->lastVisited++;
+    TrieNode *node = arena->fwds, *best = NULL, *child;
+    unsigned depth = 0, bestLength = 0, k;
+    while (depth < JUMP_DEPTH &&
+           (child = childAt(arena, node, head[depth])) &&
+           depth + child->labelLength <= JUMP_DEPTH) {
+        for (k = 1; k < child->labelLength; k++)
+            if (labelDigit(child, k) != head[depth + k]) break;
+        if (k < child->labelLength) break;
+
+        depth += child->labelLength;
+        node = child;
+        if (node->value.seq) {
+            best = node;
+            bestLength = depth;
         }
+    }
+
+    JumpEntry *jump = &arena->jump[idx];
+    jump->node = node->self;
+    jump->best = best ? best->self : ARENA_NULL;
+    jump->depth = (uint8_t) depth;
+    jump->bestLength = (uint8_t) bestLength;
 }
 
-ListNode *trieAddToList(TrieNode *node, const char *value, size_t length) {
-    if (!node->hasList) return NULL;
+/**
+ * @brief Wyznacza ponownie elementy tablicy skoków o głowach zaczynających
+ * się od @p common znaków @p head.
+ * Nic nie robi, jeśli @p common jest większe od @ref JUMP_DEPTH, gdyż
+ * zmiany poniżej głów nie dotyczą tablicy.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param head - wartości początkowych znaków głów.
+ * @param common - liczba wspólnych znaków.
+ */
+static void jumpRefresh(TrieArena *arena, int const *head, size_t common) {
+    if (!arena->fwds || common > JUMP_DEPTH) return;
+
+    size_t base = 0;
+    for (size_t i = 0; i < common; i++)
+        base = base * ALLNUM + (size_t) head[i];
+    size_t span = jumpSpan((unsigned) common);
+    base *= span;
 
-    if (!node->value.list) {
-        if (!(node->value.list = listInit(value, length, node))) return NULL;
-        else return listNodeHead(node->value.list);
+    for (size_t i = 0; i < span; i++)
+        jumpFill(arena, base + i);
+}
+
+/**
+ * @brief Wyznacza wartości początkowych znaków ciągu węzła @p node.
+ * Wszystkie głowy, których przejście prowadzi przez krawędź od rodzica do
+ * @p node, zaczynają się od zwróconej liczby znaków @p head.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param node - wskaźnik na węzeł.
+ * @param head - tablica, w której zostanie zapisanych co najwyżej
+ *               @ref JUMP_DEPTH początkowych znaków ciągu węzła.
+ * @param depth - wskaźnik na zmienną, w której zostanie zapisana długość
+ *                ciągu węzła.
+ * @return Długość ciągu rodzica @p node powiększona o jeden lub zero dla
+ * korzenia.
+ */
+static size_t edgeHead(TrieArena const *arena, TrieNode *node, int *head,
+                       size_t *depth) {
+    /* Wystarczy zapamiętać najpłytsze węzły ścieżki, gdyż każdy z nich
+     * dokłada do ciągu co najmniej jeden znak. */
+    TrieNode *top[JUMP_DEPTH];
+    size_t visited = 0;
+    *depth = 0;
+    for (TrieNode *curr = node; curr->parent != ARENA_NULL;
+         curr = nodeAt(arena, curr->parent)) {
+        top[visited++ % JUMP_DEPTH] = curr;
+        *depth += curr->labelLength;
     }
+    if (visited == 0) return 0;
 
-    return listAdd(node->value.list, value, length);
+    unsigned filled = 0;
+    for (size_t i = 0; i < visited && filled < JUMP_DEPTH; i++) {
+        TrieNode *curr = top[(visited - 1 - i) % JUMP_DEPTH];
+        for (unsigned k = 0; k < curr->labelLength && filled < JUMP_DEPTH; k++)
+            head[filled++] = labelDigit(curr, k);
+    }
+    return *depth - node->labelLength + 1;
 }
 
-bool trieNodeBind(TrieNode *trieNode, ListNode *listNode) {
-    if (!listNode || !trieNode || trieNode->hasList) return false;
-    listNodeRemove(trieNode->bound);
-    trieNode->bound = listNode;
-    return true;
+/**
+ * @brief Wyznacza ponownie elementy tablicy skoków, których przejście
+ * prowadzi przez krawędź od rodzica do węzła @p node drzewa ciągów.
+ * Nic nie robi, jeśli ciąg węzła jest dłuższy od głów, gdyż węzeł nie
+ * występuje wówczas w tablicy.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param node - wskaźnik na węzeł.
+ */
+static void jumpRefreshEdge(TrieArena *arena, TrieNode *node) {
+    if (node->hasList) return;
+
+    int head[JUMP_DEPTH];
+    size_t depth, common = edgeHead(arena, node, head, &depth);
+    if (depth <= JUMP_DEPTH) jumpRefresh(arena, head, common);
 }
 
-bool trieNodeSetSeq(TrieNode *node, const char *seq, size_t length) {
-    if (!node) return false;
+/**
+ * @brief Wyznacza ponownie elementy tablicy skoków o głowach zaczynających
+ * się od @p common początkowych znaków ciągu @p str.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param str - poprawny ciąg znaków o długości co najmniej @p common.
+ * @param common - liczba wspólnych znaków, nie większa od @ref JUMP_DEPTH.
+ */
+static void jumpRefreshStr(TrieArena *arena, const char *str, size_t common) {
+    int head[JUMP_DEPTH];
+    for (size_t i = 0; i < common; i++)
+        head[i] = symbolValue(str[i]);
+    jumpRefresh(arena, head, common);
+}
 
-    node->value.seq = realloc(node->value.seq, (length + 1) * sizeof(char));
-    if (!node->value.seq) return false;
+/**
+ * @brief Odnotowuje zmianę przekierowania prefiksu @p str.
+ * Zwiększa jeden licznik zmian: licznik ciągu @p str, jeśli jest krótszy od
+ * głów, lub licznik jego głowy w przeciwnym przypadku.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param str - poprawny ciąg znaków.
+ * @param length - długość @p str.
+ */
+static void generationTouch(TrieArena *arena, const char *str,
+                            size_t length) {
+    size_t common = length < JUMP_DEPTH ? length : JUMP_DEPTH;
+    arena->generations[generationIndex(str, common)]++;
+}
 
-    strcpy(node->value.seq, seq);
+/**
+ * @brief Zastępuje istniejące dziecko węzła @p node dla znaku o wartości
+ * @p digit węzłem o indeksie @p child. Nie alokuje pamięci.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param node - wskaźnik na węzeł.
+ * @param digit - wartość znaku.
+ * @param child - indeks nowego dziecka.
+ */
+static void replaceChild(TrieArena *arena, TrieNode *node, int digit,
+                         uint32_t child) {
+    unsigned bit = 1u << digit;
+    *childSlot(arena, node, popcount12(node->bitmap & (bit - 1u))) = child;
+}
+
+/**
+ * @brief Dołącza węzeł @p child jako dziecko węzła @p node dla znaku
+ * o wartości @p digit. Zakłada, że takie dziecko jeszcze nie istnieje.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param node - wskaźnik na węzeł.
+ * @param digit - wartość znaku.
+ * @param child - indeks dołączanego węzła.
+ * @return Wartość @p true, jeśli udało się dołączyć dziecko. Wartość
+ * @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool linkChild(TrieArena *arena, TrieNode *node, int digit,
+                      uint32_t child) {
+    unsigned bit = 1u << digit;
+    unsigned count = popcount12(node->bitmap);
+    unsigned rank = popcount12(node->bitmap & (bit - 1u));
+
+    if (count == INLINE_CHILDREN) {
+        node->overflow = arenaAlloc(arena->overflow);
+        if (node->overflow == ARENA_NULL) return false;
+    }
+
+    for (unsigned pos = count; pos > rank; pos--)
+        *childSlot(arena, node, pos) = *childSlot(arena, node, pos - 1);
+    *childSlot(arena, node, rank) = child;
+    node->bitmap |= bit;
     return true;
 }
 
-List *trieGetList(TrieNode *node) {
-    if (!node || !node->hasList) return NULL;
-    return node->value.list;
+/**
+ * @brief Odłącza od węzła @p node dziecko dla znaku o wartości @p digit.
+ * Nie alokuje pamięci, zatem zawsze się udaje.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param node - wskaźnik na węzeł.
+ * @param digit - wartość znaku.
+ */
+static void unlinkChild(TrieArena *arena, TrieNode *node, int digit) {
+    unsigned bit = 1u << digit;
+    if (!(node->bitmap & bit)) return;
+
+    unsigned count = popcount12(node->bitmap);
+    unsigned rank = popcount12(node->bitmap & (bit - 1u));
+
+    for (unsigned pos = rank; pos + 1 < count; pos++)
+        *childSlot(arena, node, pos) = *childSlot(arena, node, pos + 1);
+    node->bitmap &= ~bit;
+
+    if (count == INLINE_CHILDREN + 1) {
+        arenaFree(arena->overflow, node->overflow);
+        node->overflow = ARENA_NULL;
+    }
 }
 
-TrieNode *trieGetParent(TrieNode *node) {
-    if (!node) return NULL;
-    return node->parent;
+/**
+ * @brief Zwalnia wartość węzła @p object przy usuwaniu całej areny.
+ * Nie usuwa skojarzeń z węzłami innych drzew, gdyż te również są usuwane.
+ * Węzły zwrócone wcześniej do areny mają pustą wartość, więc są pomijane.
+ * Ciągi znaków zwalnia później pula, usuwana razem z areną.
+ * @param object - wskaźnik na węzeł drzewa.
+ */
+static void trieNodeDestroy(void *object) {
+    TrieNode *node = object;
+    if (node->hasList) {
+        setDelete(node->value.sources);
+        setDelete(node->shadowed);
+    }
 }
 
-const char *trieNodeGetSeq(TrieNode *node) {
-    if (!node) return NULL;
-    return node->value.seq;
+TrieArena *trieArenaNew(void) {
+    TrieArena *arena = malloc(sizeof(TrieArena));
+    if (!arena) return NULL;
+
+    arena->nodes = arenaNew(sizeof(TrieNode));
+    arena->overflow = arenaNew(OVERFLOW_CHILDREN * sizeof(uint32_t));
+    arena->pool = poolNew();
+    arena->revs = NULL;
+    arena->fwds = NULL;
+    arena->jump = calloc(jumpSpan(0), sizeof(JumpEntry));
+    /* Liczników jest tyle, ile ciągów o długości od zera do długości głów. */
+    arena->generations = calloc((jumpSpan(0) * ALLNUM - 1) / (ALLNUM - 1),
+                                sizeof(uint32_t));
+    arena->lpm = lpmNew();
+    arena->oversized = 0;
+    memset(arena->lengths, 0, sizeof(arena->lengths));
+    arena->indexCursor = NULL;
+    arena->shadowedValid = true;
+    arena->shadowedLoading = false;
+    arena->shadowedCursor = NULL;
+    arena->sweep = NULL;
+    arena->sweepFirst = arena->sweepCount = arena->sweepSize = 0;
+    arena->sweepSorted = NULL;
+    arena->detached = NULL;
+    arena->revived = NULL;
+    arena->deferred = NULL;
+    arena->unbound = NULL;
+    arena->unboundNums = NULL;
+    arena->unboundCount = arena->unboundSize = 0;
+
+    if (!arena->nodes || !arena->overflow || !arena->pool || !arena->jump ||
+        !arena->generations || !arena->lpm) {
+        trieArenaDelete(arena);
+        return NULL;
+    }
+    return arena;
 }
 
-TrieNode *trieFindSeq(TrieNode *root, const char *str, size_t *length) {
-    if (!root) return NULL;
-    int idx;
-    TrieNode *lastWithValue = NULL;
+void trieArenaDelete(TrieArena *arena) {
+    if (!arena) return;
+    arenaDelete(arena->nodes, trieNodeDestroy);
+    arenaDelete(arena->overflow, NULL);
+    poolDelete(arena->pool);
+    free(arena->jump);
+    free(arena->generations);
+    lpmDelete(arena->lpm);
+    free(arena->sweep);
+    free(arena->sweepSorted);
+    setDelete(arena->detached);
+    setDelete(arena->revived);
+    setDelete(arena->deferred);
+    free(arena->unbound);
+    free(arena->unboundNums);
+    free(arena);
+}
 
-    *length = 0;
-    size_t distance = 0;
-    bool leaf = false;
-    for (size_t i = 0; !leaf && str[i] != '\0'; i++) {
-        idx = getValue(str[i]);
-        if (!root->children[idx]) leaf = true;
-        else {
-            root = root->children[idx];
-            distance++;
-        }
-        if (root->value.seq) {
-            lastWithValue = root;
-            *length += distance;
-            distance = 0;
+/**
+ * @brief Tworzy nowy węzeł o pustej wartości i rodzicu o indeksie @p parent.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param parent - indeks rodzica lub @ref ARENA_NULL.
+ * @param label - etykieta krawędzi od rodzica do węzła.
+ * @param labelLength - długość etykiety.
+ * @param hasList - wartość wskazująca typ zawartości drzewa.
+ * @return Wskaźnik na utworzony węzeł lub NULL, gdy nie udało się alokować
+ * pamięci.
+ */
+static TrieNode *trieNodeAlloc(TrieArena *arena, uint32_t parent,
+                               uint64_t label, unsigned labelLength,
+                               bool hasList) {
+    uint32_t idx = arenaAlloc(arena->nodes);
+    if (idx == ARENA_NULL) return NULL;
+
+    TrieNode *node = nodeAt(arena, idx);
+    node->parent = parent;
+    node->self = idx;
+    node->bitmap = 0;
+    node->labelLength = labelLength;
+    node->hasList = hasList;
+    node->indexed = false;
+    node->label = label;
+    node->overflow = ARENA_NULL;
+
+    node->value.seq = NULL;
+    node->bound = NULL;
+
+    return node;
+}
+
+TrieNode *trieNodeNew(TrieArena *arena, bool hasList) {
+    TrieNode *root = trieNodeAlloc(arena, ARENA_NULL, 0, 0, hasList);
+    if (root && hasList) arena->revs = root;
+    if (root && !hasList) {
+        arena->fwds = root;
+        /* Liczniki zmian zachowujemy, by nie powtórzyły wcześniejszych
+         * wartości. */
+        for (size_t i = 0; i < jumpSpan(0); i++) {
+            arena->jump[i].node = root->self;
+            arena->jump[i].best = ARENA_NULL;
+            arena->jump[i].depth = 0;
+            arena->jump[i].bestLength = 0;
         }
     }
-    return lastWithValue;
+    return root;
 }
 
-TrieNode *trieInsertStr(TrieNode **rootPtr, const char *str, bool hasList) {
-    if (!(*rootPtr)) *rootPtr = trieNodeNew(NULL, hasList, rootPtr);
-    if (!(*rootPtr)) return NULL;
+/**
+ * @brief Znajduje węzeł kończący upakowany numer @p num w drzewie.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param root - wskaźnik na korzeń przeszukiwanego drzewa.
+ * @param num - wskaźnik na upakowany numer.
+ * @return Wskaźnik na węzeł lub NULL, jeśli numer nie kończy się w żadnym
+ * węźle drzewa.
+ */
+static TrieNode *trieFindPacked(TrieArena const *arena, TrieNode *root,
+                                uint8_t const *num) {
+    size_t length, i = 0;
+    uint8_t const *digits = packedDigits(num, &length);
 
-    int idx;
-    TrieNode *v = *rootPtr;
+    while (root && i < length) {
+        root = childAt(arena, root, packedSymbol(digits, i));
+        for (unsigned k = 0; root && k < root->labelLength; k++, i++)
+            if (i == length || packedSymbol(digits, i) != labelDigit(root, k))
+                root = NULL;
+    }
+    return root;
+}
 
-    for (size_t i = 0; str[i] != '\0'; i++) {
-        idx = getValue(str[i]);
-        if (!v->children[idx]) {
-            v->children[idx] = trieNodeNew(v, hasList, &v->children[idx]);
-            if (!v->children[idx]) return NULL;
-            v->count++;
-            /* Nastąpiła zmiana struktury drzewa, więc resetujemy jeszcze stan
-             * odwiedzenia tego węzła: */
-            v->lastVisited = -1;
-        }
-        v = v->children[idx];
+/**
+ * @brief Usuwa skojarzenie węzła @p node z węzłem drzewa odwrotnego.
+ * Usuwa ciąg reprezentujący @p node ze zbioru węzła wskazywanego przez jego
+ * wartość. Jeśli zbiór stanie się pusty, to usuwa zbędne węzły drzewa
+ * odwrotnego. Nie zmienia wartości @p node.
+ * @param arena - wskaźnik na arenę, z której pochodzą węzły obu drzew.
+ * @param node - wskaźnik na węzeł drzewa typu @p value.seq.
+ */
+static void trieNodeUnbind(TrieArena *arena, TrieNode *node) {
+    if (!node->bound) return;
+
+    TrieNode *rev = trieFindPacked(arena, arena->revs, node->value.seq);
+
+    /* Porzucone zbiory też tracą usuwane ciągi, więc ich odbudowa nie
+     * napotka zwolnionych numerów. */
+    rev->shadowed = setRemove(rev->shadowed, node->bound);
+    rev->value.sources = setRemove(rev->value.sources, node->bound);
+    poolRelease(arena->pool, node->bound);
+    node->bound = NULL;
+
+    if (!rev->value.sources) {
+        setDelete(rev->shadowed);
+        rev->shadowed = NULL;
+        trieCutLeaves(arena, rev);
     }
-    return v;
 }
 
-void trieRemoveStr(TrieNode **rootPtr, const char *str) {
-    if (*rootPtr) {
-        TrieNode *v = *rootPtr;
-        int idx;
-        bool mayExist = true;
-        for (size_t i = 0; mayExist && str[i] != '\0'; i++) {
-            idx = getValue(str[i]);
-            if (!v || !v->children[idx]) mayExist = false;
-            else
-                v = v->children[idx];
-        }
-        if (mayExist) {
-            *v->pointedBy = NULL;
-            v->parent->count--;
-            trieCutLeaves(v->parent);
-            trieDelete(v);
+/**
+ * @brief Porównuje odłożone skojarzenia @p a i @p b.
+ * Skojarzenia z tym samym węzłem drzewa odwrotnego mają tę samą wartość
+ * z puli, więc porównanie adresów wartości ustawia je obok siebie,
+ * uporządkowane według ciągów.
+ * @param[in] a - wskaźnik na @ref Unbound.
+ * @param[in] b - wskaźnik na @ref Unbound.
+ * @return Wartość ujemna, zero lub dodatnia, jeśli pierwsze skojarzenie
+ * jest odpowiednio mniejsze, równe lub większe od drugiego.
+ */
+static int unboundCompare(void const *a, void const *b) {
+    Unbound const *x = a, *y = b;
+    uintptr_t xs = (uintptr_t) x->seq, ys = (uintptr_t) y->seq;
+    if (xs != ys) return xs < ys ? -1 : 1;
+    return packedCompare(x->bound, y->bound);
+}
+
+/**
+ * @brief Porównuje malejąco wartości odłożonych skojarzeń @p a i @p b.
+ * Potomek węzła drzewa odwrotnego poprzedza więc swojego przodka.
+ * @param[in] a - wskaźnik na @ref Unbound.
+ * @param[in] b - wskaźnik na @ref Unbound.
+ * @return Wartość ujemna, zero lub dodatnia, jeśli wartość pierwszego
+ * skojarzenia jest odpowiednio większa, równa lub mniejsza od wartości
+ * drugiego.
+ */
+static int unboundCompareSeq(void const *a, void const *b) {
+    Unbound const *x = a, *y = b;
+    return packedCompare(y->seq, x->seq);
+}
+
+/**
+ * @brief Usuwa odłożone skojarzenia ze zbiorów drzewa odwrotnego.
+ * Każdy węzeł drzewa odwrotnego wyszukiwany jest raz, a jego zbiory
+ * przepisywane jednym przejściem. Opróżnione węzły przycinane są na końcu,
+ * od najgłębszych, więc przycinanie potomka usuwa zbędnych przodków,
+ * zanim zostaną odwiedzeni; węzły już usunięte są pomijane.
+ * @param arena - wskaźnik na arenę drzew.
+ */
+static void unboundFlush(TrieArena *arena) {
+    Unbound *unbound = arena->unbound;
+    size_t count = arena->unboundCount, emptied = 0;
+    arena->unboundCount = 0;
+    if (count > 1) qsort(unbound, count, sizeof(Unbound), unboundCompare);
+
+    for (size_t first = 0, last; first < count; first = last) {
+        uint8_t const *seq = unbound[first].seq;
+        for (last = first; last < count && unbound[last].seq == seq; last++)
+            arena->unboundNums[last - first] = unbound[last].bound;
+
+        TrieNode *rev = trieFindPacked(arena, arena->revs, seq);
+        rev->shadowed = setRemoveSorted(rev->shadowed, arena->unboundNums,
+                                        last - first);
+        rev->value.sources = setRemoveSorted(rev->value.sources,
+                                             arena->unboundNums, last - first);
+        for (size_t i = first; i < last; i++)
+            poolRelease(arena->pool, unbound[i].bound);
+
+        /* Wartość opróżnionego węzła pozostaje w puli do jego przycięcia,
+         * zaś przetworzone skojarzenia nie są już potrzebne. */
+        if (!rev->value.sources) {
+            setDelete(rev->shadowed);
+            rev->shadowed = NULL;
+            unbound[emptied++].seq = seq;
+            first++;
         }
+        for (size_t i = first; i < last; i++)
+            poolRelease(arena->pool, seq);
+    }
+
+    if (emptied > 1)
+        qsort(unbound, emptied, sizeof(Unbound), unboundCompareSeq);
+    for (size_t i = 0; i < emptied; i++) {
+        TrieNode *rev = trieFindPacked(arena, arena->revs, unbound[i].seq);
+        if (rev) trieCutLeaves(arena, rev);
+        poolRelease(arena->pool, unbound[i].seq);
     }
 }
 
 /**
- * @brief Sprawdza, czy węzeł @p node jest pusty.
+ * @brief Odkłada usunięcie skojarzenia węzła @p node z węzłem drzewa
+ * odwrotnego do wywołania unboundFlush().
+ * Gdy tablica odłożonych skojarzeń jest pełna i nie udaje się jej
+ * powiększyć, wykonuje odłożone usunięcia, robiąc w niej miejsce.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param node - wskaźnik na skojarzony węzeł drzewa typu @p value.seq.
+ * @return Wartość @p true, jeśli skojarzenie zostało odłożone, a wartość
+ * i ciąg węzła przejęte przez arenę. Wartość @p false, jeśli tablica nie ma
+ * żadnego miejsca.
+ */
+static bool unboundPush(TrieArena *arena, TrieNode *node) {
+    if (arena->unboundCount == arena->unboundSize) {
+        size_t size = arena->unboundSize ? 2 * arena->unboundSize : 64;
+        Unbound *unbound = realloc(arena->unbound, size * sizeof(Unbound));
+        if (unbound) arena->unbound = unbound;
+        uint8_t const **nums = realloc(arena->unboundNums,
+                                       size * sizeof(uint8_t const *));
+        if (nums) arena->unboundNums = nums;
+
+        if (unbound && nums) arena->unboundSize = size;
+        else unboundFlush(arena);
+        if (arena->unboundSize == 0) return false;
+    }
+
+    arena->unbound[arena->unboundCount++] = (Unbound) {node->value.seq,
+                                                       node->bound};
+    node->value.seq = NULL;
+    node->bound = NULL;
+    return true;
+}
+
+/**
+ * @brief Sprawdza, czy indeks najdłuższych prefiksów obejmuje już ciąg
+ * @p num.
+ * Odbudowywany indeks obejmuje jedynie ciągi przejrzane przez
+ * indexRebuild(), czyli nie większe od @p indexCursor.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param num - upakowany ciąg przekierowanego węzła.
+ * @return Wartość @p true, jeśli ciąg przekierowanego węzła należy do
+ * indeksu.
+ */
+static bool indexReaches(TrieArena const *arena, uint8_t const *num) {
+    if (!lpmIsLoading(arena->lpm)) return lpmIsValid(arena->lpm);
+    return arena->indexCursor && packedCompare(num, arena->indexCursor) <= 0;
+}
+
+/**
+ * @brief Sprawdza, czy ciąg przekierowanego węzła @p node należy do indeksu
+ * najdłuższych prefiksów.
+ * Węzły dalsze od przejrzanych przez odbudowę indeksu mogą mieć znacznik
+ * @p indexed z porzuconego indeksu, więc nie są w nim uwzględniane.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param node - wskaźnik na węzeł drzewa ciągów.
+ * @return Wartość @p true, jeśli ciąg węzła jest w indeksie.
+ */
+static bool fwdIsIndexed(TrieArena const *arena, TrieNode *node) {
+    return node->indexed && indexReaches(arena, node->bound);
+}
+
+/**
+ * @brief Usuwa wartość węzła @p node drzewa ciągów.
+ * Usuwa ciąg węzła z indeksu najdłuższych prefiksów oraz ze zbioru węzła
+ * drzewa odwrotnego. Usunięcie elementu zbioru jest odkładane (zobacz
+ * unboundPush()), jeśli @p defer ma wartość @p true; wywołujący musi wtedy
+ * wywołać unboundFlush(). Węzeł odłączony od zbioru przez trieSettle() ma
+ * jedynie ciąg, który opuszcza indeks.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param node - wskaźnik na węzeł drzewa typu @p value.seq.
+ * @param defer - czy odłożyć usunięcie elementu zbioru.
+ */
+static void fwdRelease(TrieArena *arena, TrieNode *node, bool defer) {
+    if (node->bound) {
+        if (fwdIsIndexed(arena, node)) lpmRemove(arena->lpm, node->bound);
+        size_t length = packedLength(node->bound);
+        if (length > LPM_MAX_LENGTH) arena->oversized--;
+        else arena->lengths[length]--;
+    }
+    if (!node->value.seq) {
+        poolRelease(arena->pool, node->bound);
+        node->bound = NULL;
+        return;
+    }
+    if (!node->bound || !defer || !unboundPush(arena, node)) {
+        trieNodeUnbind(arena, node);
+        poolRelease(arena->pool, node->value.seq);
+        node->value.seq = NULL;
+    }
+}
+
+/**
+ * @brief Zwraca węzeł @p node do areny. Jeśli z wierzchołkiem skojarzony jest
+ * pewien element zbioru w innym drzewie, to zostaje on usunięty.
+ * Usunięcie elementu jest odkładane (zobacz unboundPush()), więc po
+ * zwolnieniu węzłów wywołujący musi wywołać unboundFlush().
+ * @param arena - wskaźnik na arenę, z której pochodzi węzeł.
  * @param node - wskaźnik na węzeł drzewa.
- * @return Wartość @p true pod warunkiem, że węzeł nie ma dzieci i nie ma
- * znaczącej zawartości. Wartość @p false w przeciwnym wypadku.
  */
-static bool trieNodeIsEmpty(TrieNode *node) {
-    if (node->count) return false;
-    if (node->hasList)
-        return !node->value.list || isEmpty(node->value.list);
-    else
-        return !node->value.seq;
+static void freeTrieNode(TrieArena *arena, TrieNode *node) {
+    if (node->hasList) {
+        for (size_t i = 0; i < setGetAmount(node->value.sources); i++)
+            poolRelease(arena->pool, setGet(node->value.sources, i));
+        setDelete(node->value.sources);
+        setDelete(node->shadowed);
+        node->value.sources = NULL;
+        node->shadowed = NULL;
+    }
+    else {
+        /* Węzły poddrzewa zwalniane są od liści, więc dłuższe prefiksy
+         * opuszczają indeks wcześniej. */
+        fwdRelease(arena, node, true);
+    }
+
+    arenaFree(arena->nodes, node->self);
 }
 
-void trieCutLeaves(TrieNode *node) {
+/**
+ * @brief Zwalnia co najwyżej @p budget węzłów poddrzewa @p node, od liści.
+ * Schodzi do dziecka o największej wartości znaku. Jest ono ostatnie
+ * w tablicy dzieci, więc jego odłączenie nie wymaga przesuwania pozostałych.
+ * Nie wykonuje odłożonych usunięć skojarzeń (zobacz freeTrieNode()).
+ * @param arena - wskaźnik na arenę drzew.
+ * @param node - wskaźnik na korzeń poddrzewa.
+ * @param[in,out] budget - wskaźnik na największą liczbę zwalnianych węzłów,
+ *                         pomniejszaną o liczbę zwolnionych.
+ * @return Wartość @p true, jeśli zwolniony został również @p node.
+ */
+static bool subtreeFree(TrieArena *arena, TrieNode *node, size_t *budget) {
+    TrieNode *curr = node, *parent;
+
+    while (curr && *budget > 0)
+        if (curr->bitmap) {
+            curr = childAt(arena, curr, 31 - __builtin_clz(curr->bitmap));
+        }
+        else {
+            /* Węzeł nie ma dzieci, więc zwalniamy go. */
+            parent = curr == node ? NULL : nodeAt(arena, curr->parent);
+            if (parent) unlinkChild(arena, parent, labelDigit(curr, 0));
+            freeTrieNode(arena, curr);
+            (*budget)--;
+            curr = parent;
+        }
+    return !curr;
+}
+
+void trieDelete(TrieArena *arena, TrieNode *node) {
     if (!node) return;
+    if (node == arena->fwds) arena->fwds = NULL;
+
+    size_t budget = SIZE_MAX;
+    subtreeFree(arena, node, &budget);
+    unboundFlush(arena);
+}
+
+/**
+ * @brief Dodaje przekierowany węzeł @p fwd do indeksu najdłuższych
+ * prefiksów.
+ * Pozycje poddrzewa @p fwd, które nie leżą w poddrzewie innego węzła
+ * indeksu, miały dotąd ten sam najdłuższy prefiks co @p fwd, zaś teraz ich
+ * prefiksem jest @p fwd. Uaktualnienia wymagają jedynie znaczniki, które
+ * nie są prefiksami, więc pozycje te przeglądane są w głąb tylko do
+ * największej długości takich znaczników (zobacz lpmMarkedLengths()),
+ * a indeks odpytywany jest tylko na ich długościach. Gdy znaczników
+ * dłuższych od @p fwd nie ma, poddrzewo nie jest przeglądane. Jeśli nie uda
+ * się alokować pamięci, to indeks zostaje porzucony.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param fwd - wskaźnik na przekierowany węzeł spoza indeksu.
+ */
+static void indexInsert(TrieArena *arena, TrieNode *fwd) {
+    size_t length = packedLength(fwd->bound);
+    TrieNode *previous;
+    fwd->indexed = true;
+    if (!lpmInsert(arena->lpm, fwd, fwd->bound, &previous) || !fwd->bitmap)
+        return;
+
+    /* Prefiks jest w indeksie, więc jest nie dłuższy od LPM_MAX_LENGTH,
+     * a bit o numerze length odpowiada pierwszej dłuższej długości. */
+    uint64_t marked = length < 64 ? lpmMarkedLengths(arena->lpm) >> length
+                                  : 0;
+    if (!marked) return;
+    size_t limit = length + 64 - (size_t) __builtin_clzll(marked);
+
+    size_t cap = length + 2 * LABEL_DIGITS, depth = length;
+    char *path = malloc(cap), *grown;
+    if (!path) {
+        lpmInvalidate(arena->lpm);
+        return;
+    }
+    numUnpackEncoded(fwd->bound, path);
 
-    TrieNode *curr = node, *next;
-    while (curr && trieNodeIsEmpty(curr)) {
-        if (curr->hasList)
-            listDelete(curr->value.list);
+    TrieNode *curr = fwd, *child;
+    unsigned next = 0, bits;
+    int digit;
+    for (;;) {
+        bits = curr->bitmap >> next << next;
+        if (!bits) {
+            /* Wracamy do rodzica i przechodzimy do kolejnego rodzeństwa. */
+            if (curr == fwd) break;
+            next = labelDigit(curr, 0) + 1;
+            depth -= curr->labelLength;
+            curr = nodeAt(arena, curr->parent);
+            continue;
+        }
+
+        digit = __builtin_ctz(bits);
+        child = childAt(arena, curr, digit);
+        if (depth + child->labelLength > cap) {
+            grown = realloc(path, 2 * cap);
+            if (!grown) {
+                lpmInvalidate(arena->lpm);
+                break;
+            }
+            path = grown;
+            cap *= 2;
+        }
 
-        *curr->pointedBy = NULL;
-        if (curr->parent) {
-            curr->parent->count--;
-            curr->parent->lastVisited = -1;
+        /* Pozycja dziecka z indeksu ma własny prefiks. */
+        for (unsigned k = 0; k < child->labelLength && depth + k < limit;
+             k++) {
+            path[depth + k] = (char) ('0' + labelDigit(child, k));
+            if ((k + 1 < child->labelLength ||
+                 !fwdIsIndexed(arena, child)) &&
+                (marked >> (depth + k - length) & 1))
+                lpmRetarget(arena->lpm, path, depth + k + 1, previous, fwd,
+                            length);
+        }
+
+        if (!fwdIsIndexed(arena, child) && child->bitmap &&
+            depth + child->labelLength < limit) {
+            curr = child;
+            depth += child->labelLength;
+            next = 0;
+        }
+        else {
+            next = digit + 1;
         }
+    }
+    free(path);
+}
+
+/**
+ * @brief Wyszukuje ciąg zbioru ciągów odłączonych poddrzew, który jest
+ * prefiksem upakowanego numeru @p num lub mu równy.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param num - wskaźnik na upakowany numer.
+ * @return Wskaźnik na ciąg zbioru lub NULL, jeśli takiego nie ma.
+ */
+static uint8_t const *detachedCover(TrieArena const *arena,
+                                    uint8_t const *num) {
+    size_t lo = 0, hi = setGetAmount(arena->detached);
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = packedComparePrefix(num, setGet(arena->detached, mid));
+        if (cmp == 0) return setGet(arena->detached, mid);
+        if (cmp < 0) hi = mid;
+        else lo = mid + 1;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Dodaje nowo przekierowany węzeł @p fwd do indeksu najdłuższych
+ * prefiksów lub odkłada jego dodanie.
+ * Węzły odłączonych poddrzew pozostają w indeksie, dopóki trieSweep() nie
+ * zwolni ich od liści. Węzeł, którego ciąg leży w odłączonym poddrzewie,
+ * mógłby dzielić z nimi elementy indeksu, więc jego ciąg czeka w zbiorze
+ * @p deferred, aż poddrzewa zostaną zwolnione (zobacz indexDeferred()).
+ * Jeśli nie uda się alokować pamięci, to indeks zostaje porzucony.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param fwd - wskaźnik na nowo przekierowany węzeł.
+ */
+static void indexAdd(TrieArena *arena, TrieNode *fwd) {
+    fwd->indexed = false;
+    if (!indexReaches(arena, fwd->bound)) return;
+    if (!arena->detached || !detachedCover(arena, fwd->bound)) {
+        indexInsert(arena, fwd);
+        return;
+    }
+
+    size_t amount = setGetAmount(arena->deferred);
+    SortedSet *deferred = setInsert(arena->deferred, fwd->bound);
+    if (!deferred) {
+        lpmInvalidate(arena->lpm);
+        return;
+    }
+    /* Numer jest już w puli, więc jego kolejne odwołanie zawsze się
+     * udaje. */
+    if (setGetAmount(deferred) > amount) poolIntern(arena->pool, fwd->bound);
+    arena->deferred = deferred;
+}
+
+/**
+ * @brief Dodaje do indeksu najdłuższych prefiksów węzły, których dodanie
+ * odłożyła indexAdd().
+ * Przetwarza co najwyżej @p budget ciągów zbioru @p deferred. Ciągi, których
+ * węzły zostały od tego czasu usunięte, są pomijane.
+ * @param arena - wskaźnik na arenę drzew bez odłączonych poddrzew.
+ * @param budget - największa liczba przetwarzanych ciągów.
+ * @return Pozostała część @p budget.
+ */
+static size_t indexDeferred(TrieArena *arena, size_t budget) {
+    for (size_t amount; budget > 0 &&
+                        (amount = setGetAmount(arena->deferred)) > 0;
+         budget--) {
+        /* Usunięcie ostatniego elementu nie przesuwa pozostałych. */
+        uint8_t const *num = setGet(arena->deferred, amount - 1);
+        arena->deferred = setRemove(arena->deferred, num);
 
-        next = curr->parent;
-        free(curr);
-        curr = next;
+        TrieNode *fwd = trieFindPacked(arena, arena->fwds, num);
+        if (fwd && fwd->bound == num && !fwdIsIndexed(arena, fwd) &&
+            indexReaches(arena, num))
+            indexInsert(arena, fwd);
+        poolRelease(arena->pool, num);
     }
+    return budget;
+}
+
+/**
+ * @brief Sprawdza, czy przekierowanie węzła @p fwd jest przysłonięte.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param fwd - wskaźnik na przekierowany węzeł drzewa typu @p value.seq.
+ * @return Wartość @p true, jeśli pewien przekierowany przodek @p fwd
+ * prowadzi do tego samego numeru co @p fwd, czyli ciąg @p fwd powstaje
+ * z ciągu przodka przez dopisanie tych samych znaków co cel @p fwd z celu
+ * przodka.
+ */
+static bool fwdIsShadowed(TrieArena const *arena, TrieNode *fwd) {
+    for (TrieNode *curr = nodeAt(arena, fwd->parent); curr;
+         curr = nodeAt(arena, curr->parent))
+        if (curr->value.seq &&
+            packedIsReplaced(fwd->value.seq, curr->value.seq, fwd->bound,
+                             packedLength(curr->bound)))
+            return true;
+    return false;
+}
+
+/**
+ * @brief Porzuca zbiory przysłoniętych prefiksów.
+ * Zbiory są nadal uaktualniane, lecz dopiero pełny przegląd rozpoczęty po
+ * porzuceniu przywraca ich ważność (zobacz shadowedRebuild()), więc
+ * przerwany przegląd zaczyna się od nowa.
+ * @param arena - wskaźnik na arenę drzew.
+ */
+static void shadowedAbandon(TrieArena *arena) {
+    arena->shadowedValid = false;
+    arena->shadowedLoading = false;
+    poolRelease(arena->pool, arena->shadowedCursor);
+    arena->shadowedCursor = NULL;
+}
+
+/**
+ * @brief Wstawia ciąg węzła @p fwd do zbioru przysłoniętych prefiksów węzła
+ * jego celu lub go z niego usuwa. Jeśli nie uda się alokować pamięci, to
+ * zbiory przysłoniętych prefiksów zostają porzucone.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param fwd - wskaźnik na przekierowany węzeł drzewa typu @p value.seq.
+ * @param rev - wskaźnik na węzeł celu @p fwd w drzewie odwrotnym lub NULL,
+ *              jeśli należy go wyszukać.
+ * @param shadowed - czy ciąg ma należeć do zbioru.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool shadowedMark(TrieArena *arena, TrieNode *fwd, TrieNode *rev,
+                         bool shadowed) {
+    if (!rev) rev = trieFindPacked(arena, arena->revs, fwd->value.seq);
+
+    if (!shadowed) {
+        rev->shadowed = setRemove(rev->shadowed, fwd->bound);
+        return true;
+    }
+
+    SortedSet *set = setInsert(rev->shadowed, fwd->bound);
+    if (!set) {
+        shadowedAbandon(arena);
+        return false;
+    }
+    rev->shadowed = set;
+    return true;
+}
+
+/**
+ * @brief Sprawdza na nowo przysłonięcie przekierowań potomków węzła @p fwd,
+ * które prowadzą do ciągów zaczynających się od @p target.
+ * Potomek o ciągu Q+s może być przysłonięty przez @p fwd o ciągu Q i celu
+ * T jedynie wtedy, gdy jego celem jest T+s. Przeglądane jest więc w głąb
+ * poddrzewo drzewa odwrotnego złożone z ciągów zaczynających się od
+ * @p target, zaś w zbiorze każdego jego węzła T+s wyszukiwany jest ciąg Q+s.
+ * Koszt jest proporcjonalny do rozmiaru tego poddrzewa, a nie poddrzewa
+ * @p fwd. Jeśli nie uda się alokować pamięci, to zbiory przysłoniętych
+ * prefiksów zostają porzucone.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param fwd - wskaźnik na przekierowany węzeł.
+ * @param target - ciąg z puli, obecny lub wcześniejszy cel @p fwd.
+ * @param previous - wartość @p true, jeśli @p target jest wcześniejszym
+ *                   celem, więc przysłonięte dotąd przez @p fwd potomki
+ *                   sprawdzane są na nowo. Wartość @p false, jeśli
+ *                   @p target jest obecnym celem, więc pasujące potomki
+ *                   zostają przysłonięte.
+ * @return Wartość @p false, jeśli nie udało się alokować pamięci.
+ */
+static bool shadowedScan(TrieArena *arena, TrieNode *fwd,
+                         uint8_t const *target, bool previous) {
+    size_t targetLength, start = 0;
+    uint8_t const *digits = packedDigits(target, &targetLength);
+
+    /* Schodzimy do najwyższego węzła, którego ciąg zaczyna się od celu.
+     * Węzeł wcześniejszego celu mógł zostać scalony z dzieckiem. */
+    TrieNode *top = arena->revs;
+    while (top && start + top->labelLength < targetLength) {
+        start += top->labelLength;
+        top = childAt(arena, top, packedSymbol(digits, start));
+        for (unsigned k = 0; top && k < top->labelLength &&
+                             start + k < targetLength; k++)
+            if (labelDigit(top, k) != packedSymbol(digits, start + k))
+                top = NULL;
+    }
+    if (!top) return true;
+
+    size_t depth = start + top->labelLength, cap = depth + 2 * LABEL_DIGITS;
+    size_t sourceLength = packedLength(fwd->bound);
+    char *path = malloc(cap), *grownPath;
+    uint8_t *key = malloc(packedSize(sourceLength + cap)), *grownKey;
+    if (!path || !key) {
+        free(path);
+        free(key);
+        shadowedAbandon(arena);
+        return false;
+    }
+    for (size_t i = 0; i < start; i++)
+        path[i] = (char) ('0' + packedSymbol(digits, i));
+    for (unsigned k = 0; k < top->labelLength; k++)
+        path[start + k] = (char) ('0' + labelDigit(top, k));
+
+    TrieNode *curr = top, *child = top, *source;
+    unsigned next = 0, bits;
+    int digit;
+    bool ok = true;
+    while (ok) {
+        if (child->value.sources && depth > targetLength) {
+            packedReplacePrefix(key, fwd->bound, path, depth, targetLength);
+            uint8_t const *found = setGet(child->value.sources,
+                                          setRank(child->value.sources, key));
+            /* Skojarzenia wsadu mogą być już w zbiorze, zanim ustawiona
+             * zostanie wartość węzła; taki węzeł sprawdzi się sam. */
+            source = found && packedCompare(found, key) == 0
+                         ? trieFindPacked(arena, arena->fwds, found)
+                         : NULL;
+            if (source && source->value.seq &&
+                trieFindPacked(arena, arena->revs, source->value.seq) == child)
+                ok = shadowedMark(arena, source, child,
+                                  !previous || fwdIsShadowed(arena, source));
+            if (!ok) break;
+        }
+
+        if (child != curr) {
+            if (child->bitmap) {
+                curr = child;
+                next = 0;
+            }
+            else {
+                depth -= child->labelLength;
+                next = labelDigit(child, 0) + 1;
+            }
+        }
+
+        bits = curr->bitmap >> next << next;
+        while (!bits && curr != top) {
+            /* Wracamy do rodzica i przechodzimy do kolejnego rodzeństwa. */
+            next = labelDigit(curr, 0) + 1;
+            depth -= curr->labelLength;
+            curr = nodeAt(arena, curr->parent);
+            bits = curr->bitmap >> next << next;
+        }
+        if (!bits) break;
+
+        digit = __builtin_ctz(bits);
+        child = childAt(arena, curr, digit);
+        if (depth + child->labelLength > cap) {
+            grownPath = realloc(path, 2 * cap);
+            if (grownPath) path = grownPath;
+            grownKey = realloc(key, packedSize(sourceLength + 2 * cap));
+            if (grownKey) key = grownKey;
+            if (!grownPath || !grownKey) {
+                shadowedAbandon(arena);
+                ok = false;
+                break;
+            }
+            cap *= 2;
+        }
+        for (unsigned k = 0; k < child->labelLength; k++)
+            path[depth + k] = (char) ('0' + labelDigit(child, k));
+        depth += child->labelLength;
+    }
+    free(path);
+    free(key);
+    return ok;
+}
+
+/**
+ * @brief Uaktualnia zbiory przysłoniętych prefiksów po przekierowaniu węzła
+ * @p fwd.
+ * Przekierowanie może przysłonić sam węzeł @p fwd oraz przekierowania
+ * w jego poddrzewie; jeśli zastąpiło wcześniejsze, to przekierowania
+ * przysłonięte dotąd przez @p fwd sprawdzane są na nowo. Kandydaci
+ * wyszukiwani są w poddrzewach celów w drzewie odwrotnym (zobacz
+ * shadowedScan()), a węzeł bez dzieci nie ma czego przysłaniać.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param fwd - wskaźnik na przekierowany węzeł.
+ * @param rev - wskaźnik na węzeł celu @p fwd w drzewie odwrotnym.
+ * @param previous - wcześniejszy cel @p fwd lub NULL.
+ */
+static void shadowedUpdate(TrieArena *arena, TrieNode *fwd, TrieNode *rev,
+                           uint8_t const *previous) {
+    if (fwdIsShadowed(arena, fwd) && !shadowedMark(arena, fwd, rev, true))
+        return;
+    if (!fwd->bitmap) return;
+
+    if (shadowedScan(arena, fwd, fwd->value.seq, false) && previous)
+        shadowedScan(arena, fwd, previous, true);
+}
+
+/**
+ * @brief Ustawia wartość węzła @p fwd na ciąg @p seq i kojarzy go z węzłem
+ * @p rev, którego zbiór zawiera już @p bound. Nie może się nie powieść.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param fwd - wskaźnik na węzeł drzewa typu @p value.seq.
+ * @param rev - wskaźnik na węzeł ciągu @p seq w drzewie odwrotnym.
+ * @param seq - ustawiany ciąg z puli; węzeł przejmuje odwołanie do niego.
+ * @param bound - ciąg @p fwd z puli; węzeł przejmuje odwołanie do niego.
+ * @param source - ciąg znaków kończący się w węźle @p fwd.
+ * @param sourceLength - długość @p source.
+ */
+static void trieNodeAttach(TrieArena *arena, TrieNode *fwd, TrieNode *rev,
+                           uint8_t const *seq, uint8_t const *bound,
+                           const char *source, size_t sourceLength) {
+    /* Węzeł rev ma niepusty zbiór, więc usunięcie starego skojarzenia go nie
+     * usunie. */
+    bool added = !fwd->value.seq;
+    generationTouch(arena, source, sourceLength);
+    trieNodeUnbind(arena, fwd);
+    uint8_t const *previous = fwd->value.seq;
+    fwd->value.seq = seq;
+    fwd->bound = bound;
+    shadowedUpdate(arena, fwd, rev, previous);
+    poolRelease(arena->pool, previous);
+
+    if (added) {
+        jumpRefreshEdge(arena, fwd);
+        if (sourceLength > LPM_MAX_LENGTH) arena->oversized++;
+        else arena->lengths[sourceLength]++;
+        indexAdd(arena, fwd);
+    }
+}
+
+bool trieNodeBind(TrieArena *arena, TrieNode *fwd, TrieNode *rev,
+                  const char *source, size_t sourceLength, const char *target,
+                  size_t targetLength) {
+    if (!fwd || !rev || fwd->hasList || !rev->hasList) return false;
+
+    uint8_t const *seq = poolInternStr(arena->pool, target, targetLength);
+    if (!seq) return false;
+
+    /* Węzeł jest już przekierowany na ten sam ciąg. */
+    if (seq == fwd->value.seq) {
+        poolRelease(arena->pool, seq);
+        return true;
+    }
+
+    uint8_t const *bound = poolInternStr(arena->pool, source, sourceLength);
+    SortedSet *sources = bound ? setInsert(rev->value.sources, bound) : NULL;
+    if (!sources) {
+        poolRelease(arena->pool, bound);
+        poolRelease(arena->pool, seq);
+        return false;
+    }
+    rev->value.sources = sources;
+
+    trieNodeAttach(arena, fwd, rev, seq, bound, source, sourceLength);
+    return true;
+}
+
+/**
+ * Przekierowanie wstawiane przez trieBindSorted().
+ */
+typedef struct BindEntry {
+    uint8_t const *seq; /**< Cel przekierowania z puli lub NULL, jeśli
+                             przekierowanie jest pomijane. */
+    uint8_t const *bound; /**< Prefiks przekierowania z puli. */
+    TrieNode *rev; /**< Węzeł celu w drzewie odwrotnym. */
+} BindEntry;
+
+/**
+ * Klucz grupujący przekierowania o wspólnym celu. Równe cele mają w puli
+ * ten sam adres, więc klucze porównywane są bez odczytywania numerów.
+ */
+typedef struct BindKey {
+    uintptr_t seq; /**< Adres celu w puli. */
+    size_t rule; /**< Indeks przekierowania w tablicy wejściowej. */
+} BindKey;
+
+/**
+ * @brief Porównuje klucze @p a i @p b według adresu celu, a następnie
+ * według kolejności na wejściu.
+ * @param a - wskaźnik na @ref BindKey.
+ * @param b - wskaźnik na @ref BindKey.
+ * @return Wartość ujemna, zero lub dodatnia, jeśli pierwszy klucz jest
+ * odpowiednio mniejszy, równy lub większy od drugiego.
+ */
+static int bindCompare(void const *a, void const *b) {
+    BindKey const *x = a, *y = b;
+    if (x->seq != y->seq) return (x->seq > y->seq) - (x->seq < y->seq);
+    return (x->rule > y->rule) - (x->rule < y->rule);
+}
+
+bool trieBindSorted(TrieArena *arena, TrieNode **fwdsPtr, TrieNode **revsPtr,
+                    TrieRule const *rules, size_t count) {
+    if (count == 0) return true;
+
+    /* Każde wstawienie ciągu tworzy co najwyżej węzeł z podziału etykiety
+     * oraz po jednym węźle na każde LABEL_DIGITS znaków, zaś każdy nowy węzeł
+     * co najwyżej jeden blok nadmiarowy u rodzica. Po rezerwacji wstawienia
+     * do drzew nie mogą się więc nie powieść. */
+    size_t nodes = 2;
+    for (size_t i = 0; i < count; i++)
+        nodes += 2 + (rules[i].sourceLength + LABEL_DIGITS - 1) / LABEL_DIGITS +
+                 (rules[i].targetLength + LABEL_DIGITS - 1) / LABEL_DIGITS;
+    if (!arenaReserve(arena->nodes, nodes) ||
+        !arenaReserve(arena->overflow, nodes))
+        return false;
+
+    BindEntry *entries = malloc(count * sizeof(BindEntry));
+    BindKey *keys = malloc(count * sizeof(BindKey));
+    uint8_t const **bounds = malloc(count * sizeof(uint8_t const *));
+    SortedSet **sets = malloc(count * sizeof(SortedSet *));
+    bool ok = entries && keys && bounds && sets;
+    size_t interned = 0, used = 0, groups = 0, from, to;
+
+    poolReserve(arena->pool, ok ? 2 * count : 0);
+    for (; ok && interned < count; interned++) {
+        TrieRule const *rule = &rules[interned];
+        BindEntry *entry = &entries[interned];
+        entry->seq = poolInternStr(arena->pool, rule->target,
+                                   rule->targetLength);
+        entry->bound = entry->seq ? poolInternStr(arena->pool, rule->source,
+                                                  rule->sourceLength)
+                                  : NULL;
+        entry->rev = NULL;
+        TrieNode *fwd = entry->bound ? trieFindPacked(arena, *fwdsPtr,
+                                                      entry->bound)
+                                     : NULL;
+        if (!entry->bound || (fwd && fwd->value.seq == entry->seq)) {
+            /* Pomijamy również węzły przekierowane już na ten sam ciąg. */
+            ok = entry->bound != NULL;
+            poolRelease(arena->pool, entry->bound);
+            poolRelease(arena->pool, entry->seq);
+            entry->seq = entry->bound = NULL;
+            continue;
+        }
+        keys[used++] = (BindKey) {(uintptr_t) entry->seq, interned};
+    }
+
+    /* Zbiory celów budujemy od razu w całości, nim zmieni się którekolwiek
+     * drzewo. Przekierowania są posortowane według prefiksów, więc prefiksy
+     * o wspólnym celu trafiają do zbioru w kolejności. */
+    if (ok) qsort(keys, used, sizeof(BindKey), bindCompare);
+    for (from = 0; ok && from < used; from = to) {
+        for (to = from; to < used && keys[to].seq == keys[from].seq; to++)
+            bounds[to - from] = entries[keys[to].rule].bound;
+        TrieNode *rev = trieFindPacked(arena, *revsPtr,
+                                       entries[keys[from].rule].seq);
+        sets[groups] = setMerge(rev ? rev->value.sources : NULL, bounds,
+                                to - from);
+        if (sets[groups]) groups++;
+        else ok = false;
+    }
+
+    if (!ok) {
+        for (size_t g = 0; g < groups; g++)
+            setDelete(sets[g]);
+        for (size_t i = 0; i < interned; i++) {
+            poolRelease(arena->pool, entries[i].bound);
+            poolRelease(arena->pool, entries[i].seq);
+        }
+    }
+    else {
+        /* Węzły drzewa odwrotnego mają odtąd niepuste zbiory, więc usuwanie
+         * starych skojarzeń ich nie usunie. */
+        for (from = 0, groups = 0; from < used; from = to, groups++) {
+            TrieNode *rev = trieInsertStr(arena, revsPtr,
+                                          rules[keys[from].rule].target, true);
+            setDelete(rev->value.sources);
+            rev->value.sources = sets[groups];
+            for (to = from; to < used && keys[to].seq == keys[from].seq; to++)
+                entries[keys[to].rule].rev = rev;
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (!entries[i].seq) continue;
+            TrieNode *fwd = trieInsertStr(arena, fwdsPtr, rules[i].source,
+                                          false);
+            trieNodeAttach(arena, fwd, entries[i].rev, entries[i].seq,
+                           entries[i].bound, rules[i].source,
+                           rules[i].sourceLength);
+        }
+    }
+
+    free(entries);
+    free(keys);
+    free(bounds);
+    free(sets);
+    return ok;
+}
+
+StringPool const *trieArenaGetPool(TrieArena const *arena) {
+    return arena->pool;
+}
+
+SortedSet *trieGetShadowed(TrieArena const *arena, TrieNode *node) {
+    if (!node || !node->hasList || !trieShadowedIsValid(arena)) return NULL;
+    return node->shadowed;
+}
+
+bool trieShadowedIsValid(TrieArena const *arena) {
+    return arena->shadowedValid;
+}
+
+SortedSet *trieGetSources(TrieNode *node) {
+    if (!node || !node->hasList) return NULL;
+    return node->value.sources;
+}
+
+TrieNode *trieGetParent(TrieArena const *arena, TrieNode *node) {
+    if (!node) return NULL;
+    return nodeAt(arena, node->parent);
+}
+
+uint8_t const *trieNodeGetSeq(TrieNode *node) {
+    if (!node) return NULL;
+    return node->value.seq;
+}
+
+size_t trieNodeGetLabelLength(TrieNode *node) {
+    if (!node) return 0;
+    return node->labelLength;
+}
+
+TrieNode *trieFindSeq(TrieArena const *arena, TrieNode *root, const char *str,
+                      size_t *length) {
+    *length = 0;
+    if (!root) return NULL;
+    TrieNode *lastWithValue = NULL, *child;
+
+    /* Długość zliczamy w zmiennej lokalnej, by zapis do *length nie zmuszał
+     * kompilatora do ponownego odczytu tablicy slabów w każdym kroku. */
+    size_t found = 0, i = 0, head;
+    unsigned matched;
+
+    /* Początkowe poziomy drzewa ciągów pomija tablica skoków. */
+    if (root == arena->fwds && jumpIndex(str, &head)) {
+        JumpEntry const *jump = &arena->jump[head];
+        root = nodeAt(arena, jump->node);
+        lastWithValue = nodeAt(arena, jump->best);
+        i = jump->depth;
+        found = jump->bestLength;
+    }
+
+    while (str[i] != '\0') {
+        child = childAt(arena, root, symbolValue(str[i]));
+        if (!child) break;
+
+        /* Ciąg kończący się lub różniący wewnątrz etykiety dziecka nie ma
+         * w nim prefiksu. */
+        matched = labelMatch(child, str + i);
+        if (matched < child->labelLength) break;
+
+        i += matched;
+        root = child;
+        if (root->value.seq) {
+            lastWithValue = root;
+            found = i;
+        }
+    }
+    *length = found;
+    return lastWithValue;
+}
+
+TrieNode *trieFindSeqIndexed(TrieArena const *arena, TrieNode *root,
+                             const char *str, size_t length, size_t *found) {
+    /* Indeks zawiera jeszcze prefiksy odłączonych poddrzew, a brakuje mu
+     * prefiksów dodanych wewnątrz nich. */
+    if (lpmIsValid(arena->lpm) && arena->sweepFirst == arena->sweepCount &&
+        !arena->deferred)
+        return lpmFind(arena->lpm, str, length, found);
+    return trieFindSeq(arena, root, str, found);
+}
+
+uint32_t trieGeneration(TrieArena const *arena, const char *str) {
+    /* Liczniki tylko rosną, więc ich suma zmienia się wraz z każdym z nich. */
+    uint32_t generation = arena->generations[0];
+    size_t offset = 0, span = 1, value = 0;
+    for (size_t i = 0; i < JUMP_DEPTH && str[i] != '\0'; i++) {
+        offset += span;
+        span *= ALLNUM;
+        value = value * ALLNUM + (size_t) symbolValue(str[i]);
+        generation += arena->generations[offset + value];
+    }
+    return generation;
+}
+
+/**
+ * @brief Wyznacza pierwszy węzeł drzewa @p root w porządku przejścia
+ * w głąb, w którym dzieci odwiedzane są rosnąco, leżący za poddrzewem
+ * węzła @p node.
+ * @param arena - wskaźnik na arenę drzewa.
+ * @param root - wskaźnik na korzeń drzewa.
+ * @param node - wskaźnik na węzeł drzewa.
+ * @return Wskaźnik na węzeł lub NULL, jeśli poddrzewo @p node jest ostatnie.
+ */
+static TrieNode *preorderSkip(TrieArena const *arena, TrieNode *root,
+                              TrieNode *node) {
+    while (node != root) {
+        TrieNode *parent = nodeAt(arena, node->parent);
+        /* Rodzeństwo o większych znakach od znaku węzła. */
+        uint32_t later = parent->bitmap & ~((2u << labelDigit(node, 0)) - 1);
+        if (later) return childAt(arena, parent, __builtin_ctz(later));
+        node = parent;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Wyznacza następny po @p node węzeł drzewa @p root w porządku
+ * przejścia w głąb, w którym dzieci odwiedzane są rosnąco.
+ * @param arena - wskaźnik na arenę drzewa.
+ * @param root - wskaźnik na korzeń drzewa.
+ * @param node - wskaźnik na węzeł drzewa.
+ * @return Wskaźnik na następny węzeł lub NULL, jeśli @p node jest ostatni.
+ */
+static TrieNode *preorderNext(TrieArena const *arena, TrieNode *root,
+                              TrieNode *node) {
+    if (node->bitmap)
+        return childAt(arena, node, __builtin_ctz(node->bitmap));
+    return preorderSkip(arena, root, node);
+}
+
+/**
+ * @brief Wyznacza pierwszy węzeł drzewa @p root w porządku przejścia
+ * w głąb, którego ciąg jest większy od upakowanego numeru @p num.
+ * Schodzi wzdłuż @p num, więc działa w czasie proporcjonalnym do jego
+ * długości.
+ * @param arena - wskaźnik na arenę drzewa.
+ * @param root - wskaźnik na korzeń drzewa.
+ * @param num - wskaźnik na upakowany numer.
+ * @return Wskaźnik na węzeł lub NULL, jeśli takiego nie ma.
+ */
+static TrieNode *preorderAfter(TrieArena const *arena, TrieNode *root,
+                               uint8_t const *num) {
+    size_t length, i = 0;
+    uint8_t const *digits = packedDigits(num, &length);
+    TrieNode *node = root;
+
+    while (i < length) {
+        int digit = packedSymbol(digits, i);
+        TrieNode *child = childAt(arena, node, digit);
+        if (!child) {
+            /* Dzieci o większych znakach następują po numerze. */
+            uint32_t later = node->bitmap & ~((2u << digit) - 1);
+            if (later) return childAt(arena, node, __builtin_ctz(later));
+            return preorderSkip(arena, root, node);
+        }
+
+        for (unsigned k = 0; k < child->labelLength; k++) {
+            /* Ciąg dziecka zaczyna się od numeru lub różni się od niego. */
+            if (i + k == length) return child;
+            int diff = labelDigit(child, k) - packedSymbol(digits, i + k);
+            if (diff > 0) return child;
+            if (diff < 0) return preorderSkip(arena, root, child);
+        }
+        node = child;
+        i += child->labelLength;
+    }
+    return preorderNext(arena, root, node);
+}
+
+bool trieCollect(TrieArena const *arena, TrieNode *root, TrieRule **rules,
+                 size_t *count, char **text) {
+    size_t amount = 0, bytes = 0;
+    for (TrieNode *v = root; v; v = preorderNext(arena, root, v))
+        if (!v->hasList && v->value.seq) {
+            amount++;
+            bytes += packedLength(v->bound) + packedLength(v->value.seq) + 2;
+        }
+
+    *rules = malloc((amount ? amount : 1) * sizeof(TrieRule));
+    *text = malloc(bytes ? bytes : 1);
+    if (!*rules || !*text) {
+        free(*rules);
+        free(*text);
+        return false;
+    }
+
+    char *out = *text;
+    TrieRule *rule = *rules;
+    for (TrieNode *v = root; v; v = preorderNext(arena, root, v))
+        if (!v->hasList && v->value.seq) {
+            rule->source = out;
+            rule->sourceLength = packedLength(v->bound);
+            numUnpackEncoded(v->bound, out);
+            out += rule->sourceLength + 1;
+
+            rule->target = out;
+            rule->targetLength = packedLength(v->value.seq);
+            numUnpackEncoded(v->value.seq, out);
+            out += rule->targetLength + 1;
+            rule++;
+        }
+    *count = amount;
+    return true;
+}
+
+/**
+ * Stan jednego z wyszukiwań przeplatanych przez trieFindSeqBatch().
+ */
+typedef struct BatchWalk {
+    size_t idx; /**< Indeks wyszukiwanego ciągu. */
+    size_t pos; /**< Liczba dopasowanych znaków ciągu. */
+    TrieNode *next; /**< Dziecko, którego etykieta ma zostać dopasowana
+                         w następnym kroku. Jego linia pamięci została już
+                         zażądana instrukcją prefetch. */
+} BatchWalk;
+
+/**
+ * @brief Rozpoczyna wyszukiwanie @p idx-tego z ciągów @p strs z korzenia
+ * @p root.
+ * W drzewie ciągów głowę ciągu pomija tablica skoków, która wyznacza też
+ * najdłuższy prefiks o niepustej wartości nie dłuższy od głowy.
+ * @param[in] arena - wskaźnik na arenę, z której pochodzą węzły drzewa.
+ * @param[in] root - wskaźnik na korzeń drzewa.
+ * @param[in] strs - tablica ciągów znaków.
+ * @param[in] idx - indeks ciągu.
+ * @param[out] found - tablica, w której zapisywane są znalezione węzły.
+ * @param[out] lengths - tablica, w której zapisywane są długości
+ *                       znalezionych prefiksów.
+ * @return Stan wyszukiwania, którego pierwszy węzeł do dopasowania jest NULL,
+ * jeśli nie istnieje.
+ */
+static inline BatchWalk batchStart(TrieArena const *arena, TrieNode *root,
+                                   const char *const *strs, size_t idx,
+                                   TrieNode **found, size_t *lengths) {
+    const char *str = strs[idx];
+    size_t pos = 0, head;
+
+    if (root == arena->fwds && jumpIndex(str, &head)) {
+        JumpEntry const *jump = &arena->jump[head];
+        root = nodeAt(arena, jump->node);
+        pos = jump->depth;
+        found[idx] = nodeAt(arena, jump->best);
+        lengths[idx] = jump->bestLength;
+    }
+
+    TrieNode *child = str[pos] == '\0' ? NULL :
+                      childAt(arena, root, symbolValue(str[pos]));
+    if (child) __builtin_prefetch(child);
+    return (BatchWalk) {idx, pos, child};
+}
+
+void trieFindSeqBatch(TrieArena const *arena, TrieNode *root,
+                      const char *const *strs, size_t n, TrieNode **found,
+                      size_t *lengths) {
+    for (size_t i = 0; i < n; i++) {
+        found[i] = NULL;
+        lengths[i] = 0;
+    }
+    if (!root) return;
+
+    BatchWalk walks[BATCH_WIDTH];
+    size_t active = 0, started = 0;
+    while (active < BATCH_WIDTH && started < n) {
+        walks[active] = batchStart(arena, root, strs, started, found,
+                                   lengths);
+        started++;
+        active++;
+    }
+
+    /* Każdy krok wyszukiwania dopasowuje węzeł, którego linię pamięci
+     * zażądano krok wcześniej, i żąda linii następnego węzła. Zanim wrócimy
+     * do tego samego wyszukiwania, pozostałe wykonują swoje kroki, więc
+     * oczekiwanie na pamięć się nakłada. */
+    size_t w = 0;
+    while (active > 0) {
+        BatchWalk *walk = &walks[w];
+        TrieNode *node = walk->next;
+        const char *str = strs[walk->idx];
+        bool done = !node;
+
+        if (!done) {
+            unsigned matched = labelMatch(node, str + walk->pos);
+            if (matched < node->labelLength) {
+                done = true;
+            }
+            else {
+                walk->pos += matched;
+                if (node->value.seq) {
+                    found[walk->idx] = node;
+                    lengths[walk->idx] = walk->pos;
+                }
+                walk->next = str[walk->pos] == '\0' ? NULL :
+                             childAt(arena, node,
+                                     symbolValue(str[walk->pos]));
+                if (walk->next) __builtin_prefetch(walk->next);
+                done = !walk->next;
+            }
+        }
+
+        if (done) {
+            if (started < n) {
+                *walk = batchStart(arena, root, strs, started, found,
+                                   lengths);
+                started++;
+            }
+            else {
+                *walk = walks[--active];
+                if (w >= active) w = 0;
+                continue;
+            }
+        }
+        if (++w >= active) w = 0;
+    }
+}
+
+void trieWalkStart(TrieWalk *walk, TrieNode *root) {
+    walk->node = root;
+    walk->depth = 0;
+    walk->prefix = NULL;
+}
+
+bool trieWalkIsLongest(TrieArena const *arena, TrieWalk *walk,
+                       uint8_t const *prefix, const char *rest) {
+    size_t length, previousLength, i = 0;
+    uint8_t const *digits = packedDigits(prefix, &length);
+
+    /* Wracamy do najgłębszego węzła, którego ciąg jest wspólnym prefiksem
+     * poprzedniego i bieżącego prefiksu. */
+    if (walk->prefix) {
+        uint8_t const *previous = packedDigits(walk->prefix, &previousLength);
+        while (i < length && i < previousLength && i < walk->depth &&
+               packedSymbol(previous, i) == packedSymbol(digits, i))
+            i++;
+    }
+    while (walk->depth > i) {
+        walk->depth -= walk->node->labelLength;
+        walk->node = trieGetParent(arena, walk->node);
+    }
+    walk->prefix = prefix;
+
+    TrieNode *node = walk->node, *child;
+    while (walk->depth < length) {
+        child = childAt(arena, node, packedSymbol(digits, walk->depth));
+        if (!child || walk->depth + child->labelLength > length) return false;
+        for (unsigned k = 0; k < child->labelLength; k++)
+            if (labelDigit(child, k) != packedSymbol(digits, walk->depth + k))
+                return false;
+
+        walk->depth += child->labelLength;
+        walk->node = node = child;
+    }
+    if (!node->value.seq) return false;
+
+    /* Prefiks jest najdłuższy, jeśli żaden węzeł na ścieżce reszty ciągu nie
+     * ma wartości. */
+    for (i = 0; rest[i] != '\0'; i += child->labelLength) {
+        child = childAt(arena, node, symbolValue(rest[i]));
+        if (!child || labelMatch(child, rest + i) < child->labelLength) break;
+        if (child->value.seq) return false;
+        node = child;
+    }
+    return true;
+}
+
+/**
+ * @brief Dzieli etykietę dziecka @p child węzła @p parent po @p at znakach.
+ * Wstawia między @p parent a @p child nowy węzeł z początkowymi @p at znakami
+ * etykiety @p child. Węzeł @p child zachowuje swoją wartość oraz skojarzenia.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param parent - wskaźnik na rodzica dzielonego węzła.
+ * @param child - wskaźnik na dzielony węzeł.
+ * @param at - długość etykiety nowego węzła, mniejsza od długości etykiety
+ *             @p child.
+ * @return Wskaźnik na nowy węzeł lub NULL, gdy nie udało się alokować pamięci.
+ */
+static TrieNode *trieSplit(TrieArena *arena, TrieNode *parent, TrieNode *child,
+                           unsigned at) {
+    uint64_t head = child->label & ((UINT64_C(1) << (4 * at)) - 1);
+    TrieNode *middle = trieNodeAlloc(arena, parent->self, head, at,
+                                     child->hasList);
+    if (!middle) return NULL;
+
+    replaceChild(arena, parent, labelDigit(child, 0), middle->self);
+    child->label >>= 4 * at;
+    child->labelLength -= at;
+    child->parent = middle->self;
+    /* Pierwsze dziecko mieści się w węźle, więc dołączenie się powiedzie. */
+    linkChild(arena, middle, labelDigit(child, 0), child->self);
+
+    return middle;
+}
+
+TrieNode *trieInsertStr(TrieArena *arena, TrieNode **rootPtr, const char *str,
+                        bool hasList) {
+    if (!(*rootPtr)) *rootPtr = trieNodeNew(arena, hasList);
+    if (!(*rootPtr)) return NULL;
+
+    int idx;
+    TrieNode *v = *rootPtr, *child;
+    size_t i = 0, common = 0;
+    unsigned length;
+    uint64_t label;
+    bool created;
+
+    while (str[i] != '\0') {
+        idx = symbolValue(str[i]);
+        child = childAt(arena, v, idx);
+        created = !child;
+        if (!child) {
+            length = readLabel(str + i, &label);
+            child = trieNodeAlloc(arena, v->self, label, length, hasList);
+            if (child && !linkChild(arena, v, idx, child->self)) {
+                arenaFree(arena->nodes, child->self);
+                child = NULL;
+            }
+        }
+        else {
+            length = labelMatch(child, str + i);
+            if (length < child->labelLength) {
+                child = trieSplit(arena, v, child, length);
+                created = true;
+            }
+        }
+
+        if (!child) {
+            /* Usuwamy puste węzły utworzone przez to wywołanie. */
+            trieCutLeaves(arena, v);
+            if (common) jumpRefreshStr(arena, str, common);
+            return NULL;
+        }
+        /* Nowy węzeł płytszy od głów zmienia przejścia głów zaczynających
+         * się od ciągu jego rodzica i pierwszego znaku jego etykiety. */
+        if (created && !hasList && !common && i + length <= JUMP_DEPTH)
+            common = i + 1;
+        i += length;
+        v = child;
+    }
+
+    if (common) jumpRefreshStr(arena, str, common);
+    return v;
+}
+
+/**
+ * @brief Usuwa ze zbioru @p revived ciągi zaczynające się od @p prefix.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param prefix - wskaźnik na upakowany numer.
+ */
+static void revivedDrop(TrieArena *arena, uint8_t const *prefix) {
+    size_t pos = setRank(arena->revived, prefix);
+    uint8_t const *num;
+    while ((num = setGet(arena->revived, pos)) &&
+           packedComparePrefix(num, prefix) == 0) {
+        arena->revived = setRemove(arena->revived, num);
+        poolRelease(arena->pool, num);
+    }
+}
+
+/**
+ * @brief Zapamiętuje odłączane poddrzewo @p node o ciągu @p str.
+ * Dopisuje poddrzewo do kolejki areny, a jego ciąg do zbioru ciągów
+ * odłączonych poddrzew, usuwając z niego ciągi zaczynające się od @p str.
+ * Jeśli @p str leży już w odłączonym poddrzewie, bo jego węzły przypisano
+ * ponownie (zobacz trieSettle()), to zbiór się nie zmienia, a usunięcie
+ * obejmującego go ciągu ze zbioru przechodzi na nowe poddrzewo, zwalniane
+ * jako ostatnie.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param node - wskaźnik na korzeń poddrzewa drzewa ciągów.
+ * @param str - ciąg znaków, od którego zaczynają się ciągi poddrzewa.
+ * @param length - długość @p str.
+ * @param rootLength - długość ciągu korzenia, nie mniejsza od @p length.
+ * @return Wartość @p true, jeśli się udało. Wartość @p false, jeśli nie
+ * udało się alokować pamięci; wówczas arena pozostaje bez zmian.
+ */
+static bool detachedAdd(TrieArena *arena, TrieNode *node, const char *str,
+                        size_t length, size_t rootLength) {
+    if (arena->sweepCount == arena->sweepSize) {
+        size_t size = arena->sweepSize ? 2 * arena->sweepSize : 4;
+        Detached *sweep = realloc(arena->sweep, size * sizeof(Detached));
+        if (sweep) arena->sweep = sweep;
+        size_t *sorted = realloc(arena->sweepSorted, size * sizeof(size_t));
+        if (sorted) arena->sweepSorted = sorted;
+        if (!sweep || !sorted) return false;
+        arena->sweepSize = size;
+    }
+
+    uint8_t const *prefix = poolInternStr(arena->pool, str, length);
+    if (!prefix) return false;
+
+    uint8_t const *cover = detachedCover(arena, prefix);
+    if (cover) {
+        for (size_t i = arena->sweepCount; i-- > arena->sweepFirst;)
+            if (arena->sweep[i].cover == cover) {
+                arena->sweep[i].cover = NULL;
+                break;
+            }
+    }
+    else {
+        SortedSet *detached = setInsert(arena->detached, prefix);
+        if (!detached) {
+            poolRelease(arena->pool, prefix);
+            return false;
+        }
+
+        /* Ciągi poddrzew odłączonych wcześniej wewnątrz nowego następują
+         * w zbiorze bezpośrednio po jego ciągu. */
+        size_t pos = setRank(detached, prefix) + 1;
+        while (pos < setGetAmount(detached) &&
+               packedComparePrefix(setGet(detached, pos), prefix) == 0)
+            detached = setRemove(detached, setGet(detached, pos));
+        arena->detached = detached;
+        /* Numer jest już w puli, więc jego kolejne odwołanie zawsze się
+         * udaje. */
+        cover = poolIntern(arena->pool, prefix);
+    }
+
+    /* Przypisane ponownie węzły poddrzewa znów czekają na zwolnienie. */
+    revivedDrop(arena, prefix);
+    arena->sweep[arena->sweepCount] = (Detached) {node, prefix, rootLength,
+                                                  cover};
+
+    /* Nowe poddrzewo następuje po wcześniejszych o równym ciągu. */
+    size_t lo = 0, hi = arena->sweepCount - arena->sweepFirst;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (packedCompare(arena->sweep[arena->sweepSorted[mid]].prefix,
+                          prefix) <= 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    memmove(&arena->sweepSorted[lo + 1], &arena->sweepSorted[lo],
+            (arena->sweepCount - arena->sweepFirst - lo) * sizeof(size_t));
+    arena->sweepSorted[lo] = arena->sweepCount++;
+    return true;
+}
+
+/**
+ * @brief Usuwa pierwsze poddrzewo kolejki z tablicy @p sweepSorted.
+ * Poprzedza ono w tablicy późniejsze poddrzewa o równym ciągu.
+ * @param arena - wskaźnik na arenę drzew z niepustą kolejką poddrzew.
+ */
+static void detachedSortedPop(TrieArena *arena) {
+    uint8_t const *prefix = arena->sweep[arena->sweepFirst].prefix;
+    size_t lo = 0, hi = arena->sweepCount - arena->sweepFirst;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (packedCompare(arena->sweep[arena->sweepSorted[mid]].prefix,
+                          prefix) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    memmove(&arena->sweepSorted[lo], &arena->sweepSorted[lo + 1],
+            (arena->sweepCount - arena->sweepFirst - lo - 1) *
+            sizeof(size_t));
+}
+
+void trieRemoveStr(TrieArena *arena, TrieNode *root, const char *str) {
+    if (!root) return;
+
+    TrieNode *v = root;
+    size_t i = 0;
+    unsigned matched = 0;
+    while (v && str[i] != '\0') {
+        v = childAt(arena, v, symbolValue(str[i]));
+        if (v) {
+            matched = labelMatch(v, str + i);
+            i += matched;
+            /* Jeśli ciąg kończy się wewnątrz etykiety, to usuwamy całe
+             * poddrzewo węzła; jeśli różni się od niej, to nic nie usuwamy. */
+            if (matched < v->labelLength && str[i] != '\0') v = NULL;
+        }
+    }
+
+    if (v && v != root) {
+        /* Ciąg rodzica v to początkowe znaki str aż do etykiety v. */
+        size_t start = i - matched;
+        bool jump = !v->hasList && start + v->labelLength <= JUMP_DEPTH;
+        if (!v->hasList) generationTouch(arena, str, i);
+
+        TrieNode *parent = nodeAt(arena, v->parent);
+        unlinkChild(arena, parent, labelDigit(v, 0));
+        trieCutLeaves(arena, parent);
+        /* Poddrzewo drzewa ciągów zwalnia później trieSweep(); jeśli nie uda
+         * się go zapamiętać, to zwalniamy je od razu. */
+        if (v->hasList ||
+            !detachedAdd(arena, v, str, i, start + v->labelLength))
+            trieDelete(arena, v);
+
+        if (jump) jumpRefreshStr(arena, str, start + 1);
+    }
+}
+
+/**
+ * @brief Odbudowuje porzucony indeks najdłuższych prefiksów porcjami.
+ * Odbudowę rozpoczyna, gdy żaden prefiks nie jest dłuższy od
+ * @ref LPM_MAX_LENGTH, a wszystkie poddrzewa zostały zwolnione i węzły
+ * dodane wewnątrz nich zaindeksowane. Przekierowane węzły dodawane są
+ * w porządku przejścia w głąb, więc żaden nie jest prefiksem wcześniej
+ * dodanego i nie trzeba uaktualniać dłuższych ciągów. Ostatni dodany ciąg
+ * zapamiętuje @p indexCursor, aby kolejna porcja zaczęła się za nim,
+ * nawet jeśli jego węzeł zostanie w międzyczasie usunięty. Węzły nie dalsze
+ * od niego uaktualniają indeks na bieżąco (zobacz indexReaches()).
+ * @param arena - wskaźnik na arenę drzew bez odłączonych poddrzew.
+ * @param budget - największa liczba dodawanych węzłów.
+ * @return Pozostała część @p budget.
+ */
+static size_t indexRebuild(TrieArena *arena, size_t budget) {
+    if (!lpmIsLoading(arena->lpm)) {
+        if (lpmIsValid(arena->lpm) || arena->oversized || arena->deferred)
+            return budget;
+        /* Odbudowa mogła zostać przerwana porzuceniem indeksu. */
+        poolRelease(arena->pool, arena->indexCursor);
+        arena->indexCursor = NULL;
+
+        uint64_t lengths = 0;
+        for (size_t l = 1; l <= LPM_MAX_LENGTH; l++)
+            if (arena->lengths[l]) lengths |= UINT64_C(1) << (l - 1);
+        lpmReset(arena->lpm, lengths);
+    }
+
+    TrieNode *node = !arena->indexCursor ? arena->fwds
+                     : preorderAfter(arena, arena->fwds, arena->indexCursor);
+    TrieNode *last = NULL, *previous;
+    for (; node && budget > 0; node = preorderNext(arena, arena->fwds, node))
+        if (node->value.seq) {
+            budget--;
+            node->indexed = true;
+            if (!lpmInsert(arena->lpm, node, node->bound, &previous)) break;
+            last = node;
+        }
+
+    if (last) {
+        uint8_t const *cursor = poolIntern(arena->pool, last->bound);
+        poolRelease(arena->pool, arena->indexCursor);
+        arena->indexCursor = cursor;
+    }
+    if (!node && lpmIsLoading(arena->lpm)) {
+        lpmCompact(arena->lpm);
+        poolRelease(arena->pool, arena->indexCursor);
+        arena->indexCursor = NULL;
+    }
+    return budget;
+}
+
+/**
+ * @brief Odbudowuje porzucone zbiory przysłoniętych prefiksów porcjami.
+ * Zbiory są uaktualniane przy każdej zmianie przekierowań także po
+ * porzuceniu, a usuwane ciągi zawsze je opuszczają, więc błędna może być
+ * jedynie przynależność ciągów, których uaktualnienia nie udało się
+ * wykonać. Przegląd ustawia na nowo przynależność każdego przekierowanego
+ * węzła w porządku przejścia w głąb; węzły już przejrzane pozostają
+ * poprawne dzięki bieżącym uaktualnieniom. Ostatni przejrzany ciąg
+ * zapamiętuje @p shadowedCursor, a porzucenie zbiorów w trakcie przeglądu
+ * rozpoczyna go od nowa.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param budget - największa liczba przeglądanych węzłów.
+ */
+static void shadowedRebuild(TrieArena *arena, size_t budget) {
+    if (arena->shadowedValid) return;
+    arena->shadowedLoading = true;
+
+    TrieNode *node = !arena->shadowedCursor
+                         ? arena->fwds
+                         : preorderAfter(arena, arena->fwds,
+                                         arena->shadowedCursor);
+    TrieNode *last = NULL;
+    for (; node && budget > 0; node = preorderNext(arena, arena->fwds, node))
+        if (node->value.seq) {
+            budget--;
+            if (!shadowedMark(arena, node, NULL, fwdIsShadowed(arena, node)))
+                return;
+            last = node;
+        }
+
+    if (!node) {
+        poolRelease(arena->pool, arena->shadowedCursor);
+        arena->shadowedCursor = NULL;
+        arena->shadowedLoading = false;
+        arena->shadowedValid = true;
+    }
+    else if (last) {
+        uint8_t const *cursor = poolIntern(arena->pool, last->bound);
+        poolRelease(arena->pool, arena->shadowedCursor);
+        arena->shadowedCursor = cursor;
+    }
+}
+
+bool trieSweep(TrieArena *arena, size_t budget) {
+    while (budget > 0 && arena->sweepFirst < arena->sweepCount) {
+        Detached *tree = &arena->sweep[arena->sweepFirst];
+
+        /* Zwalniamy węzły od liści, jak trieDelete(), więc dłuższe prefiksy
+         * opuszczają indeks wcześniej. Przerwane zwalnianie wznawiane jest
+         * od korzenia poddrzewa. */
+        if (!subtreeFree(arena, tree->root, &budget)) break;
+
+        /* Korzeń został zwolniony. Ciągu nie ma w zbiorze, jeśli poddrzewo
+         * leżało w później odłączonym poddrzewie. */
+        if (tree->cover) {
+            size_t pos = setRank(arena->detached, tree->cover);
+            if (setGet(arena->detached, pos) == tree->cover) {
+                arena->detached = setRemove(arena->detached, tree->cover);
+                revivedDrop(arena, tree->cover);
+            }
+            poolRelease(arena->pool, tree->cover);
+        }
+        detachedSortedPop(arena);
+        poolRelease(arena->pool, tree->prefix);
+        arena->sweepFirst++;
+    }
+
+    unboundFlush(arena);
+
+    if (arena->sweepFirst < arena->sweepCount) return false;
+    arena->sweepFirst = arena->sweepCount = 0;
+    /* Pozostały limit przypada węzłom dodanym wewnątrz poddrzew, a potem
+     * odbudowie porzuconego indeksu i zbiorów przysłoniętych prefiksów. */
+    shadowedRebuild(arena, indexRebuild(arena, indexDeferred(arena, budget)));
+    return !arena->deferred && !lpmIsLoading(arena->lpm) &&
+           !arena->shadowedLoading;
+}
+
+bool trieIndexRefresh(TrieArena *arena) {
+    return lpmIsValid(arena->lpm) && lpmCompact(arena->lpm);
+}
+
+bool trieIndexState(TrieArena const *arena, size_t *lengths, size_t *depth) {
+    *lengths = lpmLengths(arena->lpm);
+    *depth = lpmDepth(arena->lpm);
+    return lpmIsValid(arena->lpm);
+}
+
+/**
+ * @brief Porównuje znaki ciągu @p num z upakowanym numerem @p packed.
+ * @param[in] packed - wskaźnik na upakowany numer.
+ * @param[in] num - poprawny ciąg znaków.
+ * @param[in] length - długość @p num.
+ * @return Zero, jeśli @p packed jest prefiksem @p num lub mu równy.
+ * W przeciwnym wypadku wartość ujemna lub dodatnia, jeśli @p num jest
+ * odpowiednio mniejszy lub większy od @p packed.
+ */
+static int strComparePrefix(uint8_t const *packed, const char *num,
+                            size_t length) {
+    size_t packedLen;
+    uint8_t const *digits = packedDigits(packed, &packedLen);
+    for (size_t i = 0; i < packedLen; i++) {
+        if (i == length) return -1;
+        int diff = symbolValue(num[i]) - packedSymbol(digits, i);
+        if (diff != 0) return diff;
+    }
+    return 0;
+}
+
+/**
+ * @brief Wyszukuje w odłączonym poddrzewie @p tree węzeł o ciągu @p str.
+ * Zakłada, że ciąg poddrzewa jest prefiksem @p str.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param tree - wskaźnik na odłączone poddrzewo.
+ * @param str - poprawny ciąg znaków.
+ * @param length - długość @p str.
+ * @return Wskaźnik na węzeł lub NULL, jeśli poddrzewo go nie zawiera.
+ */
+static TrieNode *detachedFind(TrieArena const *arena, Detached const *tree,
+                              const char *str, size_t length) {
+    TrieNode *node = tree->root;
+    size_t depth = tree->length;
+    if (depth > length ||
+        labelMatch(node, str + depth - node->labelLength) <
+        node->labelLength)
+        return NULL;
+
+    while (node && depth < length) {
+        node = childAt(arena, node, symbolValue(str[depth]));
+        if (node) {
+            unsigned matched = labelMatch(node, str + depth);
+            if (matched < node->labelLength) return NULL;
+            depth += matched;
+        }
+    }
+    return node;
+}
+
+/**
+ * @brief Wyszukuje w odłączonych poddrzewach ostatnio odłączony węzeł
+ * o ciągu @p str, który zachował ciąg z puli.
+ * Węzeł może leżeć jedynie w poddrzewie, którego ciąg jest prefiksem
+ * @p str, więc dla każdej długości od @p from do @p length poddrzewa
+ * o takim ciągu wyszukiwane są binarnie w tablicy @p sweepSorted,
+ * od ostatnio odłączonego. Pozostałe poddrzewa kolejki nie są przeglądane.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param str - poprawny ciąg znaków.
+ * @param length - długość @p str.
+ * @param from - długość, od której ciągi poddrzew mogą być prefiksami
+ *               @p str.
+ * @return Wskaźnik na węzeł lub NULL, jeśli takiego nie ma.
+ */
+static TrieNode *detachedNode(TrieArena const *arena, const char *str,
+                              size_t length, size_t from) {
+    size_t count = arena->sweepCount - arena->sweepFirst, newest = 0;
+    TrieNode *found = NULL;
+
+    for (size_t len = from; len <= length; len++) {
+        /* Szukamy pierwszego poddrzewa o ciągu większym od len początkowych
+         * znaków str. */
+        size_t lo = 0, hi = count;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            uint8_t const *prefix =
+                arena->sweep[arena->sweepSorted[mid]].prefix;
+            int cmp = strComparePrefix(prefix, str, len);
+            if (cmp > 0 || (cmp == 0 && packedLength(prefix) <= len))
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        while (lo-- > 0) {
+            size_t i = arena->sweepSorted[lo];
+            Detached const *tree = &arena->sweep[i];
+            if (packedLength(tree->prefix) != len ||
+                strComparePrefix(tree->prefix, str, len) != 0 ||
+                (found && i < newest))
+                break;
+
+            TrieNode *node = detachedFind(arena, tree, str, length);
+            if (node && node->bound) {
+                found = node;
+                newest = i;
+                break;
+            }
+        }
+    }
+    return found;
+}
+
+void trieSettle(TrieArena *arena, const char *str, size_t length) {
+    if (!arena->detached) return;
+
+    /* Ciągi zbioru nie są swoimi prefiksami, więc te mniejsze od str, które
+     * nie są jego prefiksami, poprzedzają jego prefiks. */
+    size_t lo = 0, hi = setGetAmount(arena->detached);
+    uint8_t const *cover = NULL;
+    while (lo < hi && !cover) {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = strComparePrefix(setGet(arena->detached, mid), str, length);
+        if (cmp == 0) cover = setGet(arena->detached, mid);
+        else if (cmp < 0) hi = mid;
+        else lo = mid + 1;
+    }
+    if (!cover) return;
+
+    size_t amount = setGetAmount(arena->revived);
+    uint8_t const *num = poolInternStr(arena->pool, str, length);
+    SortedSet *revived = num ? setInsert(arena->revived, num) : NULL;
+    if (!revived) {
+        poolRelease(arena->pool, num);
+        trieSweep(arena, SIZE_MAX);
+        return;
+    }
+    if (setGetAmount(revived) == amount) poolRelease(arena->pool, num);
+    arena->revived = revived;
+
+    /* Ciąg str ma co najwyżej jeden węzeł z wartością w odłączonych
+     * poddrzewach: węzły odłączone wcześniej odłączyło już ich ponowne
+     * przypisanie. Jego ciąg opuszcza od razu zbiór węzła drzewa
+     * odwrotnego, zaś w indeksie zostaje, dopóki trieSweep() nie zwolni
+     * węzła od liści. Nowa wartość str trafi do indeksu po zwolnieniu
+     * poddrzew (zobacz indexAdd()), więc indeks pozostaje ważny. */
+    TrieNode *node = detachedNode(arena, str, length, packedLength(cover));
+    if (node && node->value.seq) {
+        /* Numer jest już w puli, więc jego kolejne odwołanie zawsze się
+         * udaje. */
+        uint8_t const *bound = poolIntern(arena->pool, node->bound);
+        trieNodeUnbind(arena, node);
+        poolRelease(arena->pool, node->value.seq);
+        node->value.seq = NULL;
+        node->bound = bound;
+    }
+}
+
+bool trieHasDetached(TrieArena const *arena) {
+    return arena->sweepFirst < arena->sweepCount || arena->deferred ||
+           lpmIsLoading(arena->lpm) || arena->shadowedLoading;
+}
+
+bool trieIsDetached(TrieArena const *arena, uint8_t const *num) {
+    if (!arena->detached || !detachedCover(arena, num)) return false;
+
+    uint8_t const *revived = setGet(arena->revived,
+                                    setRank(arena->revived, num));
+    return !revived || packedCompare(revived, num) != 0;
+}
+
+/**
+ * @brief Zlicza ciągi zbioru @p set przypisane ponownie wewnątrz
+ * odłączonego poddrzewa o ciągu @p prefix.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param set - wskaźnik na zbiór lub NULL.
+ * @param prefix - wskaźnik na upakowany numer.
+ * @return Liczba ciągów zbioru @p set, które zaczynają się od @p prefix
+ * i należą do zbioru ciągów przypisanych ponownie.
+ */
+static size_t revivedCount(TrieArena const *arena, SortedSet const *set,
+                           uint8_t const *prefix) {
+    size_t count = 0, i = setRank(arena->revived, prefix);
+    size_t end = i + setCountPrefixed(arena->revived, prefix);
+    for (; i < end; i++) {
+        uint8_t const *num = setGet(arena->revived, i);
+        uint8_t const *found = setGet(set, setRank(set, num));
+        count += found && packedCompare(found, num) == 0;
+    }
+    return count;
+}
+
+size_t trieCountDetached(TrieArena const *arena, SortedSet const *set,
+                         uint8_t const *prefix) {
+    if (!arena->detached || !setGetAmount(set)) return 0;
+
+    size_t first = prefix ? setRank(set, prefix) : 0;
+    size_t amount = prefix ? setCountPrefixed(set, prefix)
+                           : setGetAmount(set);
+    if (amount == 0) return 0;
+    if (prefix && detachedCover(arena, prefix))
+        return amount - revivedCount(arena, set, prefix);
+
+    /* Ciągi odłączonych poddrzew nie są swoimi prefiksami, więc każdy ciąg
+     * zbioru leży w co najwyżej jednym poddrzewie. Przeglądany jest
+     * mniejszy z obu przedziałów. */
+    size_t lo = prefix ? setRank(arena->detached, prefix) : 0;
+    size_t hi = prefix ? lo + setCountPrefixed(arena->detached, prefix)
+                       : setGetAmount(arena->detached);
+    size_t count = 0;
+    if (hi - lo > amount) {
+        for (size_t i = first; i < first + amount; i++)
+            count += trieIsDetached(arena, setGet(set, i));
+        return count;
+    }
+    for (size_t i = lo; i < hi; i++) {
+        uint8_t const *root = setGet(arena->detached, i);
+        count += setCountPrefixed(set, root) - revivedCount(arena, set, root);
+    }
+    return count;
+}
+
+/**
+ * @brief Sprawdza, czy węzeł @p node ma znaczącą zawartość.
+ * Pusty zbiór reprezentowany jest przez wskaźnik NULL, zatem wystarcza
+ * sprawdzenie wartości węzła.
+ * @param node - wskaźnik na węzeł drzewa.
+ * @return Wartość @p true, jeśli węzeł zawiera ciąg znaków lub niepusty
+ * zbiór. Wartość @p false w przeciwnym wypadku.
+ */
+static bool trieNodeHasValue(TrieNode *node) {
+    return node->value.seq;
+}
+
+/**
+ * @brief Sprawdza, czy węzeł @p node jest pusty.
+ * @param node - wskaźnik na węzeł drzewa.
+ * @return Wartość @p true pod warunkiem, że węzeł nie ma dzieci i nie ma
+ * znaczącej zawartości. Wartość @p false w przeciwnym wypadku.
+ */
+static bool trieNodeIsEmpty(TrieNode *node) {
+    return !node->bitmap && !trieNodeHasValue(node);
+}
+
+/**
+ * @brief Scala węzeł @p node z jego jedynym dzieckiem.
+ * Nic nie robi, jeśli @p node jest korzeniem, ma znaczącą zawartość, nie ma
+ * dokładnie jednego dziecka lub łączna etykieta nie zmieściłaby się w węźle.
+ * Dziecko przejmuje etykietę @p node i zajmuje jego miejsce u rodzica, zatem
+ * zachowuje swoją wartość oraz skojarzenia.
+ * @param arena - wskaźnik na arenę drzew.
+ * @param node - wskaźnik na węzeł drzewa.
+ * @return Wartość @p true, jeśli węzeł został scalony.
+ */
+static bool trieMerge(TrieArena *arena, TrieNode *node) {
+    if (node->parent == ARENA_NULL || trieNodeHasValue(node) ||
+        popcount12(node->bitmap) != 1)
+        return false;
+
+    TrieNode *child = nodeAt(arena, node->children[0]);
+    if (node->labelLength + child->labelLength > LABEL_DIGITS) return false;
+
+    child->label = node->label | child->label << (4 * node->labelLength);
+    child->labelLength += node->labelLength;
+    child->parent = node->parent;
+    replaceChild(arena, nodeAt(arena, node->parent), labelDigit(node, 0),
+                 child->self);
+
+    arenaFree(arena->nodes, node->self);
+    return true;
+}
+
+void trieCutLeaves(TrieArena *arena, TrieNode *node) {
+    if (!node) return;
+
+    TrieNode *curr = node, *parent;
+    bool changed = false;
+    /* Korzeń drzewa nigdy nie jest usuwany. */
+    while (curr->parent != ARENA_NULL && trieNodeIsEmpty(curr)) {
+        parent = nodeAt(arena, curr->parent);
+        unlinkChild(arena, parent, labelDigit(curr, 0));
+        arenaFree(arena->nodes, curr->self);
+        curr = parent;
+        changed = true;
+    }
+
+    /* Usunięte węzły oraz węzeł curr, jeśli zostanie scalony, leżą na
+     * krawędzi do curr lub poniżej, więc głowy do odświeżenia wyznaczamy
+     * przed scaleniem. */
+    int head[JUMP_DEPTH];
+    size_t depth = 0, common = 0;
+    if (!curr->hasList) common = edgeHead(arena, curr, head, &depth);
+
+    /* Pierwszy niepusty węzeł mógł zostać z jednym dzieckiem. */
+    changed |= trieMerge(arena, curr);
+
+    if (changed && !curr->hasList && depth <= JUMP_DEPTH)
+        jumpRefresh(arena, head, common);
 }
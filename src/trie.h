@@ -4,6 +4,10 @@
  * wzajemnie zależnych drzew. Klasa implementuje strukturę @p TrieNode
  * zadeklarowaną w interfejsie @ref structs.h.
  *
+ * Wszystkie ciągi znaków przyjmowane przez drzewa są w kodowaniu
+ * wewnętrznym (zobacz @ref alphabet.h), zaś wartości węzłów przechowywane są
+ * jako upakowane numery (zobacz @ref packed.h).
+ *
  * @author Adam Greloch <ag438473@students.mimuw.edu.pl>
  * @copyright Uniwersytet Warszawski
  * @date 2022
@@ -14,63 +18,126 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include "structs.h"
-#include "linked_list.h"
+#include "sorted_set.h"
+#include "arena.h"
+
+/** @brief Tworzy arenę na węzły drzew.
+ * Tworzy arenę, z której przydzielane są węzły @p TrieNode oraz ich tablice
+ * dzieci, wraz z pulą ciągów znaków przechowywanych w węzłach. Jedna arena
+ * może obsługiwać dowolnie wiele drzew. Powstała arena musi być zwolniona za
+ * pomocą funkcji trieArenaDelete().
+ * @return Wskaźnik na utworzoną arenę lub NULL, gdy nie udało się alokować
+ * pamięci.
+ */
+TrieArena *trieArenaNew(void);
+
+/** @brief Usuwa arenę wraz ze wszystkimi drzewami, których węzły z niej
+ * pochodzą.
+ * Zwalnia wartości wszystkich węzłów areny, po czym zwalnia jej pamięć
+ * całymi slabami, bez przechodzenia po drzewach i bez usuwania skojarzeń
+ * między nimi. Nic nie robi, jeśli @p arena ma wartość NULL.
+ * @param[in,out] arena - wskaźnik na usuwaną arenę.
+ */
+void trieArenaDelete(TrieArena *arena);
+
+/** @brief Zwraca pulę ciągów znaków areny @p arena.
+ * @param[in] arena - wskaźnik na arenę.
+ * @return Wskaźnik na pulę wspólną dla wszystkich drzew areny.
+ */
+StringPool const *trieArenaGetPool(TrieArena const *arena);
 
-/** @brief Tworzy nowy węzeł.
- * Tworzy nowy węzeł @p TrieNode o pustej wartości. Powstały węzeł musi być
- * zwolniony za pomocą funkcji trieDelete().
- * @param[in] parent - wskaźnik na węzeł rodzica.
+/** @brief Tworzy nowy korzeń drzewa.
+ * Tworzy nowy węzeł @p TrieNode o pustej wartości i bez rodzica. Powstały
+ * węzeł musi być zwolniony za pomocą funkcji trieDelete() lub razem z areną.
+ * Korzeń drzewa przechowującego zbiory staje się drzewem odwrotnym areny,
+ * w którym trieNodeBind() umieszcza skojarzenia; arena ma jedno takie
+ * drzewo. Korzeń drzewa przechowującego ciągi otrzymuje tablicę skoków,
+ * która pozwala trieFindSeq() pominąć początkowe poziomy drzewa; również
+ * takie drzewo arena ma jedno.
+ * @param[in,out] arena - wskaźnik na arenę, z której przydzielany jest węzeł.
  * @param[in] hasList - wartość wskazująca typ zawartości drzewa.
- * @param[in] pointedBy - wskaźnik na wskaźnik na ten węzeł w tablicy dzieci
- * rodzica.
  * @return Wskaźnik na utworzoną strukturę lub NULL, gdy nie udało się
  * alokować pamięci.
  */
-TrieNode *trieNodeNew(TrieNode *parent, bool hasList, TrieNode **pointedBy);
+TrieNode *trieNodeNew(TrieArena *arena, bool hasList);
 
 /** @brief Usuwa drzewo zakorzenione w @p node.
- * Usuwa drzewo trie zakorzenione w węźle @p node. Zwalnia jego pamięć.
+ * Usuwa drzewo trie zakorzenione w węźle @p node. Zwraca jego węzły do areny.
+ * @param[in,out] arena - wskaźnik na arenę, z której pochodzą węzły drzewa.
  * @param[in,out] node - wskaźnik na korzeń drzewa do usunięcia.
  */
-void trieDelete(TrieNode *node);
-
-/** @brief Ustawia wartość w węźle @p node na ciąg znaków @p seq.
- * Ustawia wartość w węźle @p node drzewa trie na @p value. Zakłada
- * poprawność @p value.
- * @param[in,out] node - wskaźnik na węzeł w którym modyfikowana jest wartość.
- * @param[in] seq - ustawiany ciąg znaków.
- * @param[in] length - długość @p value (nie licząc znaku terminującego).
- * @return Wartość @p true, jeśli wartość została ustawiona. Wartość @p
- * false, jeśli węzeł @p node ma wartość NULL, węzeł jest niewłaściwego typu, bądź nie
- * udało się alokować pamięci.
- */
-bool trieNodeSetSeq(TrieNode *node, const char *seq, size_t length);
+void trieDelete(TrieArena *arena, TrieNode *node);
 
 /**
  * @brief Zwraca wskaźnik na ojca węzła @p node.
+ * @param arena - wskaźnik na arenę, z której pochodzą węzły drzewa.
  * @param node - wskaźnik na węzeł drzewa.
- * @return Wskaźnik na ojca, lub NULL, jeśli @p node ma wartość NULL.
+ * @return Wskaźnik na ojca, lub NULL, jeśli @p node ma wartość NULL lub jest
+ * korzeniem.
  */
-TrieNode *trieGetParent(TrieNode *node);
+TrieNode *trieGetParent(TrieArena const *arena, TrieNode *node);
 
-/** @brief Zwraca wartość węzła @p node jako poprawny ciąg znaków.
+/** @brief Zwraca wartość węzła @p node jako upakowany numer.
  * @param[in] node - wskaźnik na oglądany węzeł.
  * @return Wartość w @p node, bądź NULL, jeśli węzeł @p node ma wartość NULL
  * lub węzeł jest niewłaściwego typu.
  */
-const char *trieNodeGetSeq(TrieNode *node);
+uint8_t const *trieNodeGetSeq(TrieNode *node);
+
+/** @brief Zwraca długość etykiety węzła @p node.
+ * Etykietą nazywamy ciąg znaków na krawędzi od rodzica do węzła; głębokość
+ * węzła jest sumą długości etykiet na ścieżce od korzenia.
+ * @param[in] node - wskaźnik na oglądany węzeł.
+ * @return Długość etykiety lub zero, jeśli @p node ma wartość NULL lub jest
+ * korzeniem.
+ */
+size_t trieNodeGetLabelLength(TrieNode *node);
+
+/** @brief Zwraca wskaźnik na zbiór w węźle @p node.
+ * Elementy zbioru są posortowane, zatem można je odczytać w kolejności bez
+ * alokowania pamięci.
+ * @param[in] node - wskaźnik na oglądany węzeł.
+ * @return Wskaźnik na zbiór, bądź NULL, jeśli zbiór jest pusty, węzeł @p node
+ * ma wartość NULL, lub węzeł jest niewłaściwego typu.
+ */
+SortedSet *trieGetSources(TrieNode *node);
 
-/** @brief Zwraca wskaźnik na listę w węźle @p node.
+/** @brief Zwraca wskaźnik na zbiór przysłoniętych prefiksów w węźle @p node.
+ * Prefiks zbioru węzła drzewa odwrotnego jest przysłonięty, jeśli pewien
+ * jego przekierowany prefiks prowadzi do przodka węzła, a pozostałe znaki
+ * prefiksu są tymi samymi znakami, które dzielą przodka od węzła. Numer
+ * powstały z przysłoniętego prefiksu w przeciwobrazie powstaje więc również
+ * z krótszego prefiksu przodka. Zbiory uaktualniane są przy każdej zmianie
+ * przekierowań, zaś porzucane, gdy nie uda się przy tym alokować pamięci
+ * (zobacz trieShadowedIsValid()). Ciągi odłączonych poddrzew pozostają
+ * w zbiorach do zwolnienia, jak w zbiorze trieGetSources() (zobacz
+ * trieCountDetached()).
+ * @param[in] arena - wskaźnik na arenę, z której pochodzi węzeł.
  * @param[in] node - wskaźnik na oglądany węzeł.
- * @return Wskaźnik na listę, bądź NULL, jeśli węzeł @p node ma
- * wartość NULL, lub węzeł jest niewłaściwego typu.
+ * @return Wskaźnik na podzbiór trieGetSources(), bądź NULL, jeśli zbiór jest
+ * pusty, zbiory zostały porzucone, węzeł @p node ma wartość NULL, lub węzeł
+ * jest niewłaściwego typu.
+ */
+SortedSet *trieGetShadowed(TrieArena const *arena, TrieNode *node);
+
+/** @brief Sprawdza, czy zbiory przysłoniętych prefiksów areny są aktualne.
+ * Porzucone zbiory odbudowuje porcjami trieSweep(). Aktualne zbiory
+ * poprawnie opisują ciągi spoza odłączonych poddrzew także wtedy, gdy
+ * pewne poddrzewo czeka na zwolnienie.
+ * @param[in] arena - wskaźnik na arenę.
+ * @return Wartość @p false, jeśli zbiory zostały porzucone i nie zostały
+ * jeszcze odbudowane.
  */
-List *trieGetList(TrieNode *node);
+bool trieShadowedIsValid(TrieArena const *arena);
 
 /** @brief Znajduje najdłuższy prefiks @p str o niepustej wartości w drzewie.
  * Znajduje najdłuższy prefix ciągu @p str zawierający niepustą
  * wartość w drzewie zakorzenionym w @p root. Zakłada poprawność @p str.
+ * W drzewie przechowującym ciągi zaczyna przejście od węzła wskazanego przez
+ * tablicę skoków dla początkowych znaków @p str.
+ * @param[in] arena - wskaźnik na arenę, z której pochodzą węzły drzewa.
  * @param[in] root - wskaźnik na korzeń przeszukiwanego drzewa.
  * @param[in] str - ciąg znaków, dla którego szukany jest najdłuższy prefiks.
  * @param[in,out] length - wskaźnik na zmienną, w której zostanie zapisana
@@ -78,60 +145,304 @@ List *trieGetList(TrieNode *node);
  * @return Wskaźnik na węzeł kończący najdłuższy prefiks lub NULL, gdy @p root
  * ma wartość NULL, lub gdy szukany prefiks nie istnieje.
  */
-TrieNode *trieFindSeq(TrieNode *root, const char *str, size_t *length);
+TrieNode *trieFindSeq(TrieArena const *arena, TrieNode *root, const char *str,
+                      size_t *length);
+
+/** @brief Znajduje najdłuższy prefiks @p str o niepustej wartości w drzewie
+ * ciągów areny.
+ * Działa jak trieFindSeq(), lecz korzysta z indeksu najdłuższych prefiksów
+ * areny (zobacz @ref lpm.h), który zastępuje przejście po węzłach kilkoma
+ * sondami tablic haszujących. Jeśli indeks nie jest ważny, jest
+ * odbudowywany, zawiera jeszcze ciągi odłączonego poddrzewa lub brakuje mu
+ * ciągów dodanych wewnątrz niego (zobacz trieSweep()), to wywołuje
+ * trieFindSeq(). Indeks obejmuje drzewo, którego węzły otrzymują wartości
+ * funkcją trieNodeBind(), więc arena może mieć tylko jedno takie drzewo.
+ * @param[in] arena - wskaźnik na arenę, z której pochodzą węzły drzewa.
+ * @param[in] root - wskaźnik na korzeń drzewa przechowującego ciągi.
+ * @param[in] str - ciąg znaków, dla którego szukany jest najdłuższy prefiks.
+ * @param[in] length - długość @p str.
+ * @param[out] found - wskaźnik na zmienną, w której zostanie zapisana
+ *                     długość znalezionego prefiksu.
+ * @return Wskaźnik na węzeł kończący najdłuższy prefiks lub NULL, gdy szukany
+ * prefiks nie istnieje.
+ */
+TrieNode *trieFindSeqIndexed(TrieArena const *arena, TrieNode *root,
+                             const char *str, size_t length, size_t *found);
+
+/** @brief Zwraca licznik zmian przekierowań prefiksów ciągu @p str.
+ * Licznik zwiększa się przy każdej zmianie wartości lub usunięciu węzła
+ * drzewa przechowującego ciągi, którego ciąg jest prefiksem @p str. Jest
+ * sumą liczników kolejnych prefiksów @p str nie dłuższych od głów tablicy
+ * skoków. Zmiana węzła krótszego od głów zwiększa licznik tylko tych ciągów,
+ * które się od niego zaczynają, lecz zmiana węzła dłuższego zwiększa licznik
+ * wszystkich ciągów o tej samej głowie, także tych, których nie dotyczy.
+ * Niezmieniony licznik gwarantuje zatem, że trieFindSeq() zwróci dla @p str
+ * ten sam wynik co wcześniej.
+ * @param[in] arena - wskaźnik na arenę drzew.
+ * @param[in] str - poprawny ciąg znaków.
+ * @return Wartość licznika.
+ */
+uint32_t trieGeneration(TrieArena const *arena, const char *str);
+
+/** @brief Znajduje najdłuższe prefiksy o niepustej wartości dla wielu ciągów.
+ * Działa jak trieFindSeq() wywołane dla każdego z ciągów @p strs, lecz
+ * przeplata kroki do @ref BATCH_WIDTH wyszukiwań naraz i przed przejściem do
+ * kolejnego wyszukiwania żąda instrukcją prefetch węzła, który odwiedzi
+ * bieżące. Dzięki temu oczekiwanie na odczyty z pamięci w drzewie większym od
+ * pamięci podręcznej nakłada się. Zakłada poprawność ciągów, przy czym ciąg
+ * pusty jest dozwolony i nie ma prefiksów.
+ * @param[in] arena - wskaźnik na arenę, z której pochodzą węzły drzewa.
+ * @param[in] root - wskaźnik na korzeń przeszukiwanego drzewa lub NULL.
+ * @param[in] strs - tablica @p n ciągów znaków.
+ * @param[in] n - liczba ciągów.
+ * @param[out] found - tablica @p n wskaźników, w której zostaną zapisane
+ *                     węzły kończące najdłuższe prefiksy lub NULL.
+ * @param[out] lengths - tablica @p n długości znalezionych prefiksów.
+ */
+void trieFindSeqBatch(TrieArena const *arena, TrieNode *root,
+                      const char *const *strs, size_t n, TrieNode **found,
+                      size_t *lengths);
+
+/**
+ * Stan przejścia po drzewie wzdłuż kolejnych upakowanych prefiksów.
+ * Przejście do kolejnego prefiksu zaczyna się od węzła jego najdłuższego
+ * wspólnego prefiksu z poprzednim, więc prefiksy posortowane odwiedzają każdy
+ * węzeł wspólnych początków tylko raz.
+ */
+typedef struct TrieWalk {
+    TrieNode *node; /**< Węzeł, w którym zakończyło się ostatnie przejście. */
+    size_t depth; /**< Długość ciągu węzła @p node. */
+    uint8_t const *prefix; /**< Upakowany prefiks ostatniego przejścia, którego
+                                początkowe @p depth znaków jest ciągiem węzła
+                                @p node, lub NULL. */
+} TrieWalk;
+
+/** @brief Rozpoczyna przejście po drzewie zakorzenionym w @p root.
+ * @param[out] walk - wskaźnik na stan przejścia.
+ * @param[in] root - wskaźnik na korzeń drzewa.
+ */
+void trieWalkStart(TrieWalk *walk, TrieNode *root);
+
+/** @brief Sprawdza, czy @p prefix jest najdłuższym prefiksem o niepustej
+ * wartości ciągu powstałego z dołączenia @p rest do @p prefix.
+ * Przechodzi do węzła @p prefix, zaczynając od węzła wspólnego prefiksu
+ * z prefiksem poprzedniego wywołania, po czym schodzi z niego wzdłuż
+ * @p rest. Nie alokuje pamięci.
+ * @param[in] arena - wskaźnik na arenę, z której pochodzą węzły drzewa.
+ * @param[in,out] walk - wskaźnik na stan przejścia.
+ * @param[in] prefix - upakowany prefiks, niezmieniony i niezwolniony do
+ *                     następnego wywołania z tym samym stanem.
+ * @param[in] rest - poprawny ciąg znaków, być może pusty.
+ * @return Wartość @p true, jeśli węzeł @p prefix ma niepustą wartość, a żaden
+ * węzeł poniżej niego na ścieżce @p rest jej nie ma. Wartość @p false
+ * w przeciwnym wypadku.
+ */
+bool trieWalkIsLongest(TrieArena const *arena, TrieWalk *walk,
+                       uint8_t const *prefix, const char *rest);
 
 /** @brief Umieszcza ciąg @p str w drzewie.
  * Umieszcza ciąg @p str w drzewie zakorzenionym w @p *rootPtr. Zakłada
  * poprawność @p str.
+ * @param[in,out] arena - wskaźnik na arenę, z której pochodzą węzły drzewa.
  * @param[in,out] rootPtr - podwójny wskaźnik na drzewo.
  * @param[in] str - umieszczany ciąg znaków.
  * @param[in] hasList - wartość wskazująca typ drzewa.
  * @return Wskaźnik na węzeł kończący ciąg lub NULL, gdy nie udało się
  * alokować pamięci.
  */
-TrieNode *trieInsertStr(TrieNode **rootPtr, const char *str, bool hasList);
+TrieNode *trieInsertStr(TrieArena *arena, TrieNode **rootPtr, const char *str, bool hasList);
 
 /** @brief Usuwa wszystkie ciągi z drzewa, których prefiksem jest @p str.
- * Usuwa wszystkie ciągi z drzewa zakorzenionego w @p *rootPtr, których
+ * Usuwa wszystkie ciągi z drzewa zakorzenionego w @p root, których
  * prefiksem jest ciąg @p str. Zakłada poprawność @p str. Usuwa również
- * wszelkie zbędne węzły od @p *rootPtr do korzenia, jeśli takie napotka.
- * @param[in,out] rootPtr - podwójny wskaźnik na drzewo.
+ * wszelkie zbędne węzły na ścieżce do @p root, jeśli takie napotka.
+ * Sam korzeń nie jest usuwany.
+ * Poddrzewo drzewa ciągów jest jedynie odłączane w czasie proporcjonalnym do
+ * długości @p str, zaś jego węzły zwalnia później trieSweep(). Do tego czasu
+ * ciągi poddrzewa pozostają w zbiorach drzewa odwrotnego, a trieIsDetached()
+ * pozwala je pominąć. Jeśli nie uda się alokować pamięci na zapamiętanie
+ * poddrzewa, to jest ono zwalniane od razu.
+ * @param[in,out] arena - wskaźnik na arenę, z której pochodzą węzły drzewa.
+ * @param[in,out] root - wskaźnik na korzeń drzewa.
  * @param[in] str - ciąg znaków.
  */
-void trieRemoveStr(TrieNode **rootPtr, const char *str);
+void trieRemoveStr(TrieArena *arena, TrieNode *root, const char *str);
+
+/** @brief Zwalnia węzły poddrzew odłączonych przez trieRemoveStr().
+ * Poddrzewa zwalniane są w kolejności odłączenia, a każde od liści. Gdy
+ * żadne nie czeka, pozostały limit przypada przekierowaniom dodanym
+ * wewnątrz zwolnionych poddrzew, które trafiają wtedy do indeksu
+ * najdłuższych prefiksów, a następnie odbudowie indeksu porzuconego
+ * z braku pamięci lub z powodu prefiksu dłuższego niż @ref LPM_MAX_LENGTH
+ * i odbudowie porzuconych zbiorów przysłoniętych prefiksów (zobacz
+ * trieGetShadowed()). Odbudowa indeksu zaczyna się, gdy takich prefiksów
+ * już nie ma. Obie odbudowy przeglądają przekierowane węzły porcjami, więc
+ * ich koszt rozkłada się na kolejne wywołania.
+ * @param[in,out] arena - wskaźnik na arenę drzew.
+ * @param[in] budget - największa łączna liczba zwalnianych węzłów
+ *                     i dodawanych do indeksu przekierowań.
+ * @return Wartość @p true, jeśli żadne poddrzewo, przekierowanie ani
+ * odbudowa nie czeka. Wartość @p false w przeciwnym przypadku.
+ */
+bool trieSweep(TrieArena *arena, size_t budget);
+
+/** @brief Porządkuje indeks najdłuższych prefiksów areny.
+ * Z ważnego indeksu usuwa długości, których wszystkie prefiksy zostały
+ * usunięte (zobacz lpmCompact()). Porzucony indeks odbudowuje trieSweep().
+ * @param[in,out] arena - wskaźnik na arenę drzew.
+ * @return Wartość @p true, jeśli indeks jest ważny. Wartość @p false
+ * w przeciwnym przypadku.
+ */
+bool trieIndexRefresh(TrieArena *arena);
+
+/** @brief Podaje stan indeksu najdłuższych prefiksów areny.
+ * @param[in] arena - wskaźnik na arenę drzew.
+ * @param[out] lengths - wskaźnik na zmienną, w której zostanie zapisana
+ *                       liczba długości indeksu.
+ * @param[out] depth - wskaźnik na zmienną, w której zostanie zapisana
+ *                     największa liczba sond wyszukiwania w indeksie.
+ * @return Wartość @p true, jeśli indeks jest ważny, a trieFindSeqIndexed()
+ * korzysta z niego, gdy nic nie czeka na trieSweep(). Wartość @p false
+ * w przeciwnym przypadku.
+ */
+bool trieIndexState(TrieArena const *arena, size_t *lengths, size_t *depth);
+
+/** @brief Przygotowuje ciąg @p str leżący w odłączonym poddrzewie do
+ * ponownego przypisania.
+ * Wywoływana przed przypisaniem wartości ciągowi @p str, ponieważ jego
+ * węzeł w odłączonym poddrzewie mógłby mieć tę samą wartość w zbiorach
+ * drzewa odwrotnego. Usuwa więc ze zbioru jedynie ciąg tego węzła,
+ * wyszukanego wśród poddrzew, których ciągi są prefiksami @p str, i
+ * zapamiętuje @p str jako przypisany ponownie, tak by trieIsDetached() go
+ * nie pomijała. Węzeł pozostaje w indeksie najdłuższych prefiksów do
+ * zwolnienia przez trieSweep(), zaś nowa wartość trafia do indeksu dopiero
+ * po zwolnieniu poddrzew, więc indeks pozostaje ważny. Jeśli nie uda się
+ * alokować pamięci, to zwalnia wszystkie odłączone poddrzewa.
+ * @param[in,out] arena - wskaźnik na arenę drzew.
+ * @param[in] str - poprawny ciąg znaków.
+ * @param[in] length - długość @p str.
+ */
+void trieSettle(TrieArena *arena, const char *str, size_t length);
+
+/** @brief Sprawdza, czy upakowany numer @p num leży w odłączonym poddrzewie
+ * drzewa ciągów, którego węzły nie zostały jeszcze zwolnione.
+ * @param[in] arena - wskaźnik na arenę drzew.
+ * @param[in] num - wskaźnik na upakowany numer.
+ * @return Wartość @p true, jeśli któryś z usuniętych ciągów jest prefiksem
+ * @p num lub mu równy, a @p num nie został od tego czasu przypisany ponownie
+ * (zobacz trieSettle()). Wartość @p false w przeciwnym przypadku.
+ */
+bool trieIsDetached(TrieArena const *arena, uint8_t const *num);
+
+/** @brief Zlicza ciągi zbioru @p set, które leżą w odłączonych poddrzewach.
+ * Liczy ciągi, dla których trieIsDetached() zwraca @p true, przeglądając
+ * mniejszy z przedziałów: ciągów zbioru albo ciągów odłączonych poddrzew
+ * zaczynających się od @p prefix.
+ * @param[in] arena - wskaźnik na arenę drzew.
+ * @param[in] set - wskaźnik na zbiór drzewa odwrotnego lub NULL.
+ * @param[in] prefix - wskaźnik na upakowany numer, od którego mają się
+ *                     zaczynać liczone ciągi, lub NULL, jeśli liczone są
+ *                     wszystkie ciągi zbioru.
+ * @return Liczba ciągów.
+ */
+size_t trieCountDetached(TrieArena const *arena, SortedSet const *set,
+                         uint8_t const *prefix);
+
+/** @brief Sprawdza, czy pewne odłączone poddrzewo czeka na zwolnienie,
+ * przekierowanie dodane wewnątrz niego czeka na dodanie do indeksu lub
+ * trwa odbudowa indeksu albo zbiorów przysłoniętych prefiksów.
+ * Działa jak trieSweep() z zerowym limitem, lecz nie zmienia areny.
+ * @param[in] arena - wskaźnik na arenę drzew.
+ * @return Wartość @p true, jeśli czeka. Wartość @p false w przeciwnym
+ * przypadku.
+ */
+bool trieHasDetached(TrieArena const *arena);
+
+/**
+ * @brief Ustawia wartość węzła @p fwd na ciąg @p target i kojarzy go
+ * z węzłem @p rev drzewa odwrotnego.
+ * Umieszcza ciąg @p source, reprezentujący @p fwd, w zbiorze węzła @p rev,
+ * zachowując jego uporządkowanie. Jeśli @p fwd był skojarzony z innym
+ * węzłem, to usuwa @p source z jego zbioru, a w razie potrzeby również
+ * zbędne węzły drzewa odwrotnego. Oba ciągi przechowywane są w puli areny
+ * jako upakowane numery.
+ * Zakłada poprawność @p source i @p target oraz to, że @p rev kończy ciąg
+ * @p target w drzewie odwrotnym areny.
+ * @param[in,out] arena - wskaźnik na arenę, z której pochodzą węzły drzew.
+ * @param[in,out] fwd - wskaźnik na węzeł drzewa typu @p value.seq.
+ * @param[in,out] rev - wskaźnik na węzeł drzewa typu @p value.sources.
+ * @param[in] source - ciąg znaków kończący się w węźle @p fwd.
+ * @param[in] sourceLength - długość @p source.
+ * @param[in] target - ustawiany ciąg znaków.
+ * @param[in] targetLength - długość @p target.
+ * @return Wartość @p true, jeśli udało się ustawić wartość. Wartość @p
+ * false, jeśli któryś z węzłów ma wartość NULL lub jest niewłaściwego typu,
+ * bądź nie udało się alokować pamięci; wówczas oba węzły pozostają bez zmian.
+ */
+bool trieNodeBind(TrieArena *arena, TrieNode *fwd, TrieNode *rev,
+                  const char *source, size_t sourceLength, const char *target,
+                  size_t targetLength);
 
-/** @brief Dodaje ciąg znaków @p value do listy znajdującej się w węźle @p node.
- * Zakłada poprawność @p value. Jeśli @p node pozwala na przechowywanie list,
- * lecz jej nie zawiera, to funkcja alokuje w nim nową listę @p List.
- * @param[in,out] node - wskaźnik na węzeł w którym modyfikowana jest wartość.
- * @param[in] value - ustawiany ciąg znaków.
- * @param[in] length - długość @p value (nie licząc znaku terminującego).
- * @return Wartość @p true, jeśli wartość została ustawiona. Wartość @p
- * false, jeśli węzeł @p node ma wartość NULL, węzeł jest niewłaściwego
- * typu, bądź nie udało się alokować pamięci.
+/**
+ * Przekierowanie wstawiane hurtowo przez trieBindSorted().
  */
-ListNode *trieAddToList(TrieNode *node, const char *value, size_t length);
+typedef struct TrieRule {
+    const char *source; /**< Przekierowywany prefiks. */
+    size_t sourceLength; /**< Długość @p source. */
+    const char *target; /**< Prefiks docelowy. */
+    size_t targetLength; /**< Długość @p target. */
+} TrieRule;
 
 /**
- * @brief Dodaje do @p trieNode wskaźnik na węzeł listy @p listNode.
- * Zakłada, że @p trieNode jest drzewem typu @p value.seq.
- * @remark Ponieważ dany węzeł listy z założenia należy do pewnego
- * drzewa typu @p value.list, to funkcja ta w rzeczywistości tworzy powiązanie
- * między dwoma węzłami po jednym z drzew różnych typów.
- * @param trieNode - wskaźnik na węzeł drzewa do którego dodawane jest
- * skojarzenie
- * @param listNode - wskaźnik na kojarzony węzeł listy.
- * @return Wartość @p true, jeśli udało się dodać skojarzenie. Wartość @p
- * false, jeśli @p trieNode jest niewłaściwego typu, lub podano pusty
- * wskaźnik.
- */
-bool trieNodeBind(TrieNode *trieNode, ListNode *listNode);
+ * @brief Umieszcza w drzewach przekierowania @p rules.
+ * Działa jak wstawienie ciągów @p source do drzewa @p *fwdsPtr, ciągów
+ * @p target do drzewa @p *revsPtr i wywołanie trieNodeBind() dla każdej
+ * pary, lecz wszystkie alokacje wykonuje przed zmianą któregokolwiek
+ * drzewa: rezerwuje węzły w arenie, a każdy zbioru drzewa odwrotnego
+ * buduje jednokrotnie. Przekierowania wstawiane są w kolejności prefiksów,
+ * czyli w porządku przejścia drzewa w głąb.
+ * Zakłada poprawność wszystkich ciągów, różność ciągów w każdej parze oraz
+ * to, że prefiksy @p source są posortowane rosnąco i parami różne.
+ * @param[in,out] arena - wskaźnik na arenę, z której pochodzą węzły drzew.
+ * @param[in,out] fwdsPtr - podwójny wskaźnik na drzewo typu @p value.seq.
+ * @param[in,out] revsPtr - podwójny wskaźnik na drzewo odwrotne areny.
+ * @param[in] rules - tablica przekierowań.
+ * @param[in] count - liczba przekierowań.
+ * @return Wartość @p true, jeśli udało się wstawić przekierowania. Wartość
+ * @p false, jeśli nie udało się alokować pamięci; wówczas żadne drzewo nie
+ * ulega zmianie.
+ */
+bool trieBindSorted(TrieArena *arena, TrieNode **fwdsPtr, TrieNode **revsPtr,
+                    TrieRule const *rules, size_t count);
+
+/**
+ * @brief Wypisuje przekierowania drzewa @p root w porządku ich prefiksów.
+ * Przechodzi drzewo w głąb, więc wynik spełnia założenia trieBindSorted().
+ * Ciągi zapisywane są w kodowaniu wewnętrznym w jednym bloku pamięci.
+ * Pomija poddrzewa odłączone przez trieRemoveStr().
+ * @param[in] arena - wskaźnik na arenę, z której pochodzą węzły drzewa.
+ * @param[in] root - wskaźnik na korzeń drzewa typu @p value.seq lub NULL.
+ * @param[out] rules - wskaźnik na zmienną, w której zostanie zapisana
+ *                     tablica przekierowań do zwolnienia funkcją @p free.
+ * @param[out] count - wskaźnik na zmienną, w której zostanie zapisana
+ *                     liczba przekierowań.
+ * @param[out] text - wskaźnik na zmienną, w której zostanie zapisany blok
+ *                    ciągów do zwolnienia funkcją @p free.
+ * @return Wartość @p true, jeśli się udało. Wartość @p false, jeśli nie
+ * udało się alokować pamięci.
+ */
+bool trieCollect(TrieArena const *arena, TrieNode *root, TrieRule **rules,
+                 size_t *count, char **text);
 
 /**
  * @brief Usuwa puste liście na ścieżce z @p node do korzenia drzewa do
  * którego należy @p node. Zakłada, że @p node jest dany do usunięcia.
+ * Korzeń drzewa nie jest usuwany. Pierwszy niepusty węzeł na tej ścieżce,
+ * jeśli nie ma wartości i zostało mu jedno dziecko, jest scalany z tym
+ * dzieckiem.
+ * @param arena - wskaźnik na arenę, z której pochodzą węzły drzewa.
  * @param node - wskaźnik na węzeł drzewa od którego usuwane są liście.
  */
-void trieCutLeaves(TrieNode *node);
+void trieCutLeaves(TrieArena *arena, TrieNode *node);
 
 #endif /* __TRIE_H__ */